@@ -416,7 +416,7 @@ int main(int argc, char* argv[])
     // Save complete Solution.
     char* filename = new char[100];
     sprintf(filename, "outputs/tsln_%f.dat", current_time);
-    bool compress = false;   // Gzip compression not used as it only works on Linux.
+    bool compress = false;   // Compression requires Hermes built WITH_ZLIB.
     sln.save(filename, compress);
     info("Solution at time %g saved to file %s.", current_time, filename);
 
@@ -37,7 +37,9 @@ Adapt::Adapt(Hermes::vector<Space *> spaces,
     num_act_elems(-1),
     have_errors(false),
     have_coarse_solutions(false),
-    have_reference_solutions(false)
+    have_reference_solutions(false),
+    num_threads(1),
+    fused_error_eval(false)
 {
   // sanity check
   if (proj_norms.size() > 0 && spaces.size() != proj_norms.size())
@@ -82,7 +84,9 @@ Adapt::Adapt(Space* space, ProjNormType proj_norm) :
     num_act_elems(-1),
     have_errors(false),
     have_coarse_solutions(false),
-    have_reference_solutions(false)
+    have_reference_solutions(false),
+    num_threads(1),
+    fused_error_eval(false)
 {
   spaces.push_back(space);
 
@@ -122,6 +126,48 @@ Adapt::~Adapt()
 
 //// adapt /////////////////////////////////////////////////////////////////////////////////////////
 
+/// Returns true if the adaptivity loop ends at a regular element whose squared error is err_squared.
+/// The arguments are the parameters of Adapt::adapt() and the state of its loop.
+static bool stop_adaptivity(int strat, double thr, double to_be_processed, double errors_squared_sum,
+                            double err_squared, double err0_squared, double processed_error_squared,
+                            double error_squared_threshold)
+{
+  // first refinement strategy:
+  // refine elements until prescribed amount of error is processed
+  // if more elements have similar error refine all to keep the mesh symmetric
+  if ((strat == 0) && (processed_error_squared > sqrt(thr) * errors_squared_sum)
+                   && fabs((err_squared - err0_squared)/err0_squared) > 1e-3) return true;
+
+  // second refinement strategy:
+  // refine all elements whose error is bigger than some portion of maximal error
+  if ((strat == 1) && (err_squared < error_squared_threshold)) return true;
+
+  if ((strat == 2) && (err_squared < thr)) return true;
+
+  if ((strat == 3) &&
+    ( (err_squared < error_squared_threshold) ||
+    ( processed_error_squared > 1.5 * to_be_processed )) ) return true;
+
+  return false;
+}
+
+/// Everything one thread of the multithreaded selection of refinements needs.
+struct SelectionThreadData
+{
+  Adapt* adapt;
+  RefinementSelectors::Selector* selectors[H2D_MAX_COMPONENTS]; ///< The selectors or their copies.
+  Solution* rsln[H2D_MAX_COMPONENTS];                             ///< The reference solutions or their copies.
+  Mesh** meshes;
+  ElementToRefine* refs;  ///< Selected refinements, the index is a position in the regular queue.
+  int* refined;           ///< Results of select_refinement() (0 or 1), -1 if not selected yet.
+  int* next;              ///< The next position in the regular queue to process, shared by all threads.
+  int last;               ///< The end of the processed part of the regular queue.
+  pthread_mutex_t* mutex; ///< Protects 'next'.
+};
+
+/// A maximum number of elements selected in advance per thread.
+static const int H2D_SELECTION_BATCH = 16;
+
 bool Adapt::adapt(Hermes::vector<RefinementSelectors::Selector *> refinement_selectors, double thr, int strat,
             int regularize, double to_be_processed)
 {
@@ -165,6 +211,13 @@ bool Adapt::adapt(Hermes::vector<RefinementSelectors::Selector *> refinement_sel
   int num_not_changed = 0; //a number of element that were not changed
   int num_priority_elem = 0; //a number of elements that were processed using priority queue
 
+  // multithreaded selection: refinements of the elements of the regular queue are selected
+  // in batches in advance, the loop below only takes the results
+  SelectionThreadData* sel_data = NULL;
+  std::vector<ElementToRefine> sel_refs;
+  std::vector<int> sel_refined;
+  bool sel_initialized = false;
+
   bool first_regular_element = true; //true if first regular element was not processed yet
   int inx_regular_element = 0;
   while (inx_regular_element < num_act_elems || !priority_queue.empty())
@@ -201,28 +254,50 @@ bool Adapt::adapt(Hermes::vector<RefinementSelectors::Selector *> refinement_sel
           first_regular_element = false;
         }
 
-        // first refinement strategy:
-        // refine elements until prescribed amount of error is processed
-        // if more elements have similar error refine all to keep the mesh symmetric
-        if ((strat == 0) && (processed_error_squared > sqrt(thr) * errors_squared_sum)
-                         && fabs((err_squared - err0_squared)/err0_squared) > 1e-3) break;
-
-        // second refinement strategy:
-        // refine all elements whose error is bigger than some portion of maximal error
-        if ((strat == 1) && (err_squared < error_squared_threshod)) break;
-
-        if ((strat == 2) && (err_squared < thr)) break;
-
-        if ((strat == 3) &&
-          ( (err_squared < error_squared_threshod) ||
-          ( processed_error_squared > 1.5 * to_be_processed )) ) break;
+        if (stop_adaptivity(strat, thr, to_be_processed, errors_squared_sum, err_squared, err0_squared,
+                            processed_error_squared, error_squared_threshod)) break;
       }
 
       // get refinement suggestion
       ElementToRefine elem_ref(id, comp);
-      int current = this->spaces[comp]->get_element_order(id);
-      // rsln[comp] may be unset if refinement_selectors[comp] == HOnlySelector or POnlySelector
-      bool refined = refinement_selectors[comp]->select_refinement(e, current, rsln[comp], elem_ref);
+      bool refined;
+      if (sel_data != NULL && inx_element >= 0) {
+        if (sel_refined[inx_element] < 0) {
+          // select the following elements the loop reaches if all of them are refined
+          int last = inx_element + 1;
+          double sim_err0_squared = err_squared, sim_processed_error_squared = processed_error_squared + err_squared;
+          while (last < num_act_elems && last - inx_element < H2D_SELECTION_BATCH * num_threads) {
+            double sim_err_squared = errors[regular_queue[last].comp][regular_queue[last].id];
+            if (stop_adaptivity(strat, thr, to_be_processed, errors_squared_sum, sim_err_squared, sim_err0_squared,
+                                sim_processed_error_squared, error_squared_threshod)) break;
+            sim_err0_squared = sim_err_squared;
+            sim_processed_error_squared += sim_err_squared;
+            last++;
+          }
+          select_refinements_parallel(sel_data, inx_element, last);
+        }
+        elem_ref = sel_refs[inx_element];
+        refined = (sel_refined[inx_element] != 0);
+      }
+      else {
+        int current = this->spaces[comp]->get_element_order(id);
+        // rsln[comp] may be unset if refinement_selectors[comp] == HOnlySelector or POnlySelector
+        refined = refinement_selectors[comp]->select_refinement(e, current, rsln[comp], elem_ref);
+
+        // The threads are set up after the first element is selected serially: the selectors
+        // have filled their caches, so their copies for the other threads can take them over.
+        if (num_threads > 1 && !sel_initialized && inx_element >= 0) {
+          sel_initialized = true;
+          if (can_select_in_parallel(meshes, refinement_selectors)) {
+            sel_refs.resize(num_act_elems);
+            sel_refined.resize(num_act_elems, -1);
+            sel_data = init_selection_threads(refinement_selectors, meshes, &sel_refs.front(), &sel_refined.front());
+          }
+          else {
+            verbose("Multithreaded selection of refinements not possible, selecting serially.");
+          }
+        }
+      }
 
       //add to a list of elements that are going to be refined
       if (can_refine_element(mesh, e, refined, elem_ref) ) {
@@ -241,6 +316,9 @@ bool Adapt::adapt(Hermes::vector<RefinementSelectors::Selector *> refinement_sel
     }
   }
 
+  if (sel_data != NULL)
+    free_selection_threads(sel_data);
+
   verbose("Examined elements: %d", num_exam_elem);
   verbose(" Elements taken from priority queue: %d", num_priority_elem);
   verbose(" Ignored elements: %d", num_ignored_elem);
@@ -309,6 +387,130 @@ bool Adapt::adapt(RefinementSelectors::Selector* refinement_selector, double thr
   return adapt(refinement_selectors, thr, strat, regularize, to_be_processed);
 }
 
+void Adapt::set_num_threads(int num_threads)
+{
+  _F_
+  if (num_threads < 1)
+    error("Invalid number of threads (%d) in Adapt::set_num_threads().", num_threads);
+  this->num_threads = num_threads;
+}
+
+/// Returns true if all active elements of the meshes are of the same mode. The quadrature and the
+/// limit tables are shared by all threads and they hold the mode of the current element.
+static bool have_same_mode(Mesh** meshes, int num_meshes)
+{
+  int mode = -1;
+  for (int j = 0; j < num_meshes; j++) {
+    Element* e;
+    for_all_active_elements(e, meshes[j]) {
+      if (mode >= 0 && e->get_mode() != mode)
+        return false;
+      mode = e->get_mode();
+    }
+  }
+  return true;
+}
+
+bool Adapt::can_select_in_parallel(Mesh** meshes, Hermes::vector<RefinementSelectors::Selector *>& refinement_selectors)
+{
+  _F_
+  // Every thread gets a copy of the reference solutions.
+  for (int j = 0; j < this->num; j++)
+    if (rsln[j] != NULL && rsln[j]->get_type() != HERMES_SLN)
+      return false;
+
+  // Every thread but the first one uses copies of the selectors. The copies are created here.
+  for (int j = 0; j < this->num; j++)
+    for (int t = 1; t < num_threads; t++)
+      if (refinement_selectors[j]->get_thread_copy(t) == NULL)
+        return false;
+
+  // The shapesets are shared as well.
+  return have_same_mode(meshes, this->num);
+}
+
+SelectionThreadData* Adapt::init_selection_threads(Hermes::vector<RefinementSelectors::Selector *>& refinement_selectors,
+                                                   Mesh** meshes, ElementToRefine* refs, int* refined)
+{
+  _F_
+  SelectionThreadData* data = new SelectionThreadData[num_threads];
+  for (int t = 0; t < num_threads; t++) {
+    data[t].adapt = this;
+    data[t].meshes = meshes;
+    data[t].refs = refs;
+    data[t].refined = refined;
+    for (int j = 0; j < this->num; j++) {
+      if (t == 0 || rsln[j] == NULL) {
+        data[t].rsln[j] = rsln[j];
+      }
+      else {
+        data[t].rsln[j] = new Solution;
+        data[t].rsln[j]->copy(rsln[j]);
+        data[t].rsln[j]->set_quad_2d(&g_quad_2d_std);
+        data[t].rsln[j]->enable_transform(false);
+      }
+      data[t].selectors[j] = (t == 0) ? refinement_selectors[j] : refinement_selectors[j]->get_thread_copy(t);
+    }
+  }
+  return data;
+}
+
+void Adapt::free_selection_threads(SelectionThreadData* data)
+{
+  _F_
+  for (int t = 1; t < num_threads; t++)
+    for (int j = 0; j < this->num; j++)
+      if (data[t].rsln[j] != rsln[j])
+        delete data[t].rsln[j];
+  delete [] data;
+}
+
+void* Adapt::selection_thread(void* data_ptr)
+{
+  _F_
+  SelectionThreadData* data = (SelectionThreadData*) data_ptr;
+  Adapt* adapt = data->adapt;
+  for (;;) {
+    // elements have very different costs, so they are taken one by one
+    pthread_mutex_lock(data->mutex);
+    int inx = (*data->next)++;
+    pthread_mutex_unlock(data->mutex);
+    if (inx >= data->last)
+      break;
+
+    int id = adapt->regular_queue[inx].id, comp = adapt->regular_queue[inx].comp;
+    Element* e = data->meshes[comp]->get_element(id);
+    ElementToRefine elem_ref(id, comp);
+    int current = adapt->spaces[comp]->get_element_order(id);
+    bool refined = data->selectors[comp]->select_refinement(e, current, data->rsln[comp], elem_ref);
+    data->refs[inx] = elem_ref;
+    data->refined[inx] = refined ? 1 : 0;
+  }
+  return NULL;
+}
+
+void Adapt::select_refinements_parallel(SelectionThreadData* data, int first, int last)
+{
+  _F_
+  pthread_mutex_t selection_mutex;
+  pthread_mutex_init(&selection_mutex, NULL);
+  int next = first;
+
+  pthread_t* threads = new pthread_t[num_threads];
+  for (int t = 0; t < num_threads; t++) {
+    data[t].next = &next;
+    data[t].last = last;
+    data[t].mutex = &selection_mutex;
+    if (pthread_create(&threads[t], NULL, selection_thread, &data[t]) != 0)
+      error("Could not create selection thread %d.", t);
+  }
+  for (int t = 0; t < num_threads; t++)
+    pthread_join(threads[t], NULL);
+  delete [] threads;
+
+  pthread_mutex_destroy(&selection_mutex);
+}
+
 void Adapt::fix_shared_mesh_refinements(Mesh** meshes, Hermes::vector<ElementToRefine>& elems_to_refine,
                                         int** idx, Hermes::vector<RefinementSelectors::Selector *> refinement_selectors) {
   int num_elem_to_proc = elems_to_refine.size();
@@ -677,6 +879,217 @@ double Adapt::eval_error_norm(Adapt::MatrixFormVolError* form,
   return std::abs(res);
 }
 
+/// Everything one thread of the multithreaded error calculation needs, and its sums.
+struct ErrorThreadData
+{
+  Adapt* adapt;
+  int thread_index;
+  int num_threads;
+  Mesh** meshes;                                ///< The meshes of the coarse solutions followed by the reference ones.
+  Solution* sln[H2D_MAX_COMPONENTS];            ///< The coarse solutions or their copies.
+  Solution* rsln[H2D_MAX_COMPONENTS];           ///< The reference solutions or their copies.
+  double* errors[H2D_MAX_COMPONENTS];           ///< Errors of elements, NULL if they are not stored.
+  double norms[H2D_MAX_COMPONENTS];             ///< Squares of norms of components.
+  double errors_components[H2D_MAX_COMPONENTS]; ///< Squares of errors of components.
+  double total_norm, total_error;
+
+  /// Orders of the error forms, the key is the form and the function orders of the two reference solutions.
+  std::map<std::pair<Adapt::MatrixFormVolError*, std::pair<int, int> >, int> order_cache;
+};
+
+/// Number of consecutive traversal states handled by one thread of the error calculation.
+static const int H2D_ERROR_CHUNK = 16;
+
+double Adapt::eval_error_and_norm(Adapt::MatrixFormVolError* form,
+                                  MeshFunction *sln1, MeshFunction *sln2, MeshFunction *rsln1,
+                                  MeshFunction *rsln2, double& norm, ErrorThreadData* data)
+{
+  RefMap *rrv1 = rsln1->get_refmap();
+
+  // determine the integration order, the order of the form is parsed once for every pair of function orders
+  int inc = (rsln1->get_num_components() == 2) ? 1 : 0;
+  std::pair<Adapt::MatrixFormVolError*, std::pair<int, int> > key(form,
+    std::pair<int, int>(rsln1->get_fn_order() + inc, rsln2->get_fn_order() + inc));
+  int form_order;
+  std::map<std::pair<Adapt::MatrixFormVolError*, std::pair<int, int> >, int>::iterator it = data->order_cache.find(key);
+  if (it != data->order_cache.end())
+    form_order = it->second;
+  else {
+    Func<Ord>* ou = init_fn_ord(key.second.first);
+    Func<Ord>* ov = init_fn_ord(key.second.second);
+
+    double fake_wt = 1.0;
+    Geom<Ord>* fake_e = init_geom_ord();
+    Ord o = form->ord(1, &fake_wt, NULL, ou, ov, fake_e, NULL);
+    form_order = o.get_order();
+    data->order_cache[key] = form_order;
+
+    ou->free_ord(); delete ou;
+    ov->free_ord(); delete ov;
+    delete fake_e;
+  }
+  int order = rrv1->get_inv_ref_order();
+  order += form_order;
+  if(static_cast<Solution *>(rsln1)->get_type() == HERMES_EXACT)
+  { limit_order_nowarn(order); }
+  else
+    limit_order(order);
+
+  // eval the form
+  Quad2D* quad = rsln1->get_quad_2d();
+  double3* pt = quad->get_points(order);
+  int np = quad->get_num_points(order);
+
+  // init geometry and jacobian*weights
+  Geom<double>* e = init_geom_vol(rrv1, order);
+  double* jac = rrv1->get_jacobian(order);
+  double* jwt = new double[np];
+  for(int i = 0; i < np; i++)
+    jwt[i] = pt[i][2] * jac[i];
+
+  // the norm, from the values of the reference solutions
+  Func<scalar>* v1 = init_fn(rsln1, order);
+  Func<scalar>* v2 = init_fn(rsln2, order);
+  norm = std::abs(form->value(np, jwt, NULL, v1, v2, e, NULL));
+
+  // the error, the values of the reference solutions are reused
+  Func<scalar>* err1 = init_fn(sln1, order);
+  Func<scalar>* err2 = init_fn(sln2, order);
+  err1->subtract(*v1);
+  err2->subtract(*v2);
+  scalar res = form->value(np, jwt, NULL, err1, err2, e, NULL);
+
+  e->free(); delete e;
+  delete [] jwt;
+  err1->free_fn(); delete err1;
+  err2->free_fn(); delete err2;
+  v1->free_fn(); delete v1;
+  v2->free_fn(); delete v2;
+
+  return std::abs(res);
+}
+
+void Adapt::calc_err_state(Element** ee, ErrorThreadData* data)
+{
+  for (int i = 0; i < num; i++) {
+    for (int j = 0; j < num; j++) {
+      if (error_form[i][j] != NULL) {
+        double err, nrm;
+        if (fused_error_eval)
+          err = eval_error_and_norm(error_form[i][j], data->sln[i], data->sln[j], data->rsln[i], data->rsln[j], nrm, data);
+        else {
+          err = eval_error(error_form[i][j], data->sln[i], data->sln[j], data->rsln[i], data->rsln[j]);
+          nrm = eval_error_norm(error_form[i][j], data->rsln[i], data->rsln[j]);
+        }
+
+        data->norms[i] += nrm;
+        data->total_norm  += nrm;
+        data->total_error += err;
+        data->errors_components[i] += err;
+        if (data->errors[i] != NULL)
+          data->errors[i][ee[i]->id] += err;
+      }
+    }
+  }
+}
+
+bool Adapt::can_calc_err_in_parallel(Mesh** meshes)
+{
+  _F_
+  // Every thread gets a copy of the solutions.
+  for (int i = 0; i < num; i++)
+    if (sln[i]->get_type() != HERMES_SLN || rsln[i]->get_type() != HERMES_SLN)
+      return false;
+
+  return have_same_mode(meshes, 2 * num);
+}
+
+void* Adapt::error_thread(void* data_ptr)
+{
+  _F_
+  ErrorThreadData* data = (ErrorThreadData*) data_ptr;
+  Adapt* adapt = data->adapt;
+  int num = adapt->num;
+
+  // Every thread traverses all states with its own solutions, but evaluates only its share of them.
+  Transformable* tr[2 * H2D_MAX_COMPONENTS];
+  for (int i = 0; i < num; i++) {
+    tr[i] = data->sln[i];
+    tr[i + num] = data->rsln[i];
+  }
+  Traverse trav;
+  trav.begin(2 * num, data->meshes, tr);
+  Element** ee;
+  int state = 0;
+  while ((ee = trav.get_next_state(NULL, NULL)) != NULL) {
+    if ((state++ / H2D_ERROR_CHUNK) % data->num_threads != data->thread_index)
+      continue;
+    adapt->calc_err_state(ee, data);
+  }
+  trav.finish();
+  return NULL;
+}
+
+void Adapt::calc_err_parallel(ErrorThreadData* data0)
+{
+  _F_
+  ErrorThreadData* data = new ErrorThreadData[num_threads];
+  data[0] = *data0;
+  for (int t = 0; t < num_threads; t++) {
+    data[t].thread_index = t;
+    data[t].num_threads = num_threads;
+    if (t == 0)
+      continue;
+    data[t].adapt = this;
+    data[t].meshes = data0->meshes;
+    data[t].total_norm = data[t].total_error = 0.0;
+    data[t].order_cache = data0->order_cache;
+    for (int i = 0; i < num; i++) {
+      data[t].sln[i] = new Solution;
+      data[t].sln[i]->copy(sln[i]);
+      data[t].sln[i]->set_quad_2d(&g_quad_2d_std);
+      data[t].rsln[i] = new Solution;
+      data[t].rsln[i]->copy(rsln[i]);
+      data[t].rsln[i]->set_quad_2d(&g_quad_2d_std);
+      data[t].norms[i] = data[t].errors_components[i] = 0.0;
+      data[t].errors[i] = NULL;
+      if (data0->errors[i] != NULL) {
+        int max = data0->meshes[i]->get_max_element_id();
+        data[t].errors[i] = new double[max];
+        memset(data[t].errors[i], 0, sizeof(double) * max);
+      }
+    }
+  }
+
+  pthread_t* threads = new pthread_t[num_threads];
+  for (int t = 0; t < num_threads; t++)
+    if (pthread_create(&threads[t], NULL, error_thread, &data[t]) != 0)
+      error("Could not create error calculation thread %d.", t);
+  for (int t = 0; t < num_threads; t++)
+    pthread_join(threads[t], NULL);
+  delete [] threads;
+
+  // Add up the sums of the threads.
+  *data0 = data[0];
+  for (int t = 1; t < num_threads; t++) {
+    data0->total_norm += data[t].total_norm;
+    data0->total_error += data[t].total_error;
+    for (int i = 0; i < num; i++) {
+      data0->norms[i] += data[t].norms[i];
+      data0->errors_components[i] += data[t].errors_components[i];
+      if (data[t].errors[i] != NULL) {
+        int max = data0->meshes[i]->get_max_element_id();
+        for (int id = 0; id < max; id++)
+          data0->errors[i][id] += data[t].errors[i][id];
+        delete [] data[t].errors[i];
+      }
+      delete data[t].sln[i];
+      delete data[t].rsln[i];
+    }
+  }
+  delete [] data;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 double Adapt::calc_err_internal(Hermes::vector<Solution *> slns, Hermes::vector<Solution *> rslns,
                                 Hermes::vector<double>* component_errors, bool solutions_for_adapt, unsigned int error_flags)
@@ -727,36 +1140,41 @@ double Adapt::calc_err_internal(Hermes::vector<Solution *> slns, Hermes::vector<
     }
   }
 
-  double total_norm = 0.0;
-  double *norms = new double[num];
-  memset(norms, 0, num * sizeof(double));
-  double *errors_components = new double[num];
-  memset(errors_components, 0, num * sizeof(double));
+  ErrorThreadData data;
+  data.adapt = this;
+  data.thread_index = 0;
+  data.num_threads = 1;
+  data.meshes = meshes;
+  data.total_norm = data.total_error = 0.0;
+  for (i = 0; i < num; i++) {
+    data.sln[i] = sln[i];
+    data.rsln[i] = rsln[i];
+    data.errors[i] = solutions_for_adapt ? this->errors[i] : NULL;
+    data.norms[i] = data.errors_components[i] = 0.0;
+  }
   if(solutions_for_adapt) this->errors_squared_sum = 0.0;
-  double total_error = 0.0;
 
   // Calculate error.
-  Element **ee;
-  trav.begin(2 * num, meshes, tr);
-  while ((ee = trav.get_next_state(NULL, NULL)) != NULL) {
-    for (i = 0; i < num; i++) {
-      for (j = 0; j < num; j++) {
-        if (error_form[i][j] != NULL) {
-          double err, nrm;
-          err = eval_error(error_form[i][j], sln[i], sln[j], rsln[i], rsln[j]);
-          nrm = eval_error_norm(error_form[i][j], rsln[i], rsln[j]);
-
-          norms[i] += nrm;
-          total_norm  += nrm;
-          total_error += err;
-          errors_components[i] += err;
-          if(solutions_for_adapt)
-            this->errors[i][ee[i]->id] += err;
-        }
-      }
+  bool parallel = false;
+  if (num_threads > 1) {
+    parallel = can_calc_err_in_parallel(meshes);
+    if (!parallel) {
+      verbose("Multithreaded calculation of errors not possible, calculating serially.");
     }
   }
-  trav.finish();
+  if (parallel)
+    calc_err_parallel(&data);
+  else {
+    Element **ee;
+    trav.begin(2 * num, meshes, tr);
+    while ((ee = trav.get_next_state(NULL, NULL)) != NULL)
+      calc_err_state(ee, &data);
+    trav.finish();
+  }
+  double total_norm = data.total_norm;
+  double total_error = data.total_error;
+  double* norms = data.norms;
+  double* errors_components = data.errors_components;
 
   // Store the calculation for each solution component separately.
   if(component_errors != NULL) {
@@ -809,8 +1227,6 @@ double Adapt::calc_err_internal(Hermes::vector<Solution *> slns, Hermes::vector<
 
   delete [] meshes;
   delete [] tr;
-  delete [] norms;
-  delete [] errors_components;
 
 
   // Return error value.
@@ -42,6 +42,9 @@
 
 #define H2D_MAX_COMPONENTS 10 ///< A maximum number of components.
 
+struct SelectionThreadData;
+struct ErrorThreadData;
+
 // Constant used by Adapt::calc_eror().
 #define HERMES_TOTAL_ERROR_REL  0x00  ///< A flag which defines interpretation of the total error. \ingroup g_adapt
                                       ///  The total error is divided by the norm and therefore it should be in a range [0, 1].
@@ -250,6 +253,27 @@ public:
   bool adapt(RefinementSelectors::Selector* refinement_selector, double thr, int strat = 0,
             int regularize = -1, double to_be_processed = 0.0);
 
+  /// Sets the number of threads used to calculate errors and to select refinements in adapt(). The default is 1.
+  /** Errors are calculated by threads which traverse the meshes with their own copies of the solutions
+   *  and evaluate a part of the elements each. Their sums are added up at the end, so the errors may
+   *  differ from the ones calculated by one thread in rounding only.
+   *
+   *  Refinements of several elements of the regular queue are selected at once, every thread
+   *  with its own copies of the selectors (see RefinementSelectors::Selector::get_thread_copy())
+   *  and of the reference solutions. The meshes are modified serially afterwards, so the result
+   *  is the same as with one thread. Refinements are selected serially if a selector can not be
+   *  copied, if a reference solution is not a standard solution, or if the meshes contain both
+   *  triangles and quads. The same applies to errors, except for the selectors. */
+  void set_num_threads(int num_threads);
+  int get_num_threads() const { return num_threads; }
+
+  /// Sets whether the error and the norm of an element are evaluated at once. The default is false.
+  /** Both are then integrated with the same order and the values of the reference solutions are
+   *  calculated only once. Integration orders of the error forms are cached for each combination of
+   *  orders of the reference solutions. The result is the same. The fused evaluation bypasses
+   *  eval_error() and eval_error_norm(), so it must not be switched on in a class which overrides them. */
+  void set_fused_error_evaluation(bool fused) { fused_error_eval = fused; }
+
   /// Unrefines the elements with the smallest error.
   /** \note This method is provided just for backward compatibility reasons. Currently, it is not used by the library.
    *  \param[in] thr A stop condition relative error threshold. */
@@ -342,6 +366,56 @@ protected: // spaces & solutions
 
   double error_time;                    ///< Time needed to calculate the error.
 
+protected: //multithreaded selection of refinements
+  int num_threads; ///< A number of threads used to select refinements, see set_num_threads().
+
+  /// Returns true if refinements of elements of the meshes can be selected by several threads at once.
+  bool can_select_in_parallel(Mesh** meshes, Hermes::vector<RefinementSelectors::Selector *>& refinement_selectors);
+
+  /// Prepares the data of the threads: the copies of the reference solutions and of the selectors.
+  /** \param[in] refs An array of Adapt::num_act_elems items which receives the selected refinements.
+   *  \param[in] refined An array of Adapt::num_act_elems items which receives the results of selection, initialized to -1.
+   *  \return An array of Adapt::num_threads items. */
+  SelectionThreadData* init_selection_threads(Hermes::vector<RefinementSelectors::Selector *>& refinement_selectors,
+                                              Mesh** meshes, ElementToRefine* refs, int* refined);
+
+  /// Deletes the data returned by init_selection_threads().
+  void free_selection_threads(SelectionThreadData* data);
+
+  /// Selects refinements of the elements Adapt::regular_queue[first], ..., Adapt::regular_queue[last-1] using all threads.
+  /** \param[in] data The data returned by init_selection_threads(). */
+  void select_refinements_parallel(SelectionThreadData* data, int first, int last);
+
+  /// Thread function of the multithreaded selection, the argument is SelectionThreadData.
+  static void* selection_thread(void* data);
+
+protected: //multithreaded error calculation
+  bool fused_error_eval; ///< True if the error and the norm are evaluated at once, see set_fused_error_evaluation().
+
+  /// Returns true if the errors of the solutions can be calculated by several threads at once.
+  bool can_calc_err_in_parallel(Mesh** meshes);
+
+  /// Adds the errors and the norms of all pairs of components on the current traversal state to the sums of a thread.
+  /** \param[in] ee The elements of the state, as returned by Traverse::get_next_state().
+   *  \param[in] data The solutions of the thread and its sums. */
+  void calc_err_state(Element** ee, ErrorThreadData* data);
+
+  /// Evaluates both the square of an absolute error and the square of a norm of an active element.
+  /** The same as eval_error() and eval_error_norm() together, see set_fused_error_evaluation().
+   *  \param[out] norm The square of the norm.
+   *  \param[in] data The thread whose cache of integration orders is used.
+   *  \return The square of the absolute error. */
+  double eval_error_and_norm(Adapt::MatrixFormVolError* form, MeshFunction *sln1, MeshFunction *sln2,
+                             MeshFunction *rsln1, MeshFunction *rsln2, double& norm, ErrorThreadData* data);
+
+  /// Calculates the errors of all states of the traversal using all threads.
+  /** \param[in] data The data of the first thread, which uses the solutions Adapt::sln and Adapt::rsln.
+   *  The other threads use copies of them. Their sums are added to the first one at the end. */
+  void calc_err_parallel(ErrorThreadData* data);
+
+  /// Thread function of the multithreaded error calculation, the argument is ErrorThreadData.
+  static void* error_thread(void* data);
+
 protected: //forms and error evaluation
   static const unsigned char HERMES_TOTAL_ERROR_MASK = 0x0F;    ///< A mask which masks-out total error type. Used by Adapt::calc_err_internal(). \internal
   static const unsigned char HERMES_ELEMENT_ERROR_MASK = 0xF0;  ///< A mask which masks-out element error type. Used by Adapt::calc_err_internal(). \internal
@@ -254,7 +254,7 @@ double KellyTypeAdapt::calc_err_internal(Hermes::vector<Solution *> slns,
             }
             else
             {
-              NeighborSearch *ns = new NeighborSearch(ee[i], stage.meshes[i]);
+              NeighborSearch *ns = new NeighborSearch(ee[i], stage.meshes[i], dp.get_neighbor_table(stage.meshes[i]));
               ns->original_central_el_transform = stage.fns[i]->get_transform();
               ns->set_active_edge(isurf);
               ns->clear_initial_sub_idx();
@@ -0,0 +1,67 @@
+// This file is part of Hermes2D.
+//
+// Hermes2D is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "arena.h"
+
+Arena::Arena(size_t block_size) : current(-1), used(0), block_size(block_size), peak(0)
+{
+}
+
+Arena::~Arena()
+{
+  free();
+}
+
+void Arena::free()
+{
+  for (unsigned int i = 0; i < blocks.size(); i++)
+    ::free(blocks[i].data);
+  blocks.clear();
+  reset();
+}
+
+void Arena::release(const Mark& mark)
+{
+  current = mark.block;
+  used = mark.used;
+}
+
+void Arena::next_block(size_t size)
+{
+  size_t start = used_total();
+  unsigned int next = current + 1;
+
+  // Reuse the next block if it is large enough, otherwise insert a new one in front of it.
+  if (next >= blocks.size() || blocks[next].size < size)
+  {
+    Block block;
+    block.size = std::max(block_size, size);
+    block.data = (char*) malloc(block.size);
+    if (block.data == NULL) error("Could not allocate an arena block of %lu bytes.", (unsigned long) block.size);
+    blocks.insert(blocks.begin() + next, block);
+  }
+
+  current = next;
+  used = 0;
+  blocks[current].start = start;
+}
+
+size_t Arena::get_capacity() const
+{
+  size_t capacity = 0;
+  for (unsigned int i = 0; i < blocks.size(); i++)
+    capacity += blocks[i].size;
+  return capacity;
+}
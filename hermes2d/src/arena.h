@@ -0,0 +1,118 @@
+// This file is part of Hermes2D.
+//
+// Hermes2D is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef __H2D_ARENA_H
+#define __H2D_ARENA_H
+
+#include "h2d_common.h"
+#include <new>
+
+/// Default size of one arena block (in bytes).
+#define H2D_ARENA_BLOCK_SIZE  (64 * 1024)
+
+/// Alignment of all arena allocations (in bytes).
+#define H2D_ARENA_ALIGNMENT   16
+
+
+/// Arena is a bump allocator for short-lived temporary data, typically everything
+/// the assembling allocates for one traversal state. Memory is taken from large blocks
+/// by moving a pointer; it is never returned piece by piece, but all at once by reset(),
+/// or back to a mark obtained by get_mark(). The blocks themselves are kept for reuse,
+/// so after the first few states the arena does not call malloc at all.
+///
+/// Destructors of objects created in the arena are never called, therefore only objects
+/// which do not own other memory may be placed there (Func, Geom and ExtData objects whose
+/// arrays are in the arena as well, plain arrays). Such objects must not be freed with
+/// free_fn() / free() / delete.
+///
+class HERMES_API Arena
+{
+public:
+  Arena(size_t block_size = H2D_ARENA_BLOCK_SIZE);
+  ~Arena();
+
+  /// Returns 'size' bytes of uninitialized memory aligned to H2D_ARENA_ALIGNMENT.
+  void* allocate(size_t size)
+  {
+    size = (size + H2D_ARENA_ALIGNMENT - 1) & ~(size_t) (H2D_ARENA_ALIGNMENT - 1);
+    if (current < 0 || used + size > blocks[current].size)
+      next_block(size);
+    void* ptr = blocks[current].data + used;
+    used += size;
+    if (used_total() > peak) peak = used_total();
+    return ptr;
+  }
+
+  /// Returns 'size' bytes aligned to 'alignment', which has to be a power of two
+  /// not smaller than H2D_ARENA_ALIGNMENT.
+  void* allocate(size_t size, size_t alignment)
+  {
+    size_t ptr = (size_t) allocate(size + alignment - H2D_ARENA_ALIGNMENT);
+    return (void*) ((ptr + alignment - 1) & ~(alignment - 1));
+  }
+
+  /// Returns an uninitialized array of n items of type T.
+  template<typename T>
+  T* alloc_array(size_t n) { return (T*) allocate(n * sizeof(T)); }
+
+  /// Position in the arena. Everything allocated after get_mark() is released
+  /// by release() with the returned mark.
+  struct Mark
+  {
+    int block;
+    size_t used;
+  };
+
+  Mark get_mark() const { Mark mark = { current, used }; return mark; }
+  void release(const Mark& mark);
+
+  /// Releases all allocations. The blocks are kept.
+  void reset() { current = -1; used = 0; }
+
+  /// Frees the blocks as well.
+  void free();
+
+  /// Statistics: bytes allocated since the last reset, the maximum of that,
+  /// and the total size of the blocks.
+  size_t get_num_bytes() const { return used_total(); }
+  size_t get_peak_bytes() const { return peak; }
+  size_t get_capacity() const;
+
+protected:
+  struct Block
+  {
+    char* data;
+    size_t size;
+    size_t start;   ///< Number of bytes in all blocks preceding this one.
+  };
+
+  void next_block(size_t size);
+  size_t used_total() const { return (current < 0) ? 0 : blocks[current].start + used; }
+
+  std::vector<Block> blocks;
+  int current;          ///< Index of the block allocations are taken from, -1 if none.
+  size_t used;          ///< Bytes used in the current block.
+  size_t block_size;
+  size_t peak;
+};
+
+/// Allocates an array of n items in the arena, or on the heap if the arena is NULL.
+template<typename T>
+inline T* new_array(Arena* arena, int n)
+{
+  return (arena != NULL) ? arena->alloc_array<T>(n) : new T[n];
+}
+
+#endif
@@ -15,6 +15,8 @@
 
 #include "h2d_common.h"
 #include "integrals/integrals_h1.h"
+#include "spline.h"
+#include "weakform_library/h1.h"
 #include "quadrature/limit_order.h"
 #include "discrete_problem.h"
 #include "mesh/traverse.h"
@@ -22,6 +24,7 @@
 #include "shapeset/precalc.h"
 #include "../../hermes_common/matrix.h"
 #include "../../hermes_common/solver/umfpack_solver.h"
+#include "../../hermes_common/solver/ldl.h"
 #include "mesh/refmap.h"
 #include "function/solution.h"
 #include "config.h"
@@ -45,6 +48,62 @@ DiscreteProblem::DiscreteProblem(WeakForm* wf, Space* space, bool is_linear)
   init();
 }
 
+DiscreteProblem::DiscreteProblem(DiscreteProblem* parent)
+   : wf(parent->wf), is_linear(parent->is_linear), wf_seq(-1), spaces(parent->spaces)
+{
+  _F_
+  sp_seq = new int[wf->get_neq()];
+  memset(sp_seq, -1, sizeof(int) * wf->get_neq());
+
+  // Workers never create matrices.
+  sparsity_pattern = NULL;
+  pattern_sp_seq = NULL;
+  pattern_wf_seq = -1;
+
+  matrix_buffer = NULL;
+  matrix_buffer_dim = 0;
+  have_spaces = true;
+  have_matrix = false;
+  values_changed = true;
+  struct_changed = true;
+
+  // Own master precalc shapesets, the tables of the parent ones must not be shared.
+  pss = new PrecalcShapeset*[wf->get_neq()];
+  num_user_pss = 0;
+  for (unsigned int i = 0; i < wf->get_neq(); i++) {
+    pss[i] = new PrecalcShapeset(spaces[i]->get_shapeset());
+    num_user_pss++;
+  }
+
+  // The dofs are already assigned by the parent.
+  ndof = parent->ndof;
+  element_markers_conversion = parent->element_markers_conversion;
+  boundary_markers_conversion = parent->boundary_markers_conversion;
+  is_fvm = parent->is_fvm;
+  vector_valued_forms = parent->vector_valued_forms;
+  geom_ord = parent->geom_ord;
+
+  // Stages with DG forms are never assembled in parallel.
+  DG_matrix_forms_present = false;
+  DG_vector_forms_present = false;
+
+  num_threads = 1;
+  assembling_worker = true;
+
+  // The result of a multithreaded apply() is allocated by assemble_parallel().
+  apply_x = parent->apply_x;
+  apply_y = NULL;
+
+  // The scatter maps of the parent are only read.
+  precomputed_scatter = parent->precomputed_scatter;
+  scatter_map = parent->scatter_map;
+
+  // Start with the orders the parent already knows.
+  order_cache = parent->order_cache;
+  order_cache_wf_seq = parent->order_cache_wf_seq;
+  order_cache_queries = order_cache_hits = 0;
+}
+
 void DiscreteProblem::init()
 {
   _F_
@@ -60,6 +119,14 @@ void DiscreteProblem::init()
   sp_seq = new int[wf->get_neq()];
   memset(sp_seq, -1, sizeof(int) * wf->get_neq());
 
+  // No sparsity pattern yet.
+  sparsity_pattern = NULL;
+  pattern_sp_seq = new int[wf->get_neq()];
+  memset(pattern_sp_seq, -1, sizeof(int) * wf->get_neq());
+  pattern_wf_seq = -1;
+  precomputed_scatter = false;
+  scatter_map = NULL;
+
   // Matrix related settings.
   matrix_buffer = NULL;
   matrix_buffer_dim = 0;
@@ -96,6 +163,16 @@ void DiscreteProblem::init()
 
   vector_valued_forms = false;
 
+  // Serial assembling by default.
+  num_threads = 1;
+  assembling_worker = false;
+
+  apply_x = NULL;
+  apply_y = NULL;
+
+  order_cache_wf_seq = -1;
+  order_cache_queries = order_cache_hits = 0;
+
   Geom<Ord> *tmp = init_geom_ord();
   geom_ord = *tmp;
   delete tmp;
@@ -106,11 +183,20 @@ DiscreteProblem::~DiscreteProblem()
   _F_
   free();
   if (sp_seq != NULL) delete [] sp_seq;
+  if (sparsity_pattern != NULL) delete sparsity_pattern;
+  if (pattern_sp_seq != NULL) delete [] pattern_sp_seq;
+  if (scatter_map != NULL && !assembling_worker) delete scatter_map;
   if (pss != NULL) {
     for(int i = 0; i < num_user_pss; i++)
       delete pss[i];
     delete [] pss;
   }
+  for(unsigned int i = 0; i < state_al.size(); i++)
+    delete state_al[i];
+  for(std::map<Mesh*, NeighborTable*>::iterator it = neighbor_tables.begin(); it != neighbor_tables.end(); it++)
+    delete it->second;
+  for(std::map<MeshFunction*, MeshFunction*>::iterator it = ext_copies.begin(); it != ext_copies.end(); it++)
+    delete it->second;
 }
 
 void DiscreteProblem::free()
@@ -166,12 +252,284 @@ bool DiscreteProblem::is_up_to_date()
 }
 
 //// matrix creation /////////////////////////////////////////////////////////
+bool DiscreteProblem::is_sparsity_pattern_up_to_date(std::vector<bool>& pattern_blocks)
+{
+  _F_
+  if (sparsity_pattern == NULL || pattern_wf_seq != wf->get_seq() || pattern_blocks != this->pattern_blocks)
+    return false;
+  for (unsigned int i = 0; i < wf->get_neq(); i++)
+    if (spaces[i]->get_seq() != pattern_sp_seq[i])
+      return false;
+  return true;
+}
+
+void DiscreteProblem::create_sparsity_pattern(bool** blocks, bool force_diagonal_blocks, Table* block_weights,
+                                              bool is_DG, std::vector<bool>& pattern_blocks)
+{
+  _F_
+  if (sparsity_pattern == NULL)
+    sparsity_pattern = new SparsityPattern;
+  sparsity_pattern->prealloc(get_num_dofs());
+
+  // The positions in the old pattern are no longer valid.
+  if (scatter_map != NULL) {
+    delete scatter_map;
+    scatter_map = NULL;
+  }
+
+  AsmList* al = new AsmList[wf->get_neq()];
+  // Assembly list of a DG neighbor.
+  AsmList neighbor_al;
+  Mesh** meshes = new Mesh*[wf->get_neq()];
+
+  // Init multi-mesh traversal.
+  for (unsigned int i = 0; i < wf->get_neq(); i++) meshes[i] = spaces[i]->get_mesh();
+
+  Traverse trav;
+  trav.begin(wf->get_neq(), meshes);
+
+  // Loop through all elements.
+  Element **e;
+  while ((e = trav.get_next_state(NULL, NULL)) != NULL) {
+    // Obtain assembly lists for the element at all spaces.
+    for (unsigned int i = 0; i < wf->get_neq(); i++) {
+      // TODO: do not get the assembly list again if the element was not changed.
+      if (e[i] != NULL) spaces[i]->get_element_assembly_list(e[i], &(al[i]));
+    }
+
+    if(is_DG) {
+      // Number of edges (= number of vertices).
+      int num_edges = e[0]->get_num_surf();
+
+      // Allocation an array of arrays of neighboring elements for every mesh x edge.
+      // The arrays only live for this state, they are taken from the state arena.
+      Element **** neighbor_elems_arrays = state_arena.alloc_array<Element ***>(wf->get_neq());
+      for(unsigned int i = 0; i < wf->get_neq(); i++)
+        neighbor_elems_arrays[i] = state_arena.alloc_array<Element **>(num_edges);
+
+      // The same, only for number of elements
+      int ** neighbor_elems_counts = state_arena.alloc_array<int *>(wf->get_neq());
+      for(unsigned int i = 0; i < wf->get_neq(); i++)
+        neighbor_elems_counts[i] = state_arena.alloc_array<int>(num_edges);
+
+      // Get the neighbors (there are none across a boundary edge).
+      for(unsigned int el = 0; el < wf->get_neq(); el++) {
+        NeighborTable* table = get_neighbor_table(meshes[el]);
+        for(int ed = 0; ed < num_edges; ed++) {
+          neighbor_elems_counts[el][ed] = table->get_num_neighbors(e[el], ed);
+          neighbor_elems_arrays[el][ed] = state_arena.alloc_array<Element *>(neighbor_elems_counts[el][ed]);
+          for(int neigh = 0; neigh < neighbor_elems_counts[el][ed]; neigh++)
+            neighbor_elems_arrays[el][ed][neigh] = table->get_neighbor(e[el], ed, neigh);
+        }
+      }
+
+      // Pre-add into the stiffness matrix.
+      for (unsigned int m = 0; m < wf->get_neq(); m++) {
+        for(unsigned int el = 0; el < wf->get_neq(); el++) {
+
+          // Do not include blocks with zero weight except if
+          // (force_diagonal_blocks == true && this is a diagonal block).
+          bool is_diagonal_block = (m == el);
+          if (is_diagonal_block == false || force_diagonal_blocks == false) {
+            if (block_weights != NULL) {
+              if (fabs(block_weights->get_A(m, el)) < 1e-12) continue;
+            }
+          }
+
+          for(int ed = 0; ed < num_edges; ed++) {
+            for(int neigh = 0; neigh < neighbor_elems_counts[el][ed]; neigh++) {
+              if ((blocks[m][el] || blocks[el][m]) && e[m] != NULL)  {
+                AsmList *am = &(al[m]);
+                AsmList *an = &neighbor_al;
+                spaces[el]->get_element_assembly_list(neighbor_elems_arrays[el][ed][neigh], an);
+
+                // pretend assembling of the element stiffness matrix
+                // register nonzero elements
+                for (unsigned int i = 0; i < am->cnt; i++) {
+                  if (am->dof[i] >= 0) {
+                    for (unsigned int j = 0; j < an->cnt; j++) {
+                      if (an->dof[j] >= 0) {
+                        if(blocks[m][el]) sparsity_pattern->pre_add_ij(am->dof[i], an->dof[j]);
+                        if(blocks[el][m]) sparsity_pattern->pre_add_ij(an->dof[j], am->dof[i]);
+                      }
+                    }
+                  }
+                }
+              }
+            }
+          }
+        }
+      }
+
+      // Deallocation of the arrays of neighboring elements and their numbers.
+      state_arena.reset();
+    }
+
+    // Go through all equation-blocks of the local stiffness matrix.
+    for (unsigned int m = 0; m < wf->get_neq(); m++) {
+      for (unsigned int n = 0; n < wf->get_neq(); n++) {
+
+        // Do not include blocks with zero weight except if
+        // (force_diagonal_blocks == true && this is a diagonal block).
+        bool is_diagonal_block = (m == n);
+        if (is_diagonal_block == false || force_diagonal_blocks == false) {
+          if (block_weights != NULL) {
+            if (fabs(block_weights->get_A(m, n)) < 1e-12) continue;
+          }
+        }
+
+        if (blocks[m][n] && e[m] != NULL && e[n] != NULL) {
+          AsmList *am = &(al[m]);
+          AsmList *an = &(al[n]);
+
+          // Pretend assembling of the element stiffness matrix.
+          for (unsigned int i = 0; i < am->cnt; i++) {
+            if (am->dof[i] >= 0) {
+              for (unsigned int j = 0; j < an->cnt; j++) {
+                if (an->dof[j] >= 0) {
+                  sparsity_pattern->pre_add_ij(am->dof[i], an->dof[j]);
+                }
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+
+  trav.finish();
+
+  delete [] al;
+  delete [] meshes;
+
+  sparsity_pattern->finish();
+
+  // Remember what the pattern was created for.
+  this->pattern_blocks = pattern_blocks;
+  for (unsigned int i = 0; i < wf->get_neq(); i++)
+    pattern_sp_seq[i] = spaces[i]->get_seq();
+  pattern_wf_seq = wf->get_seq();
+}
+
+void DiscreteProblem::create_scatter_map(bool** blocks, Table* block_weights)
+{
+  _F_
+  unsigned int neq = wf->get_neq();
+  scatter_map = new ScatterMap;
+
+  // Blocks with local matrices of volume and surface forms (a block with zero weight
+  // is not assembled at all).
+  std::vector<bool> vol_blocks(neq * neq, false), surf_blocks(neq * neq, false);
+  for (unsigned int i = 0; i < wf->mfvol.size(); i++) {
+    WeakForm::MatrixFormVol* mfv = wf->mfvol[i];
+    vol_blocks[mfv->i * neq + mfv->j] = true;
+    if (mfv->i != mfv->j && mfv->sym != 0)
+      vol_blocks[mfv->j * neq + mfv->i] = true;
+  }
+  bool have_surf = false;
+  for (unsigned int i = 0; i < wf->mfsurf.size(); i++)
+    if (wf->mfsurf[i]->area != H2D_DG_INNER_EDGE) {
+      surf_blocks[wf->mfsurf[i]->i * neq + wf->mfsurf[i]->j] = true;
+      have_surf = true;
+    }
+  for (unsigned int m = 0; m < neq; m++)
+    for (unsigned int n = 0; n < neq; n++)
+      if (!blocks[m][n] || (block_weights != NULL && fabs(block_weights->get_A(m, n)) < 1e-12))
+        vol_blocks[m * neq + n] = surf_blocks[m * neq + n] = false;
+
+  AsmList* al = new AsmList[neq];
+  Mesh** meshes = new Mesh*[neq];
+  for (unsigned int i = 0; i < neq; i++) meshes[i] = spaces[i]->get_mesh();
+
+  bool bnd[4];
+  SurfPos surf_pos[4];
+  Traverse trav;
+  trav.begin(neq, meshes);
+
+  Element **e;
+  while ((e = trav.get_next_state(bnd, surf_pos)) != NULL) {
+    Element* e0 = NULL;
+    for (unsigned int i = 0; i < neq; i++) {
+      if (e[i] == NULL) continue;
+      spaces[i]->get_element_assembly_list(e[i], &(al[i]));
+      if (e0 == NULL) e0 = e[i];
+    }
+
+    for (unsigned int m = 0; m < neq; m++)
+      for (unsigned int n = 0; n < neq; n++)
+        if (vol_blocks[m * neq + n] && e[m] != NULL && e[n] != NULL) {
+          ScatterKey key = { (int) (m * neq + n), e[m]->id, e[n]->id, -1 };
+          add_scatter_positions(key, &(al[m]), &(al[n]));
+        }
+
+    if (!have_surf) continue;
+    for (int isurf = 0; isurf < e0->get_num_surf(); isurf++) {
+      if (!bnd[isurf]) continue;
+      for (unsigned int i = 0; i < neq; i++)
+        if (e[i] != NULL) spaces[i]->get_boundary_assembly_list(e[i], isurf, &(al[i]));
+      for (unsigned int m = 0; m < neq; m++)
+        for (unsigned int n = 0; n < neq; n++)
+          if (surf_blocks[m * neq + n] && e[m] != NULL && e[n] != NULL) {
+            ScatterKey key = { (int) (m * neq + n), e[m]->id, e[n]->id, isurf };
+            add_scatter_positions(key, &(al[m]), &(al[n]));
+          }
+    }
+  }
+  trav.finish();
+
+  delete [] al;
+  delete [] meshes;
+
+  verbose("Scatter maps of %d local matrices, %d entries.", (int) scatter_map->offsets.size(),
+          (int) scatter_map->positions.size());
+}
+
+void DiscreteProblem::add_scatter_positions(const ScatterKey& key, AsmList* am, AsmList* an)
+{
+  _F_
+  // In multi-mesh assembling, the same pair of elements may be met in several states.
+  if (!scatter_map->offsets.insert(std::make_pair(key, scatter_map->positions.size())).second)
+    return;
+
+  int* Ap = sparsity_pattern->get_Ap();
+  int* Ai = sparsity_pattern->get_Ai();
+  for (unsigned int i = 0; i < am->cnt; i++)
+    for (unsigned int j = 0; j < an->cnt; j++) {
+      int pos = -1;
+      int row = am->dof[i], col = an->dof[j];
+      if (row >= 0 && col >= 0) {
+        int* found = std::lower_bound(Ai + Ap[col], Ai + Ap[col + 1], row);
+        if (found != Ai + Ap[col + 1] && *found == row)
+          pos = found - Ai;
+      }
+      scatter_map->positions.push_back(pos);
+    }
+}
+
+void DiscreteProblem::insert_local_matrix(SparseMatrix* mat, int m, int n, int surf, scalar** local_matrix,
+                                          AsmList* am, AsmList* an)
+{
+  _F_
+  if (scatter_map != NULL && mat->has_pattern_positions()) {
+    ScatterKey key = { (int) (m * wf->get_neq() + n), state_elems[m]->id, state_elems[n]->id, surf };
+    std::map<ScatterKey, size_t>::const_iterator it = scatter_map->offsets.find(key);
+    if (it != scatter_map->offsets.end()) {
+      mat->add_at_positions(am->cnt, an->cnt, local_matrix, &scatter_map->positions[it->second]);
+      return;
+    }
+  }
+  mat->add(am->cnt, an->cnt, local_matrix, am->dof, an->dof);
+}
+
 void DiscreteProblem::create_sparse_structure(SparseMatrix* mat, Vector* rhs, 
                       bool force_diagonal_blocks, Table* block_weights)
 {
   _F_
 
-  if (is_up_to_date())
+  // A matrix or vector that was not allocated for the current structure (e.g. a new one
+  // passed to assemble()) has to be allocated below.
+  unsigned int size = get_num_dofs();
+  if (is_up_to_date() && (mat == NULL || mat->get_size() == size) && (rhs == NULL || rhs->length() == size))
   {
     if (mat != NULL)
     {
@@ -218,152 +576,31 @@ void DiscreteProblem::create_sparse_structure(SparseMatrix* mat, Vector* rhs,
     // Spaces have changed: create the matrix from scratch.
     have_matrix = true;
     mat->free();
-    mat->prealloc(ndof);
 
-    AsmList* al = new AsmList[wf->get_neq()];
-    Mesh** meshes = new Mesh*[wf->get_neq()];
     bool **blocks = wf->get_blocks(force_diagonal_blocks);
 
-    // Init multi-mesh traversal.
-    for (unsigned int i = 0; i < wf->get_neq(); i++) meshes[i] = spaces[i]->get_mesh();
-
-    Traverse trav;
-    trav.begin(wf->get_neq(), meshes);
-
-    // Loop through all elements.
-    Element **e;
-    while ((e = trav.get_next_state(NULL, NULL)) != NULL) {
-      // Obtain assembly lists for the element at all spaces.
-      for (unsigned int i = 0; i < wf->get_neq(); i++) {
-        // TODO: do not get the assembly list again if the element was not changed.
-        if (e[i] != NULL) spaces[i]->get_element_assembly_list(e[i], &(al[i]));
-      }
-
-      if(is_DG) {
-        // Number of edges (= number of vertices).
-        int num_edges = e[0]->get_num_surf();
-
-        // Allocation an array of arrays of neighboring elements for every mesh x edge.
-        Element **** neighbor_elems_arrays = new Element *** [wf->get_neq()];
-        for(unsigned int i = 0; i < wf->get_neq(); i++)
-          neighbor_elems_arrays[i] = new Element ** [num_edges];
-
-        // The same, only for number of elements
-        int ** neighbor_elems_counts = new int * [wf->get_neq()];
-        for(unsigned int i = 0; i < wf->get_neq(); i++)
-          neighbor_elems_counts[i] = new int [num_edges];
-
-        // Get the neighbors.
-        for(unsigned int el = 0; el < wf->get_neq(); el++) {
-          NeighborSearch ns(e[el], meshes[el]);
-
-          // Ignoring errors (and doing nothing) in case the edge is a boundary one.
-          ns.set_ignore_errors(true);
-
-          for(int ed = 0; ed < num_edges; ed++) {
-            ns.set_active_edge(ed);
-            std::vector<Element *> *neighbors = ns.get_neighbors();
-
-            neighbor_elems_counts[el][ed] = ns.get_num_neighbors();
-            neighbor_elems_arrays[el][ed] = new Element * [neighbor_elems_counts[el][ed]];
-            for(int neigh = 0; neigh < neighbor_elems_counts[el][ed]; neigh++)
-              neighbor_elems_arrays[el][ed][neigh] = (*neighbors)[neigh];
-          }
-        }
-
-        // Pre-add into the stiffness matrix.
-        for (unsigned int m = 0; m < wf->get_neq(); m++) {
-          for(unsigned int el = 0; el < wf->get_neq(); el++) {
-
-            // Do not include blocks with zero weight except if
-            // (force_diagonal_blocks == true && this is a diagonal block).
-            bool is_diagonal_block = (m == el);
-            if (is_diagonal_block == false || force_diagonal_blocks == false) {
-              if (block_weights != NULL) {
-                if (fabs(block_weights->get_A(m, el)) < 1e-12) continue;
-              }
-            }
-
-            for(int ed = 0; ed < num_edges; ed++) {
-              for(int neigh = 0; neigh < neighbor_elems_counts[el][ed]; neigh++) {
-                if ((blocks[m][el] || blocks[el][m]) && e[m] != NULL)  {
-                  AsmList *am = &(al[m]);
-                  AsmList *an = new AsmList;
-                  spaces[el]->get_element_assembly_list(neighbor_elems_arrays[el][ed][neigh], an);
-
-                  // pretend assembling of the element stiffness matrix
-                  // register nonzero elements
-                  for (unsigned int i = 0; i < am->cnt; i++) {
-                    if (am->dof[i] >= 0) {
-                      for (unsigned int j = 0; j < an->cnt; j++) {
-                        if (an->dof[j] >= 0) {
-                          if(blocks[m][el]) mat->pre_add_ij(am->dof[i], an->dof[j]);
-                          if(blocks[el][m]) mat->pre_add_ij(an->dof[j], am->dof[i]);
-                        }
-                      }
-                    }
-                  }
-                  delete an;
-                }
-              }
-            }
-          }
-        }
-
-        // Deallocation an array of arrays of neighboring elements 
-        // for every mesh x edge.
-        for(unsigned int el = 0; el < wf->get_neq(); el++) {
-          for(int ed = 0; ed < num_edges; ed++)
-            delete [] neighbor_elems_arrays[el][ed];
-          delete [] neighbor_elems_arrays[el];
-        }
-        delete [] neighbor_elems_arrays;
-
-        // The same, only for number of elements.
-        for(unsigned int el = 0; el < wf->get_neq(); el++)
-          delete [] neighbor_elems_counts[el];
-        delete [] neighbor_elems_counts;
-      }
-
-      // Go through all equation-blocks of the local stiffness matrix.
-      for (unsigned int m = 0; m < wf->get_neq(); m++) {
-        for (unsigned int n = 0; n < wf->get_neq(); n++) {
-
-          // Do not include blocks with zero weight except if
-          // (force_diagonal_blocks == true && this is a diagonal block).
-          bool is_diagonal_block = (m == n);
-          if (is_diagonal_block == false || force_diagonal_blocks == false) {
-            if (block_weights != NULL) {
-              if (fabs(block_weights->get_A(m, n)) < 1e-12) continue;
-            }
-          }
-
-          if (blocks[m][n] && e[m] != NULL && e[n] != NULL) {
-            AsmList *am = &(al[m]);
-            AsmList *an = &(al[n]);
-
-            // Pretend assembling of the element stiffness matrix.
-            for (unsigned int i = 0; i < am->cnt; i++) {
-              if (am->dof[i] >= 0) {
-                for (unsigned int j = 0; j < an->cnt; j++) {
-                  if (an->dof[j] >= 0) {
-                    mat->pre_add_ij(am->dof[i], an->dof[j]);
-                  }
-                }
-              }
-            }
-          }
-        }
+    // The nonzero structure only depends on the spaces and on the matrix blocks
+    // present. If neither changed, the stored pattern is just copied into the matrix.
+    std::vector<bool> pattern_blocks;
+    for (unsigned int m = 0; m < wf->get_neq(); m++)
+      for (unsigned int n = 0; n < wf->get_neq(); n++) {
+        bool is_diagonal_block = (m == n);
+        bool zero_weight = (block_weights != NULL && fabs(block_weights->get_A(m, n)) < 1e-12);
+        pattern_blocks.push_back(blocks[m][n]);
+        pattern_blocks.push_back(zero_weight && !(is_diagonal_block && force_diagonal_blocks));
       }
+    if (is_sparsity_pattern_up_to_date(pattern_blocks))
+    {
+      verbose("Reusing matrix sparsity pattern.");
     }
-
-    trav.finish();
-
-    delete [] al;
-    delete [] meshes;
+    else
+      create_sparsity_pattern(blocks, force_diagonal_blocks, block_weights, is_DG, pattern_blocks);
+    if (precomputed_scatter && scatter_map == NULL)
+      create_scatter_map(blocks, block_weights);
     delete [] blocks;
 
-    mat->alloc();
+
+    mat->alloc_from_pattern(sparsity_pattern);
   }
 
   // WARNING: unlike Matrix::alloc(), Vector::alloc(ndof) frees the memory occupied
@@ -393,6 +630,63 @@ void DiscreteProblem::assemble(SparseMatrix* mat, Vector* rhs,
 }
 
 
+/// The "matrix" of apply(): adding an entry A_mn adds A_mn x_n to y_m.
+class OperatorProductMatrix : public SparseMatrix
+{
+public:
+  OperatorProductMatrix(const scalar* x, scalar* y, unsigned int size) : x(x), y(y)
+  {
+    this->size = size;
+  }
+
+  virtual void alloc() { }
+  virtual void free() { }
+  virtual scalar get(unsigned int m, unsigned int n) 
+  {
+    error("OperatorProductMatrix::get() not available.");
+    return 0.0;
+  }
+  virtual void zero() { }
+  virtual void add_to_diagonal(scalar v)
+  {
+    for (unsigned int i = 0; i < size; i++)
+      y[i] += v * x[i];
+  }
+  virtual void add(unsigned int m, unsigned int n, scalar v) { y[m] += v * x[n]; }
+  virtual void add(unsigned int m, unsigned int n, scalar **mat, int *rows, int *cols)
+  {
+    for (unsigned int i = 0; i < m; i++)
+      if (rows[i] >= 0) // not Dir. dofs.
+        for (unsigned int j = 0; j < n; j++)
+          if (cols[j] >= 0)
+            y[rows[i]] += mat[i][j] * x[cols[j]];
+  }
+  virtual bool dump(FILE *file, const char *var_name, EMatrixDumpFormat fmt = DF_MATLAB_SPARSE) { return false; }
+  virtual unsigned int get_matrix_size() const { return 0; }
+  virtual double get_fill_in() const { return 0.0; }
+
+protected:
+  const scalar* x;
+  scalar* y;
+};
+
+void DiscreteProblem::apply(const scalar* x, scalar* y, scalar* coeff_vec, bool add_dir_lift)
+{
+  _F_
+  if (x == NULL || y == NULL)
+    error("NULL vector passed to DiscreteProblem::apply().");
+
+  int ndof = get_num_dofs();
+  memset(y, 0, ndof * sizeof(scalar));
+
+  OperatorProductMatrix product(x, y, ndof);
+  apply_x = x;
+  apply_y = y;
+  assemble(coeff_vec, &product, NULL, false, add_dir_lift);
+  apply_x = NULL;
+  apply_y = NULL;
+}
+
 void DiscreteProblem::assemble_sanity_checks(Table* block_weights) 
 {
   _F_
@@ -452,8 +746,11 @@ void DiscreteProblem::assemble(scalar* coeff_vec, SparseMatrix* mat,
   // Sanity checks.
   assemble_sanity_checks(block_weights);
 
-  // Creating matrix sparse structure.
-  create_sparse_structure(mat, rhs, force_diagonal_blocks, block_weights);
+  // Creating matrix sparse structure (apply() needs none).
+  if (apply_x == NULL)
+    create_sparse_structure(mat, rhs, force_diagonal_blocks, block_weights);
+  else
+    get_num_dofs();
  
   // Convert the coefficient vector 'coeff_vec' into solutions Hermes::vector 'u_ext'.
   Hermes::vector<Solution *> u_ext = Hermes::vector<Solution *>();
@@ -462,6 +759,14 @@ void DiscreteProblem::assemble(scalar* coeff_vec, SparseMatrix* mat,
   // Reset the warnings about insufficiently high integration order.
   reset_warn_order();
 
+  // The cached integration orders are only valid for the same weak formulation.
+  if (order_cache_wf_seq != wf->get_seq()) {
+    order_cache.clear();
+    order_cache_wf_seq = wf->get_seq();
+  }
+  unsigned long order_cache_queries_old = order_cache_queries;
+  unsigned long order_cache_hits_old = order_cache_hits;
+
   // Create slave pss's, refmaps.
   Hermes::vector<PrecalcShapeset *> spss;
   Hermes::vector<RefMap *> refmap;
@@ -486,17 +791,21 @@ void DiscreteProblem::assemble(scalar* coeff_vec, SparseMatrix* mat,
   // In such a case, the matrix forms are assembled over one mesh, and only the rhs
   // traverses through the union mesh. On the other hand, if you don't use multi-mesh
   // at all, there will always be only one stage in which all forms are assembled as usual.
-  for (unsigned ss = 0; ss < stages.size(); ss++) {
-    // Assemble one stage. One stage is a collection of functions, 
-    // and meshes that can not be further minimized.
-    // E.g. if a linear form uses two external solutions, each of 
-    // which is defined on a different mesh, and different to the
-    // mesh of the current test function, then the stage would have 
-    // three meshes. By stage functions, all functions are meant: shape 
-    // functions (their precalculated values), and mesh functions.
-    assemble_one_stage(stages[ss], mat, rhs, force_diagonal_blocks, 
-                       block_weights, spss, refmap, u_ext);
-  }
+  if (num_threads > 1)
+    assemble_parallel(stages, u_ext, spss, refmap, coeff_vec, mat, rhs, 
+                      force_diagonal_blocks, add_dir_lift, block_weights);
+  else
+    for (unsigned ss = 0; ss < stages.size(); ss++) {
+      // Assemble one stage. One stage is a collection of functions, 
+      // and meshes that can not be further minimized.
+      // E.g. if a linear form uses two external solutions, each of 
+      // which is defined on a different mesh, and different to the
+      // mesh of the current test function, then the stage would have 
+      // three meshes. By stage functions, all functions are meant: shape 
+      // functions (their precalculated values), and mesh functions.
+      assemble_one_stage(stages[ss], mat, rhs, force_diagonal_blocks, 
+                         block_weights, spss, refmap, u_ext);
+    }
 
   // Deinitialize matrix buffer.
   if(matrix_buffer != NULL)
@@ -513,85 +822,617 @@ void DiscreteProblem::assemble(scalar* coeff_vec, SparseMatrix* mat,
   // Delete the vector u_ext.
   for(std::vector<Solution *>::iterator it = u_ext.begin(); it != u_ext.end(); it++)
     delete *it;
+
+  if (order_cache_queries > order_cache_queries_old)
+  {
+    verbose("Integration order cache: %lu queries, hit rate %g%%.", order_cache_queries - order_cache_queries_old,
+            100.0 * (order_cache_hits - order_cache_hits_old) / (order_cache_queries - order_cache_queries_old));
+  }
+}
+
+void DiscreteProblem::assemble_one_stage(WeakForm::Stage& stage, 
+					 SparseMatrix* matrix, Vector* rhs,
+                                         bool force_diagonal_blocks, Table* block_weights,
+                                         Hermes::vector<PrecalcShapeset *>& spss, 
+                                         Hermes::vector<RefMap *>& refmap, 
+                                         Hermes::vector<Solution *>& u_ext)
+{
+  _F_
+  // Boundary flags. bnd[i] == true if i-th edge of the current 
+  // element is a boundary edge.
+  bool bnd[4];
+
+  // Info about the boundary edge.
+  SurfPos surf_pos[4];
+
+  // Create the assembling states.
+  Traverse trav;
+  for (unsigned i = 0; i < stage.idx.size(); i++)
+    stage.fns[i] = pss[stage.idx[i]];
+  for (unsigned i = 0; i < stage.ext.size(); i++)
+    stage.ext[i]->set_quad_2d(&g_quad_2d_std);
+  trav.begin(stage.meshes.size(), &(stage.meshes.front()), &(stage.fns.front()));
+
+  // Check that there is a DG form, so that the DG assembling procedure needs to be performed.
+  DG_matrix_forms_present = false;
+  DG_vector_forms_present = false;
+  for(unsigned int i = 0; i < stage.mfsurf.size(); i++) {
+    if (stage.mfsurf[i]->area == H2D_DG_INNER_EDGE) {
+      DG_matrix_forms_present = true;
+      break;
+    }
+  }
+  for(unsigned int i = 0; i < stage.vfsurf.size(); i++) {
+    if (stage.vfsurf[i]->area == H2D_DG_INNER_EDGE) {
+      DG_vector_forms_present = true;
+      break;
+    }
+  }
+
+  for(unsigned int i = 0; i < stage.mfsurf_mc.size(); i++) {
+    if (stage.mfsurf_mc[i]->area == H2D_DG_INNER_EDGE) {
+      DG_matrix_forms_present = true;
+      break;
+    }
+  }
+  for(unsigned int i = 0; i < stage.vfsurf_mc.size(); i++) {
+    if (stage.vfsurf_mc[i]->area == H2D_DG_INNER_EDGE) {
+      DG_vector_forms_present = true;
+      break;
+    }
+  }
+
+  // Loop through all assembling states.
+  // Assemble each one.
+  Element** e;
+  while ((e = trav.get_next_state(bnd, surf_pos)) != NULL) {
+    // One state is a collection of (virtual) elements sharing 
+    // the same physical location on (possibly) different meshes.
+    // This is then the same element of the virtual union mesh. 
+    // The proper sub-element mappings to all the functions of
+    // this stage is supplied by the function Traverse::get_next_state() 
+    // called in the while loop.
+    assemble_one_state(stage, matrix, rhs, force_diagonal_blocks, 
+                       block_weights, spss, refmap, 
+                       u_ext, e, bnd, surf_pos, trav.get_base());
+  }
+
+  if (matrix != NULL) matrix->finish();
+  if (rhs != NULL) rhs->finish();
+  trav.finish();
+
+  if(DG_matrix_forms_present || DG_vector_forms_present) {
+    Element* element_to_set_nonvisited;
+    for(unsigned int mesh_i = 0; mesh_i < stage.meshes.size(); mesh_i++)
+      for_all_elements(element_to_set_nonvisited, stage.meshes[mesh_i])
+        element_to_set_nonvisited->visited = false;
+  }
+}
+
+void DiscreteProblem::set_num_threads(int num_threads)
+{
+  _F_
+  if (num_threads < 1)
+    error("Invalid number of threads (%d) in DiscreteProblem::set_num_threads().", num_threads);
+  this->num_threads = num_threads;
+}
+
+void DiscreteProblem::set_precomputed_scatter(bool precomputed_scatter)
+{
+  _F_
+  if (precomputed_scatter == this->precomputed_scatter)
+    return;
+  this->precomputed_scatter = precomputed_scatter;
+  if (scatter_map != NULL) {
+    delete scatter_map;
+    scatter_map = NULL;
+  }
+  // The maps are created together with the matrix structure.
+  free();
+}
+
+/// Solutions are copied for every assembling thread, exact solutions and filters can not be.
+static bool can_copy_ext_fn(MeshFunction* fn)
+{
+  Solution* sln = dynamic_cast<Solution*>(fn);
+  return sln != NULL && (sln->get_type() == HERMES_SLN || sln->get_type() == HERMES_CONST);
+}
+
+bool DiscreteProblem::can_assemble_in_parallel(WeakForm::Stage& stage, Hermes::vector<Solution *>& u_ext)
+{
+  _F_
+  // DG assembling marks visited elements directly in the meshes.
+  bool dg = false;
+  for (unsigned int i = 0; i < stage.mfsurf.size(); i++)
+    if (stage.mfsurf[i]->area == H2D_DG_INNER_EDGE)
+      dg = true;
+  for (unsigned int i = 0; i < stage.vfsurf.size(); i++)
+    if (stage.vfsurf[i]->area == H2D_DG_INNER_EDGE)
+      dg = true;
+  for (unsigned int i = 0; i < stage.mfsurf_mc.size(); i++)
+    if (stage.mfsurf_mc[i]->area == H2D_DG_INNER_EDGE)
+      dg = true;
+  for (unsigned int i = 0; i < stage.vfsurf_mc.size(); i++)
+    if (stage.vfsurf_mc[i]->area == H2D_DG_INNER_EDGE)
+      dg = true;
+  if (dg) {
+    warning("DG forms can not be assembled by several threads, assembling a stage serially.");
+    return false;
+  }
+
+  // Every worker gets its own copy of the previous Newton iterate and of the other solutions,
+  // as the external functions hold their active element and transformations.
+  for (unsigned int i = 0; i < stage.ext.size(); i++) {
+    bool found = false;
+    for (unsigned int j = 0; j < u_ext.size(); j++)
+      if (stage.ext[i] == u_ext[j])
+        found = true;
+    if (!found && !can_copy_ext_fn(stage.ext[i])) {
+      warning("External functions other than solutions (e.g. filters) can not be evaluated by several threads, assembling a stage serially.");
+      return false;
+    }
+  }
+  return true;
+}
+
+/// Collects the matrix contributions of one assembling thread and flushes them into
+/// the shared matrix in larger chunks under a lock.
+class AssemblingBufferMatrix : public SparseMatrix
+{
+public:
+  AssemblingBufferMatrix(SparseMatrix* target, pthread_mutex_t* mutex) : target(target), mutex(mutex)
+  {
+    this->size = target->get_size();
+  }
+  virtual ~AssemblingBufferMatrix() { flush(); }
+
+  virtual void alloc() { }
+  virtual void free() { entries.clear(); positions.clear(); position_values.clear(); }
+  virtual scalar get(unsigned int m, unsigned int n) 
+  {
+    error("AssemblingBufferMatrix::get() not available.");
+    return 0.0;
+  }
+  virtual void zero() { entries.clear(); positions.clear(); position_values.clear(); }
+  virtual void add_to_diagonal(scalar v)
+  {
+    for (unsigned int i = 0; i < size; i++)
+      add(i, i, v);
+  }
+  virtual void add(unsigned int m, unsigned int n, scalar v)
+  {
+    Entry entry = { m, n, v };
+    entries.push_back(entry);
+    if (entries.size() >= BUFFER_SIZE)
+      flush();
+  }
+  virtual void add(unsigned int m, unsigned int n, scalar **mat, int *rows, int *cols)
+  {
+    for (unsigned int i = 0; i < m; i++)
+      for (unsigned int j = 0; j < n; j++)
+        if (rows[i] >= 0 && cols[j] >= 0) // not Dir. dofs.
+          add(rows[i], cols[j], mat[i][j]);
+  }
+  virtual bool has_pattern_positions() const { return target->has_pattern_positions(); }
+  virtual void add_at_positions(unsigned int m, unsigned int n, scalar **mat, const int *pos)
+  {
+    for (unsigned int i = 0; i < m; i++, pos += n)
+      for (unsigned int j = 0; j < n; j++)
+        if (pos[j] >= 0) {
+          positions.push_back(pos[j]);
+          position_values.push_back(mat[i][j]);
+        }
+    if (positions.size() >= BUFFER_SIZE)
+      flush();
+  }
+  virtual bool dump(FILE *file, const char *var_name, EMatrixDumpFormat fmt = DF_MATLAB_SPARSE) { return false; }
+  virtual unsigned int get_matrix_size() const { return target->get_matrix_size(); }
+  virtual double get_fill_in() const { return target->get_fill_in(); }
+
+  /// Adds the buffered values to the target matrix.
+  void flush()
+  {
+    if (entries.empty() && positions.empty())
+      return;
+    pthread_mutex_lock(mutex);
+    for (unsigned int i = 0; i < entries.size(); i++)
+      target->add(entries[i].m, entries[i].n, entries[i].v);
+    if (!positions.empty()) {
+      scalar* values = &position_values.front();
+      target->add_at_positions(1, positions.size(), &values, &positions.front());
+    }
+    pthread_mutex_unlock(mutex);
+    entries.clear();
+    positions.clear();
+    position_values.clear();
+  }
+
+protected:
+  static const unsigned int BUFFER_SIZE = 1 << 15;
+  struct Entry
+  {
+    unsigned int m, n;
+    scalar v;
+  };
+  std::vector<Entry> entries;
+  /// Values added at precomputed positions (see SparseMatrix::add_at_positions()).
+  std::vector<int> positions;
+  std::vector<scalar> position_values;
+  SparseMatrix* target;
+  pthread_mutex_t* mutex;
+};
+
+/// The same as AssemblingBufferMatrix for the right-hand side.
+class AssemblingBufferVector : public Vector
+{
+public:
+  AssemblingBufferVector(Vector* target, pthread_mutex_t* mutex) : target(target), mutex(mutex)
+  {
+    this->size = target->length();
+  }
+  virtual ~AssemblingBufferVector() { flush(); }
+
+  virtual void alloc(unsigned int ndofs) { }
+  virtual void free() { idx.clear(); values.clear(); }
+  virtual scalar get(unsigned int idx)
+  {
+    error("AssemblingBufferVector::get() not available.");
+    return 0.0;
+  }
+  virtual void extract(scalar *v) const { error("AssemblingBufferVector::extract() not available."); }
+  virtual void zero() { idx.clear(); values.clear(); }
+  virtual void change_sign() { error("AssemblingBufferVector::change_sign() not available."); }
+  virtual void set(unsigned int idx, scalar y) { error("AssemblingBufferVector::set() not available."); }
+  virtual void add(unsigned int i, scalar y)
+  {
+    idx.push_back(i);
+    values.push_back(y);
+    if (idx.size() >= BUFFER_SIZE)
+      flush();
+  }
+  virtual void add_vector(Vector* vec)
+  {
+    for (unsigned int i = 0; i < size; i++)
+      add(i, vec->get(i));
+  }
+  virtual void add_vector(scalar* vec)
+  {
+    for (unsigned int i = 0; i < size; i++)
+      add(i, vec[i]);
+  }
+  virtual void add(unsigned int n, unsigned int *idx, scalar *y)
+  {
+    for (unsigned int i = 0; i < n; i++)
+      add(idx[i], y[i]);
+  }
+  virtual bool dump(FILE *file, const char *var_name, EMatrixDumpFormat fmt = DF_MATLAB_SPARSE) { return false; }
+
+  /// Adds the buffered values to the target vector.
+  void flush()
+  {
+    if (idx.empty())
+      return;
+    pthread_mutex_lock(mutex);
+    target->add(idx.size(), &idx.front(), &values.front());
+    pthread_mutex_unlock(mutex);
+    idx.clear();
+    values.clear();
+  }
+
+protected:
+  static const unsigned int BUFFER_SIZE = 1 << 12;
+  std::vector<unsigned int> idx;
+  std::vector<scalar> values;
+  Vector* target;
+  pthread_mutex_t* mutex;
+};
+
+/// The states of one stage as returned by Traverse::get_next_state(), recorded by the
+/// parent and replayed by the assembling threads.
+struct AssemblingStates
+{
+  struct State
+  {
+    bool bnd[4];
+    SurfPos surf_pos[4];
+    Element* base;
+  };
+  std::vector<State> states;
+  /// Number of functions (meshes) of the stage.
+  unsigned int num;
+  /// The elements of the functions in the k-th state are e[k * num], ..., e[k * num + num - 1],
+  /// sub_idx are their transformations.
+  std::vector<Element*> e;
+  std::vector<uint64_t> sub_idx;
+};
+
+/// Traverses the meshes of the stage and records all its states.
+static void record_states(WeakForm::Stage& stage, AssemblingStates& rec)
+{
+  _F_
+  rec.num = stage.meshes.size();
+
+  // The traversal only sets the active elements and the transformations of the functions,
+  // plain Transformables are enough to record them.
+  Transformable* fns = new Transformable[rec.num];
+  Transformable** fn_ptrs = new Transformable*[rec.num];
+  for (unsigned int i = 0; i < rec.num; i++)
+    fn_ptrs[i] = fns + i;
+
+  Traverse trav;
+  trav.begin(rec.num, &(stage.meshes.front()), fn_ptrs);
+  AssemblingStates::State state;
+  Element** e;
+  while ((e = trav.get_next_state(state.bnd, state.surf_pos)) != NULL) {
+    state.base = trav.get_base();
+    rec.states.push_back(state);
+    for (unsigned int i = 0; i < rec.num; i++) {
+      rec.e.push_back(e[i]);
+      rec.sub_idx.push_back((e[i] != NULL) ? fns[i].get_transform() : 0);
+    }
+  }
+  trav.finish();
+
+  delete [] fn_ptrs;
+  delete [] fns;
+}
+
+/// Maximum number of colors of the assembling states, a bit mask of the colors fits in uint64_t.
+static const int H2D_MAX_ASSEMBLING_COLORS = 64;
+
+/// Colors the recorded states of the given element mode greedily (in the order of the
+/// traversal), so that no two states of the same color share a dof. colors[c] are the
+/// indices of the states of the color c, the states for which no color was left are
+/// stored in 'uncolored'.
+static void color_states(WeakForm::Stage& stage, Hermes::vector<Space *>& spaces, int ndof,
+                         AssemblingStates& rec, int mode,
+                         std::vector<std::vector<unsigned int> >& colors, std::vector<unsigned int>& uncolored)
+{
+  _F_
+  // Bit c of dof_colors[dof] is set if a state of the color c uses the dof.
+  std::vector<uint64_t> dof_colors(ndof, 0);
+  std::vector<int> dofs;
+  AsmList al;
+  for (unsigned int k = 0; k < rec.states.size(); k++) {
+    if (rec.states[k].base->get_mode() != mode)
+      continue;
+
+    // The dofs of the state (the Dirichlet ones are not assembled).
+    dofs.clear();
+    uint64_t used = 0;
+    for (unsigned int i = 0; i < stage.idx.size(); i++) {
+      Element* e = rec.e[k * rec.num + i];
+      if (e == NULL)
+        continue;
+      spaces[stage.idx[i]]->get_element_assembly_list(e, &al);
+      for (unsigned int j = 0; j < al.cnt; j++)
+        if (al.dof[j] >= 0) {
+          dofs.push_back(al.dof[j]);
+          used |= dof_colors[al.dof[j]];
+        }
+    }
+
+    int c = 0;
+    while (c < H2D_MAX_ASSEMBLING_COLORS && (used & ((uint64_t) 1 << c)))
+      c++;
+    if (c == H2D_MAX_ASSEMBLING_COLORS) {
+      uncolored.push_back(k);
+      continue;
+    }
+    for (unsigned int j = 0; j < dofs.size(); j++)
+      dof_colors[dofs[j]] |= (uint64_t) 1 << c;
+    if ((int) colors.size() <= c)
+      colors.resize(c + 1);
+    colors[c].push_back(k);
+  }
 }
 
-void DiscreteProblem::assemble_one_stage(WeakForm::Stage& stage, 
-					 SparseMatrix* matrix, Vector* rhs,
-                                         bool force_diagonal_blocks, Table* block_weights,
-                                         Hermes::vector<PrecalcShapeset *>& spss, 
-                                         Hermes::vector<RefMap *>& refmap, 
-                                         Hermes::vector<Solution *>& u_ext)
+/// Everything one assembling thread needs.
+struct AssemblingThreadData
+{
+  DiscreteProblem* worker;
+  /// The copies of the stages with the functions of the worker.
+  std::vector<WeakForm::Stage> stages;
+  unsigned int stage;
+  /// The states to assemble are states->states[state_idx[0]], ..., states->states[state_idx[num_states - 1]].
+  AssemblingStates* states;
+  const unsigned int* state_idx;
+  unsigned int num_states;
+  Hermes::vector<Solution *> u_ext;
+  Hermes::vector<PrecalcShapeset *> spss;
+  Hermes::vector<RefMap *> refmap;
+  /// The matrix and the vector the worker adds to: the shared ones or the buffers below.
+  SparseMatrix* mat;
+  Vector* rhs;
+  AssemblingBufferMatrix* mat_buffer;
+  AssemblingBufferVector* rhs_buffer;
+  bool force_diagonal_blocks;
+  Table* block_weights;
+};
+
+void* DiscreteProblem::assembling_thread(void* data_ptr)
 {
   _F_
-  // Boundary flags. bnd[i] == true if i-th edge of the current 
-  // element is a boundary edge.
-  bool bnd[4];
+  AssemblingThreadData* data = (AssemblingThreadData*) data_ptr;
+  DiscreteProblem* dp = data->worker;
+  WeakForm::Stage& stage = data->stages[data->stage];
+  AssemblingStates* rec = data->states;
+
+  for (unsigned int k = 0; k < data->num_states; k++) {
+    unsigned int s = data->state_idx[k];
+    AssemblingStates::State& state = rec->states[s];
+    Element** e = &rec->e[s * rec->num];
+
+    // Set the elements and transformations the traversal would set. Consecutive states
+    // often share elements, the tables of the functions are then kept.
+    for (unsigned int i = 0; i < rec->num; i++)
+      if (e[i] != NULL) {
+        if (stage.fns[i]->get_active_element() != e[i])
+          stage.fns[i]->set_active_element(e[i]);
+        stage.fns[i]->set_transform(rec->sub_idx[s * rec->num + i]);
+      }
 
-  // Info about the boundary edge.
-  SurfPos surf_pos[4];
+    dp->assemble_one_state(stage, data->mat, data->rhs, data->force_diagonal_blocks, 
+                           data->block_weights, data->spss, data->refmap, 
+                           data->u_ext, e, state.bnd, state.surf_pos, state.base);
+  }
+  return NULL;
+}
 
-  // Create the assembling states.
-  Traverse trav;
-  for (unsigned i = 0; i < stage.idx.size(); i++)
-    stage.fns[i] = pss[stage.idx[i]];
-  for (unsigned i = 0; i < stage.ext.size(); i++)
-    stage.ext[i]->set_quad_2d(&g_quad_2d_std);
-  trav.begin(stage.meshes.size(), &(stage.meshes.front()), &(stage.fns.front()));
+MeshFunction* DiscreteProblem::get_ext_fn(MeshFunction* fn)
+{
+  if (ext_copies.empty())
+    return fn;
+  std::map<MeshFunction*, MeshFunction*>::iterator it = ext_copies.find(fn);
+  return (it != ext_copies.end()) ? it->second : fn;
+}
 
-  // Check that there is a DG form, so that the DG assembling procedure needs to be performed.
-  DG_matrix_forms_present = false;
-  DG_vector_forms_present = false;
-  for(unsigned int i = 0; i < stage.mfsurf.size(); i++) {
-    if (stage.mfsurf[i]->area == H2D_DG_INNER_EDGE) {
-      DG_matrix_forms_present = true;
-      break;
+void DiscreteProblem::assemble_parallel(std::vector<WeakForm::Stage>& stages, Hermes::vector<Solution *>& u_ext,
+                                        Hermes::vector<PrecalcShapeset *>& spss, Hermes::vector<RefMap *>& refmap,
+                                        scalar* coeff_vec, SparseMatrix* mat, Vector* rhs,
+                                        bool force_diagonal_blocks, bool add_dir_lift, Table* block_weights)
+{
+  _F_
+  pthread_mutex_t assembling_mutex;
+  pthread_mutex_init(&assembling_mutex, NULL);
+
+  // The states of one color never add to the same entry, so the workers add directly to
+  // matrices and vectors which only touch the added entries. The other ones get the
+  // contributions through buffers flushed under a lock.
+  bool direct_mat = (mat != NULL && mat->supports_concurrent_add());
+  bool direct_rhs = (rhs != NULL && rhs->supports_concurrent_add());
+
+  AssemblingThreadData* data = NULL;
+  pthread_t* threads = new pthread_t[num_threads];
+  for (unsigned int ss = 0; ss < stages.size(); ss++) {
+    if (!can_assemble_in_parallel(stages[ss], u_ext)) {
+      assemble_one_stage(stages[ss], mat, rhs, force_diagonal_blocks, 
+                         block_weights, spss, refmap, u_ext);
+      continue;
     }
-  }
-  for(unsigned int i = 0; i < stage.vfsurf.size(); i++) {
-    if (stage.vfsurf[i]->area == H2D_DG_INNER_EDGE) {
-      DG_vector_forms_present = true;
-      break;
+
+    // Set up the workers. Everything that touches shared data (solutions from coeff_vec,
+    // the copies of the external functions) is done serially here.
+    if (data == NULL) {
+      data = new AssemblingThreadData[num_threads];
+      for (int t = 0; t < num_threads; t++) {
+        DiscreteProblem* worker = new DiscreteProblem(this);
+        data[t].worker = worker;
+        worker->convert_coeff_vec(coeff_vec, data[t].u_ext, add_dir_lift);
+        worker->initialize_psss(data[t].spss);
+        worker->initialize_refmaps(data[t].refmap);
+        if (mat != NULL) worker->get_matrix_buffer(9);
+        if (apply_x != NULL) {
+          worker->apply_y = new scalar[ndof];
+          memset(worker->apply_y, 0, ndof * sizeof(scalar));
+        }
+        data[t].stages = stages;
+        data[t].mat_buffer = (mat != NULL && !direct_mat) ? new AssemblingBufferMatrix(mat, &assembling_mutex) : NULL;
+        data[t].rhs_buffer = (rhs != NULL && !direct_rhs) ? new AssemblingBufferVector(rhs, &assembling_mutex) : NULL;
+        data[t].mat = direct_mat ? mat : data[t].mat_buffer;
+        data[t].rhs = direct_rhs ? rhs : data[t].rhs_buffer;
+        data[t].force_diagonal_blocks = force_diagonal_blocks;
+        data[t].block_weights = block_weights;
+      }
     }
-  }
 
-  for(unsigned int i = 0; i < stage.mfsurf_mc.size(); i++) {
-    if (stage.mfsurf_mc[i]->area == H2D_DG_INNER_EDGE) {
-      DG_matrix_forms_present = true;
-      break;
+    // The functions of the workers: their own shapesets, previous iterates and copies of
+    // the other solutions, in the same order as in the stage of the parent.
+    for (int t = 0; t < num_threads; t++) {
+      DiscreteProblem* worker = data[t].worker;
+      WeakForm::Stage& stage = data[t].stages[ss];
+      for (unsigned int i = 0; i < stage.idx.size(); i++)
+        stage.fns[i] = worker->pss[stage.idx[i]];
+      for (unsigned int i = 0; i < stage.ext.size(); i++) {
+        MeshFunction* fn = NULL;
+        for (unsigned int j = 0; j < u_ext.size(); j++)
+          if (stage.ext[i] == u_ext[j])
+            fn = data[t].u_ext[j];
+        if (fn == NULL) {
+          if (worker->ext_copies.find(stage.ext[i]) == worker->ext_copies.end()) {
+            Solution* copy = new Solution;
+            copy->copy(static_cast<Solution*>(stage.ext[i]));
+            worker->ext_copies[stage.ext[i]] = copy;
+          }
+          fn = worker->ext_copies[stage.ext[i]];
+        }
+        fn->set_quad_2d(&g_quad_2d_std);
+        stage.ext[i] = fn;
+        stage.fns[stage.idx.size() + i] = fn;
+      }
+      data[t].stage = ss;
     }
-  }
-  for(unsigned int i = 0; i < stage.vfsurf_mc.size(); i++) {
-    if (stage.vfsurf_mc[i]->area == H2D_DG_INNER_EDGE) {
-      DG_vector_forms_present = true;
-      break;
+
+    AssemblingStates rec;
+    record_states(stages[ss], rec);
+
+    for (int mode = HERMES_MODE_TRIANGLE; mode <= HERMES_MODE_QUAD; mode++) {
+      std::vector<std::vector<unsigned int> > colors;
+      std::vector<unsigned int> uncolored;
+      color_states(stages[ss], spaces, ndof, rec, mode, colors, uncolored);
+      if (colors.empty() && uncolored.empty())
+        continue;
+
+      verbose("Multithreaded assembling in %d colors, %d states left for one thread.",
+              (int) colors.size(), (int) uncolored.size());
+
+      // The limit tables are global and depend on the element mode.
+      update_limit_table(mode);
+
+      // The states of one color are split into contiguous parts, consecutive states are
+      // often neighbors, which makes the caches of the workers more efficient.
+      for (unsigned int c = 0; c < colors.size(); c++) {
+        unsigned int n = colors[c].size();
+        for (int t = 0; t < num_threads; t++) {
+          unsigned int first = n * t / num_threads, last = n * (t + 1) / num_threads;
+          data[t].states = &rec;
+          data[t].state_idx = &colors[c].front() + first;
+          data[t].num_states = last - first;
+          if (pthread_create(&threads[t], NULL, assembling_thread, &data[t]) != 0)
+            error("Could not create assembling thread %d.", t);
+        }
+        for (int t = 0; t < num_threads; t++)
+          pthread_join(threads[t], NULL);
+      }
+
+      // The states which did not get a color.
+      if (!uncolored.empty()) {
+        data[0].states = &rec;
+        data[0].state_idx = &uncolored.front();
+        data[0].num_states = uncolored.size();
+        assembling_thread(&data[0]);
+      }
     }
   }
-
-  // Loop through all assembling states.
-  // Assemble each one.
-  Element** e;
-  while ((e = trav.get_next_state(bnd, surf_pos)) != NULL) {
-    // One state is a collection of (virtual) elements sharing 
-    // the same physical location on (possibly) different meshes.
-    // This is then the same element of the virtual union mesh. 
-    // The proper sub-element mappings to all the functions of
-    // this stage is supplied by the function Traverse::get_next_state() 
-    // called in the while loop.
-    assemble_one_state(stage, matrix, rhs, force_diagonal_blocks, 
-                       block_weights, spss, refmap, 
-                       u_ext, e, bnd, surf_pos, trav.get_base());
+  delete [] threads;
+
+  for (int t = 0; data != NULL && t < num_threads; t++) {
+    // Flushes the rest of the buffered values.
+    delete data[t].mat_buffer;
+    delete data[t].rhs_buffer;
+    for (unsigned int i = 0; i < data[t].spss.size(); i++)
+      delete data[t].spss[i];
+    for (unsigned int i = 0; i < data[t].refmap.size(); i++)
+      delete data[t].refmap[i];
+    for (unsigned int i = 0; i < data[t].u_ext.size(); i++)
+      delete data[t].u_ext[i];
+    if (data[t].worker->matrix_buffer != NULL)
+      delete [] data[t].worker->matrix_buffer;
+    if (data[t].worker->apply_y != NULL) {
+      for (int i = 0; i < ndof; i++)
+        apply_y[i] += data[t].worker->apply_y[i];
+      delete [] data[t].worker->apply_y;
+    }
+    order_cache.insert(data[t].worker->order_cache.begin(), data[t].worker->order_cache.end());
+    order_cache_queries += data[t].worker->order_cache_queries;
+    order_cache_hits += data[t].worker->order_cache_hits;
+    delete data[t].worker;
   }
+  delete [] data;
+  pthread_mutex_destroy(&assembling_mutex);
 
-  if (matrix != NULL) matrix->finish();
+  if (mat != NULL) mat->finish();
   if (rhs != NULL) rhs->finish();
-  trav.finish();
-
-  if(DG_matrix_forms_present || DG_vector_forms_present) {
-    Element* element_to_set_nonvisited;
-    for(unsigned int mesh_i = 0; mesh_i < stage.meshes.size(); mesh_i++)
-      for_all_elements(element_to_set_nonvisited, stage.meshes[mesh_i])
-        element_to_set_nonvisited->visited = false;
-  }
 }
 
 Element* DiscreteProblem::init_state(WeakForm::Stage& stage, Hermes::vector<PrecalcShapeset *>& spss, 
@@ -607,14 +1448,19 @@ Element* DiscreteProblem::init_state(WeakForm::Stage& stage, Hermes::vector<Prec
     return NULL;
 
   // Set maximum integration order for use in integrals, see limit_order()
-  update_limit_table(e0->get_mode());
+  // In multithreaded assembling, the parent has already done this for all states of the mode.
+  if (!assembling_worker)
+    update_limit_table(e0->get_mode());
 
   // Obtain assembly lists for the element at all spaces of the stage, set appropriate mode for each pss.
+  // The elements identify the local matrices in the scatter maps.
+  state_elems.assign(wf->get_neq(), NULL);
   // NOTE: Active elements and transformations for external functions (including the solutions from previous
   // Newton's iteration) as well as basis functions (master PrecalcShapesets) have already been set in
   // trav.get_next_state(...).
   for (unsigned int i = 0; i < stage.idx.size(); i++) {
     int j = stage.idx[i];
+    state_elems[j] = e[i];
     if (e[i] == NULL) {
       isempty[j] = true;
       continue;
@@ -646,20 +1492,20 @@ void DiscreteProblem::assemble_one_state(WeakForm::Stage& stage,
       bool* bnd, SurfPos* surf_pos, Element* trav_base)
 {
   _F_
-  // Assembly list vector.
-  Hermes::vector<AsmList *> al;
-  for(unsigned int i = 0; i < wf->get_neq(); i++) 
+  // Assembly list vector. The lists are reused by all states.
+  Hermes::vector<AsmList *>& al = state_al;
+  while(al.size() < wf->get_neq())
     al.push_back(new AsmList);
+  for(unsigned int i = 0; i < wf->get_neq(); i++) 
+    al[i]->clear();
   
   // Natural boundary condition flag.
-  Hermes::vector<bool> nat;
-  for(unsigned int i = 0; i < wf->get_neq(); i++) 
-    nat.push_back(false);
+  Hermes::vector<bool>& nat = state_nat;
+  nat.assign(wf->get_neq(), false);
   
   // Element usage flag: iempty[i] == true if the current state does not posses an active element in the i-th space.
-  Hermes::vector<bool> isempty;
-  for(unsigned int i = 0; i < wf->get_neq(); i++) 
-    isempty.push_back(false);
+  Hermes::vector<bool>& isempty = state_isempty;
+  isempty.assign(wf->get_neq(), false);
     
   // Initialize the state, return a non-NULL element; if no such element found, return.
   Element* rep_element = init_state(stage, spss, refmap, e, isempty, al);
@@ -697,10 +1543,6 @@ void DiscreteProblem::assemble_one_state(WeakForm::Stage& stage,
                               nat, isurf, e, trav_base, rep_element);
   }
 
-  // Delete assembly lists.
-  for(unsigned int i = 0; i < wf->get_neq(); i++) 
-    delete al[i];
-
   delete_cache();
 }
 
@@ -734,6 +1576,12 @@ void DiscreteProblem::assemble_volume_matrix_forms(WeakForm::Stage& stage,
     bool tra = (m != n) && (mfv->sym != 0);
     bool sym = (m == n) && (mfv->sym == 1);
 
+    // Matrix-free product, see apply().
+    if (apply_x != NULL && !mfv->adapt_eval) {
+      apply_matrix_form_vol(mfv, u_ext, spss, refmap, al, block_scaling_coeff, tra);
+      continue;
+    }
+
     // Assemble the local stiffness matrix for the form mfv.
     scalar **local_stiffness_matrix = NULL;
     local_stiffness_matrix = get_matrix_buffer(std::max(al[m]->cnt, al[n]->cnt));
@@ -813,7 +1661,7 @@ void DiscreteProblem::assemble_volume_matrix_forms(WeakForm::Stage& stage,
 
     // Insert the local stiffness matrix into the global one.
     if (mat != NULL) {
-      mat->add(al[m]->cnt, al[n]->cnt, local_stiffness_matrix, al[m]->dof, al[n]->dof);
+      insert_local_matrix(mat, m, n, -1, local_stiffness_matrix, al[m], al[n]);
     }
 
     // Insert also the off-diagonal (anti-)symmetric block, if required.
@@ -824,7 +1672,7 @@ void DiscreteProblem::assemble_volume_matrix_forms(WeakForm::Stage& stage,
       transpose(local_stiffness_matrix, al[m]->cnt, al[n]->cnt);
 
       if (mat != NULL) {
-        mat->add(al[n]->cnt, al[m]->cnt, local_stiffness_matrix, al[n]->dof, al[m]->dof);
+        insert_local_matrix(mat, n, m, -1, local_stiffness_matrix, al[n], al[m]);
       }
 
       // Linear problems only: Subtracting Dirichlet lift contribution from the RHS:
@@ -1142,12 +1990,7 @@ void DiscreteProblem::assemble_DG_forms(WeakForm::Stage& stage,
 
     // For every neighbor we want to delete the geometry caches and create new ones.
     for (int i = 0; i < g_max_quad + 1 + 4 * g_max_quad + 4; i++)
-      if (cache_e[i] != NULL) {
-        cache_e[i]->free(); 
-        delete cache_e[i];
-        cache_e[i] = NULL;
-        delete [] cache_jwt[i];
-      }
+      delete_single_geom_cache(i);
 
     assemble_DG_one_neighbor(processed, neighbor_i, stage, mat, rhs, 
                              force_diagonal_blocks, block_weights, spss, refmap, 
@@ -1263,7 +2106,8 @@ void DiscreteProblem::init_neighbors(LightArray<NeighborSearch*>& neighbor_searc
   // Initialize the NeighborSearches.
   for(unsigned int i = 0; i < stage.meshes.size(); i++) {
     if(!neighbor_searches.present(stage.meshes[i]->get_seq() - min_dg_mesh_seq)) {
-      NeighborSearch* ns = new NeighborSearch(stage.fns[i]->get_active_element(), stage.meshes[i]);
+      NeighborSearch* ns = new NeighborSearch(stage.fns[i]->get_active_element(), stage.meshes[i],
+                                              get_neighbor_table(stage.meshes[i]));
       ns->original_central_el_transform = stage.fns[i]->get_transform();
       neighbor_searches.add(ns, stage.meshes[i]->get_seq() - min_dg_mesh_seq);
     }
@@ -1280,6 +2124,21 @@ void DiscreteProblem::init_neighbors(LightArray<NeighborSearch*>& neighbor_searc
   return;
 }
 
+NeighborTable* DiscreteProblem::get_neighbor_table(Mesh* mesh)
+{
+  _F_
+  std::map<Mesh*, NeighborTable*>::iterator it = neighbor_tables.find(mesh);
+  if (it != neighbor_tables.end()) {
+    if (it->second->is_up_to_date(mesh))
+      return it->second;
+    delete it->second;
+    neighbor_tables.erase(it);
+  }
+  NeighborTable* table = new NeighborTable(mesh);
+  neighbor_tables[mesh] = table;
+  return table;
+}
+
 void DiscreteProblem::build_multimesh_tree(DiscreteProblem::NeighborNode* root, 
                                            LightArray<NeighborSearch*>& neighbor_searches)
 {
@@ -1607,6 +2466,12 @@ void DiscreteProblem::assemble_surface_matrix_forms(WeakForm::Stage& stage,
     surf_pos.space_v = spaces[m];
     surf_pos.space_u = spaces[n];
 
+    // Matrix-free product, see apply().
+    if (apply_x != NULL && !mfs->adapt_eval) {
+      apply_matrix_form_surf(mfs, u_ext, spss, refmap, al, block_scaling_coeff, &surf_pos);
+      continue;
+    }
+
     scalar **local_stiffness_matrix = get_matrix_buffer(std::max(al[m]->cnt, al[n]->cnt));
     for (unsigned int i = 0; i < al[m]->cnt; i++) {
       if (al[m]->dof[i] < 0) continue;
@@ -1638,7 +2503,7 @@ void DiscreteProblem::assemble_surface_matrix_forms(WeakForm::Stage& stage,
       }
     }
     if (mat != NULL)
-      mat->add(al[m]->cnt, al[n]->cnt, local_stiffness_matrix, al[m]->dof, al[n]->dof);
+      insert_local_matrix(mat, m, n, isurf, local_stiffness_matrix, al[m], al[n]);
   }
 }
 void DiscreteProblem::assemble_multicomponent_surface_matrix_forms(WeakForm::Stage& stage, 
@@ -2076,6 +2941,219 @@ void DiscreteProblem::assemble_multicomponent_DG_vector_forms(WeakForm::Stage& s
   }
 }
 
+//// matrix-free product ////////////////////////////////////////////////////////////////
+
+#ifdef H2D_COMPLEX
+static const int H2D_APPLY_PARTS = 2;
+static inline double apply_part(scalar v, bool imag) { return imag ? v.imag() : v.real(); }
+static inline scalar apply_unit(bool imag) { return imag ? scalar(0.0, 1.0) : scalar(1.0, 0.0); }
+#else
+static const int H2D_APPLY_PARTS = 1;
+static inline double apply_part(scalar v, bool imag) { return v; }
+static inline scalar apply_unit(bool imag) { return 1.0; }
+#endif
+
+/// dst += c * src at np points, dst is allocated in the arena (zeroed) when first needed.
+static void add_scaled_values(double*& dst, const double* src, double c, int np, Arena* arena)
+{
+  if (src == NULL) return;
+  if (dst == NULL) {
+    dst = arena->alloc_array<double>(np);
+    memset(dst, 0, np * sizeof(double));
+  }
+  for (int i = 0; i < np; i++)
+    dst[i] += c * src[i];
+}
+
+/// Activates the shape function of the highest order in 'al' (on the edge 'edge' if not -1).
+static void set_highest_order_shape(PrecalcShapeset* fu, AsmList* al, int edge = -1)
+{
+  int index = al->idx[0], max_order = -1;
+  for (unsigned int i = 0; i < al->cnt; i++) {
+    fu->set_active_shape(al->idx[i]);
+    int order = (edge < 0) ? fu->get_fn_order() : fu->get_edge_fn_order(edge);
+    if (order > max_order) {
+      max_order = order;
+      index = al->idx[i];
+    }
+  }
+  fu->set_active_shape(index);
+}
+
+Func<double>* DiscreteProblem::interpolate_fn(AsmList* al, PrecalcShapeset* fu, RefMap* rm, int order, bool imag)
+{
+  _F_
+  Func<double>* u = NULL;
+  for (unsigned int i = 0; i < al->cnt; i++) {
+    if (al->dof[i] < 0 || std::abs(al->coef[i]) <= 1e-12)
+      continue;
+    double c = apply_part(al->coef[i] * apply_x[al->dof[i]], imag);
+    if (c == 0.0)
+      continue;
+    fu->set_active_shape(al->idx[i]);
+    Func<double>* fn = get_fn(fu, rm, order);
+    if (u == NULL)
+      u = new (form_arena.allocate(sizeof(Func<double>))) Func<double>(fn->num_gip, fn->nc);
+    int np = fn->num_gip;
+    add_scaled_values(u->val, fn->val, c, np, &form_arena);
+    add_scaled_values(u->dx, fn->dx, c, np, &form_arena);
+    add_scaled_values(u->dy, fn->dy, c, np, &form_arena);
+#ifdef H2D_SECOND_DERIVATIVES_ENABLED
+    add_scaled_values(u->laplace, fn->laplace, c, np, &form_arena);
+#endif
+    add_scaled_values(u->val0, fn->val0, c, np, &form_arena);
+    add_scaled_values(u->val1, fn->val1, c, np, &form_arena);
+    add_scaled_values(u->dx0, fn->dx0, c, np, &form_arena);
+    add_scaled_values(u->dx1, fn->dx1, c, np, &form_arena);
+    add_scaled_values(u->dy0, fn->dy0, c, np, &form_arena);
+    add_scaled_values(u->dy1, fn->dy1, c, np, &form_arena);
+    add_scaled_values(u->curl, fn->curl, c, np, &form_arena);
+    add_scaled_values(u->div, fn->div, c, np, &form_arena);
+  }
+  return u;
+}
+
+void DiscreteProblem::apply_matrix_form_vol(WeakForm::MatrixFormVol* mfv, Hermes::vector<Solution *>& u_ext,
+                                            Hermes::vector<PrecalcShapeset *>& spss, Hermes::vector<RefMap *>& refmap,
+                                            Hermes::vector<AsmList *>& al, double block_scaling_coeff, bool tra)
+{
+  _F_
+  int m = mfv->i;
+  int n = mfv->j;
+
+  // One integration order for the whole local matrix, the order of the product of the
+  // basis functions of the highest degree.
+  set_highest_order_shape(pss[n], al[n]);
+  set_highest_order_shape(spss[m], al[m]);
+  int order = calc_order_matrix_form_vol(mfv, u_ext, pss[n], spss[m], refmap[n], refmap[m]);
+
+  Quad2D* quad = pss[n]->get_quad_2d();
+  double3* pt = quad->get_points(order);
+  int np = quad->get_num_points(order);
+
+  // Init geometry and jacobian*weights.
+  RefMap* ru = refmap[n];
+  if (cache_e[order] == NULL)
+  {
+    cache_e[order] = init_geom_vol(ru, order, &state_arena);
+    double* jac = NULL;
+    if(!ru->is_jacobian_const()) 
+      jac = ru->get_jacobian(order);
+    cache_jwt[order] = state_arena.alloc_array<double>(np);
+    for(int i = 0; i < np; i++) {
+      if(ru->is_jacobian_const())
+        cache_jwt[order][i] = pt[i][2] * ru->get_const_jacobian();
+      else
+        cache_jwt[order][i] = pt[i][2] * jac[i];
+    }
+  }
+  Geom<double>* e = cache_e[order];
+  double* jwt = cache_jwt[order];
+
+  // Values of the previous Newton iteration and external functions, the same for all
+  // the basis functions.
+  int prev_size = u_ext.size() - mfv->u_ext_offset;
+  Arena::Mark mark = form_arena.get_mark();
+  Func<scalar>** prev = form_arena.alloc_array<Func<scalar>*>(prev_size);
+  for (int i = 0; i < prev_size; i++)
+    if (u_ext[i + mfv->u_ext_offset] != NULL) 
+      prev[i] = init_fn(u_ext[i + mfv->u_ext_offset], order, &form_arena);
+    else 
+      prev[i] = NULL;
+  ExtData<scalar>* ext = init_ext_fns(mfv->ext, refmap[m], order, &form_arena);
+
+  double scaling = block_scaling_coeff * mfv->scaling_factor;
+  for (int part = 0; part < H2D_APPLY_PARTS; part++) {
+    // Block (m, n): the form is evaluated with the combination of the trial functions.
+    Func<double>* u = interpolate_fn(al[n], pss[n], refmap[n], order, part == 1);
+    if (u != NULL)
+      for (unsigned int i = 0; i < al[m]->cnt; i++) {
+        if (al[m]->dof[i] < 0 || std::abs(al[m]->coef[i]) <= 1e-12)
+          continue;
+        spss[m]->set_active_shape(al[m]->idx[i]);
+        Func<double>* v = get_fn(spss[m], refmap[m], order);
+        apply_y[al[m]->dof[i]] += mfv->value(np, jwt, prev, u, v, e, ext) * scaling
+                                  * al[m]->coef[i] * apply_unit(part == 1);
+      }
+
+    // The (anti-)symmetric block (n, m): with the combination of the test functions.
+    if (tra) {
+      Func<double>* v = interpolate_fn(al[m], spss[m], refmap[m], order, part == 1);
+      if (v != NULL)
+        for (unsigned int j = 0; j < al[n]->cnt; j++) {
+          if (al[n]->dof[j] < 0 || std::abs(al[n]->coef[j]) <= 1e-12)
+            continue;
+          pss[n]->set_active_shape(al[n]->idx[j]);
+          Func<double>* u = get_fn(pss[n], refmap[n], order);
+          scalar val = mfv->value(np, jwt, prev, u, v, e, ext) * scaling
+                       * al[n]->coef[j] * apply_unit(part == 1);
+          apply_y[al[n]->dof[j]] += (mfv->sym < 0) ? -val : val;
+        }
+    }
+  }
+
+  form_arena.release(mark);
+}
+
+void DiscreteProblem::apply_matrix_form_surf(WeakForm::MatrixFormSurf* mfs, Hermes::vector<Solution *>& u_ext,
+                                             Hermes::vector<PrecalcShapeset *>& spss, Hermes::vector<RefMap *>& refmap,
+                                             Hermes::vector<AsmList *>& al, double block_scaling_coeff, SurfPos* surf_pos)
+{
+  _F_
+  int m = mfs->i;
+  int n = mfs->j;
+
+  set_highest_order_shape(pss[n], al[n], surf_pos->surf_num);
+  set_highest_order_shape(spss[m], al[m], surf_pos->surf_num);
+  int order = calc_order_matrix_form_surf(mfs, u_ext, pss[n], spss[m], refmap[n], refmap[m], surf_pos);
+
+  Quad2D* quad = pss[n]->get_quad_2d();
+  int eo = quad->get_edge_points(surf_pos->surf_num, order);
+  double3* pt = quad->get_points(eo);
+  int np = quad->get_num_points(eo);
+
+  // Init geometry and jacobian*weights.
+  RefMap* ru = refmap[n];
+  if (cache_e[eo] == NULL)
+  {
+    cache_e[eo] = init_geom_surf(ru, surf_pos, eo, &state_arena);
+    double3* tan = ru->get_tangent(surf_pos->surf_num, eo);
+    cache_jwt[eo] = state_arena.alloc_array<double>(np);
+    for(int i = 0; i < np; i++)
+      cache_jwt[eo][i] = pt[i][2] * tan[i][2];
+  }
+  Geom<double>* e = cache_e[eo];
+  double* jwt = cache_jwt[eo];
+
+  int prev_size = u_ext.size() - mfs->u_ext_offset;
+  Arena::Mark mark = form_arena.get_mark();
+  Func<scalar>** prev = form_arena.alloc_array<Func<scalar>*>(prev_size);
+  for (int i = 0; i < prev_size; i++)
+    if (u_ext[i + mfs->u_ext_offset] != NULL) 
+      prev[i] = init_fn(u_ext[i + mfs->u_ext_offset], eo, &form_arena);
+    else 
+      prev[i] = NULL;
+  ExtData<scalar>* ext = init_ext_fns(mfs->ext, refmap[m], eo, &form_arena);
+
+  // Edges are parameterized from 0 to 1 while integration weights are defined in (-1, 1).
+  double scaling = 0.5 * block_scaling_coeff * mfs->scaling_factor;
+  for (int part = 0; part < H2D_APPLY_PARTS; part++) {
+    Func<double>* u = interpolate_fn(al[n], pss[n], refmap[n], eo, part == 1);
+    if (u == NULL)
+      continue;
+    for (unsigned int i = 0; i < al[m]->cnt; i++) {
+      if (al[m]->dof[i] < 0 || std::abs(al[m]->coef[i]) <= 1e-12)
+        continue;
+      spss[m]->set_active_shape(al[m]->idx[i]);
+      Func<double>* v = get_fn(spss[m], refmap[m], eo);
+      apply_y[al[m]->dof[i]] += mfs->value(np, jwt, prev, u, v, e, ext) * scaling
+                                * al[m]->coef[i] * apply_unit(part == 1);
+    }
+  }
+
+  form_arena.release(mark);
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 // Initialize integration order for external functions
@@ -2088,7 +3166,7 @@ ExtData<Ord>* DiscreteProblem::init_ext_fns_ord(Hermes::vector<MeshFunction *> &
   fake_ext->nf = ext.size();
   Func<Ord>** fake_ext_fn = new Func<Ord>*[fake_ext->nf];
   for (int i = 0; i < fake_ext->nf; i++)
-    fake_ext_fn[i] = get_fn_ord(ext[i]->get_fn_order());
+    fake_ext_fn[i] = get_fn_ord(get_ext_fn(ext[i])->get_fn_order());
   fake_ext->fn = fake_ext_fn;
   
   return fake_ext;
@@ -2096,15 +3174,16 @@ ExtData<Ord>* DiscreteProblem::init_ext_fns_ord(Hermes::vector<MeshFunction *> &
 
 // Initialize external functions (obtain values, derivatives,...)
 ExtData<scalar>* DiscreteProblem::init_ext_fns(Hermes::vector<MeshFunction *> &ext, 
-                                               RefMap *rm, const int order)
+                                               RefMap *rm, const int order, Arena* arena)
 {
   _F_
-  ExtData<scalar>* ext_data = new ExtData<scalar>;
+  ExtData<scalar>* ext_data = (arena != NULL) ? new (arena->allocate(sizeof(ExtData<scalar>))) ExtData<scalar>
+                                              : new ExtData<scalar>;
 
   // Copy external functions.
-  Func<scalar>** ext_fn = new Func<scalar>*[ext.size()];
+  Func<scalar>** ext_fn = new_array<Func<scalar>*>(arena, ext.size());
   for (unsigned i = 0; i < ext.size(); i++) {
-    if (ext[i] != NULL) ext_fn[i] = init_fn(ext[i], order);
+    if (ext[i] != NULL) ext_fn[i] = init_fn(get_ext_fn(ext[i]), order, arena);
     else ext_fn[i] = NULL;
   }
   ext_data->nf = ext.size();
@@ -2124,7 +3203,7 @@ ExtData<Ord>* DiscreteProblem::init_ext_fns_ord(Hermes::vector<MeshFunction *> &
   fake_ext->nf = ext.size();
   Func<Ord>** fake_ext_fn = new Func<Ord>*[fake_ext->nf];
   for (int i = 0; i < fake_ext->nf; i++)
-    fake_ext_fn[i] = get_fn_ord(ext[i]->get_edge_fn_order(edge));
+    fake_ext_fn[i] = get_fn_ord(get_ext_fn(ext[i])->get_edge_fn_order(edge));
   fake_ext->fn = fake_ext_fn;
 
   return fake_ext;
@@ -2133,16 +3212,17 @@ ExtData<Ord>* DiscreteProblem::init_ext_fns_ord(Hermes::vector<MeshFunction *> &
 // Initialize discontinuous external functions (obtain values, derivatives,... on both sides of the
 // supplied NeighborSearch's active edge).
 ExtData<scalar>* DiscreteProblem::init_ext_fns(Hermes::vector<MeshFunction *> &ext, 
-                                               LightArray<NeighborSearch*>& neighbor_searches, int order)
+                                               LightArray<NeighborSearch*>& neighbor_searches, int order, Arena* arena)
 {
   _F_
-  Func<scalar>** ext_fns = new Func<scalar>*[ext.size()];
+  Func<scalar>** ext_fns = new_array<Func<scalar>*>(arena, ext.size());
   for(unsigned int j = 0; j < ext.size(); j++) {
     neighbor_searches.get(ext[j]->get_mesh()->get_seq() - min_dg_mesh_seq)->set_quad_order(order);
-    ext_fns[j] = neighbor_searches.get(ext[j]->get_mesh()->get_seq() - min_dg_mesh_seq)->init_ext_fn(ext[j]);
+    ext_fns[j] = neighbor_searches.get(ext[j]->get_mesh()->get_seq() - min_dg_mesh_seq)->init_ext_fn(ext[j], arena);
   }
 
-  ExtData<scalar>* ext_data = new ExtData<scalar>;
+  ExtData<scalar>* ext_data = (arena != NULL) ? new (arena->allocate(sizeof(ExtData<scalar>))) ExtData<scalar>
+                                              : new ExtData<scalar>;
   ext_data->fn = ext_fns;
   ext_data->nf = ext.size();
 
@@ -2187,12 +3267,12 @@ Func<double>* DiscreteProblem::get_fn(PrecalcShapeset *fu, RefMap *rm, const int
                                       fu->get_transform(), fu->get_shapeset()->get_id());
     if(rm->get_active_element()->get_mode() == HERMES_MODE_TRIANGLE) {
       if(assembling_caches.cache_fn_triangles.find(key) == assembling_caches.cache_fn_triangles.end())
-        assembling_caches.cache_fn_triangles[key] = init_fn(fu, rm, order);
+        assembling_caches.cache_fn_triangles[key] = init_fn(fu, rm, order, &state_arena);
       return assembling_caches.cache_fn_triangles[key];
     }
     else {
       if(assembling_caches.cache_fn_quads.find(key) == assembling_caches.cache_fn_quads.end())
-        assembling_caches.cache_fn_quads[key] = init_fn(fu, rm, order);
+        assembling_caches.cache_fn_quads[key] = init_fn(fu, rm, order, &state_arena);
       return assembling_caches.cache_fn_quads[key];
     }
   }
@@ -2209,6 +3289,61 @@ Func<Ord>* DiscreteProblem::get_fn_ord(const int order)
   return assembling_caches.cache_fn_ord.get(cached_order);
 }
 
+bool DiscreteProblem::get_order_cache_key(void* form, Hermes::vector<Solution *>& u_ext,
+                                          PrecalcShapeset *fu, PrecalcShapeset *fv,
+                                          Hermes::vector<MeshFunction *>& ext, int edge, OrderCacheKey& key)
+{
+  _F_
+  // Surface forms use both the edge and the element orders of the external functions.
+  int num_orders = 2 + (u_ext.size() + ext.size()) * (edge >= 0 ? 2 : 1);
+  if (num_orders > H2D_ORDER_CACHE_MAX_FNS) {
+    key.form = NULL;
+    return false;
+  }
+
+  key.form = form;
+  key.mode = fv->get_active_element()->get_mode();
+  key.num_orders = 0;
+  if (edge >= 0) {
+    key.orders[key.num_orders++] = (fu != NULL) ? fu->get_edge_fn_order(edge) : -1;
+    key.orders[key.num_orders++] = fv->get_edge_fn_order(edge);
+  }
+  else {
+    key.orders[key.num_orders++] = (fu != NULL) ? fu->get_fn_order() : -1;
+    key.orders[key.num_orders++] = fv->get_fn_order();
+  }
+  for (unsigned int i = 0; i < u_ext.size(); i++) {
+    key.orders[key.num_orders++] = (u_ext[i] != NULL) ? u_ext[i]->get_fn_order() : -1;
+    if (edge >= 0)
+      key.orders[key.num_orders++] = (u_ext[i] != NULL) ? u_ext[i]->get_edge_fn_order(edge) : -1;
+  }
+  for (unsigned int i = 0; i < ext.size(); i++) {
+    key.orders[key.num_orders++] = get_ext_fn(ext[i])->get_fn_order();
+    if (edge >= 0)
+      key.orders[key.num_orders++] = get_ext_fn(ext[i])->get_edge_fn_order(edge);
+  }
+  return true;
+}
+
+bool DiscreteProblem::order_cache_lookup(const OrderCacheKey& key, int& order)
+{
+  _F_
+  order_cache_queries++;
+  std::map<OrderCacheKey, int, OrderCacheCompare>::iterator it = order_cache.find(key);
+  if (it == order_cache.end())
+    return false;
+  order_cache_hits++;
+  order = it->second;
+  return true;
+}
+
+void DiscreteProblem::order_cache_insert(const OrderCacheKey& key, int order)
+{
+  _F_
+  if (key.form != NULL)
+    order_cache[key] = order;
+}
+
 // Caching transformed values
 void DiscreteProblem::init_cache()
 {
@@ -2220,41 +3355,25 @@ void DiscreteProblem::init_cache()
   }
 }
 
+// The geometry is in the state arena, its memory is reclaimed at the end of the state.
 void DiscreteProblem::delete_single_geom_cache(int order)
 {
-  if (cache_e[order] != NULL) {
-    cache_e[order]->free();
-    delete cache_e[order];
-    cache_e[order] = NULL;
-    delete [] cache_jwt[order];
-  }
+  cache_e[order] = NULL;
+  cache_jwt[order] = NULL;
 }
 
 void DiscreteProblem::delete_cache()
 {
   _F_
+  // The geometry and the non-constant shape function caches live in the state arena.
   for (int i = 0; i < g_max_quad + 1 + 4 * g_max_quad + 4; i++)
   {
-    if (cache_e[i] != NULL)
-    {
-      cache_e[i]->free(); delete cache_e[i];
-      delete [] cache_jwt[i];
-    }
-  }
-  
-  for (std::map<AssemblingCaches::KeyNonConst, Func<double>*, AssemblingCaches::CompareNonConst>::const_iterator it = assembling_caches.cache_fn_quads.begin();
-       it != assembling_caches.cache_fn_quads.end(); it++)
-  {
-    (it->second)->free_fn(); delete (it->second);
+    cache_e[i] = NULL;
+    cache_jwt[i] = NULL;
   }
   assembling_caches.cache_fn_quads.clear();
-
-  for (std::map<AssemblingCaches::KeyNonConst, Func<double>*, AssemblingCaches::CompareNonConst>::const_iterator it = assembling_caches.cache_fn_triangles.begin();
-       it != assembling_caches.cache_fn_triangles.end(); it++)
-  {
-    (it->second)->free_fn(); delete (it->second);
-  }
   assembling_caches.cache_fn_triangles.clear();
+  state_arena.reset();
 }
 
 DiscontinuousFunc<Ord>* DiscreteProblem::init_ext_fn_ord(NeighborSearch* ns, MeshFunction* fu)
@@ -2271,7 +3390,7 @@ DiscontinuousFunc<Ord>* DiscreteProblem::init_ext_fn_ord(NeighborSearch* ns, Mes
 // Volume matrix forms.
 
 scalar DiscreteProblem::eval_form(WeakForm::MatrixFormVol *mfv, 
-                                  Hermes::vector<Solution *> u_ext,
+                                  Hermes::vector<Solution *>& u_ext,
                                   PrecalcShapeset *fu, PrecalcShapeset *fv, 
                                   RefMap *ru, RefMap *rv)
 {
@@ -2313,7 +3432,7 @@ scalar DiscreteProblem::eval_form(WeakForm::MatrixFormVol *mfv,
   return result;
 }
 void DiscreteProblem::eval_form(WeakForm::MultiComponentMatrixFormVol *mfv, 
-                                  Hermes::vector<Solution *> u_ext,
+                                  Hermes::vector<Solution *>& u_ext,
                                   PrecalcShapeset *fu, PrecalcShapeset *fv, 
                                   RefMap *ru, RefMap *rv, Hermes::vector<scalar>& result)
 {
@@ -2329,11 +3448,11 @@ void DiscreteProblem::eval_form(WeakForm::MultiComponentMatrixFormVol *mfv,
   // Init geometry and jacobian*weights.
   if (cache_e[order] == NULL)
   {
-    cache_e[order] = init_geom_vol(ru, order);
+    cache_e[order] = init_geom_vol(ru, order, &state_arena);
     double* jac = NULL;
     if(!ru->is_jacobian_const()) 
       jac = ru->get_jacobian(order);
-    cache_jwt[order] = new double[np];
+    cache_jwt[order] = state_arena.alloc_array<double>(np);
     for(int i = 0; i < np; i++) {
       if(ru->is_jacobian_const())
         cache_jwt[order][i] = pt[i][2] * ru->get_const_jacobian();
@@ -2347,11 +3466,12 @@ void DiscreteProblem::eval_form(WeakForm::MultiComponentMatrixFormVol *mfv,
   // Values of the previous Newton iteration, shape functions 
   // and external functions in quadrature points.
   int prev_size = u_ext.size() - mfv->u_ext_offset;
-  Func<scalar>** prev = new Func<scalar>*[prev_size];
+  Arena::Mark mark = form_arena.get_mark();
+  Func<scalar>** prev = form_arena.alloc_array<Func<scalar>*>(prev_size);
   if (u_ext != Hermes::vector<Solution *>())
     for (int i = 0; i < prev_size; i++)
       if (u_ext[i + mfv->u_ext_offset] != NULL) 
-        prev[i] = init_fn(u_ext[i + mfv->u_ext_offset], order);
+        prev[i] = init_fn(u_ext[i + mfv->u_ext_offset], order, &form_arena);
       else 
         prev[i] = NULL;
   else
@@ -2361,7 +3481,7 @@ void DiscreteProblem::eval_form(WeakForm::MultiComponentMatrixFormVol *mfv,
   Func<double>* u = get_fn(fu, ru, order);
   Func<double>* v = get_fn(fv, rv, order);
 
-  ExtData<scalar>* ext = init_ext_fns(mfv->ext, rv, order);
+  ExtData<scalar>* ext = init_ext_fns(mfv->ext, rv, order, &form_arena);
 
   // The actual calculation takes place here.
   mfv->value(np, jwt, prev, u, v, e, ext, result);
@@ -2370,20 +3490,10 @@ void DiscreteProblem::eval_form(WeakForm::MultiComponentMatrixFormVol *mfv,
     result[i] *= mfv->scaling_factor;
 
   // Clean up.
-  for(int i = 0; i < prev_size; i++)
-    if (prev[i] != NULL) { 
-      prev[i]->free_fn(); 
-      delete prev[i]; 
-    }
-  delete [] prev;
-
-  if (ext != NULL) {
-    ext->free(); 
-    delete ext;
-  }
+  form_arena.release(mark);
 }
 
-int DiscreteProblem::calc_order_matrix_form_vol(WeakForm::MatrixFormVol *mfv, Hermes::vector<Solution *> u_ext,
+int DiscreteProblem::calc_order_matrix_form_vol(WeakForm::MatrixFormVol *mfv, Hermes::vector<Solution *>& u_ext,
                                                 PrecalcShapeset *fu, PrecalcShapeset *fv, RefMap *ru, RefMap *rv)
 {
   _F_
@@ -2393,54 +3503,63 @@ int DiscreteProblem::calc_order_matrix_form_vol(WeakForm::MatrixFormVol *mfv, He
   if(is_fvm) 
     order = ru->get_inv_ref_order();
   else {
-    int u_ext_length = u_ext.size();      // Number of external solutions.
-    int u_ext_offset = mfv->u_ext_offset; // External solutions will start with u_ext[u_ext_offset]
-                                          // and there will be only u_ext_length - u_ext_offset of them.
+    // Look the order up in the cache first, the form only needs to be parsed
+    // once for each combination of function orders.
+    OrderCacheKey key;
+    int form_order;
+    if (!get_order_cache_key(mfv, u_ext, fu, fv, mfv->ext, -1, key) || !order_cache_lookup(key, form_order)) {
+      int u_ext_length = u_ext.size();      // Number of external solutions.
+      int u_ext_offset = mfv->u_ext_offset; // External solutions will start with u_ext[u_ext_offset]
+                                            // and there will be only u_ext_length - u_ext_offset of them.
   
-    // Increase for multi-valued shape functions.
-    int inc = (fu->get_num_components() == 2) ? 1 : 0;
-
-    // Order of solutions from the previous Newton iteration.
-    Func<Ord>** oi = new Func<Ord>*[u_ext_length - u_ext_offset];
-    if (u_ext != Hermes::vector<Solution *>())
-      for(int i = 0; i < u_ext_length - u_ext_offset; i++)
-        if (u_ext[i + u_ext_offset] != NULL)
-          oi[i] = get_fn_ord(u_ext[i + u_ext_offset]->get_fn_order() + inc);
-        else
+      // Increase for multi-valued shape functions.
+      int inc = (fu->get_num_components() == 2) ? 1 : 0;
+
+      // Order of solutions from the previous Newton iteration.
+      Func<Ord>** oi = new Func<Ord>*[u_ext_length - u_ext_offset];
+      if (u_ext != Hermes::vector<Solution *>())
+        for(int i = 0; i < u_ext_length - u_ext_offset; i++)
+          if (u_ext[i + u_ext_offset] != NULL)
+            oi[i] = get_fn_ord(u_ext[i + u_ext_offset]->get_fn_order() + inc);
+          else
+            oi[i] = get_fn_ord(0);
+      else
+        for(int i = 0; i < u_ext_length - u_ext_offset; i++)
           oi[i] = get_fn_ord(0);
-    else
-      for(int i = 0; i < u_ext_length - u_ext_offset; i++)
-        oi[i] = get_fn_ord(0);
 
-    // Order of shape functions.
-    Func<Ord>* ou = get_fn_ord(fu->get_fn_order() + inc);
-    Func<Ord>* ov = get_fn_ord(fv->get_fn_order() + inc);
+      // Order of shape functions.
+      Func<Ord>* ou = get_fn_ord(fu->get_fn_order() + inc);
+      Func<Ord>* ov = get_fn_ord(fv->get_fn_order() + inc);
 
-    // Order of additional external functions.
-    ExtData<Ord>* fake_ext = init_ext_fns_ord(mfv->ext);
+      // Order of additional external functions.
+      ExtData<Ord>* fake_ext = init_ext_fns_ord(mfv->ext);
 
-    // Order of geometric attributes (eg. for multiplication of a solution with coordinates, normals, etc.).
-    double fake_wt = 1.0;
+      // Order of geometric attributes (eg. for multiplication of a solution with coordinates, normals, etc.).
+      double fake_wt = 1.0;
 
-    // Total order of the matrix form.
-    Ord o = mfv->ord(1, &fake_wt, oi, ou, ov, &geom_ord, fake_ext);
+      // Total order of the matrix form.
+      Ord o = mfv->ord(1, &fake_wt, oi, ou, ov, &geom_ord, fake_ext);
 
-    // Increase due to reference map.
-    order = ru->get_inv_ref_order();
-    order += o.get_order();
-    limit_order(order);
+      form_order = o.get_order();
+      order_cache_insert(key, form_order);
     
-    // Cleanup.
-    delete [] oi;
-
-    if (fake_ext != NULL) {
-      fake_ext->free_ord(); 
-      delete fake_ext;
+      // Cleanup.
+      delete [] oi;
+
+      if (fake_ext != NULL) {
+        fake_ext->free_ord(); 
+        delete fake_ext;
+      }
     }
+
+    // Increase due to reference map.
+    order = ru->get_inv_ref_order();
+    order += form_order;
+    limit_order(order);
   }
   return order;
 }
-int DiscreteProblem::calc_order_matrix_form_vol(WeakForm::MultiComponentMatrixFormVol *mfv, Hermes::vector<Solution *> u_ext,
+int DiscreteProblem::calc_order_matrix_form_vol(WeakForm::MultiComponentMatrixFormVol *mfv, Hermes::vector<Solution *>& u_ext,
                                                 PrecalcShapeset *fu, PrecalcShapeset *fv, RefMap *ru, RefMap *rv)
 {
   _F_
@@ -2450,56 +3569,65 @@ int DiscreteProblem::calc_order_matrix_form_vol(WeakForm::MultiComponentMatrixFo
   if(is_fvm) 
     order = ru->get_inv_ref_order();
   else {
-    int u_ext_length = u_ext.size();      // Number of external solutions.
-    int u_ext_offset = mfv->u_ext_offset; // External solutions will start with u_ext[u_ext_offset]
-                                          // and there will be only u_ext_length - u_ext_offset of them.
+    // Look the order up in the cache first, the form only needs to be parsed
+    // once for each combination of function orders.
+    OrderCacheKey key;
+    int form_order;
+    if (!get_order_cache_key(mfv, u_ext, fu, fv, mfv->ext, -1, key) || !order_cache_lookup(key, form_order)) {
+      int u_ext_length = u_ext.size();      // Number of external solutions.
+      int u_ext_offset = mfv->u_ext_offset; // External solutions will start with u_ext[u_ext_offset]
+                                            // and there will be only u_ext_length - u_ext_offset of them.
   
-    // Increase for multi-valued shape functions.
-    int inc = (fu->get_num_components() == 2) ? 1 : 0;
-
-    // Order of solutions from the previous Newton iteration.
-    Func<Ord>** oi = new Func<Ord>*[u_ext_length - u_ext_offset];
-    if (u_ext != Hermes::vector<Solution *>())
-      for(int i = 0; i < u_ext_length - u_ext_offset; i++)
-        if (u_ext[i + u_ext_offset] != NULL)
-          oi[i] = get_fn_ord(u_ext[i + u_ext_offset]->get_fn_order() + inc);
-        else
+      // Increase for multi-valued shape functions.
+      int inc = (fu->get_num_components() == 2) ? 1 : 0;
+
+      // Order of solutions from the previous Newton iteration.
+      Func<Ord>** oi = new Func<Ord>*[u_ext_length - u_ext_offset];
+      if (u_ext != Hermes::vector<Solution *>())
+        for(int i = 0; i < u_ext_length - u_ext_offset; i++)
+          if (u_ext[i + u_ext_offset] != NULL)
+            oi[i] = get_fn_ord(u_ext[i + u_ext_offset]->get_fn_order() + inc);
+          else
+            oi[i] = get_fn_ord(0);
+      else
+        for(int i = 0; i < u_ext_length - u_ext_offset; i++)
           oi[i] = get_fn_ord(0);
-    else
-      for(int i = 0; i < u_ext_length - u_ext_offset; i++)
-        oi[i] = get_fn_ord(0);
 
-    // Order of shape functions.
-    Func<Ord>* ou = get_fn_ord(fu->get_fn_order() + inc);
-    Func<Ord>* ov = get_fn_ord(fv->get_fn_order() + inc);
+      // Order of shape functions.
+      Func<Ord>* ou = get_fn_ord(fu->get_fn_order() + inc);
+      Func<Ord>* ov = get_fn_ord(fv->get_fn_order() + inc);
 
-    // Order of additional external functions.
-    ExtData<Ord>* fake_ext = init_ext_fns_ord(mfv->ext);
+      // Order of additional external functions.
+      ExtData<Ord>* fake_ext = init_ext_fns_ord(mfv->ext);
 
-    // Order of geometric attributes (eg. for multiplication of a solution with coordinates, normals, etc.).
-    double fake_wt = 1.0;
+      // Order of geometric attributes (eg. for multiplication of a solution with coordinates, normals, etc.).
+      double fake_wt = 1.0;
 
-    // Total order of the matrix form.
-    Ord o = mfv->ord(1, &fake_wt, oi, ou, ov, &geom_ord, fake_ext);
+      // Total order of the matrix form.
+      Ord o = mfv->ord(1, &fake_wt, oi, ou, ov, &geom_ord, fake_ext);
 
-    // Increase due to reference map.
-    order = ru->get_inv_ref_order();
-    order += o.get_order();
-    limit_order(order);
+      form_order = o.get_order();
+      order_cache_insert(key, form_order);
     
-    // Cleanup.
-    delete [] oi;
+      // Cleanup.
+      delete [] oi;
 
-    if (fake_ext != NULL) {
-      fake_ext->free_ord(); 
-      delete fake_ext;
+      if (fake_ext != NULL) {
+        fake_ext->free_ord(); 
+        delete fake_ext;
+      }
     }
+
+    // Increase due to reference map.
+    order = ru->get_inv_ref_order();
+    order += form_order;
+    limit_order(order);
   }
   return order;
 }
 
 scalar DiscreteProblem::eval_form_subelement(int order, WeakForm::MatrixFormVol *mfv, 
-                                             Hermes::vector<Solution *> u_ext,
+                                             Hermes::vector<Solution *>& u_ext,
                                              PrecalcShapeset *fu, PrecalcShapeset *fv, 
                                              RefMap *ru, RefMap *rv)
 {
@@ -2511,11 +3639,11 @@ scalar DiscreteProblem::eval_form_subelement(int order, WeakForm::MatrixFormVol
   // Init geometry and jacobian*weights.
   if (cache_e[order] == NULL)
   {
-    cache_e[order] = init_geom_vol(ru, order);
+    cache_e[order] = init_geom_vol(ru, order, &state_arena);
     double* jac = NULL;
     if(!ru->is_jacobian_const()) 
       jac = ru->get_jacobian(order);
-    cache_jwt[order] = new double[np];
+    cache_jwt[order] = state_arena.alloc_array<double>(np);
     for(int i = 0; i < np; i++) {
       if(ru->is_jacobian_const())
         cache_jwt[order][i] = pt[i][2] * ru->get_const_jacobian();
@@ -2529,11 +3657,12 @@ scalar DiscreteProblem::eval_form_subelement(int order, WeakForm::MatrixFormVol
   // Values of the previous Newton iteration, shape functions 
   // and external functions in quadrature points.
   int prev_size = u_ext.size() - mfv->u_ext_offset;
-  Func<scalar>** prev = new Func<scalar>*[prev_size];
+  Arena::Mark mark = form_arena.get_mark();
+  Func<scalar>** prev = form_arena.alloc_array<Func<scalar>*>(prev_size);
   if (u_ext != Hermes::vector<Solution *>())
     for (int i = 0; i < prev_size; i++)
       if (u_ext[i + mfv->u_ext_offset] != NULL) 
-        prev[i] = init_fn(u_ext[i + mfv->u_ext_offset], order);
+        prev[i] = init_fn(u_ext[i + mfv->u_ext_offset], order, &form_arena);
       else 
         prev[i] = NULL;
   else
@@ -2543,30 +3672,20 @@ scalar DiscreteProblem::eval_form_subelement(int order, WeakForm::MatrixFormVol
   Func<double>* u = get_fn(fu, ru, order);
   Func<double>* v = get_fn(fv, rv, order);
 
-  ExtData<scalar>* ext = init_ext_fns(mfv->ext, rv, order);
+  ExtData<scalar>* ext = init_ext_fns(mfv->ext, rv, order, &form_arena);
 
   // The actual calculation takes place here.
   scalar res = mfv->value(np, jwt, prev, u, v, e, ext) * mfv->scaling_factor;
 
   // Clean up.
-  for(int i = 0; i < prev_size; i++)
-    if (prev[i] != NULL) { 
-      prev[i]->free_fn(); 
-      delete prev[i]; 
-    }
-  delete [] prev;
-
-  if (ext != NULL) {
-    ext->free(); 
-    delete ext;
-  }
+  form_arena.release(mark);
 
   return res;
 }
 
 scalar DiscreteProblem::eval_form_adaptive(int order_init, scalar result_init,
                                            WeakForm::MatrixFormVol *mfv, 
-                                           Hermes::vector<Solution *> u_ext,
+                                           Hermes::vector<Solution *>& u_ext,
                                            PrecalcShapeset *fu, PrecalcShapeset *fv, 
                                            RefMap *ru, RefMap *rv)
 {
@@ -2576,7 +3695,8 @@ scalar DiscreteProblem::eval_form_adaptive(int order_init, scalar result_init,
   transformable_entities.insert(fv);
   transformable_entities.insert(ru);
   transformable_entities.insert(rv);
-  transformable_entities.insert(mfv->ext.begin(), mfv->ext.end());
+  for (unsigned int i = 0; i < mfv->ext.size(); i++)
+    transformable_entities.insert(get_ext_fn(mfv->ext[i]));
   transformable_entities.insert(u_ext.begin(), u_ext.end());
 
   scalar result = 0;
@@ -2655,7 +3775,7 @@ scalar DiscreteProblem::eval_form_adaptive(int order_init, scalar result_init,
 // Volume vector forms.
 
 scalar DiscreteProblem::eval_form(WeakForm::VectorFormVol *vfv, 
-                                  Hermes::vector<Solution *> u_ext, 
+                                  Hermes::vector<Solution *>& u_ext, 
                                   PrecalcShapeset *fv, RefMap *rv)
 {
   _F_
@@ -2691,7 +3811,7 @@ scalar DiscreteProblem::eval_form(WeakForm::VectorFormVol *vfv,
   return result;
 }
 void DiscreteProblem::eval_form(WeakForm::MultiComponentVectorFormVol *vfv, 
-                                  Hermes::vector<Solution *> u_ext, 
+                                  Hermes::vector<Solution *>& u_ext, 
                                   PrecalcShapeset *fv, RefMap *rv, Hermes::vector<scalar>& result)
 {
   _F_
@@ -2705,11 +3825,11 @@ void DiscreteProblem::eval_form(WeakForm::MultiComponentVectorFormVol *vfv,
   // Init geometry and jacobian*weights.
   if (cache_e[order] == NULL)
   {
-    cache_e[order] = init_geom_vol(rv, order);
+    cache_e[order] = init_geom_vol(rv, order, &state_arena);
     double* jac = NULL;
     if(!rv->is_jacobian_const()) 
       jac = rv->get_jacobian(order);
-    cache_jwt[order] = new double[np];
+    cache_jwt[order] = state_arena.alloc_array<double>(np);
     for(int i = 0; i < np; i++) {
       if(rv->is_jacobian_const())
         cache_jwt[order][i] = pt[i][2] * rv->get_const_jacobian();
@@ -2722,11 +3842,12 @@ void DiscreteProblem::eval_form(WeakForm::MultiComponentVectorFormVol *vfv,
 
   // Values of the previous Newton iteration, shape functions and external functions in quadrature points.
   int prev_size = u_ext.size() - vfv->u_ext_offset;
-  Func<scalar>** prev = new Func<scalar>*[prev_size];
+  Arena::Mark mark = form_arena.get_mark();
+  Func<scalar>** prev = form_arena.alloc_array<Func<scalar>*>(prev_size);
   if (u_ext != Hermes::vector<Solution *>())
     for (int i = 0; i < prev_size; i++)
       if (u_ext[i + vfv->u_ext_offset] != NULL) 
-        prev[i] = init_fn(u_ext[i + vfv->u_ext_offset], order);
+        prev[i] = init_fn(u_ext[i + vfv->u_ext_offset], order, &form_arena);
       else 
         prev[i] = NULL;
   else
@@ -2734,7 +3855,7 @@ void DiscreteProblem::eval_form(WeakForm::MultiComponentVectorFormVol *vfv,
       prev[i] = NULL;
 
   Func<double>* v = get_fn(fv, rv, order);
-  ExtData<scalar>* ext = init_ext_fns(vfv->ext, rv, order);
+  ExtData<scalar>* ext = init_ext_fns(vfv->ext, rv, order, &form_arena);
 
   // The actual calculation takes place here.
   vfv->value(np, jwt, prev, v, e, ext, result);
@@ -2743,21 +3864,11 @@ void DiscreteProblem::eval_form(WeakForm::MultiComponentVectorFormVol *vfv,
     result[i] *= vfv->scaling_factor;
 
   // Clean up.
-  for(int i = 0; i < prev_size; i++)
-    if (prev[i] != NULL) { 
-      prev[i]->free_fn(); 
-      delete prev[i]; 
-    }
-  delete [] prev;
-
-  if (ext != NULL) {
-    ext->free(); 
-    delete ext;
-  }
+  form_arena.release(mark);
 }
 
 int DiscreteProblem::calc_order_vector_form_vol(WeakForm::VectorFormVol *vfv, 
-                                                Hermes::vector<Solution *> u_ext,
+                                                Hermes::vector<Solution *>& u_ext,
                                                 PrecalcShapeset *fv, RefMap *rv)
 {
   _F_
@@ -2767,55 +3878,64 @@ int DiscreteProblem::calc_order_vector_form_vol(WeakForm::VectorFormVol *vfv,
   if(is_fvm) 
     order = rv->get_inv_ref_order();
   else {
-    int u_ext_length = u_ext.size();      // Number of external solutions.
-    int u_ext_offset = vfv->u_ext_offset; // External solutions will start with u_ext[u_ext_offset]
-                                          // and there will be only u_ext_length - u_ext_offset of them.
+    // Look the order up in the cache first, the form only needs to be parsed
+    // once for each combination of function orders.
+    OrderCacheKey key;
+    int form_order;
+    if (!get_order_cache_key(vfv, u_ext, NULL, fv, vfv->ext, -1, key) || !order_cache_lookup(key, form_order)) {
+      int u_ext_length = u_ext.size();      // Number of external solutions.
+      int u_ext_offset = vfv->u_ext_offset; // External solutions will start with u_ext[u_ext_offset]
+                                            // and there will be only u_ext_length - u_ext_offset of them.
   
-    // Increase for multi-valued shape functions.
-    int inc = (fv->get_num_components() == 2) ? 1 : 0;
-
-    // Order of solutions from the previous Newton iteration.
-    Func<Ord>** oi = new Func<Ord>*[u_ext_length - u_ext_offset];
-    if (u_ext != Hermes::vector<Solution *>())
-      for(int i = 0; i < u_ext_length - u_ext_offset; i++)
-        if (u_ext[i + u_ext_offset] != NULL)
-          oi[i] = get_fn_ord(u_ext[i + u_ext_offset]->get_fn_order() + inc);
-        else
+      // Increase for multi-valued shape functions.
+      int inc = (fv->get_num_components() == 2) ? 1 : 0;
+
+      // Order of solutions from the previous Newton iteration.
+      Func<Ord>** oi = new Func<Ord>*[u_ext_length - u_ext_offset];
+      if (u_ext != Hermes::vector<Solution *>())
+        for(int i = 0; i < u_ext_length - u_ext_offset; i++)
+          if (u_ext[i + u_ext_offset] != NULL)
+            oi[i] = get_fn_ord(u_ext[i + u_ext_offset]->get_fn_order() + inc);
+          else
+            oi[i] = get_fn_ord(0);
+      else
+        for(int i = 0; i < u_ext_length - u_ext_offset; i++)
           oi[i] = get_fn_ord(0);
-    else
-      for(int i = 0; i < u_ext_length - u_ext_offset; i++)
-        oi[i] = get_fn_ord(0);
 
-    // Order of the shape function.
-    Func<Ord>* ov = get_fn_ord(fv->get_fn_order() + inc);
+      // Order of the shape function.
+      Func<Ord>* ov = get_fn_ord(fv->get_fn_order() + inc);
 
-    // Order of additional external functions.
-    ExtData<Ord>* fake_ext = init_ext_fns_ord(vfv->ext);
+      // Order of additional external functions.
+      ExtData<Ord>* fake_ext = init_ext_fns_ord(vfv->ext);
 
-    // Order of geometric attributes (eg. for multiplication of 
-    // a solution with coordinates, normals, etc.).
-    double fake_wt = 1.0;
+      // Order of geometric attributes (eg. for multiplication of 
+      // a solution with coordinates, normals, etc.).
+      double fake_wt = 1.0;
 
-    // Total order of the vector form.
-    Ord o = vfv->ord(1, &fake_wt, oi, ov, &geom_ord, fake_ext);
+      // Total order of the vector form.
+      Ord o = vfv->ord(1, &fake_wt, oi, ov, &geom_ord, fake_ext);
 
-    // Increase due to reference map.
-    order = rv->get_inv_ref_order();
-    order += o.get_order();
-    limit_order(order);
+      form_order = o.get_order();
+      order_cache_insert(key, form_order);
     
-    // Cleanup.
-    delete [] oi;
+      // Cleanup.
+      delete [] oi;
 
-    if (fake_ext != NULL) {
-      fake_ext->free_ord(); 
-      delete fake_ext;
+      if (fake_ext != NULL) {
+        fake_ext->free_ord(); 
+        delete fake_ext;
+      }
     }
+
+    // Increase due to reference map.
+    order = rv->get_inv_ref_order();
+    order += form_order;
+    limit_order(order);
   }
   return order;
 }
 int DiscreteProblem::calc_order_vector_form_vol(WeakForm::MultiComponentVectorFormVol *vfv, 
-                                                Hermes::vector<Solution *> u_ext,
+                                                Hermes::vector<Solution *>& u_ext,
                                                 PrecalcShapeset *fv, RefMap *rv)
 {
   _F_
@@ -2825,56 +3945,65 @@ int DiscreteProblem::calc_order_vector_form_vol(WeakForm::MultiComponentVectorFo
   if(is_fvm) 
     order = rv->get_inv_ref_order();
   else {
-    int u_ext_length = u_ext.size();      // Number of external solutions.
-    int u_ext_offset = vfv->u_ext_offset; // External solutions will start with u_ext[u_ext_offset]
-                                          // and there will be only u_ext_length - u_ext_offset of them.
+    // Look the order up in the cache first, the form only needs to be parsed
+    // once for each combination of function orders.
+    OrderCacheKey key;
+    int form_order;
+    if (!get_order_cache_key(vfv, u_ext, NULL, fv, vfv->ext, -1, key) || !order_cache_lookup(key, form_order)) {
+      int u_ext_length = u_ext.size();      // Number of external solutions.
+      int u_ext_offset = vfv->u_ext_offset; // External solutions will start with u_ext[u_ext_offset]
+                                            // and there will be only u_ext_length - u_ext_offset of them.
   
-    // Increase for multi-valued shape functions.
-    int inc = (fv->get_num_components() == 2) ? 1 : 0;
-
-    // Order of solutions from the previous Newton iteration.
-    Func<Ord>** oi = new Func<Ord>*[u_ext_length - u_ext_offset];
-    if (u_ext != Hermes::vector<Solution *>())
-      for(int i = 0; i < u_ext_length - u_ext_offset; i++)
-        if (u_ext[i + u_ext_offset] != NULL)
-          oi[i] = get_fn_ord(u_ext[i + u_ext_offset]->get_fn_order() + inc);
-        else
+      // Increase for multi-valued shape functions.
+      int inc = (fv->get_num_components() == 2) ? 1 : 0;
+
+      // Order of solutions from the previous Newton iteration.
+      Func<Ord>** oi = new Func<Ord>*[u_ext_length - u_ext_offset];
+      if (u_ext != Hermes::vector<Solution *>())
+        for(int i = 0; i < u_ext_length - u_ext_offset; i++)
+          if (u_ext[i + u_ext_offset] != NULL)
+            oi[i] = get_fn_ord(u_ext[i + u_ext_offset]->get_fn_order() + inc);
+          else
+            oi[i] = get_fn_ord(0);
+      else
+        for(int i = 0; i < u_ext_length - u_ext_offset; i++)
           oi[i] = get_fn_ord(0);
-    else
-      for(int i = 0; i < u_ext_length - u_ext_offset; i++)
-        oi[i] = get_fn_ord(0);
 
-    // Order of the shape function.
-    Func<Ord>* ov = get_fn_ord(fv->get_fn_order() + inc);
+      // Order of the shape function.
+      Func<Ord>* ov = get_fn_ord(fv->get_fn_order() + inc);
 
-    // Order of additional external functions.
-    ExtData<Ord>* fake_ext = init_ext_fns_ord(vfv->ext);
+      // Order of additional external functions.
+      ExtData<Ord>* fake_ext = init_ext_fns_ord(vfv->ext);
 
-    // Order of geometric attributes (eg. for multiplication of 
-    // a solution with coordinates, normals, etc.).
-    double fake_wt = 1.0;
+      // Order of geometric attributes (eg. for multiplication of 
+      // a solution with coordinates, normals, etc.).
+      double fake_wt = 1.0;
 
-    // Total order of the vector form.
-    Ord o = vfv->ord(1, &fake_wt, oi, ov, &geom_ord, fake_ext);
+      // Total order of the vector form.
+      Ord o = vfv->ord(1, &fake_wt, oi, ov, &geom_ord, fake_ext);
 
-    // Increase due to reference map.
-    order = rv->get_inv_ref_order();
-    order += o.get_order();
-    limit_order(order);
+      form_order = o.get_order();
+      order_cache_insert(key, form_order);
     
-    // Cleanup.
-    delete [] oi;
+      // Cleanup.
+      delete [] oi;
 
-    if (fake_ext != NULL) {
-      fake_ext->free_ord(); 
-      delete fake_ext;
+      if (fake_ext != NULL) {
+        fake_ext->free_ord(); 
+        delete fake_ext;
+      }
     }
+
+    // Increase due to reference map.
+    order = rv->get_inv_ref_order();
+    order += form_order;
+    limit_order(order);
   }
   return order;
 }
 
 scalar DiscreteProblem::eval_form_subelement(int order, WeakForm::VectorFormVol *vfv, 
-                                  Hermes::vector<Solution *> u_ext, 
+                                  Hermes::vector<Solution *>& u_ext, 
                                   PrecalcShapeset *fv, RefMap *rv)
 {
   _F_
@@ -2886,11 +4015,11 @@ scalar DiscreteProblem::eval_form_subelement(int order, WeakForm::VectorFormVol
   // Init geometry and jacobian*weights.
   if (cache_e[order] == NULL)
   {
-    cache_e[order] = init_geom_vol(rv, order);
+    cache_e[order] = init_geom_vol(rv, order, &state_arena);
     double* jac = NULL;
     if(!rv->is_jacobian_const()) 
       jac = rv->get_jacobian(order);
-    cache_jwt[order] = new double[np];
+    cache_jwt[order] = state_arena.alloc_array<double>(np);
     for(int i = 0; i < np; i++) {
       if(rv->is_jacobian_const())
         cache_jwt[order][i] = pt[i][2] * rv->get_const_jacobian();
@@ -2903,11 +4032,12 @@ scalar DiscreteProblem::eval_form_subelement(int order, WeakForm::VectorFormVol
 
   // Values of the previous Newton iteration, shape functions and external functions in quadrature points.
   int prev_size = u_ext.size() - vfv->u_ext_offset;
-  Func<scalar>** prev = new Func<scalar>*[prev_size];
+  Arena::Mark mark = form_arena.get_mark();
+  Func<scalar>** prev = form_arena.alloc_array<Func<scalar>*>(prev_size);
   if (u_ext != Hermes::vector<Solution *>())
     for (int i = 0; i < prev_size; i++)
       if (u_ext[i + vfv->u_ext_offset] != NULL) 
-        prev[i] = init_fn(u_ext[i + vfv->u_ext_offset], order);
+        prev[i] = init_fn(u_ext[i + vfv->u_ext_offset], order, &form_arena);
       else 
         prev[i] = NULL;
   else
@@ -2915,36 +4045,27 @@ scalar DiscreteProblem::eval_form_subelement(int order, WeakForm::VectorFormVol
       prev[i] = NULL;
 
   Func<double>* v = get_fn(fv, rv, order);
-  ExtData<scalar>* ext = init_ext_fns(vfv->ext, rv, order);
+  ExtData<scalar>* ext = init_ext_fns(vfv->ext, rv, order, &form_arena);
 
   // The actual calculation takes place here.
   scalar res = vfv->value(np, jwt, prev, v, e, ext) * vfv->scaling_factor;
 
   // Clean up.
-  for(int i = 0; i < prev_size; i++)
-    if (prev[i] != NULL) { 
-      prev[i]->free_fn(); 
-      delete prev[i]; 
-    }
-  delete [] prev;
-
-  if (ext != NULL) {
-    ext->free(); 
-    delete ext;
-  }
+  form_arena.release(mark);
 
   return res;
 }
 
 scalar DiscreteProblem::eval_form_adaptive(int order_init, scalar result_init,
-                                           WeakForm::VectorFormVol *vfv, Hermes::vector<Solution *> u_ext,
+                                           WeakForm::VectorFormVol *vfv, Hermes::vector<Solution *>& u_ext,
                                            PrecalcShapeset *fv, RefMap *rv)
 {
   // Initialize set of all transformable entities.
   std::set<Transformable *> transformable_entities;
   transformable_entities.insert(fv);
   transformable_entities.insert(rv);
-  transformable_entities.insert(vfv->ext.begin(), vfv->ext.end());
+  for (unsigned int i = 0; i < vfv->ext.size(); i++)
+    transformable_entities.insert(get_ext_fn(vfv->ext[i]));
   transformable_entities.insert(u_ext.begin(), u_ext.end());
 
   scalar result = 0;
@@ -3023,7 +4144,7 @@ scalar DiscreteProblem::eval_form_adaptive(int order_init, scalar result_init,
 // Surface matrix forms.
 
 scalar DiscreteProblem::eval_form(WeakForm::MatrixFormSurf *mfs, 
-                                  Hermes::vector<Solution *> u_ext, 
+                                  Hermes::vector<Solution *>& u_ext, 
                                   PrecalcShapeset *fu, PrecalcShapeset *fv, RefMap *ru, RefMap *rv, SurfPos* surf_pos)
 {
   _F_
@@ -3056,7 +4177,7 @@ scalar DiscreteProblem::eval_form(WeakForm::MatrixFormSurf *mfs,
   return result;
 }
 void DiscreteProblem::eval_form(WeakForm::MultiComponentMatrixFormSurf *mfs, 
-                                  Hermes::vector<Solution *> u_ext, 
+                                  Hermes::vector<Solution *>& u_ext, 
                                   PrecalcShapeset *fu, PrecalcShapeset *fv, RefMap *ru, RefMap *rv, SurfPos* surf_pos, Hermes::vector<scalar>& result)
 {
   _F_
@@ -3072,9 +4193,9 @@ void DiscreteProblem::eval_form(WeakForm::MultiComponentMatrixFormSurf *mfs,
   // Init geometry and jacobian*weights.
   if (cache_e[eo] == NULL)
   {
-    cache_e[eo] = init_geom_surf(ru, surf_pos, eo);
+    cache_e[eo] = init_geom_surf(ru, surf_pos, eo, &state_arena);
     double3* tan = ru->get_tangent(surf_pos->surf_num, eo);
-    cache_jwt[eo] = new double[np];
+    cache_jwt[eo] = state_arena.alloc_array<double>(np);
     for(int i = 0; i < np; i++)
       cache_jwt[eo][i] = pt[i][2] * tan[i][2];
   }
@@ -3083,11 +4204,12 @@ void DiscreteProblem::eval_form(WeakForm::MultiComponentMatrixFormSurf *mfs,
 
   // Values of the previous Newton iteration, shape functions and external functions in quadrature points.
   int prev_size = u_ext.size() - mfs->u_ext_offset;
-  Func<scalar>** prev = new Func<scalar>*[prev_size];
+  Arena::Mark mark = form_arena.get_mark();
+  Func<scalar>** prev = form_arena.alloc_array<Func<scalar>*>(prev_size);
   if (u_ext != Hermes::vector<Solution *>())
     for (int i = 0; i < prev_size; i++)
       if (u_ext[i + mfs->u_ext_offset] != NULL) 
-        prev[i] = init_fn(u_ext[i + mfs->u_ext_offset], eo);
+        prev[i] = init_fn(u_ext[i + mfs->u_ext_offset], eo, &form_arena);
       else 
         prev[i] = NULL;
   else
@@ -3096,7 +4218,7 @@ void DiscreteProblem::eval_form(WeakForm::MultiComponentMatrixFormSurf *mfs,
 
   Func<double>* u = get_fn(fu, ru, eo);
   Func<double>* v = get_fn(fv, rv, eo);
-  ExtData<scalar>* ext = init_ext_fns(mfs->ext, rv, eo);
+  ExtData<scalar>* ext = init_ext_fns(mfs->ext, rv, eo, &form_arena);
 
   // The actual calculation takes place here.
   mfs->value(np, jwt, prev, u, v, e, ext, result);
@@ -3105,20 +4227,10 @@ void DiscreteProblem::eval_form(WeakForm::MultiComponentMatrixFormSurf *mfs,
     result[i] *= mfs->scaling_factor * 0.5;
 
   // Clean up.
-  for(int i = 0; i < prev_size; i++)
-    if (prev[i] != NULL) { 
-      prev[i]->free_fn(); 
-      delete prev[i]; 
-    }
-  delete [] prev;
-
-  if (ext != NULL) {
-    ext->free(); 
-    delete ext;
-  }
+  form_arena.release(mark);
 }
 
-int DiscreteProblem::calc_order_matrix_form_surf(WeakForm::MatrixFormSurf *mfs, Hermes::vector<Solution *> u_ext,
+int DiscreteProblem::calc_order_matrix_form_surf(WeakForm::MatrixFormSurf *mfs, Hermes::vector<Solution *>& u_ext,
                                   PrecalcShapeset *fu, PrecalcShapeset *fv, RefMap *ru, RefMap *rv, SurfPos* surf_pos)
 {
   _F_
@@ -3128,54 +4240,63 @@ int DiscreteProblem::calc_order_matrix_form_surf(WeakForm::MatrixFormSurf *mfs,
   if(is_fvm)
     order = ru->get_inv_ref_order();
   else {
-    int u_ext_length = u_ext.size();      // Number of external solutions.
-    int u_ext_offset = mfs->u_ext_offset; // External solutions will start with u_ext[u_ext_offset]
-                                          // and there will be only u_ext_length - u_ext_offset of them.
+    // Look the order up in the cache first, the form only needs to be parsed
+    // once for each combination of function orders.
+    OrderCacheKey key;
+    int form_order;
+    if (!get_order_cache_key(mfs, u_ext, fu, fv, mfs->ext, surf_pos->surf_num, key) || !order_cache_lookup(key, form_order)) {
+      int u_ext_length = u_ext.size();      // Number of external solutions.
+      int u_ext_offset = mfs->u_ext_offset; // External solutions will start with u_ext[u_ext_offset]
+                                            // and there will be only u_ext_length - u_ext_offset of them.
   
-    // Increase for multi-valued shape functions.
-    int inc = (fu->get_num_components() == 2) ? 1 : 0;
-
-    // Order of solutions from the previous Newton iteration.
-    Func<Ord>** oi = new Func<Ord>*[u_ext_length - u_ext_offset];
-    if (u_ext != Hermes::vector<Solution *>())
-      for(int i = 0; i < u_ext_length - u_ext_offset; i++)
-        if (u_ext[i + u_ext_offset] != NULL)
-          oi[i] = get_fn_ord(u_ext[i + u_ext_offset]->get_edge_fn_order(surf_pos->surf_num) + inc);
-        else
+      // Increase for multi-valued shape functions.
+      int inc = (fu->get_num_components() == 2) ? 1 : 0;
+
+      // Order of solutions from the previous Newton iteration.
+      Func<Ord>** oi = new Func<Ord>*[u_ext_length - u_ext_offset];
+      if (u_ext != Hermes::vector<Solution *>())
+        for(int i = 0; i < u_ext_length - u_ext_offset; i++)
+          if (u_ext[i + u_ext_offset] != NULL)
+            oi[i] = get_fn_ord(u_ext[i + u_ext_offset]->get_edge_fn_order(surf_pos->surf_num) + inc);
+          else
+            oi[i] = get_fn_ord(0);
+      else
+        for(int i = 0; i < u_ext_length - u_ext_offset; i++)
           oi[i] = get_fn_ord(0);
-    else
-      for(int i = 0; i < u_ext_length - u_ext_offset; i++)
-        oi[i] = get_fn_ord(0);
 
-    // Order of shape functions.
-    Func<Ord>* ou = get_fn_ord(fu->get_edge_fn_order(surf_pos->surf_num) + inc);
-    Func<Ord>* ov = get_fn_ord(fv->get_edge_fn_order(surf_pos->surf_num) + inc);
+      // Order of shape functions.
+      Func<Ord>* ou = get_fn_ord(fu->get_edge_fn_order(surf_pos->surf_num) + inc);
+      Func<Ord>* ov = get_fn_ord(fv->get_edge_fn_order(surf_pos->surf_num) + inc);
 
-    // Order of additional external functions.
-    ExtData<Ord>* fake_ext = init_ext_fns_ord(mfs->ext, surf_pos->surf_num);
+      // Order of additional external functions.
+      ExtData<Ord>* fake_ext = init_ext_fns_ord(mfs->ext, surf_pos->surf_num);
 
-    // Order of geometric attributes (eg. for multiplication of a solution with coordinates, normals, etc.).
-    double fake_wt = 1.0;
+      // Order of geometric attributes (eg. for multiplication of a solution with coordinates, normals, etc.).
+      double fake_wt = 1.0;
 
-    // Total order of the matrix form.
-    Ord o = mfs->ord(1, &fake_wt, oi, ou, ov, &geom_ord, fake_ext);
+      // Total order of the matrix form.
+      Ord o = mfs->ord(1, &fake_wt, oi, ou, ov, &geom_ord, fake_ext);
 
-    // Increase due to reference map.
-    order = ru->get_inv_ref_order();
-    order += o.get_order();
-    limit_order(order);
+      form_order = o.get_order();
+      order_cache_insert(key, form_order);
 
-    // Cleanup.
-    delete [] oi;
+      // Cleanup.
+      delete [] oi;
 
-    if (fake_ext != NULL) {
-      fake_ext->free_ord(); 
-      delete fake_ext;
+      if (fake_ext != NULL) {
+        fake_ext->free_ord(); 
+        delete fake_ext;
+      }
     }
+
+    // Increase due to reference map.
+    order = ru->get_inv_ref_order();
+    order += form_order;
+    limit_order(order);
   }
   return order;
 }
-int DiscreteProblem::calc_order_matrix_form_surf(WeakForm::MultiComponentMatrixFormSurf *mfs, Hermes::vector<Solution *> u_ext,
+int DiscreteProblem::calc_order_matrix_form_surf(WeakForm::MultiComponentMatrixFormSurf *mfs, Hermes::vector<Solution *>& u_ext,
                                   PrecalcShapeset *fu, PrecalcShapeset *fv, RefMap *ru, RefMap *rv, SurfPos* surf_pos)
 {
   _F_
@@ -3185,55 +4306,64 @@ int DiscreteProblem::calc_order_matrix_form_surf(WeakForm::MultiComponentMatrixF
   if(is_fvm)
     order = ru->get_inv_ref_order();
   else {
-    int u_ext_length = u_ext.size();      // Number of external solutions.
-    int u_ext_offset = mfs->u_ext_offset; // External solutions will start with u_ext[u_ext_offset]
-                                          // and there will be only u_ext_length - u_ext_offset of them.
+    // Look the order up in the cache first, the form only needs to be parsed
+    // once for each combination of function orders.
+    OrderCacheKey key;
+    int form_order;
+    if (!get_order_cache_key(mfs, u_ext, fu, fv, mfs->ext, surf_pos->surf_num, key) || !order_cache_lookup(key, form_order)) {
+      int u_ext_length = u_ext.size();      // Number of external solutions.
+      int u_ext_offset = mfs->u_ext_offset; // External solutions will start with u_ext[u_ext_offset]
+                                            // and there will be only u_ext_length - u_ext_offset of them.
   
-    // Increase for multi-valued shape functions.
-    int inc = (fu->get_num_components() == 2) ? 1 : 0;
-
-    // Order of solutions from the previous Newton iteration.
-    Func<Ord>** oi = new Func<Ord>*[u_ext_length - u_ext_offset];
-    if (u_ext != Hermes::vector<Solution *>())
-      for(int i = 0; i < u_ext_length - u_ext_offset; i++)
-        if (u_ext[i + u_ext_offset] != NULL)
-          oi[i] = get_fn_ord(u_ext[i + u_ext_offset]->get_edge_fn_order(surf_pos->surf_num) + inc);
-        else
+      // Increase for multi-valued shape functions.
+      int inc = (fu->get_num_components() == 2) ? 1 : 0;
+
+      // Order of solutions from the previous Newton iteration.
+      Func<Ord>** oi = new Func<Ord>*[u_ext_length - u_ext_offset];
+      if (u_ext != Hermes::vector<Solution *>())
+        for(int i = 0; i < u_ext_length - u_ext_offset; i++)
+          if (u_ext[i + u_ext_offset] != NULL)
+            oi[i] = get_fn_ord(u_ext[i + u_ext_offset]->get_edge_fn_order(surf_pos->surf_num) + inc);
+          else
+            oi[i] = get_fn_ord(0);
+      else
+        for(int i = 0; i < u_ext_length - u_ext_offset; i++)
           oi[i] = get_fn_ord(0);
-    else
-      for(int i = 0; i < u_ext_length - u_ext_offset; i++)
-        oi[i] = get_fn_ord(0);
 
-    // Order of shape functions.
-    Func<Ord>* ou = get_fn_ord(fu->get_edge_fn_order(surf_pos->surf_num) + inc);
-    Func<Ord>* ov = get_fn_ord(fv->get_edge_fn_order(surf_pos->surf_num) + inc);
+      // Order of shape functions.
+      Func<Ord>* ou = get_fn_ord(fu->get_edge_fn_order(surf_pos->surf_num) + inc);
+      Func<Ord>* ov = get_fn_ord(fv->get_edge_fn_order(surf_pos->surf_num) + inc);
 
-    // Order of additional external functions.
-    ExtData<Ord>* fake_ext = init_ext_fns_ord(mfs->ext, surf_pos->surf_num);
+      // Order of additional external functions.
+      ExtData<Ord>* fake_ext = init_ext_fns_ord(mfs->ext, surf_pos->surf_num);
 
-    // Order of geometric attributes (eg. for multiplication of a solution with coordinates, normals, etc.).
-    double fake_wt = 1.0;
+      // Order of geometric attributes (eg. for multiplication of a solution with coordinates, normals, etc.).
+      double fake_wt = 1.0;
 
-    // Total order of the matrix form.
-    Ord o = mfs->ord(1, &fake_wt, oi, ou, ov, &geom_ord, fake_ext);
+      // Total order of the matrix form.
+      Ord o = mfs->ord(1, &fake_wt, oi, ou, ov, &geom_ord, fake_ext);
 
-    // Increase due to reference map.
-    order = ru->get_inv_ref_order();
-    order += o.get_order();
-    limit_order(order);
+      form_order = o.get_order();
+      order_cache_insert(key, form_order);
 
-    // Cleanup.
-    delete [] oi;
+      // Cleanup.
+      delete [] oi;
 
-    if (fake_ext != NULL) {
-      fake_ext->free_ord(); 
-      delete fake_ext;
+      if (fake_ext != NULL) {
+        fake_ext->free_ord(); 
+        delete fake_ext;
+      }
     }
+
+    // Increase due to reference map.
+    order = ru->get_inv_ref_order();
+    order += form_order;
+    limit_order(order);
   }
   return order;
 }
 
-scalar DiscreteProblem::eval_form_subelement(int order, WeakForm::MatrixFormSurf *mfs, Hermes::vector<Solution *> u_ext,
+scalar DiscreteProblem::eval_form_subelement(int order, WeakForm::MatrixFormSurf *mfs, Hermes::vector<Solution *>& u_ext,
                         PrecalcShapeset *fu, PrecalcShapeset *fv, RefMap *ru, RefMap *rv, SurfPos* surf_pos)
 {
   _F_
@@ -3247,9 +4377,9 @@ scalar DiscreteProblem::eval_form_subelement(int order, WeakForm::MatrixFormSurf
   // Init geometry and jacobian*weights.
   if (cache_e[eo] == NULL)
   {
-    cache_e[eo] = init_geom_surf(ru, surf_pos, eo);
+    cache_e[eo] = init_geom_surf(ru, surf_pos, eo, &state_arena);
     double3* tan = ru->get_tangent(surf_pos->surf_num, eo);
-    cache_jwt[eo] = new double[np];
+    cache_jwt[eo] = state_arena.alloc_array<double>(np);
     for(int i = 0; i < np; i++)
       cache_jwt[eo][i] = pt[i][2] * tan[i][2];
   }
@@ -3258,11 +4388,12 @@ scalar DiscreteProblem::eval_form_subelement(int order, WeakForm::MatrixFormSurf
 
   // Values of the previous Newton iteration, shape functions and external functions in quadrature points.
   int prev_size = u_ext.size() - mfs->u_ext_offset;
-  Func<scalar>** prev = new Func<scalar>*[prev_size];
+  Arena::Mark mark = form_arena.get_mark();
+  Func<scalar>** prev = form_arena.alloc_array<Func<scalar>*>(prev_size);
   if (u_ext != Hermes::vector<Solution *>())
     for (int i = 0; i < prev_size; i++)
       if (u_ext[i + mfs->u_ext_offset] != NULL) 
-        prev[i] = init_fn(u_ext[i + mfs->u_ext_offset], eo);
+        prev[i] = init_fn(u_ext[i + mfs->u_ext_offset], eo, &form_arena);
       else 
         prev[i] = NULL;
   else
@@ -3271,23 +4402,13 @@ scalar DiscreteProblem::eval_form_subelement(int order, WeakForm::MatrixFormSurf
 
   Func<double>* u = get_fn(fu, ru, eo);
   Func<double>* v = get_fn(fv, rv, eo);
-  ExtData<scalar>* ext = init_ext_fns(mfs->ext, rv, eo);
+  ExtData<scalar>* ext = init_ext_fns(mfs->ext, rv, eo, &form_arena);
 
   // The actual calculation takes place here.
   scalar res = mfs->value(np, jwt, prev, u, v, e, ext) * mfs->scaling_factor;
 
   // Clean up.
-  for(int i = 0; i < prev_size; i++)
-    if (prev[i] != NULL) { 
-      prev[i]->free_fn(); 
-      delete prev[i]; 
-    }
-  delete [] prev;
-
-  if (ext != NULL) {
-    ext->free(); 
-    delete ext;
-  }
+  form_arena.release(mark);
 
   return 0.5 * res; // Edges are parameterized from 0 to 1 while integration weights
                     // are defined in (-1, 1). Thus multiplying with 0.5 to correct
@@ -3295,7 +4416,7 @@ scalar DiscreteProblem::eval_form_subelement(int order, WeakForm::MatrixFormSurf
 }
 
 scalar DiscreteProblem::eval_form_adaptive(int order_init, scalar result_init,
-                                           WeakForm::MatrixFormSurf *mfs, Hermes::vector<Solution *> u_ext,
+                                           WeakForm::MatrixFormSurf *mfs, Hermes::vector<Solution *>& u_ext,
                                            PrecalcShapeset *fu, PrecalcShapeset *fv, RefMap *ru, RefMap *rv, SurfPos* surf_pos)
 {
   // Initialize set of all transformable entities.
@@ -3304,7 +4425,8 @@ scalar DiscreteProblem::eval_form_adaptive(int order_init, scalar result_init,
   transformable_entities.insert(fv);
   transformable_entities.insert(ru);
   transformable_entities.insert(rv);
-  transformable_entities.insert(mfs->ext.begin(), mfs->ext.end());
+  for (unsigned int i = 0; i < mfs->ext.size(); i++)
+    transformable_entities.insert(get_ext_fn(mfs->ext[i]));
   transformable_entities.insert(u_ext.begin(), u_ext.end());
 
   scalar result = 0;
@@ -3383,7 +4505,7 @@ scalar DiscreteProblem::eval_form_adaptive(int order_init, scalar result_init,
 // Surface vector forms.
 
 scalar DiscreteProblem::eval_form(WeakForm::VectorFormSurf *vfs, 
-                                  Hermes::vector<Solution *> u_ext, 
+                                  Hermes::vector<Solution *>& u_ext, 
                                   PrecalcShapeset *fv, RefMap *rv, SurfPos* surf_pos)
 {
   _F_
@@ -3415,7 +4537,7 @@ scalar DiscreteProblem::eval_form(WeakForm::VectorFormSurf *vfs,
   return result;
 }
 void DiscreteProblem::eval_form(WeakForm::MultiComponentVectorFormSurf *vfs, 
-                                  Hermes::vector<Solution *> u_ext, 
+                                  Hermes::vector<Solution *>& u_ext, 
                                   PrecalcShapeset *fv, RefMap *rv, SurfPos* surf_pos, Hermes::vector<scalar>& result)
 {
   _F_
@@ -3430,9 +4552,9 @@ void DiscreteProblem::eval_form(WeakForm::MultiComponentVectorFormSurf *vfs,
 
   // Init geometry and jacobian*weights.
   if (cache_e[eo] == NULL) {
-    cache_e[eo] = init_geom_surf(rv, surf_pos, eo);
+    cache_e[eo] = init_geom_surf(rv, surf_pos, eo, &state_arena);
     double3* tan = rv->get_tangent(surf_pos->surf_num, eo);
-    cache_jwt[eo] = new double[np];
+    cache_jwt[eo] = state_arena.alloc_array<double>(np);
     for(int i = 0; i < np; i++)
       cache_jwt[eo][i] = pt[i][2] * tan[i][2];
   }
@@ -3441,11 +4563,12 @@ void DiscreteProblem::eval_form(WeakForm::MultiComponentVectorFormSurf *vfs,
 
   // Values of the previous Newton iteration, shape functions and external functions in quadrature points.
   int prev_size = u_ext.size() - vfs->u_ext_offset;
-  Func<scalar>** prev = new Func<scalar>*[prev_size];
+  Arena::Mark mark = form_arena.get_mark();
+  Func<scalar>** prev = form_arena.alloc_array<Func<scalar>*>(prev_size);
   if (u_ext != Hermes::vector<Solution *>())
     for (int i = 0; i < prev_size; i++)
       if (u_ext[i + vfs->u_ext_offset] != NULL) 
-        prev[i] = init_fn(u_ext[i + vfs->u_ext_offset], eo);
+        prev[i] = init_fn(u_ext[i + vfs->u_ext_offset], eo, &form_arena);
       else 
         prev[i] = NULL;
   else
@@ -3453,7 +4576,7 @@ void DiscreteProblem::eval_form(WeakForm::MultiComponentVectorFormSurf *vfs,
       prev[i] = NULL;
 
   Func<double>* v = get_fn(fv, rv, eo);
-  ExtData<scalar>* ext = init_ext_fns(vfs->ext, rv, eo);
+  ExtData<scalar>* ext = init_ext_fns(vfs->ext, rv, eo, &form_arena);
 
   // The actual calculation takes place here.
   vfs->value(np, jwt, prev, v, e, ext, result);
@@ -3462,20 +4585,10 @@ void DiscreteProblem::eval_form(WeakForm::MultiComponentVectorFormSurf *vfs,
     result[i] *= vfs->scaling_factor * 0.5;
 
   // Clean up.
-  for(int i = 0; i < prev_size; i++)
-    if (prev[i] != NULL) { 
-      prev[i]->free_fn(); 
-      delete prev[i]; 
-    }
-  delete [] prev;
-
-  if (ext != NULL) {
-    ext->free(); 
-    delete ext;
-  }
+  form_arena.release(mark);
 }
 
-int DiscreteProblem::calc_order_vector_form_surf(WeakForm::VectorFormSurf *vfs, Hermes::vector<Solution *> u_ext,
+int DiscreteProblem::calc_order_vector_form_surf(WeakForm::VectorFormSurf *vfs, Hermes::vector<Solution *>& u_ext,
                                   PrecalcShapeset *fv, RefMap *rv, SurfPos* surf_pos)
 {
   _F_
@@ -3485,53 +4598,62 @@ int DiscreteProblem::calc_order_vector_form_surf(WeakForm::VectorFormSurf *vfs,
   if(is_fvm) 
     order = rv->get_inv_ref_order();
   else {
-    int u_ext_length = u_ext.size();      // Number of external solutions.
-    int u_ext_offset = vfs->u_ext_offset; // External solutions will start with u_ext[u_ext_offset]
-                                          // and there will be only u_ext_length - u_ext_offset of them.
+    // Look the order up in the cache first, the form only needs to be parsed
+    // once for each combination of function orders.
+    OrderCacheKey key;
+    int form_order;
+    if (!get_order_cache_key(vfs, u_ext, NULL, fv, vfs->ext, surf_pos->surf_num, key) || !order_cache_lookup(key, form_order)) {
+      int u_ext_length = u_ext.size();      // Number of external solutions.
+      int u_ext_offset = vfs->u_ext_offset; // External solutions will start with u_ext[u_ext_offset]
+                                            // and there will be only u_ext_length - u_ext_offset of them.
   
-    // Increase for multi-valued shape functions.
-    int inc = (fv->get_num_components() == 2) ? 1 : 0;
-
-    // Order of solutions from the previous Newton iteration.
-    Func<Ord>** oi = new Func<Ord>*[u_ext_length - u_ext_offset];
-    if (u_ext != Hermes::vector<Solution *>())
-      for(int i = 0; i < u_ext_length - u_ext_offset; i++)
-        if (u_ext[i + u_ext_offset] != NULL)
-          oi[i] = get_fn_ord(u_ext[i]->get_edge_fn_order(surf_pos->surf_num) + inc);
-        else
+      // Increase for multi-valued shape functions.
+      int inc = (fv->get_num_components() == 2) ? 1 : 0;
+
+      // Order of solutions from the previous Newton iteration.
+      Func<Ord>** oi = new Func<Ord>*[u_ext_length - u_ext_offset];
+      if (u_ext != Hermes::vector<Solution *>())
+        for(int i = 0; i < u_ext_length - u_ext_offset; i++)
+          if (u_ext[i + u_ext_offset] != NULL)
+            oi[i] = get_fn_ord(u_ext[i]->get_edge_fn_order(surf_pos->surf_num) + inc);
+          else
+            oi[i] = get_fn_ord(0);
+      else
+        for(int i = 0; i < u_ext_length - u_ext_offset; i++)
           oi[i] = get_fn_ord(0);
-    else
-      for(int i = 0; i < u_ext_length - u_ext_offset; i++)
-        oi[i] = get_fn_ord(0);
 
-    // Order of the shape function.
-    Func<Ord>* ov = get_fn_ord(fv->get_edge_fn_order(surf_pos->surf_num) + inc);
+      // Order of the shape function.
+      Func<Ord>* ov = get_fn_ord(fv->get_edge_fn_order(surf_pos->surf_num) + inc);
 
-    // Order of additional external functions.
-    ExtData<Ord>* fake_ext = init_ext_fns_ord(vfs->ext);
+      // Order of additional external functions.
+      ExtData<Ord>* fake_ext = init_ext_fns_ord(vfs->ext);
 
-    // Order of geometric attributes (eg. for multiplication of a solution with coordinates, normals, etc.).
-    double fake_wt = 1.0;
+      // Order of geometric attributes (eg. for multiplication of a solution with coordinates, normals, etc.).
+      double fake_wt = 1.0;
 
-    // Total order of the vector form.
-    Ord o = vfs->ord(1, &fake_wt, oi, ov, &geom_ord, fake_ext);
+      // Total order of the vector form.
+      Ord o = vfs->ord(1, &fake_wt, oi, ov, &geom_ord, fake_ext);
 
-    // Increase due to reference map.
-    order = rv->get_inv_ref_order();
-    order += o.get_order();
-    limit_order(order);
+      form_order = o.get_order();
+      order_cache_insert(key, form_order);
     
-    // Cleanup.
-    delete [] oi;
+      // Cleanup.
+      delete [] oi;
 
-    if (fake_ext != NULL) {
-      fake_ext->free_ord(); 
-      delete fake_ext;
+      if (fake_ext != NULL) {
+        fake_ext->free_ord(); 
+        delete fake_ext;
+      }
     }
+
+    // Increase due to reference map.
+    order = rv->get_inv_ref_order();
+    order += form_order;
+    limit_order(order);
   }
   return order;
 }
-int DiscreteProblem::calc_order_vector_form_surf(WeakForm::MultiComponentVectorFormSurf *vfs, Hermes::vector<Solution *> u_ext,
+int DiscreteProblem::calc_order_vector_form_surf(WeakForm::MultiComponentVectorFormSurf *vfs, Hermes::vector<Solution *>& u_ext,
                                   PrecalcShapeset *fv, RefMap *rv, SurfPos* surf_pos)
 {
   _F_
@@ -3541,54 +4663,63 @@ int DiscreteProblem::calc_order_vector_form_surf(WeakForm::MultiComponentVectorF
   if(is_fvm) 
     order = rv->get_inv_ref_order();
   else {
-    int u_ext_length = u_ext.size();      // Number of external solutions.
-    int u_ext_offset = vfs->u_ext_offset; // External solutions will start with u_ext[u_ext_offset]
-                                          // and there will be only u_ext_length - u_ext_offset of them.
+    // Look the order up in the cache first, the form only needs to be parsed
+    // once for each combination of function orders.
+    OrderCacheKey key;
+    int form_order;
+    if (!get_order_cache_key(vfs, u_ext, NULL, fv, vfs->ext, surf_pos->surf_num, key) || !order_cache_lookup(key, form_order)) {
+      int u_ext_length = u_ext.size();      // Number of external solutions.
+      int u_ext_offset = vfs->u_ext_offset; // External solutions will start with u_ext[u_ext_offset]
+                                            // and there will be only u_ext_length - u_ext_offset of them.
   
-    // Increase for multi-valued shape functions.
-    int inc = (fv->get_num_components() == 2) ? 1 : 0;
-
-    // Order of solutions from the previous Newton iteration.
-    Func<Ord>** oi = new Func<Ord>*[u_ext_length - u_ext_offset];
-    if (u_ext != Hermes::vector<Solution *>())
-      for(int i = 0; i < u_ext_length - u_ext_offset; i++)
-        if (u_ext[i + u_ext_offset] != NULL)
-          oi[i] = get_fn_ord(u_ext[i]->get_edge_fn_order(surf_pos->surf_num) + inc);
-        else
+      // Increase for multi-valued shape functions.
+      int inc = (fv->get_num_components() == 2) ? 1 : 0;
+
+      // Order of solutions from the previous Newton iteration.
+      Func<Ord>** oi = new Func<Ord>*[u_ext_length - u_ext_offset];
+      if (u_ext != Hermes::vector<Solution *>())
+        for(int i = 0; i < u_ext_length - u_ext_offset; i++)
+          if (u_ext[i + u_ext_offset] != NULL)
+            oi[i] = get_fn_ord(u_ext[i]->get_edge_fn_order(surf_pos->surf_num) + inc);
+          else
+            oi[i] = get_fn_ord(0);
+      else
+        for(int i = 0; i < u_ext_length - u_ext_offset; i++)
           oi[i] = get_fn_ord(0);
-    else
-      for(int i = 0; i < u_ext_length - u_ext_offset; i++)
-        oi[i] = get_fn_ord(0);
 
-    // Order of the shape function.
-    Func<Ord>* ov = get_fn_ord(fv->get_edge_fn_order(surf_pos->surf_num) + inc);
+      // Order of the shape function.
+      Func<Ord>* ov = get_fn_ord(fv->get_edge_fn_order(surf_pos->surf_num) + inc);
 
-    // Order of additional external functions.
-    ExtData<Ord>* fake_ext = init_ext_fns_ord(vfs->ext);
+      // Order of additional external functions.
+      ExtData<Ord>* fake_ext = init_ext_fns_ord(vfs->ext);
 
-    // Order of geometric attributes (eg. for multiplication of a solution with coordinates, normals, etc.).
-    double fake_wt = 1.0;
+      // Order of geometric attributes (eg. for multiplication of a solution with coordinates, normals, etc.).
+      double fake_wt = 1.0;
 
-    // Total order of the vector form.
-    Ord o = vfs->ord(1, &fake_wt, oi, ov, &geom_ord, fake_ext);
+      // Total order of the vector form.
+      Ord o = vfs->ord(1, &fake_wt, oi, ov, &geom_ord, fake_ext);
 
-    // Increase due to reference map.
-    order = rv->get_inv_ref_order();
-    order += o.get_order();
-    limit_order(order);
+      form_order = o.get_order();
+      order_cache_insert(key, form_order);
     
-    // Cleanup.
-    delete [] oi;
+      // Cleanup.
+      delete [] oi;
 
-    if (fake_ext != NULL) {
-      fake_ext->free_ord(); 
-      delete fake_ext;
+      if (fake_ext != NULL) {
+        fake_ext->free_ord(); 
+        delete fake_ext;
+      }
     }
+
+    // Increase due to reference map.
+    order = rv->get_inv_ref_order();
+    order += form_order;
+    limit_order(order);
   }
   return order;
 }
 
-scalar DiscreteProblem::eval_form_subelement(int order, WeakForm::VectorFormSurf *vfs, Hermes::vector<Solution *> u_ext,
+scalar DiscreteProblem::eval_form_subelement(int order, WeakForm::VectorFormSurf *vfs, Hermes::vector<Solution *>& u_ext,
                         PrecalcShapeset *fv, RefMap *rv, SurfPos* surf_pos)
 {
   _F_
@@ -3601,9 +4732,9 @@ scalar DiscreteProblem::eval_form_subelement(int order, WeakForm::VectorFormSurf
 
   // Init geometry and jacobian*weights.
   if (cache_e[eo] == NULL) {
-    cache_e[eo] = init_geom_surf(rv, surf_pos, eo);
+    cache_e[eo] = init_geom_surf(rv, surf_pos, eo, &state_arena);
     double3* tan = rv->get_tangent(surf_pos->surf_num, eo);
-    cache_jwt[eo] = new double[np];
+    cache_jwt[eo] = state_arena.alloc_array<double>(np);
     for(int i = 0; i < np; i++)
       cache_jwt[eo][i] = pt[i][2] * tan[i][2];
   }
@@ -3612,11 +4743,12 @@ scalar DiscreteProblem::eval_form_subelement(int order, WeakForm::VectorFormSurf
 
   // Values of the previous Newton iteration, shape functions and external functions in quadrature points.
   int prev_size = u_ext.size() - vfs->u_ext_offset;
-  Func<scalar>** prev = new Func<scalar>*[prev_size];
+  Arena::Mark mark = form_arena.get_mark();
+  Func<scalar>** prev = form_arena.alloc_array<Func<scalar>*>(prev_size);
   if (u_ext != Hermes::vector<Solution *>())
     for (int i = 0; i < prev_size; i++)
       if (u_ext[i + vfs->u_ext_offset] != NULL) 
-        prev[i] = init_fn(u_ext[i + vfs->u_ext_offset], eo);
+        prev[i] = init_fn(u_ext[i + vfs->u_ext_offset], eo, &form_arena);
       else 
         prev[i] = NULL;
   else
@@ -3624,23 +4756,13 @@ scalar DiscreteProblem::eval_form_subelement(int order, WeakForm::VectorFormSurf
       prev[i] = NULL;
 
   Func<double>* v = get_fn(fv, rv, eo);
-  ExtData<scalar>* ext = init_ext_fns(vfs->ext, rv, eo);
+  ExtData<scalar>* ext = init_ext_fns(vfs->ext, rv, eo, &form_arena);
 
   // The actual calculation takes place here.
   scalar res = vfs->value(np, jwt, prev, v, e, ext) * vfs->scaling_factor;
 
   // Clean up.
-  for(int i = 0; i < prev_size; i++)
-    if (prev[i] != NULL) { 
-      prev[i]->free_fn(); 
-      delete prev[i]; 
-    }
-  delete [] prev;
-
-  if (ext != NULL) {
-    ext->free(); 
-    delete ext;
-  }
+  form_arena.release(mark);
 
   return 0.5 * res; // Edges are parameterized from 0 to 1 while integration weights
                     // are defined in (-1, 1). Thus multiplying with 0.5 to correct
@@ -3648,14 +4770,15 @@ scalar DiscreteProblem::eval_form_subelement(int order, WeakForm::VectorFormSurf
 }
 
 scalar DiscreteProblem::eval_form_adaptive(int order_init, scalar result_init,
-                                           WeakForm::VectorFormSurf *vfs, Hermes::vector<Solution *> u_ext,
+                                           WeakForm::VectorFormSurf *vfs, Hermes::vector<Solution *>& u_ext,
                                            PrecalcShapeset *fv, RefMap *rv, SurfPos* surf_pos)
 {
   // Initialize set of all transformable entities.
   std::set<Transformable *> transformable_entities;
   transformable_entities.insert(fv);
   transformable_entities.insert(rv);
-  transformable_entities.insert(vfs->ext.begin(), vfs->ext.end());
+  for (unsigned int i = 0; i < vfs->ext.size(); i++)
+    transformable_entities.insert(get_ext_fn(vfs->ext[i]));
   transformable_entities.insert(u_ext.begin(), u_ext.end());
 
   scalar result = 0;
@@ -3733,7 +4856,7 @@ scalar DiscreteProblem::eval_form_adaptive(int order_init, scalar result_init,
 
 // DG forms.
 
-int DiscreteProblem::calc_order_dg_matrix_form(WeakForm::MatrixFormSurf *mfs, Hermes::vector<Solution *> u_ext,
+int DiscreteProblem::calc_order_dg_matrix_form(WeakForm::MatrixFormSurf *mfs, Hermes::vector<Solution *>& u_ext,
                                   PrecalcShapeset *fu, PrecalcShapeset *fv, RefMap *ru, SurfPos* surf_pos,
                                   bool neighbor_supp_u, bool neighbor_supp_v, LightArray<NeighborSearch*>& neighbor_searches, int neighbor_index_u)
 {
@@ -3798,7 +4921,7 @@ int DiscreteProblem::calc_order_dg_matrix_form(WeakForm::MatrixFormSurf *mfs, He
   }
   return order;
 }
-int DiscreteProblem::calc_order_dg_matrix_form(WeakForm::MultiComponentMatrixFormSurf *mfs, Hermes::vector<Solution *> u_ext,
+int DiscreteProblem::calc_order_dg_matrix_form(WeakForm::MultiComponentMatrixFormSurf *mfs, Hermes::vector<Solution *>& u_ext,
                                   PrecalcShapeset *fu, PrecalcShapeset *fv, RefMap *ru, SurfPos* surf_pos,
                                   bool neighbor_supp_u, bool neighbor_supp_v, LightArray<NeighborSearch*>& neighbor_searches, int neighbor_index_u)
 {
@@ -3864,7 +4987,7 @@ int DiscreteProblem::calc_order_dg_matrix_form(WeakForm::MultiComponentMatrixFor
   return order;
 }
 
-scalar DiscreteProblem::eval_dg_form(WeakForm::MatrixFormSurf* mfs, Hermes::vector<Solution *> u_ext,
+scalar DiscreteProblem::eval_dg_form(WeakForm::MatrixFormSurf* mfs, Hermes::vector<Solution *>& u_ext,
                                      PrecalcShapeset *fu, PrecalcShapeset *fv, RefMap *ru_central, RefMap *ru_actual, RefMap *rv, 
                                      bool neighbor_supp_u, bool neighbor_supp_v,
                                      SurfPos* surf_pos, LightArray<NeighborSearch*>& neighbor_searches, int neighbor_index_u, int neighbor_index_v)
@@ -3888,25 +5011,27 @@ scalar DiscreteProblem::eval_dg_form(WeakForm::MatrixFormSurf* mfs, Hermes::vect
 
   // Init geometry and jacobian*weights.
   if (cache_e[eo] == NULL) {
-    cache_e[eo] = init_geom_surf(ru_central, surf_pos, eo);
+    cache_e[eo] = init_geom_surf(ru_central, surf_pos, eo, &state_arena);
     double3* tan = ru_central->get_tangent(surf_pos->surf_num, eo);
-    cache_jwt[eo] = new double[np];
+    cache_jwt[eo] = state_arena.alloc_array<double>(np);
     for(int i = 0; i < np; i++)
       cache_jwt[eo][i] = pt[i][2] * tan[i][2];
   }
 
-  Geom<double>* e = new InterfaceGeom<double>(cache_e[eo], nbs_u->neighb_el->marker, 
+  Arena::Mark mark = form_arena.get_mark();
+  Geom<double>* e = new (form_arena.allocate(sizeof(InterfaceGeom<double>)))
+    InterfaceGeom<double>(cache_e[eo], nbs_u->neighb_el->marker, 
     nbs_u->neighb_el->id, nbs_u->neighb_el->get_diameter());
   double* jwt = cache_jwt[eo];
 
   // Values of the previous Newton iteration, shape functions and external functions in quadrature points.
   int prev_size = u_ext.size() - mfs->u_ext_offset;
-  Func<scalar>** prev = new Func<scalar>*[prev_size];
+  Func<scalar>** prev = form_arena.alloc_array<Func<scalar>*>(prev_size);
   if (u_ext != Hermes::vector<Solution *>())
     for (int i = 0; i < prev_size; i++)
       if (u_ext[i + mfs->u_ext_offset] != NULL) {
         neighbor_searches.get(u_ext[i]->get_mesh()->get_seq() - min_dg_mesh_seq)->set_quad_order(order);
-        prev[i]  = neighbor_searches.get(u_ext[i]->get_mesh()->get_seq() - min_dg_mesh_seq)->init_ext_fn(u_ext[i]);
+        prev[i]  = neighbor_searches.get(u_ext[i]->get_mesh()->get_seq() - min_dg_mesh_seq)->init_ext_fn(u_ext[i], &form_arena);
       }
       else prev[i] = NULL;
   else
@@ -3915,35 +5040,20 @@ scalar DiscreteProblem::eval_dg_form(WeakForm::MatrixFormSurf* mfs, Hermes::vect
 
   // Values of the previous Newton iteration, shape functions and external functions in quadrature points.
   nbs_u->set_quad_order(order);
-  DiscontinuousFunc<double>* u = new DiscontinuousFunc<double>(get_fn(fu, ru_actual, nbs_u->get_quad_eo(neighbor_supp_u)),
+  DiscontinuousFunc<double>* u = new (form_arena.allocate(sizeof(DiscontinuousFunc<double>)))
+    DiscontinuousFunc<double>(get_fn(fu, ru_actual, nbs_u->get_quad_eo(neighbor_supp_u)),
     neighbor_supp_u, nbs_u->neighbor_edge.orientation);
   nbs_v->set_quad_order(order);
-  DiscontinuousFunc<double>* v = new DiscontinuousFunc<double>(get_fn(fv, rv, nbs_v->get_quad_eo(neighbor_supp_v)),
+  DiscontinuousFunc<double>* v = new (form_arena.allocate(sizeof(DiscontinuousFunc<double>)))
+    DiscontinuousFunc<double>(get_fn(fv, rv, nbs_v->get_quad_eo(neighbor_supp_v)),
     neighbor_supp_v, nbs_v->neighbor_edge.orientation);
   
-  ExtData<scalar>* ext = init_ext_fns(mfs->ext, neighbor_searches, order);
+  ExtData<scalar>* ext = init_ext_fns(mfs->ext, neighbor_searches, order, &form_arena);
 
   scalar res = mfs->value(np, jwt, prev, u, v, e, ext);
 
   // Clean up.
-  for (int i = 0; i < prev_size; i++) {
-    if (prev[i] != NULL) {
-      prev[i]->free_fn();
-      delete prev[i];
-    }
-  }
-
-  delete [] prev;
-
-
-  if (ext != NULL) {
-    ext->free(); 
-    delete ext;
-  }
-
-  delete u;
-  delete v;
-  delete e;
+  form_arena.release(mark);
 
   // Scaling.
   res *= mfs->scaling_factor;
@@ -3952,7 +5062,7 @@ scalar DiscreteProblem::eval_dg_form(WeakForm::MatrixFormSurf* mfs, Hermes::vect
                     // are defined in (-1, 1). Thus multiplying with 0.5 to correct
                     // the weights.
 }
-void DiscreteProblem::eval_dg_form(WeakForm::MultiComponentMatrixFormSurf* mfs, Hermes::vector<Solution *> u_ext,
+void DiscreteProblem::eval_dg_form(WeakForm::MultiComponentMatrixFormSurf* mfs, Hermes::vector<Solution *>& u_ext,
                                      PrecalcShapeset *fu, PrecalcShapeset *fv, RefMap *ru_central, RefMap *ru_actual, RefMap *rv, 
                                      bool neighbor_supp_u, bool neighbor_supp_v,
                                      SurfPos* surf_pos, LightArray<NeighborSearch*>& neighbor_searches, int neighbor_index_u, int neighbor_index_v, Hermes::vector<scalar>& result)
@@ -3976,25 +5086,27 @@ void DiscreteProblem::eval_dg_form(WeakForm::MultiComponentMatrixFormSurf* mfs,
 
   // Init geometry and jacobian*weights.
   if (cache_e[eo] == NULL) {
-    cache_e[eo] = init_geom_surf(ru_central, surf_pos, eo);
+    cache_e[eo] = init_geom_surf(ru_central, surf_pos, eo, &state_arena);
     double3* tan = ru_central->get_tangent(surf_pos->surf_num, eo);
-    cache_jwt[eo] = new double[np];
+    cache_jwt[eo] = state_arena.alloc_array<double>(np);
     for(int i = 0; i < np; i++)
       cache_jwt[eo][i] = pt[i][2] * tan[i][2];
   }
 
-  Geom<double>* e = new InterfaceGeom<double>(cache_e[eo], nbs_u->neighb_el->marker, 
+  Arena::Mark mark = form_arena.get_mark();
+  Geom<double>* e = new (form_arena.allocate(sizeof(InterfaceGeom<double>)))
+    InterfaceGeom<double>(cache_e[eo], nbs_u->neighb_el->marker, 
     nbs_u->neighb_el->id, nbs_u->neighb_el->get_diameter());
   double* jwt = cache_jwt[eo];
 
   // Values of the previous Newton iteration, shape functions and external functions in quadrature points.
   int prev_size = u_ext.size() - mfs->u_ext_offset;
-  Func<scalar>** prev = new Func<scalar>*[prev_size];
+  Func<scalar>** prev = form_arena.alloc_array<Func<scalar>*>(prev_size);
   if (u_ext != Hermes::vector<Solution *>())
     for (int i = 0; i < prev_size; i++)
       if (u_ext[i + mfs->u_ext_offset] != NULL) {
         neighbor_searches.get(u_ext[i]->get_mesh()->get_seq() - min_dg_mesh_seq)->set_quad_order(order);
-        prev[i]  = neighbor_searches.get(u_ext[i]->get_mesh()->get_seq() - min_dg_mesh_seq)->init_ext_fn(u_ext[i]);
+        prev[i]  = neighbor_searches.get(u_ext[i]->get_mesh()->get_seq() - min_dg_mesh_seq)->init_ext_fn(u_ext[i], &form_arena);
       }
       else prev[i] = NULL;
   else
@@ -4003,13 +5115,15 @@ void DiscreteProblem::eval_dg_form(WeakForm::MultiComponentMatrixFormSurf* mfs,
 
   // Values of the previous Newton iteration, shape functions and external functions in quadrature points.
   nbs_u->set_quad_order(order);
-  DiscontinuousFunc<double>* u = new DiscontinuousFunc<double>(get_fn(fu, ru_actual, nbs_u->get_quad_eo(neighbor_supp_u)),
+  DiscontinuousFunc<double>* u = new (form_arena.allocate(sizeof(DiscontinuousFunc<double>)))
+    DiscontinuousFunc<double>(get_fn(fu, ru_actual, nbs_u->get_quad_eo(neighbor_supp_u)),
     neighbor_supp_u, nbs_u->neighbor_edge.orientation);
   nbs_v->set_quad_order(order);
-  DiscontinuousFunc<double>* v = new DiscontinuousFunc<double>(get_fn(fv, rv, nbs_v->get_quad_eo(neighbor_supp_v)),
+  DiscontinuousFunc<double>* v = new (form_arena.allocate(sizeof(DiscontinuousFunc<double>)))
+    DiscontinuousFunc<double>(get_fn(fv, rv, nbs_v->get_quad_eo(neighbor_supp_v)),
     neighbor_supp_v, nbs_v->neighbor_edge.orientation);
   
-  ExtData<scalar>* ext = init_ext_fns(mfs->ext, neighbor_searches, order);
+  ExtData<scalar>* ext = init_ext_fns(mfs->ext, neighbor_searches, order, &form_arena);
 
   mfs->value(np, jwt, prev, u, v, e, ext, result);
 
@@ -4017,27 +5131,10 @@ void DiscreteProblem::eval_dg_form(WeakForm::MultiComponentMatrixFormSurf* mfs,
     result[i] *= mfs->scaling_factor * 0.5;
 
   // Clean up.
-  for (int i = 0; i < prev_size; i++) {
-    if (prev[i] != NULL) {
-      prev[i]->free_fn();
-      delete prev[i];
-    }
-  }
-
-  delete [] prev;
-
-
-  if (ext != NULL) {
-    ext->free(); 
-    delete ext;
-  }
-
-  delete u;
-  delete v;
-  delete e;
+  form_arena.release(mark);
 }
 
-int DiscreteProblem::calc_order_dg_vector_form(WeakForm::VectorFormSurf *vfs, Hermes::vector<Solution *> u_ext,
+int DiscreteProblem::calc_order_dg_vector_form(WeakForm::VectorFormSurf *vfs, Hermes::vector<Solution *>& u_ext,
                                   PrecalcShapeset *fv, RefMap *rv, SurfPos* surf_pos,
                                   LightArray<NeighborSearch*>& neighbor_searches, int neighbor_index_v)
 {
@@ -4102,7 +5199,7 @@ int DiscreteProblem::calc_order_dg_vector_form(WeakForm::VectorFormSurf *vfs, He
   }
   return order;
 }
-int DiscreteProblem::calc_order_dg_vector_form(WeakForm::MultiComponentVectorFormSurf *vfs, Hermes::vector<Solution *> u_ext,
+int DiscreteProblem::calc_order_dg_vector_form(WeakForm::MultiComponentVectorFormSurf *vfs, Hermes::vector<Solution *>& u_ext,
                                   PrecalcShapeset *fv, RefMap *rv, SurfPos* surf_pos,
                                   LightArray<NeighborSearch*>& neighbor_searches, int neighbor_index_v)
 {
@@ -4168,7 +5265,7 @@ int DiscreteProblem::calc_order_dg_vector_form(WeakForm::MultiComponentVectorFor
   return order;
 }
 
-scalar DiscreteProblem::eval_dg_form(WeakForm::VectorFormSurf* vfs, Hermes::vector<Solution *> u_ext,
+scalar DiscreteProblem::eval_dg_form(WeakForm::VectorFormSurf* vfs, Hermes::vector<Solution *>& u_ext,
                                      PrecalcShapeset *fv, RefMap *rv, 
                                      SurfPos* surf_pos, LightArray<NeighborSearch*>& neighbor_searches, int neighbor_index_v)
 {
@@ -4187,25 +5284,27 @@ scalar DiscreteProblem::eval_dg_form(WeakForm::VectorFormSurf* vfs, Hermes::vect
 
   // Init geometry and jacobian*weights.
   if (cache_e[eo] == NULL) {
-    cache_e[eo] = init_geom_surf(rv, surf_pos, eo);
+    cache_e[eo] = init_geom_surf(rv, surf_pos, eo, &state_arena);
     double3* tan = rv->get_tangent(surf_pos->surf_num, eo);
-    cache_jwt[eo] = new double[np];
+    cache_jwt[eo] = state_arena.alloc_array<double>(np);
     for(int i = 0; i < np; i++)
       cache_jwt[eo][i] = pt[i][2] * tan[i][2];
   }
 
-  Geom<double>* e = new InterfaceGeom<double>(cache_e[eo], nbs_v->neighb_el->marker, 
+  Arena::Mark mark = form_arena.get_mark();
+  Geom<double>* e = new (form_arena.allocate(sizeof(InterfaceGeom<double>)))
+    InterfaceGeom<double>(cache_e[eo], nbs_v->neighb_el->marker, 
     nbs_v->neighb_el->id, nbs_v->neighb_el->get_diameter());
   double* jwt = cache_jwt[eo];
 
   // Values of the previous Newton iteration, shape functions and external functions in quadrature points.
   int prev_size = u_ext.size() - vfs->u_ext_offset;
-  Func<scalar>** prev = new Func<scalar>*[prev_size];
+  Func<scalar>** prev = form_arena.alloc_array<Func<scalar>*>(prev_size);
   if (u_ext != Hermes::vector<Solution *>())
     for (int i = 0; i < prev_size; i++)
       if (u_ext[i + vfs->u_ext_offset] != NULL) {
         neighbor_searches.get(u_ext[i]->get_mesh()->get_seq() - min_dg_mesh_seq)->set_quad_order(order);
-        prev[i]  = neighbor_searches.get(u_ext[i]->get_mesh()->get_seq() - min_dg_mesh_seq)->init_ext_fn(u_ext[i]);
+        prev[i]  = neighbor_searches.get(u_ext[i]->get_mesh()->get_seq() - min_dg_mesh_seq)->init_ext_fn(u_ext[i], &form_arena);
       }
       else prev[i] = NULL;
   else
@@ -4213,26 +5312,12 @@ scalar DiscreteProblem::eval_dg_form(WeakForm::VectorFormSurf* vfs, Hermes::vect
       prev[i] = NULL;
 
   Func<double>* v = get_fn(fv, rv, eo);
-  ExtData<scalar>* ext = init_ext_fns(vfs->ext, neighbor_searches, order);
+  ExtData<scalar>* ext = init_ext_fns(vfs->ext, neighbor_searches, order, &form_arena);
 
   scalar res = vfs->value(np, jwt, prev, v, e, ext);
 
   // Clean up.
-  for (int i = 0; i < prev_size; i++) {
-    if (prev[i] != NULL) {
-      prev[i]->free_fn(); 
-      delete prev[i];
-    }
-  }
-
-  delete [] prev;
-
-  if (ext != NULL) {
-    ext->free(); 
-    delete ext;
-  }
-
-  delete e;
+  form_arena.release(mark);
 
   // Scaling.
   res *= vfs->scaling_factor;
@@ -4241,7 +5326,7 @@ scalar DiscreteProblem::eval_dg_form(WeakForm::VectorFormSurf* vfs, Hermes::vect
                     // are defined in (-1, 1). Thus multiplying with 0.5 to correct
                     // the weights.
 }
-void DiscreteProblem::eval_dg_form(WeakForm::MultiComponentVectorFormSurf* vfs, Hermes::vector<Solution *> u_ext,
+void DiscreteProblem::eval_dg_form(WeakForm::MultiComponentVectorFormSurf* vfs, Hermes::vector<Solution *>& u_ext,
                                      PrecalcShapeset *fv, RefMap *rv, 
                                      SurfPos* surf_pos, LightArray<NeighborSearch*>& neighbor_searches, int neighbor_index_v, Hermes::vector<scalar>& result)
 {
@@ -4260,25 +5345,27 @@ void DiscreteProblem::eval_dg_form(WeakForm::MultiComponentVectorFormSurf* vfs,
 
   // Init geometry and jacobian*weights.
   if (cache_e[eo] == NULL) {
-    cache_e[eo] = init_geom_surf(rv, surf_pos, eo);
+    cache_e[eo] = init_geom_surf(rv, surf_pos, eo, &state_arena);
     double3* tan = rv->get_tangent(surf_pos->surf_num, eo);
-    cache_jwt[eo] = new double[np];
+    cache_jwt[eo] = state_arena.alloc_array<double>(np);
     for(int i = 0; i < np; i++)
       cache_jwt[eo][i] = pt[i][2] * tan[i][2];
   }
 
-  Geom<double>* e = new InterfaceGeom<double>(cache_e[eo], nbs_v->neighb_el->marker, 
+  Arena::Mark mark = form_arena.get_mark();
+  Geom<double>* e = new (form_arena.allocate(sizeof(InterfaceGeom<double>)))
+    InterfaceGeom<double>(cache_e[eo], nbs_v->neighb_el->marker, 
     nbs_v->neighb_el->id, nbs_v->neighb_el->get_diameter());
   double* jwt = cache_jwt[eo];
 
   // Values of the previous Newton iteration, shape functions and external functions in quadrature points.
   int prev_size = u_ext.size() - vfs->u_ext_offset;
-  Func<scalar>** prev = new Func<scalar>*[prev_size];
+  Func<scalar>** prev = form_arena.alloc_array<Func<scalar>*>(prev_size);
   if (u_ext != Hermes::vector<Solution *>())
     for (int i = 0; i < prev_size; i++)
       if (u_ext[i + vfs->u_ext_offset] != NULL) {
         neighbor_searches.get(u_ext[i]->get_mesh()->get_seq() - min_dg_mesh_seq)->set_quad_order(order);
-        prev[i]  = neighbor_searches.get(u_ext[i]->get_mesh()->get_seq() - min_dg_mesh_seq)->init_ext_fn(u_ext[i]);
+        prev[i]  = neighbor_searches.get(u_ext[i]->get_mesh()->get_seq() - min_dg_mesh_seq)->init_ext_fn(u_ext[i], &form_arena);
       }
       else prev[i] = NULL;
   else
@@ -4286,7 +5373,7 @@ void DiscreteProblem::eval_dg_form(WeakForm::MultiComponentVectorFormSurf* vfs,
       prev[i] = NULL;
 
   Func<double>* v = get_fn(fv, rv, eo);
-  ExtData<scalar>* ext = init_ext_fns(vfs->ext, neighbor_searches, order);
+  ExtData<scalar>* ext = init_ext_fns(vfs->ext, neighbor_searches, order, &form_arena);
 
   vfs->value(np, jwt, prev, v, e, ext, result);
 
@@ -4294,21 +5381,7 @@ void DiscreteProblem::eval_dg_form(WeakForm::MultiComponentVectorFormSurf* vfs,
     result[i] *= vfs->scaling_factor * 0.5;
 
   // Clean up.
-  for (int i = 0; i < prev_size; i++) {
-    if (prev[i] != NULL) {
-      prev[i]->free_fn(); 
-      delete prev[i];
-    }
-  }
-
-  delete [] prev;
-
-  if (ext != NULL) {
-    ext->free(); 
-    delete ext;
-  }
-
-  delete e;
+  form_arena.release(mark);
 }
 
 DiscreteProblem::NeighborNode::NeighborNode(NeighborNode* parent, unsigned int transformation) : parent(parent), transformation(transformation)
@@ -4395,7 +5468,8 @@ double Hermes2D::get_l2_norm(Vector* vec) const
 bool Hermes2D::solve_newton(scalar* coeff_vec, DiscreteProblem* dp, Solver* solver, SparseMatrix* matrix,
                             Vector* rhs, double newton_tol, int newton_max_iter, bool verbose,
                             bool residual_as_function,
-                            double damping_coeff, double max_allowed_residual_norm) const
+                            double damping_coeff, double max_allowed_residual_norm,
+                            double jacobian_reuse_contraction) const
 {
   // Prepare solutions for measuring residual norm.
   int num_spaces = dp->get_spaces().size();
@@ -4406,18 +5480,34 @@ bool Hermes2D::solve_newton(scalar* coeff_vec, DiscreteProblem* dp, Solver* solv
     dir_lift_false.push_back(false);      // No Dirichlet lifts will be considered.
   }
 
+  // In the modified Newton's method, a reused Jacobian is solved with the factorization
+  // reused completely, the factorization scheme of the user is restored at the end.
+  FactorizationScheme factorization_scheme = solver->get_factorization_scheme();
+  bool modified_newton = (jacobian_reuse_contraction > 0);
+  bool have_jacobian = false;
+
   // The Newton's loop.
-  double residual_norm;
+  double residual_norm = 0, prev_residual_norm = 0, contraction = 1;
   int it = 1;
+  int num_jacobians = 0;
   while (1)
   {
     // Obtain the number of degrees of freedom.
     int ndof = dp->get_num_dofs();
 
-    // Assemble the residual vector.
-    dp->assemble(coeff_vec, NULL, rhs); // NULL = we do not want the Jacobian.
+    // The Jacobian is assembled together with the residual vector in one traversal, unless
+    // it is not going to be needed: the residual norm extrapolated from the last contraction
+    // is within tolerance, or the last Jacobian will be reused.
+    bool predict_converged = (it > 2 && residual_norm * contraction < newton_tol);
+    bool predict_reuse = (modified_newton && have_jacobian && contraction < jacobian_reuse_contraction);
+    bool fused = !predict_converged && !predict_reuse;
+
+    // Assemble the residual vector (and the Jacobian matrix).
+    dp->assemble(coeff_vec, fused ? matrix : NULL, rhs);
+    if (fused) num_jacobians++;
 
     // Measure the residual norm.
+    prev_residual_norm = residual_norm;
     if (residual_as_function) {
       // Translate the residual vector into a residual function (or multiple functions)
       // in the corresponding finite element space(s) and measure their norm(s) there.
@@ -4432,6 +5522,7 @@ bool Hermes2D::solve_newton(scalar* coeff_vec, DiscreteProblem* dp, Solver* solv
       // Calculate the l2-norm of residual vector, this is the traditional way.
       residual_norm = get_l2_norm(rhs);
     }
+    if (it > 1) contraction = (prev_residual_norm > 0) ? residual_norm / prev_residual_norm : 0;
 
     // Info for the user.
     if (it == 1) {
@@ -4448,6 +5539,7 @@ bool Hermes2D::solve_newton(scalar* coeff_vec, DiscreteProblem* dp, Solver* solv
       }
       for (unsigned int i = 0; i < solutions.size(); i++)
         delete solutions[i];
+      if (modified_newton) solver->set_factorization_scheme(factorization_scheme);
       return false;
     }
 
@@ -4455,8 +5547,20 @@ bool Hermes2D::solve_newton(scalar* coeff_vec, DiscreteProblem* dp, Solver* solv
     // of iteration has been reached, then quit.
     if ((residual_norm < newton_tol || it > newton_max_iter) && it > 1) break;
 
-    // Assemble the Jacobian matrix.
-    dp->assemble(coeff_vec, matrix, NULL); // NULL = we do not want the rhs.
+    // In the modified Newton's method, the last Jacobian (and its factorization) is kept
+    // as long as it reduces the residual norm at least by the factor jacobian_reuse_contraction.
+    bool reuse = (!fused && modified_newton && have_jacobian && contraction < jacobian_reuse_contraction);
+    if (!fused && !reuse) {
+      // Assemble the Jacobian matrix.
+      dp->assemble(coeff_vec, matrix, NULL); // NULL = we do not want the rhs.
+      num_jacobians++;
+    }
+    have_jacobian = true;
+    if (modified_newton)
+      solver->set_factorization_scheme(reuse ? HERMES_REUSE_FACTORIZATION_COMPLETELY : factorization_scheme);
+    if (verbose && reuse) {
+      info("---- Newton iter %d, reusing the Jacobian.", it);
+    }
 
     // Multiply the residual vector with -1 since the matrix
     // equation reads J(Y^n) \deltaY^{n+1} = -F(Y^n).
@@ -4473,6 +5577,10 @@ bool Hermes2D::solve_newton(scalar* coeff_vec, DiscreteProblem* dp, Solver* solv
 
   for (unsigned int i = 0; i < solutions.size(); i++)
     delete solutions[i];
+  if (modified_newton) solver->set_factorization_scheme(factorization_scheme);
+  if (verbose) {
+    info("---- Newton: %d residual vectors and %d Jacobian matrices assembled.", it, num_jacobians);
+  }
 
   if (it >= newton_max_iter) {
     if (verbose) info("Maximum allowed number of Newton iterations exceeded, returning false.");
@@ -4482,12 +5590,65 @@ bool Hermes2D::solve_newton(scalar* coeff_vec, DiscreteProblem* dp, Solver* solv
   return true;
 }
 
+// Inner product of coefficient vectors.
+static scalar picard_dot(const std::vector<scalar>& x, const std::vector<scalar>& y)
+{
+  scalar val = 0;
+  for (unsigned int i = 0; i < x.size(); i++) val += conj(x[i]) * y[i];
+  return val;
+}
+
+// Anderson mixing: finds gamma minimizing |f - sum_j gamma_j df[j]| by modified Gram-Schmidt
+// QR of the columns df[j], in the norm given by the Gram matrix, or in the l2 norm if it is
+// NULL. Columns (nearly) dependent on the previous ones get gamma_j = 0.
+static void anderson_coefficients(const std::vector<std::vector<scalar> >& df,
+                                  const std::vector<scalar>& f, SparseMatrix* gram,
+                                  std::vector<scalar>& gamma)
+{
+  int m = df.size();
+  std::vector<std::vector<scalar> > q(df), gq(df);
+  std::vector<scalar> r(m * m, 0.0), qf(m, 0.0);
+  std::vector<bool> used(m, false);
+  for (int j = 0; j < m; j++) {
+    if (gram != NULL) gram->multiply_with_vector(&q[j][0], &gq[j][0]);
+    double col_norm = sqrt(std::abs(picard_dot(q[j], gq[j])));
+    for (int i = 0; i < j; i++) {
+      if (!used[i]) continue;
+      r[i * m + j] = picard_dot(gq[i], q[j]);
+      for (unsigned int k = 0; k < q[j].size(); k++) {
+        q[j][k] -= r[i * m + j] * q[i][k];
+        gq[j][k] -= r[i * m + j] * gq[i][k];
+      }
+    }
+    double norm = sqrt(std::abs(picard_dot(q[j], gq[j])));
+    if (norm <= 1e-10 * col_norm || norm == 0) continue;
+    used[j] = true;
+    r[j * m + j] = norm;
+    for (unsigned int k = 0; k < q[j].size(); k++) {
+      q[j][k] /= norm;
+      gq[j][k] /= norm;
+    }
+    qf[j] = picard_dot(gq[j], f);
+  }
+
+  gamma.assign(m, 0.0);
+  for (int j = m - 1; j >= 0; j--) {
+    if (!used[j]) continue;
+    scalar val = qf[j];
+    for (int i = j + 1; i < m; i++) val -= r[j * m + i] * gamma[i];
+    gamma[j] = val / r[j * m + j];
+  }
+}
+
 // Perform Picard's iteration.
 bool Hermes2D::solve_picard(WeakForm* wf, Space* space, Solution* sln_prev_iter,
                   MatrixSolverType matrix_solver, double picard_tol,
-                  int picard_max_iter, bool verbose) const
+                  int picard_max_iter, bool verbose, int anderson_window,
+                  double anderson_beta, bool picard_tol_on_coeff_vec) const
 {
+  _F_
   // Set up the solver, matrix, and rhs according to the solver selection.
+  matrix_solver = wf->select_matrix_solver(matrix_solver);
   SparseMatrix* matrix = create_matrix(matrix_solver);
   Vector* rhs = create_vector(matrix_solver);
   Solver* solver = create_linear_solver(matrix_solver, matrix, rhs);
@@ -4495,25 +5656,77 @@ bool Hermes2D::solve_picard(WeakForm* wf, Space* space, Solution* sln_prev_iter,
   // Initialize the FE problem.
   bool is_linear = true;
   DiscreteProblem dp(wf, space, is_linear);
+  int ndof = space->get_num_dofs();
+
+  // The H1 norm of u = sum_i x_i v_i + lift is |u|^2 = x^T G x + 2 Re(x^T g) + |lift|^2,
+  // where G is the Gram matrix and g_i = (lift, v_i). Both are assembled at once as the
+  // Jacobian and the residual of the H1 inner product at the zero coefficient vector.
+  SymCSCMatrix gram;
+  UMFPackVector gram_lift;
+  double lift_norm_squared = 0;
+  std::vector<scalar> zero(ndof, 0.0), work(ndof);
+  if (!picard_tol_on_coeff_vec) {
+    WeakForm gram_wf(1);
+    WeakFormsH1::VolumetricMatrixForms::DefaultLinearDiffusion gram_diffusion(0, 0);
+    WeakFormsH1::VolumetricMatrixForms::DefaultLinearMass gram_mass(0, 0);
+    WeakFormsH1::VolumetricVectorForms::DefaultResidualLinearDiffusion gram_residual_diffusion(0);
+    WeakFormsH1::VolumetricVectorForms::DefaultResidualLinearMass gram_residual_mass(0, 1.0);
+    gram_wf.add_matrix_form(&gram_diffusion);
+    gram_wf.add_matrix_form(&gram_mass);
+    gram_wf.add_vector_form(&gram_residual_diffusion);
+    gram_wf.add_vector_form(&gram_residual_mass);
+    DiscreteProblem gram_dp(&gram_wf, space, false);
+    gram_dp.assemble(&zero[0], &gram, &gram_lift);
+
+    Solution lift;
+    Solution::vector_to_solution(&zero[0], space, &lift);
+    lift_norm_squared = sqr(calc_norm(&lift, HERMES_H1_NORM));
+  }
+
+  // Coefficient vectors: the current iterate x (the coefficients of sln_prev_iter), its
+  // Picard update g, the change f = g - x and their differences from the last iteration.
+  std::vector<scalar> x(ndof), g(ndof), f(ndof), g_last, f_last, gamma;
+  std::vector<std::vector<scalar> > dg, df;
 
   int iter_count = 0;
   while (true) {
     // Assemble the stiffness matrix and right-hand side.
     dp.assemble(matrix, rhs);
 
-    // Solve the linear system and if successful, obtain the solution.
-    Solution sln_new;
-    if(solver->solve()) Solution::vector_to_solution(solver->get_solution(), space, &sln_new);
-    else error ("Matrix solver failed.\n");
+    // Solve the linear system, the sparsity pattern does not change, so the ordering
+    // of the first factorization can be reused.
+    if (!solver->solve()) error ("Matrix solver failed.\n");
+    solver->set_factorization_scheme(HERMES_REUSE_MATRIX_REORDERING);
+    scalar* sln_vec = solver->get_solution();
+    for (int i = 0; i < ndof; i++) {
+      g[i] = sln_vec[i];
+      f[i] = g[i] - x[i];
+    }
 
-    double rel_error = calc_abs_error(sln_prev_iter, &sln_new, HERMES_H1_NORM)
-                       / calc_norm(&sln_new, HERMES_H1_NORM) * 100;
+    double rel_error;
+    if (iter_count == 0) {
+      // The initial sln_prev_iter is arbitrary, the difference has to be integrated.
+      Solution sln_new;
+      Solution::vector_to_solution(&g[0], space, &sln_new);
+      rel_error = calc_abs_error(sln_prev_iter, &sln_new, HERMES_H1_NORM)
+                  / calc_norm(&sln_new, HERMES_H1_NORM) * 100;
+    }
+    else if (picard_tol_on_coeff_vec)
+      rel_error = sqrt(std::abs(picard_dot(f, f)) / std::abs(picard_dot(g, g))) * 100;
+    else {
+      gram.multiply_with_vector(&f[0], &work[0]);
+      double diff_norm_squared = std::abs(picard_dot(f, work));
+      gram.multiply_with_vector(&g[0], &work[0]);
+      double norm_squared = std::abs(picard_dot(g, work)) + lift_norm_squared;
+      for (int i = 0; i < ndof; i++) norm_squared += 2 * REAL(conj(g[i]) * gram_lift.get(i));
+      rel_error = sqrt(diff_norm_squared / norm_squared) * 100;
+    }
     if (verbose) info("---- Picard iter %d, ndof %d, rel. error %g%%",
-      iter_count+1, space->get_num_dofs(), rel_error);
+      iter_count+1, ndof, rel_error);
 
     // Stopping criterion.
     if (rel_error < picard_tol) {
-      sln_prev_iter->copy(&sln_new);
+      Solution::vector_to_solution(&g[0], space, sln_prev_iter);
       delete matrix;
       delete rhs;
       delete solver;
@@ -4528,8 +5741,39 @@ bool Hermes2D::solve_picard(WeakForm* wf, Space* space, Solution* sln_prev_iter,
       return false;
     }
 
-    // Saving solution for the next iteration;
-    sln_prev_iter->copy(&sln_new);
+    // The next iterate. In the first iteration, the initial sln_prev_iter has no coefficient
+    // vector, so the Picard update is taken.
+    if (iter_count == 0) x = g;
+    else if (anderson_window > 0 && iter_count > 1) {
+      // Differences of the updates and of the changes in the window.
+      if ((int) df.size() == anderson_window) {
+        df.erase(df.begin());
+        dg.erase(dg.begin());
+      }
+      df.push_back(f);
+      dg.push_back(g);
+      for (int i = 0; i < ndof; i++) {
+        df.back()[i] -= f_last[i];
+        dg.back()[i] -= g_last[i];
+      }
+      anderson_coefficients(df, f, picard_tol_on_coeff_vec ? NULL : &gram, gamma);
+
+      // x = g - dg gamma - (1 - beta) (f - df gamma).
+      for (int i = 0; i < ndof; i++) {
+        scalar g_mix = g[i], f_mix = f[i];
+        for (unsigned int j = 0; j < df.size(); j++) {
+          g_mix -= gamma[j] * dg[j][i];
+          f_mix -= gamma[j] * df[j][i];
+        }
+        x[i] = g_mix - (1 - anderson_beta) * f_mix;
+      }
+    }
+    else for (int i = 0; i < ndof; i++) x[i] += anderson_beta * f[i];
+    g_last = g;
+    f_last = f;
+
+    // Saving solution for the next iteration.
+    Solution::vector_to_solution(&x[0], space, sln_prev_iter);
 
     iter_count++;
   }
@@ -57,7 +57,10 @@ public:
   DiscreteProblem(WeakForm* wf, Space* space, bool is_linear = false);
 
   /// Non-parameterized constructor (currently used only in KellyTypeAdapt to gain access to NeighborSearch methods).
-  DiscreteProblem() : wf(NULL), pss(NULL) {num_user_pss = 0; sp_seq = NULL;}
+  DiscreteProblem() : wf(NULL), pss(NULL) {num_user_pss = 0; sp_seq = NULL; num_threads = 1; assembling_worker = false;
+                                            order_cache_wf_seq = -1; order_cache_queries = order_cache_hits = 0;
+                                            sparsity_pattern = NULL; pattern_sp_seq = NULL;
+                                            precomputed_scatter = false; scatter_map = NULL;}
 
   /// Init function. Common code for the constructors.
   void init();
@@ -100,6 +103,21 @@ public:
                                bool force_diagonal_blocks = false, 
                                Table* block_weights = NULL);
 
+  /// Nonzero structure of the matrix for the current spaces (NULL before the first
+  /// call to create_sparse_structure()). It is kept as long as the spaces do not
+  /// change, so that matrices can be allocated repeatedly without traversing the meshes.
+  SparsityPattern* get_sparsity_pattern() { return sparsity_pattern; }
+
+  /// Turns on (off) the precomputed scatter maps: once the sparsity pattern is known, the
+  /// positions of the entries of all local matrices in the values of the global matrix are
+  /// calculated, and assemble() adds the local matrices to these positions instead of
+  /// searching for every entry. Used for matrices with SparseMatrix::has_pattern_positions()
+  /// (UMFPack, MUMPS, SuperLU), volume and surface forms (except the DG and multicomponent
+  /// ones). The maps take one int per entry of every local matrix, i.e. more memory than
+  /// the matrix itself; they pay off in repeated assembling and at high polynomial degrees.
+  void set_precomputed_scatter(bool precomputed_scatter);
+  bool get_precomputed_scatter() const { return precomputed_scatter; }
+
   /// Assembling utilities.
   /// Check whether it is sane to assemble.
   /// Throws errors if not.
@@ -138,6 +156,17 @@ public:
   void assemble(SparseMatrix* mat, Vector* rhs = NULL, 
                 bool force_diagonal_blocks = false, Table* block_weights = NULL);
 
+  /// Matrix-free product y = A x with the matrix assemble() would create (for nonlinear
+  /// problems the Jacobian at coeff_vec), without storing the matrix or its sparsity
+  /// pattern. Both x and y have get_num_dofs() entries. Volume and surface matrix forms
+  /// are applied element by element: the local coefficients of x are first combined into
+  /// one function, so that every form is evaluated once per test function instead of once
+  /// per pair of basis functions. The local action is integrated with the order of the
+  /// basis functions of the highest degree, so on curved elements the result may differ
+  /// from the assembled matrix within the quadrature error. Adaptive, multicomponent and DG
+  /// forms go through the local matrices. Uses the threads of set_num_threads().
+  void apply(const scalar* x, scalar* y, scalar* coeff_vec = NULL, bool add_dir_lift = true);
+
   /// Assemble one stage.
   void assemble_one_stage(WeakForm::Stage& stage, 
                           SparseMatrix* mat, Vector* rhs, bool force_diagonal_blocks, Table* block_weights,
@@ -249,7 +278,71 @@ public:
 
   void set_fvm() {this->is_fvm = true;}
 
+  /// Sets the number of threads used in assemble(). The default is 1 (serial assembling).
+  /// Stages with DG forms, or with external functions other than solutions (which are
+  /// copied for every thread), are assembled serially (with a warning).
+  void set_num_threads(int num_threads);
+  int get_num_threads() const { return num_threads; }
+
+  /// Statistics of the cache of integration orders (see OrderCacheKey), accumulated
+  /// over all calls to assemble().
+  unsigned long get_order_cache_queries() const { return order_cache_queries; }
+  unsigned long get_order_cache_hits() const { return order_cache_hits; }
+
 protected:
+  /// Multithreaded assembling.
+  /// Creates a worker sharing the weak form and spaces with 'parent', but owning its
+  /// own precalculated shapesets, reference maps and caches.
+  DiscreteProblem(DiscreteProblem* parent);
+
+  /// Returns true if the stage can be assembled by several threads at once, warns otherwise.
+  bool can_assemble_in_parallel(WeakForm::Stage& stage, Hermes::vector<Solution *>& u_ext);
+
+  /// Assembles the stages using 'num_threads' workers. The states of each stage are recorded
+  /// by one traversal and colored so that no two states of a color share a dof. The states of
+  /// one color are then split among the workers, which add to the matrix and the vector
+  /// without locking if these allow it (see SparseMatrix::supports_concurrent_add()).
+  /// Stages which can not be assembled in parallel are assembled serially with spss, refmap.
+  void assemble_parallel(std::vector<WeakForm::Stage>& stages, Hermes::vector<Solution *>& u_ext,
+                         Hermes::vector<PrecalcShapeset *>& spss, Hermes::vector<RefMap *>& refmap,
+                         scalar* coeff_vec, SparseMatrix* mat, Vector* rhs,
+                         bool force_diagonal_blocks, bool add_dir_lift, Table* block_weights);
+
+  /// Thread function of one worker, the argument is AssemblingThreadData.
+  static void* assembling_thread(void* data);
+
+  /// Copies of the external functions of the forms owned by a worker (the functions hold
+  /// their active element), get_ext_fn() returns the copy of fn if there is one.
+  std::map<MeshFunction*, MeshFunction*> ext_copies;
+  MeshFunction* get_ext_fn(MeshFunction* fn);
+
+  /// Number of threads used in assemble().
+  int num_threads;
+
+  /// True if this instance is a worker of a multithreaded assembling. Workers do not
+  /// touch the global limit tables (update_limit_table()), the parent sets them up.
+  bool assembling_worker;
+
+  /// Operand and result of apply(), NULL otherwise. Every worker of a multithreaded
+  /// product has its own result, the parent sums them.
+  const scalar* apply_x;
+  scalar* apply_y;
+
+  /// Adds the action of the local matrix of the volume form mfv (and of its transposed
+  /// block if 'tra') on apply_x to apply_y.
+  void apply_matrix_form_vol(WeakForm::MatrixFormVol* mfv, Hermes::vector<Solution *>& u_ext,
+                             Hermes::vector<PrecalcShapeset *>& spss, Hermes::vector<RefMap *>& refmap,
+                             Hermes::vector<AsmList *>& al, double block_scaling_coeff, bool tra);
+  /// The same for a surface form on the edge surf_pos.
+  void apply_matrix_form_surf(WeakForm::MatrixFormSurf* mfs, Hermes::vector<Solution *>& u_ext,
+                              Hermes::vector<PrecalcShapeset *>& spss, Hermes::vector<RefMap *>& refmap,
+                              Hermes::vector<AsmList *>& al, double block_scaling_coeff, SurfPos* surf_pos);
+  /// Combines the basis functions of 'al' (values of get_fn()) with the coefficients
+  /// coef * apply_x[dof], the Dirichlet ones are left out. As the forms take real functions,
+  /// only the real or only the imaginary parts of the coefficients are used. Allocated
+  /// in form_arena, NULL if all the coefficients are zero.
+  Func<double>* interpolate_fn(AsmList* al, PrecalcShapeset* fu, RefMap* rm, int order, bool imag);
+
   /// Assembling.
   /// Experimental caching of vector valued (vector) forms.
   struct SurfVectorFormsKey
@@ -274,19 +367,19 @@ protected:
   // Main function for the evaluation of weak forms. 
   // Evaluates weak form on element given by the RefMap, 
   // using either non-adaptive or adaptive numerical quadrature.
-  scalar eval_form(WeakForm::MatrixFormVol *mfv, Hermes::vector<Solution *> u_ext,
+  scalar eval_form(WeakForm::MatrixFormVol *mfv, Hermes::vector<Solution *>& u_ext,
                    PrecalcShapeset *fu, PrecalcShapeset *fv, RefMap *ru, RefMap *rv);
-  void eval_form(WeakForm::MultiComponentMatrixFormVol *mfv, Hermes::vector<Solution *> u_ext,
+  void eval_form(WeakForm::MultiComponentMatrixFormVol *mfv, Hermes::vector<Solution *>& u_ext,
                    PrecalcShapeset *fu, PrecalcShapeset *fv, RefMap *ru, RefMap *rv, Hermes::vector<scalar>& result);
 
-  int calc_order_matrix_form_vol(WeakForm::MatrixFormVol *mfv, Hermes::vector<Solution *> u_ext,
+  int calc_order_matrix_form_vol(WeakForm::MatrixFormVol *mfv, Hermes::vector<Solution *>& u_ext,
                                   PrecalcShapeset *fu, PrecalcShapeset *fv, RefMap *ru, RefMap *rv);
-  int calc_order_matrix_form_vol(WeakForm::MultiComponentMatrixFormVol *mfv, Hermes::vector<Solution *> u_ext,
+  int calc_order_matrix_form_vol(WeakForm::MultiComponentMatrixFormVol *mfv, Hermes::vector<Solution *>& u_ext,
                                   PrecalcShapeset *fu, PrecalcShapeset *fv, RefMap *ru, RefMap *rv);
 
   // Elementary function used in eval_form() in adaptive mode.
   scalar eval_form_subelement(int order, WeakForm::MatrixFormVol *mfv, 
-                              Hermes::vector<Solution *> u_ext,
+                              Hermes::vector<Solution *>& u_ext,
                               PrecalcShapeset *fu, PrecalcShapeset *fv, 
                               RefMap *ru, RefMap *rv);
   
@@ -294,56 +387,56 @@ protected:
   // numerical quadrature.
   scalar eval_form_adaptive(int order_init, scalar result_init,
                             WeakForm::MatrixFormVol *mfv, 
-                            Hermes::vector<Solution *> u_ext,
+                            Hermes::vector<Solution *>& u_ext,
                             PrecalcShapeset *fu, PrecalcShapeset *fv, 
                             RefMap *ru, RefMap *rv);
 
   // Vector volume forms. The functions provide the same functionality as the
   // parallel ones for matrix volume forms.
 
-  scalar eval_form(WeakForm::VectorFormVol *vfv, Hermes::vector<Solution *> u_ext,
+  scalar eval_form(WeakForm::VectorFormVol *vfv, Hermes::vector<Solution *>& u_ext,
                    PrecalcShapeset *fv, RefMap *rv);
-  void eval_form(WeakForm::MultiComponentVectorFormVol *vfv, Hermes::vector<Solution *> u_ext,
+  void eval_form(WeakForm::MultiComponentVectorFormVol *vfv, Hermes::vector<Solution *>& u_ext,
                    PrecalcShapeset *fv, RefMap *rv, Hermes::vector<scalar>& result);
 
-  int calc_order_vector_form_vol(WeakForm::VectorFormVol *mfv, Hermes::vector<Solution *> u_ext,
+  int calc_order_vector_form_vol(WeakForm::VectorFormVol *mfv, Hermes::vector<Solution *>& u_ext,
                                   PrecalcShapeset *fv, RefMap *rv);
-  int calc_order_vector_form_vol(WeakForm::MultiComponentVectorFormVol *mfv, Hermes::vector<Solution *> u_ext,
+  int calc_order_vector_form_vol(WeakForm::MultiComponentVectorFormVol *mfv, Hermes::vector<Solution *>& u_ext,
                                   PrecalcShapeset *fv, RefMap *rv);
   
   scalar eval_form_subelement(int order, WeakForm::VectorFormVol *vfv, 
-                              Hermes::vector<Solution *> u_ext,
+                              Hermes::vector<Solution *>& u_ext,
                               PrecalcShapeset *fv, RefMap *rv);
   
   scalar eval_form_adaptive(int order_init, scalar result_init,
                             WeakForm::VectorFormVol *vfv, 
-                            Hermes::vector<Solution *> u_ext,
+                            Hermes::vector<Solution *>& u_ext,
                             PrecalcShapeset *fv, RefMap *rv);
  
   // Matrix surface forms. The functions provide the same functionality as the
   // parallel ones for matrix volume forms.
   
   scalar eval_form(WeakForm::MatrixFormSurf *mfs, 
-                                  Hermes::vector<Solution *> u_ext, 
+                                  Hermes::vector<Solution *>& u_ext, 
                                   PrecalcShapeset *fu, PrecalcShapeset *fv, RefMap *ru, RefMap *rv, SurfPos* surf_pos);
   void eval_form(WeakForm::MultiComponentMatrixFormSurf *mfs, 
-                                  Hermes::vector<Solution *> u_ext, 
+                                  Hermes::vector<Solution *>& u_ext, 
                                   PrecalcShapeset *fu, PrecalcShapeset *fv, RefMap *ru, RefMap *rv, SurfPos* surf_pos, Hermes::vector<scalar>& result);
 
   int calc_order_matrix_form_surf(WeakForm::MatrixFormSurf *mfs, 
-                                  Hermes::vector<Solution *> u_ext,
+                                  Hermes::vector<Solution *>& u_ext,
                                   PrecalcShapeset *fu, PrecalcShapeset *fv, 
                                   RefMap *ru, RefMap *rv, SurfPos* surf_pos);
   int calc_order_matrix_form_surf(WeakForm::MultiComponentMatrixFormSurf *mfs, 
-                                  Hermes::vector<Solution *> u_ext,
+                                  Hermes::vector<Solution *>& u_ext,
                                   PrecalcShapeset *fu, PrecalcShapeset *fv, 
                                   RefMap *ru, RefMap *rv, SurfPos* surf_pos);
 
-  scalar eval_form_subelement(int order, WeakForm::MatrixFormSurf *mfs, Hermes::vector<Solution *> u_ext,
+  scalar eval_form_subelement(int order, WeakForm::MatrixFormSurf *mfs, Hermes::vector<Solution *>& u_ext,
                               PrecalcShapeset *fu, PrecalcShapeset *fv, RefMap *ru, RefMap *rv, SurfPos* surf_pos);
 
   scalar eval_form_adaptive(int order_init, scalar result_init,
-                                             WeakForm::MatrixFormSurf *mfs, Hermes::vector<Solution *> u_ext,
+                                             WeakForm::MatrixFormSurf *mfs, Hermes::vector<Solution *>& u_ext,
                                              PrecalcShapeset *fu, PrecalcShapeset *fv, RefMap *ru, 
                                              RefMap *rv, SurfPos* surf_pos);
 
@@ -351,53 +444,53 @@ protected:
   // parallel ones for matrix volume forms.
   
   scalar eval_form(WeakForm::VectorFormSurf *vfs, 
-                                  Hermes::vector<Solution *> u_ext, 
+                                  Hermes::vector<Solution *>& u_ext, 
                                   PrecalcShapeset *fv, RefMap *rv, SurfPos* surf_pos);
   void eval_form(WeakForm::MultiComponentVectorFormSurf *vfs, 
-                                  Hermes::vector<Solution *> u_ext, 
+                                  Hermes::vector<Solution *>& u_ext, 
                                   PrecalcShapeset *fv, RefMap *rv, SurfPos* surf_pos, Hermes::vector<scalar>& result);
 
-  int calc_order_vector_form_surf(WeakForm::VectorFormSurf *vfs, Hermes::vector<Solution *> u_ext,
+  int calc_order_vector_form_surf(WeakForm::VectorFormSurf *vfs, Hermes::vector<Solution *>& u_ext,
                                   PrecalcShapeset *fv, RefMap *rv, SurfPos* surf_pos);
-  int calc_order_vector_form_surf(WeakForm::MultiComponentVectorFormSurf *vfs, Hermes::vector<Solution *> u_ext,
+  int calc_order_vector_form_surf(WeakForm::MultiComponentVectorFormSurf *vfs, Hermes::vector<Solution *>& u_ext,
                                   PrecalcShapeset *fv, RefMap *rv, SurfPos* surf_pos);
 
-  scalar eval_form_subelement(int order, WeakForm::VectorFormSurf *vfs, Hermes::vector<Solution *> u_ext,
+  scalar eval_form_subelement(int order, WeakForm::VectorFormSurf *vfs, Hermes::vector<Solution *>& u_ext,
                               PrecalcShapeset *fv, RefMap *rv, SurfPos* surf_pos);
 
   scalar eval_form_adaptive(int order_init, scalar result_init,
-                                             WeakForm::VectorFormSurf *vfs, Hermes::vector<Solution *> u_ext,
+                                             WeakForm::VectorFormSurf *vfs, Hermes::vector<Solution *>& u_ext,
                                              PrecalcShapeset *fv, RefMap *rv, SurfPos* surf_pos);
 
   // DG forms.
 
-  int calc_order_dg_matrix_form(WeakForm::MatrixFormSurf *mfs, Hermes::vector<Solution *> u_ext,
+  int calc_order_dg_matrix_form(WeakForm::MatrixFormSurf *mfs, Hermes::vector<Solution *>& u_ext,
                                   PrecalcShapeset *fu, PrecalcShapeset *fv, RefMap *ru, SurfPos* surf_pos,
                                   bool neighbor_supp_u, bool neighbor_supp_v, LightArray<NeighborSearch*>& neighbor_searches, int neighbor_index_u);
-  int calc_order_dg_matrix_form(WeakForm::MultiComponentMatrixFormSurf *mfs, Hermes::vector<Solution *> u_ext,
+  int calc_order_dg_matrix_form(WeakForm::MultiComponentMatrixFormSurf *mfs, Hermes::vector<Solution *>& u_ext,
                                   PrecalcShapeset *fu, PrecalcShapeset *fv, RefMap *ru, SurfPos* surf_pos,
                                   bool neighbor_supp_u, bool neighbor_supp_v, LightArray<NeighborSearch*>& neighbor_searches, int neighbor_index_u);
 
-  scalar eval_dg_form(WeakForm::MatrixFormSurf* mfs, Hermes::vector<Solution *> u_ext,
+  scalar eval_dg_form(WeakForm::MatrixFormSurf* mfs, Hermes::vector<Solution *>& u_ext,
                                      PrecalcShapeset *fu, PrecalcShapeset *fv, RefMap *ru_central, RefMap * ru_actual, RefMap *rv, 
                                      bool neighbor_supp_u, bool neighbor_supp_v,
                                      SurfPos* surf_pos, LightArray<NeighborSearch*>& neighbor_searches, int neighbor_index_u, int neighbor_index_v);
-  void eval_dg_form(WeakForm::MultiComponentMatrixFormSurf* mfs, Hermes::vector<Solution *> u_ext,
+  void eval_dg_form(WeakForm::MultiComponentMatrixFormSurf* mfs, Hermes::vector<Solution *>& u_ext,
                                      PrecalcShapeset *fu, PrecalcShapeset *fv, RefMap *ru_central, RefMap * ru_actual, RefMap *rv, 
                                      bool neighbor_supp_u, bool neighbor_supp_v,
                                      SurfPos* surf_pos, LightArray<NeighborSearch*>& neighbor_searches, int neighbor_index_u, int neighbor_index_v, Hermes::vector<scalar>& result);
   
-  int calc_order_dg_vector_form(WeakForm::VectorFormSurf *vfs, Hermes::vector<Solution *> u_ext,
+  int calc_order_dg_vector_form(WeakForm::VectorFormSurf *vfs, Hermes::vector<Solution *>& u_ext,
                                   PrecalcShapeset *fv, RefMap *ru, SurfPos* surf_pos,
                                   LightArray<NeighborSearch*>& neighbor_searches, int neighbor_index_v);
-  int calc_order_dg_vector_form(WeakForm::MultiComponentVectorFormSurf *vfs, Hermes::vector<Solution *> u_ext,
+  int calc_order_dg_vector_form(WeakForm::MultiComponentVectorFormSurf *vfs, Hermes::vector<Solution *>& u_ext,
                                   PrecalcShapeset *fv, RefMap *ru, SurfPos* surf_pos,
                                   LightArray<NeighborSearch*>& neighbor_searches, int neighbor_index_v);
 
-  scalar eval_dg_form(WeakForm::VectorFormSurf* vfs, Hermes::vector<Solution *> u_ext,
+  scalar eval_dg_form(WeakForm::VectorFormSurf* vfs, Hermes::vector<Solution *>& u_ext,
                                      PrecalcShapeset *fv, RefMap *rv, 
                                      SurfPos* surf_pos, LightArray<NeighborSearch*>& neighbor_searches, int neighbor_index_v);
-  void eval_dg_form(WeakForm::MultiComponentVectorFormSurf* vfs, Hermes::vector<Solution *> u_ext,
+  void eval_dg_form(WeakForm::MultiComponentVectorFormSurf* vfs, Hermes::vector<Solution *>& u_ext,
                                      PrecalcShapeset *fv, RefMap *rv, 
                                      SurfPos* surf_pos, LightArray<NeighborSearch*>& neighbor_searches, int neighbor_index_v, Hermes::vector<scalar>& result);
 
@@ -407,14 +500,51 @@ protected:
   ExtData<Ord>* init_ext_fns_ord(Hermes::vector<MeshFunction *> &ext,
                                  LightArray<NeighborSearch*>& neighbor_searches);
   ExtData<scalar>* init_ext_fns(Hermes::vector<MeshFunction *> &ext,  
-                                RefMap *rm, const int order);
+                                RefMap *rm, const int order, Arena* arena = NULL);
   ExtData<scalar>* init_ext_fns(Hermes::vector<MeshFunction *> &ext, 
                                 LightArray<NeighborSearch*>& neighbor_searches,
-                                int order);
+                                int order, Arena* arena = NULL);
 
   Func<double>* get_fn(PrecalcShapeset *fu, RefMap *rm, const int order);
   Func<Ord>* get_fn_ord(const int order);
 
+  /// Cache of integration orders.
+  /// The order of a form only depends on the polynomial orders of the functions it
+  /// is evaluated with (and on the element mode), so the Ord version of the form is
+  /// only parsed once for each such combination. The cache is cleared whenever the
+  /// weak formulation changes.
+  static const int H2D_ORDER_CACHE_MAX_FNS = 24;
+  struct OrderCacheKey
+  {
+    void* form;
+    int mode;
+    int num_orders;
+    int orders[H2D_ORDER_CACHE_MAX_FNS];
+  };
+  struct OrderCacheCompare
+  {
+    bool operator()(const OrderCacheKey& a, const OrderCacheKey& b) const {
+      if (a.form != b.form) return a.form < b.form;
+      if (a.mode != b.mode) return a.mode < b.mode;
+      if (a.num_orders != b.num_orders) return a.num_orders < b.num_orders;
+      for (int i = 0; i < a.num_orders; i++)
+        if (a.orders[i] != b.orders[i]) return a.orders[i] < b.orders[i];
+      return false;
+    }
+  };
+  std::map<OrderCacheKey, int, OrderCacheCompare> order_cache;
+  int order_cache_wf_seq;
+  unsigned long order_cache_queries;
+  unsigned long order_cache_hits;
+
+  /// Fills in the key for the current functions; edge is -1 for volumetric forms.
+  /// Returns false if the form uses too many functions to be cached.
+  bool get_order_cache_key(void* form, Hermes::vector<Solution *>& u_ext,
+                           PrecalcShapeset *fu, PrecalcShapeset *fv,
+                           Hermes::vector<MeshFunction *>& ext, int edge, OrderCacheKey& key);
+  bool order_cache_lookup(const OrderCacheKey& key, int& order);
+  void order_cache_insert(const OrderCacheKey& key, int order);
+
   struct VolVectorFormsKey
   {
     WeakForm::VectorFormVol* vfv;
@@ -434,6 +564,11 @@ protected:
   /// Initialize neighbors.
   void init_neighbors(LightArray<NeighborSearch*>& neighbor_searches, const WeakForm::Stage& stage, const int& isurf);
 
+  /// Returns the table of neighbors of the current state of the mesh, it is built the first time
+  /// the state is used and then shared by the sparse structure creation and all assemblings.
+  NeighborTable* get_neighbor_table(Mesh* mesh);
+  std::map<Mesh*, NeighborTable*> neighbor_tables;
+
   /// Multimesh neighbors traversal class.
   class NeighborNode
   {
@@ -517,6 +652,56 @@ protected:
   bool struct_changed;
   bool is_up_to_date();
 
+  /// Cached nonzero structure of the matrix and the space and weak form seq numbers
+  /// and present blocks it was created for.
+  SparsityPattern* sparsity_pattern;
+  int* pattern_sp_seq;
+  int pattern_wf_seq;
+  std::vector<bool> pattern_blocks;
+  bool is_sparsity_pattern_up_to_date(std::vector<bool>& pattern_blocks);
+  void create_sparsity_pattern(bool** blocks, bool force_diagonal_blocks, Table* block_weights,
+                               bool is_DG, std::vector<bool>& pattern_blocks);
+
+  /// Precomputed scatter maps, see set_precomputed_scatter().
+  /// A local matrix is identified by its block, the elements of the two spaces
+  /// and the boundary edge (-1 for volume forms).
+  struct ScatterKey
+  {
+    int block, id_m, id_n, surf;
+    bool operator<(const ScatterKey& other) const
+    {
+      if (block != other.block) return block < other.block;
+      if (id_m != other.id_m) return id_m < other.id_m;
+      if (id_n != other.id_n) return id_n < other.id_n;
+      return surf < other.surf;
+    }
+  };
+  /// Positions of the entries of the local matrices (row by row, -1 for Dirichlet dofs
+  /// and entries outside the pattern),
+  /// the map gives the offset of each local matrix in 'positions'.
+  struct ScatterMap
+  {
+    std::map<ScatterKey, size_t> offsets;
+    std::vector<int> positions;
+  };
+  bool precomputed_scatter;
+  /// Owned by the DiscreteProblem, shared (read only) by its assembling workers.
+  /// Deleted whenever the sparsity pattern is recreated.
+  ScatterMap* scatter_map;
+  /// Elements of the current state in all spaces, they identify the local matrices.
+  Hermes::vector<Element *> state_elems;
+
+  /// Calculates the scatter maps of all volume and surface matrix forms, the sparsity
+  /// pattern has to be finished.
+  void create_scatter_map(bool** blocks, Table* block_weights);
+  /// Appends the positions of the local matrix with the rows 'am' and the columns 'an'.
+  void add_scatter_positions(const ScatterKey& key, AsmList* am, AsmList* an);
+
+  /// Inserts the local matrix of the block (m, n) with the rows 'am' and the columns 'an'
+  /// into the global matrix, using the precomputed positions if available.
+  void insert_local_matrix(SparseMatrix* mat, int m, int n, int surf, scalar** local_matrix,
+                           AsmList* am, AsmList* an);
+
   PrecalcShapeset** pss;    // This is different from H3D.
   int num_user_pss;         // This is different from H3D.
 
@@ -530,6 +715,20 @@ protected:
   void delete_cache();
   void delete_single_geom_cache(int order);
 
+  /// Scratch memory of one traversal state: the geometry caches above, the shape functions
+  /// in the caches for elements with non-constant jacobians, and the neighbor arrays
+  /// in create_sparsity_pattern(). Reset at the end of every state.
+  Arena state_arena;
+  /// Scratch memory of one form evaluation: values of the previous iteration, external
+  /// functions and the DG wrappers. Released when eval_form() / eval_dg_form() returns.
+  Arena form_arena;
+
+  /// Assembly lists and flags of the current state, kept between states so that
+  /// their arrays are allocated only once.
+  Hermes::vector<AsmList *> state_al;
+  Hermes::vector<bool> state_nat;
+  Hermes::vector<bool> state_isempty;
+
   /// Class handling various caches used in assembling.
   class AssemblingCaches {
   public:
@@ -23,6 +23,15 @@ template<> double DiscontinuousFunc<double>::zero = 0.0;
   template<> std::complex<double> DiscontinuousFunc<std::complex<double> >::zero = std::complex<double>(0);
 #endif
 
+/// Creates a Func object in the arena, or on the heap if the arena is NULL.
+template<typename T>
+static Func<T>* new_func(Arena* arena, int np, int nc)
+{
+  if (arena != NULL)
+    return new (arena->allocate(sizeof(Func<T>))) Func<T>(np, nc);
+  return new Func<T>(np, nc);
+}
+
 /// Integration order for coordinates, normals and tangents is one.
 Geom<Ord>* init_geom_ord()
 {
@@ -48,9 +57,9 @@ Geom<Ord>* init_geom_ord()
 }
 
 /// Initialize element marker and coordinates.
-Geom<double>* init_geom_vol(RefMap *rm, const int order)
+Geom<double>* init_geom_vol(RefMap *rm, const int order, Arena* arena)
 {
-  Geom<double>* e = new Geom<double>;
+  Geom<double>* e = (arena != NULL) ? new (arena->allocate(sizeof(Geom<double>))) Geom<double> : new Geom<double>;
   e->diam = rm->get_active_element()->get_diameter();
   e->id = rm->get_active_element()->id;
   e->elem_marker = rm->get_active_element()->marker;
@@ -60,9 +69,9 @@ Geom<double>* init_geom_vol(RefMap *rm, const int order)
 }
 
 /// Initialize edge marker, coordinates, tangent and normals.
-Geom<double>* init_geom_surf(RefMap *rm, SurfPos* surf_pos, const int order)
+Geom<double>* init_geom_surf(RefMap *rm, SurfPos* surf_pos, const int order, Arena* arena)
 {
-  Geom<double>* e = new Geom<double>;
+  Geom<double>* e = (arena != NULL) ? new (arena->allocate(sizeof(Geom<double>))) Geom<double> : new Geom<double>;
   e->edge_marker = surf_pos->marker;
   e->elem_marker = rm->get_active_element()->marker;
   e->diam = rm->get_active_element()->get_diameter();
@@ -74,10 +83,10 @@ Geom<double>* init_geom_surf(RefMap *rm, SurfPos* surf_pos, const int order)
 
   Quad2D* quad = rm->get_quad_2d();
   int np = quad->get_num_points(order);
-  e->tx = new double [np];
-  e->ty = new double [np];
-  e->nx = new double [np];
-  e->ny = new double [np];
+  e->tx = new_array<double>(arena, np);
+  e->ty = new_array<double>(arena, np);
+  e->nx = new_array<double>(arena, np);
+  e->ny = new_array<double>(arena, np);
   for (int i = 0; i < np; i++) {
     e->tx[i] = tan[i][0];  e->ty[i] =   tan[i][1];
     e->nx[i] = tan[i][1];  e->ny[i] = - tan[i][0];
@@ -106,7 +115,7 @@ Func<Ord>* init_fn_ord(const int order)
 }
 
 /// Transformation of shape functions using reference mapping.
-Func<double>* init_fn(PrecalcShapeset *fu, RefMap *rm, const int order)
+Func<double>* init_fn(PrecalcShapeset *fu, RefMap *rm, const int order, Arena* arena)
 {
   int nc = fu->get_num_components();
   ESpaceType space_type = fu->get_space_type();
@@ -119,15 +128,15 @@ Func<double>* init_fn(PrecalcShapeset *fu, RefMap *rm, const int order)
   fu->set_quad_order(order);
   double3* pt = quad->get_points(order);
   int np = quad->get_num_points(order);
-  Func<double>* u = new Func<double>(np, nc);
+  Func<double>* u = new_func<double>(arena, np, nc);
 
   // H1 space.
   if (space_type == HERMES_H1_SPACE) {
-    u->val = new double [np];
-    u->dx  = new double [np];
-    u->dy  = new double [np];
+    u->val = new_array<double>(arena, np);
+    u->dx  = new_array<double>(arena, np);
+    u->dy  = new_array<double>(arena, np);
 #ifdef H2D_SECOND_DERIVATIVES_ENABLED
-    u->laplace = new double [np];
+    u->laplace = new_array<double>(arena, np);
 #endif
     double *fn = fu->get_fn_values();
     double *dx = fu->get_dx_values();
@@ -140,7 +149,7 @@ Func<double>* init_fn(PrecalcShapeset *fu, RefMap *rm, const int order)
 
     double2x2 *m;
     if(rm->is_jacobian_const()) {
-      m = new double2x2[np];
+      m = new_array<double2x2>(arena, np);
       double2x2 const_inv_ref_map;
 
       const_inv_ref_map[0][0] = rm->get_const_inv_ref_map()[0][0][0];
@@ -184,14 +193,14 @@ Func<double>* init_fn(PrecalcShapeset *fu, RefMap *rm, const int order)
     }
 
     m -= np;
-    if(rm->is_jacobian_const())
+    if(rm->is_jacobian_const() && arena == NULL)
       delete [] m;
   }
   // Hcurl space.
   else if (space_type == HERMES_HCURL_SPACE) {
-    u->val0 = new double [np];
-    u->val1 = new double [np];
-    u->curl = new double [np];
+    u->val0 = new_array<double>(arena, np);
+    u->val1 = new_array<double>(arena, np);
+    u->curl = new_array<double>(arena, np);
 
     double *fn0 = fu->get_fn_values(0);
     double *fn1 = fu->get_fn_values(1);
@@ -199,7 +208,7 @@ Func<double>* init_fn(PrecalcShapeset *fu, RefMap *rm, const int order)
     double *dy0 = fu->get_dy_values(0);
     double2x2 *m;
     if(rm->is_jacobian_const()) {
-      m = new double2x2[np];
+      m = new_array<double2x2>(arena, np);
       double2x2 const_inv_ref_map;
 
       const_inv_ref_map[0][0] = rm->get_const_inv_ref_map()[0][0][0];
@@ -223,13 +232,14 @@ Func<double>* init_fn(PrecalcShapeset *fu, RefMap *rm, const int order)
     }
 
     m -= np;
-    if(rm->is_jacobian_const())
+    if(rm->is_jacobian_const() && arena == NULL)
       delete [] m;
   }
   // Hdiv space.
   else if (space_type == HERMES_HDIV_SPACE) {
-    u->val0 = new double [np];
-    u->val1 = new double [np];
+    u->val0 = new_array<double>(arena, np);
+    u->val1 = new_array<double>(arena, np);
+    u->div = new_array<double>(arena, np);
 
     double *fn0 = fu->get_fn_values(0);
     double *fn1 = fu->get_fn_values(1);
@@ -237,7 +247,7 @@ Func<double>* init_fn(PrecalcShapeset *fu, RefMap *rm, const int order)
     double *dy1 = fu->get_dy_values(1);
     double2x2 *m;
     if(rm->is_jacobian_const()) {
-      m = new double2x2[np];
+      m = new_array<double2x2>(arena, np);
       double2x2 const_inv_ref_map;
 
       const_inv_ref_map[0][0] = rm->get_const_inv_ref_map()[0][0][0];
@@ -260,16 +270,16 @@ Func<double>* init_fn(PrecalcShapeset *fu, RefMap *rm, const int order)
       u->div[i] = ((*m)[0][0] * (*m)[1][1] - (*m)[1][0] * (*m)[0][1]) * (dx0[i] + dy1[i]);
     }
     m -= np;
-    if(rm->is_jacobian_const())
+    if(rm->is_jacobian_const() && arena == NULL)
       delete [] m;
   }
   // L2 Space.
   else if (space_type == HERMES_L2_SPACE) {
     // Same as for H1, except that we currently do not have
     // second derivatives of L2 shape functions for triangles.
-    u->val = new double [np];
-    u->dx  = new double [np];
-    u->dy  = new double [np];
+    u->val = new_array<double>(arena, np);
+    u->dx  = new_array<double>(arena, np);
+    u->dy  = new_array<double>(arena, np);
 
     double *fn = fu->get_fn_values();
     double *dx = fu->get_dx_values();
@@ -277,7 +287,7 @@ Func<double>* init_fn(PrecalcShapeset *fu, RefMap *rm, const int order)
 
     double2x2 *m;
     if(rm->is_jacobian_const()) {
-      m = new double2x2[np];
+      m = new_array<double2x2>(arena, np);
       double2x2 const_inv_ref_map;
 
       const_inv_ref_map[0][0] = rm->get_const_inv_ref_map()[0][0][0];
@@ -302,7 +312,7 @@ Func<double>* init_fn(PrecalcShapeset *fu, RefMap *rm, const int order)
     }
 
     m -= np;
-    if(rm->is_jacobian_const())
+    if(rm->is_jacobian_const() && arena == NULL)
       delete [] m;
 	}
   else
@@ -312,7 +322,7 @@ Func<double>* init_fn(PrecalcShapeset *fu, RefMap *rm, const int order)
 }
 
 /// Preparation of mesh functions.
-Func<scalar>* init_fn(MeshFunction *fu, const int order)
+Func<scalar>* init_fn(MeshFunction *fu, const int order, Arena* arena)
 {
   // Sanity checks.
   if (fu == NULL) error("NULL MeshFunction in Func<scalar>*::init_fn().");
@@ -323,21 +333,21 @@ Func<scalar>* init_fn(MeshFunction *fu, const int order)
   fu->set_quad_order(order);
   double3* pt = quad->get_points(order);
   int np = quad->get_num_points(order);
-  Func<scalar>* u = new Func<scalar>(np, nc);
+  Func<scalar>* u = new_func<scalar>(arena, np, nc);
 
   if (u->nc == 1) {
-    u->val = new scalar [np];
-    u->dx  = new scalar [np];
-    u->dy  = new scalar [np];
+    u->val = new_array<scalar>(arena, np);
+    u->dx  = new_array<scalar>(arena, np);
+    u->dy  = new_array<scalar>(arena, np);
     memcpy(u->val, fu->get_fn_values(), np * sizeof(scalar));
     memcpy(u->dx, fu->get_dx_values(), np * sizeof(scalar));
     memcpy(u->dy, fu->get_dy_values(), np * sizeof(scalar));
   }
   else if (u->nc == 2) {
-    u->val0 = new scalar [np];
-    u->val1 = new scalar [np];
-    u->curl = new scalar [np];
-    u->div = new scalar [np];
+    u->val0 = new_array<scalar>(arena, np);
+    u->val1 = new_array<scalar>(arena, np);
+    u->curl = new_array<scalar>(arena, np);
+    u->div = new_array<scalar>(arena, np);
 
     memcpy(u->val0, fu->get_fn_values(0), np * sizeof(scalar));
     memcpy(u->val1, fu->get_fn_values(1), np * sizeof(scalar));
@@ -354,7 +364,7 @@ Func<scalar>* init_fn(MeshFunction *fu, const int order)
 }
 
 /// Preparation of solutions.
-Func<scalar>* init_fn(Solution *fu, const int order)
+Func<scalar>* init_fn(Solution *fu, const int order, Arena* arena)
 {
   // Sanity checks.
   if (fu == NULL) error("NULL MeshFunction in Func<scalar>*::init_fn().");
@@ -374,15 +384,15 @@ Func<scalar>* init_fn(Solution *fu, const int order)
 
   double3* pt = quad->get_points(order);
   int np = quad->get_num_points(order);
-  Func<scalar>* u = new Func<scalar>(np, nc);
+  Func<scalar>* u = new_func<scalar>(arena, np, nc);
 
   if (u->nc == 1) {
-    u->val = new scalar [np];
-    u->dx  = new scalar [np];
-    u->dy  = new scalar [np];
+    u->val = new_array<scalar>(arena, np);
+    u->dx  = new_array<scalar>(arena, np);
+    u->dy  = new_array<scalar>(arena, np);
 #ifdef H2D_SECOND_DERIVATIVES_ENABLED
     if (space_type == HERMES_H1_SPACE && sln_type != HERMES_EXACT)
-      u->laplace = new scalar [np];
+      u->laplace = new_array<scalar>(arena, np);
 #endif
     memcpy(u->val, fu->get_fn_values(), np * sizeof(scalar));
     memcpy(u->dx, fu->get_dx_values(), np * sizeof(scalar));
@@ -401,10 +411,10 @@ Func<scalar>* init_fn(Solution *fu, const int order)
 #endif
   }
   else if (u->nc == 2) {
-    u->val0 = new scalar [np];
-    u->val1 = new scalar [np];
-    u->curl = new scalar [np];
-    u->div = new scalar [np];
+    u->val0 = new_array<scalar>(arena, np);
+    u->val1 = new_array<scalar>(arena, np);
+    u->curl = new_array<scalar>(arena, np);
+    u->div = new_array<scalar>(arena, np);
 
     memcpy(u->val0, fu->get_fn_values(0), np * sizeof(scalar));
     memcpy(u->val1, fu->get_fn_values(1), np * sizeof(scalar));
@@ -22,6 +22,7 @@
 #include "../function/function.h"
 #include "../function/solution.h"
 #include "../mesh/refmap.h"
+#include "../arena.h"
 
 #define callback(a)	a<double, scalar>, a<Ord, Ord>
 
@@ -399,18 +400,22 @@ public:
 /// Init element geometry for calculating the integration order.
 HERMES_API Geom<Ord>* init_geom_ord();
 /// Init element geometry for volumetric integrals.
-HERMES_API Geom<double>* init_geom_vol(RefMap *rm, const int order);
+HERMES_API Geom<double>* init_geom_vol(RefMap *rm, const int order, Arena* arena = NULL);
 /// Init element geometry for surface integrals.
-HERMES_API Geom<double>* init_geom_surf(RefMap *rm, SurfPos* surf_pos, const int order);
+HERMES_API Geom<double>* init_geom_surf(RefMap *rm, SurfPos* surf_pos, const int order, Arena* arena = NULL);
 
 /// Init the function for calculation the integration order.
 HERMES_API Func<Ord>* init_fn_ord(const int order);
+
+// The following functions place the returned object and its arrays in the arena if one
+// is given; such objects are released with the arena and must not be freed by free_fn().
+
 /// Init the shape function for the evaluation of the volumetric/surface integral (transformation of values).
-HERMES_API Func<double>* init_fn(PrecalcShapeset *fu, RefMap *rm, const int order);
+HERMES_API Func<double>* init_fn(PrecalcShapeset *fu, RefMap *rm, const int order, Arena* arena = NULL);
 /// Init the mesh-function for the evaluation of the volumetric/surface integral.
-HERMES_API Func<scalar>* init_fn(MeshFunction *fu, const int order);
+HERMES_API Func<scalar>* init_fn(MeshFunction *fu, const int order, Arena* arena = NULL);
 /// Init the solution for the evaluation of the volumetric/surface integral.
-HERMES_API Func<scalar>* init_fn(Solution *fu, const int order);
+HERMES_API Func<scalar>* init_fn(Solution *fu, const int order, Arena* arena = NULL);
 
 /// User defined data that can go to the bilinear and linear forms.
 /// It also holds arbitraty number of functions, that user can use.
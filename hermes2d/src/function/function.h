@@ -115,7 +115,13 @@ public:
   ///   H2D_FN_VAL | H2D_FN_DX | H2D_FN_DY. You can also use H2D_FN_ALL to precalculate everything.
   void set_quad_order(unsigned int order, int mask = H2D_FN_DEFAULT)
   {
-    if(nodes->present(order)) {
+    if(order_nodes != NULL) {
+      cur_node = (order < num_order_nodes) ? order_nodes[order] : NULL;
+      // precalculate() stores the new Node in order_nodes itself.
+      if(cur_node == NULL || (cur_node->mask & mask) != mask)
+        precalculate(order, mask);
+    }
+    else if(nodes->present(order)) {
       cur_node = nodes->get(order);
       // If the mask has changed.
       if((cur_node->mask & mask) != mask) {
@@ -244,6 +250,11 @@ protected:
   /// Table of nodes.
   LightArray<Node*>* nodes;
 
+  /// Table of nodes indexed directly by the integration order. If not NULL, it is used
+  /// instead of 'nodes' (see PrecalcShapeset).
+  Node** order_nodes;
+  unsigned int num_order_nodes;
+
   // Current Node.
   Node* cur_node;
 
@@ -323,6 +334,8 @@ Function<TYPE>::Function()
   cur_node = NULL;
   sub_tables = NULL;
   nodes = NULL;
+  order_nodes = NULL;
+  num_order_nodes = 0;
   overflow_nodes = NULL;
   memset(quads, 0, sizeof(quads));
 }
@@ -18,6 +18,17 @@
 #include "../../../hermes_common/matrix.h"
 #include "../shapeset/precalc.h"
 #include "../mesh/refmap.h"
+#include "../mesh/element_locator.h"
+#ifdef WITH_ZLIB
+  #include <zlib.h>
+#endif
+#if !defined(WIN32) && !defined(_WINDOWS)
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+  #define H2D_MMAP
+#endif
 
 //// MeshFunction //////////////////////////////////////////////////////////////////////////////////
 
@@ -190,6 +201,7 @@ void Solution::init()
   own_mesh = false;
   num_components = 0;
   e_last = NULL;
+  locator = NULL;
   exact_mult = 1.0;
 
   for(int i = 0; i < 4; i++)
@@ -200,6 +212,8 @@ void Solution::init()
   elem_coefs[0] = elem_coefs[1] = NULL;
   elem_orders = NULL;
   dxdy_buffer = NULL;
+  mapped_data = NULL;
+  mapped_size = 0;
   num_coefs = num_elems = 0;
   num_dofs = -1;
 
@@ -272,6 +286,8 @@ void Solution::assign(Solution* sln)
   elem_coefs[0] = sln->elem_coefs[0];  sln->elem_coefs[0] = NULL;
   elem_coefs[1] = sln->elem_coefs[1];  sln->elem_coefs[1] = NULL;
   elem_orders = sln->elem_orders;      sln->elem_orders = NULL;
+  mapped_data = sln->mapped_data;      sln->mapped_data = NULL;
+  mapped_size = sln->mapped_size;      sln->mapped_size = 0;
   dxdy_buffer = sln->dxdy_buffer;      sln->dxdy_buffer = NULL;
   num_coefs = sln->num_coefs;          sln->num_coefs = 0;
   num_elems = sln->num_elems;          sln->num_elems = 0;
@@ -350,6 +366,7 @@ void Solution::free_tables()
 
 void Solution::free()
 {
+  free_mapping();
   if (mono_coefs  != NULL) { delete [] mono_coefs;   mono_coefs = NULL;  }
   if (elem_orders != NULL) { delete [] elem_orders;  elem_orders = NULL; }
   if (dxdy_buffer != NULL) { delete [] dxdy_buffer;  dxdy_buffer = NULL; }
@@ -366,6 +383,7 @@ void Solution::free()
   }
 
   e_last = NULL;
+  if (locator != NULL) { delete locator;  locator = NULL; }
 
   free_tables();
 }
@@ -1169,6 +1187,124 @@ void Solution::precalculate(int order, int mask)
 
 //// save & load ///////////////////////////////////////////////////////////////////////////////////
 
+// Solution file, version 2: a header followed by the sections listed below. Every section
+// starts at an offset aligned to H2DS_ALIGN bytes, so that an uncompressed file can be mapped
+// into memory and the sections used directly as the arrays of the Solution. In a compressed
+// file, each section is split into blocks of H2DS_BLOCK_SIZE bytes and every block is stored
+// as its size in the file followed by the zlib stream (or by the raw data, if the block did
+// not compress).
+
+static const int H2DS_VERSION = 2;
+static const int H2DS_ALIGN = 64;
+static const int H2DS_BLOCK_SIZE = 1 << 20;
+static const int H2DS_COMPRESSED = 1;
+
+enum { H2DS_MONO_COEFS, H2DS_ELEM_ORDERS, H2DS_ELEM_COEFS_0, H2DS_ELEM_COEFS_1, H2DS_MESH, H2DS_NUM_SECTIONS };
+
+struct H2DSHeader
+{
+  char magic[4];                       // "H2DS"
+  int ver, flags;
+  int ss, nc, ne, nf, nd;              // scalar size, components, elements, coefficients, dofs
+  uint64_t offset[H2DS_NUM_SECTIONS];  // position of the section in the file
+  uint64_t size[H2DS_NUM_SECTIONS];    // size of the section data
+  uint64_t stored[H2DS_NUM_SECTIONS];  // number of bytes the section takes in the file
+};
+
+static void write_section(FILE* f, H2DSHeader& hdr, int sec, const void* data, uint64_t size)
+{
+  // align the section
+  static const char zeros[H2DS_ALIGN] = { 0 };
+  long pos = ftell(f);
+  if (pos % H2DS_ALIGN) hermes_fwrite(zeros, 1, H2DS_ALIGN - pos % H2DS_ALIGN, f);
+  hdr.offset[sec] = ftell(f);
+  hdr.size[sec] = size;
+
+  if (!(hdr.flags & H2DS_COMPRESSED))
+  {
+    if (size) hermes_fwrite(data, 1, size, f);
+    hdr.stored[sec] = size;
+    return;
+  }
+
+#ifdef WITH_ZLIB
+  hdr.stored[sec] = 0;
+  Bytef* buffer = new Bytef[compressBound(H2DS_BLOCK_SIZE)];
+  for (uint64_t start = 0; start < size; start += H2DS_BLOCK_SIZE)
+  {
+    uLong block = (uLong) std::min((uint64_t) H2DS_BLOCK_SIZE, size - start);
+    const Bytef* src = (const Bytef*) data + start;
+    uLongf len = compressBound(block);
+    if (compress2(buffer, &len, src, block, Z_BEST_SPEED) != Z_OK)
+      error("Compression of the solution failed.");
+
+    // incompressible blocks are stored as they are
+    unsigned int stored = (len < block) ? len : block;
+    hermes_fwrite(&stored, sizeof(unsigned int), 1, f);
+    hermes_fwrite((stored < block) ? buffer : src, 1, stored, f);
+    hdr.stored[sec] += sizeof(unsigned int) + stored;
+  }
+  delete [] buffer;
+#endif
+}
+
+static void read_section(FILE* f, const H2DSHeader& hdr, int sec, void* data)
+{
+  uint64_t size = hdr.size[sec];
+  if (fseek(f, hdr.offset[sec], SEEK_SET) != 0) error("Corrupt solution file.");
+
+  if (!(hdr.flags & H2DS_COMPRESSED))
+  {
+    if (size) hermes_fread(data, 1, size, f);
+    return;
+  }
+
+#ifdef WITH_ZLIB
+  Bytef* buffer = new Bytef[compressBound(H2DS_BLOCK_SIZE)];
+  for (uint64_t start = 0; start < size; start += H2DS_BLOCK_SIZE)
+  {
+    uLongf block = (uLongf) std::min((uint64_t) H2DS_BLOCK_SIZE, size - start);
+    Bytef* dest = (Bytef*) data + start;
+    unsigned int stored;
+    hermes_fread(&stored, sizeof(unsigned int), 1, f);
+    if (stored > compressBound(H2DS_BLOCK_SIZE)) error("Corrupt solution file.");
+    if (stored == block)
+      hermes_fread(dest, 1, stored, f);
+    else
+    {
+      hermes_fread(buffer, 1, stored, f);
+      uLongf len = block;
+      if (uncompress(dest, &len, buffer, stored) != Z_OK || len != block)
+        error("Corrupt solution file.");
+    }
+  }
+  delete [] buffer;
+#else
+  error("The solution file is compressed, Hermes has to be built WITH_ZLIB to load it.");
+#endif
+}
+
+// Converts monomial coefficients stored with a different scalar size (real <-> complex).
+static scalar* convert_mono_coefs(const double* temp, int ss, int num_coefs)
+{
+  scalar* mono_coefs = new scalar[num_coefs];
+  if (ss == sizeof(double))
+  {
+    for (int i = 0; i < num_coefs; i++)
+      mono_coefs[i] = temp[i];
+  }
+  else if (ss == 2*sizeof(double))
+  {
+    warn("Ignoring imaginary part of the complex solution since this is not H2D_COMPLEX code.");
+    for (int i = 0; i < num_coefs; i++)
+      mono_coefs[i] = temp[2*i];
+  }
+  else
+    error("Corrupt solution file.");
+  return mono_coefs;
+}
+
+
 void Solution::save(const char* filename, bool compress)
 {
   int i;
@@ -1177,48 +1313,61 @@ void Solution::save(const char* filename, bool compress)
   if (sln_type == HERMES_CONST)  error("Constant solution cannot be saved to a file.");
   if (sln_type == HERMES_UNDEF) error("Cannot save -- uninitialized solution.");
 
-  // open the stream
-  std::string fname = filename;
-  if (compress) fname += ".gz";
-  FILE* f = fopen(fname.c_str(), "wb");
-  if (f == NULL) error("Could not open %s for writing.", filename);
-
+#ifndef WITH_ZLIB
   if (compress)
   {
-    fclose(f);
-    std::stringstream cmdline;
-    cmdline << "gzip > " << filename << ".gz";
-    f = popen(cmdline.str().c_str(), "w");
-    if (f == NULL) error("Could not create compressed stream (command line: %s).", cmdline.str().c_str());
+    warn("Hermes was built without zlib, saving the solution uncompressed.");
+    compress = false;
   }
+#endif
 
-  // write header
-  hermes_fwrite("H2DS\001\000\000\000", 1, 8, f);
-  int ssize = sizeof(scalar);
-  hermes_fwrite(&ssize, sizeof(int), 1, f);
-  hermes_fwrite(&num_components, sizeof(int), 1, f);
-  hermes_fwrite(&num_elems, sizeof(int), 1, f);
-  hermes_fwrite(&num_coefs, sizeof(int), 1, f);
-
-  // write monomial coefficients
-  hermes_fwrite(mono_coefs, sizeof(scalar), num_coefs, f);
-
-  // write element orders
-  char* temp_orders = new char[num_elems];
-  for (i = 0; i < num_elems; i++) {
-    temp_orders[i] = elem_orders[i];
-  }
-  hermes_fwrite(temp_orders, sizeof(char), num_elems, f);
-  delete [] temp_orders;
+  // open the stream
+  FILE* f = fopen(filename, "wb");
+  if (f == NULL) error("Could not open %s for writing.", filename);
 
-  // write element coef table
+  // the header is written once more at the end, when the section offsets are known
+  H2DSHeader hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, "H2DS", 4);
+  hdr.ver = H2DS_VERSION;
+  hdr.flags = compress ? H2DS_COMPRESSED : 0;
+  hdr.ss = sizeof(scalar);
+  hdr.nc = num_components;
+  hdr.ne = num_elems;
+  hdr.nf = num_coefs;
+  hdr.nd = num_dofs;
+  hermes_fwrite(&hdr, sizeof(hdr), 1, f);
+
+  // write monomial coefficients, element orders and element coef tables
+  write_section(f, hdr, H2DS_MONO_COEFS, mono_coefs, (uint64_t) num_coefs * sizeof(scalar));
+  write_section(f, hdr, H2DS_ELEM_ORDERS, elem_orders, (uint64_t) num_elems * sizeof(int));
   for (i = 0; i < num_components; i++)
-    hermes_fwrite(elem_coefs[i], sizeof(int), num_elems, f);
+    write_section(f, hdr, H2DS_ELEM_COEFS_0 + i, elem_coefs[i], (uint64_t) num_elems * sizeof(int));
 
   // write the mesh
-  mesh->save_raw(f);
+  if (!compress)
+  {
+    write_section(f, hdr, H2DS_MESH, NULL, 0);
+    mesh->save_raw(f);
+    hdr.size[H2DS_MESH] = hdr.stored[H2DS_MESH] = ftell(f) - hdr.offset[H2DS_MESH];
+  }
+  else
+  {
+    FILE* tmp = tmpfile();
+    if (tmp == NULL) error("Could not create a temporary file.");
+    mesh->save_raw(tmp);
+    long size = ftell(tmp);
+    char* buffer = new char[size];
+    rewind(tmp);
+    hermes_fread(buffer, 1, size, tmp);
+    fclose(tmp);
+    write_section(f, hdr, H2DS_MESH, buffer, size);
+    delete [] buffer;
+  }
 
-  if (compress) pclose(f); else fclose(f);
+  fseek(f, 0, SEEK_SET);
+  hermes_fwrite(&hdr, sizeof(hdr), 1, f);
+  fclose(f);
 }
 
 
@@ -1229,66 +1378,171 @@ void Solution::load(const char* filename)
   free();
   sln_type = HERMES_SLN;
 
-  int len = strlen(filename);
-  bool compressed = (len > 3 && !strcmp(filename + len - 3, ".gz"));
-
   // open the stream
   FILE* f = fopen(filename, "rb");
   if (f == NULL) error("Could not open %s", filename);
 
-  if (compressed)
+  // files saved by older versions may be gzipped as a whole
+  unsigned char gz[2] = { 0, 0 };
+  if (fread(gz, 1, 2, f) == 2 && gz[0] == 0x1f && gz[1] == 0x8b)
   {
+#ifdef WITH_ZLIB
     fclose(f);
-    std::stringstream cmdline;
-    cmdline << "gunzip < " << filename << ".gz";
-    f = popen(cmdline.str().c_str(), "r");
-    if (f == NULL) error("Could not read from compressed stream (command line: %s).", cmdline.str().c_str());
+    gzFile gzf = gzopen(filename, "rb");
+    f = tmpfile();
+    if (gzf == NULL || f == NULL) error("Could not decompress %s.", filename);
+    char buffer[65536];
+    int len;
+    while ((len = gzread(gzf, buffer, sizeof(buffer))) > 0)
+      hermes_fwrite(buffer, 1, len, f);
+    if (len < 0) error("Could not decompress %s.", filename);
+    gzclose(gzf);
+#else
+    error("%s is compressed with gzip. Decompress it first or build Hermes WITH_ZLIB.", filename);
+#endif
   }
+  rewind(f);
 
-  // load header
-  struct {
-    char magic[4];
-    int  ver, ss, nc, ne, nf;
-  } hdr;
-  hermes_fread(&hdr, sizeof(hdr), 1, f);
-
-  // some checks
+  H2DSHeader hdr;
+  hermes_fread(&hdr, 8, 1, f);
   if (hdr.magic[0] != 'H' || hdr.magic[1] != '2' || hdr.magic[2] != 'D' || hdr.magic[3] != 'S')
     error("Not a Hermes2D solution file.");
-  if (hdr.ver > 1)
+  if (hdr.ver == 1)
+  {
+    load_v1(f);
+    fclose(f);
+    init_dxdy_buffer();
+    return;
+  }
+  if (hdr.ver > H2DS_VERSION)
     error("Unsupported file version.");
+  hermes_fread((char*) &hdr + 8, sizeof(hdr) - 8, 1, f);
 
-  // load monomial coefficients
+  // some checks
+  if (hdr.nc < 1 || hdr.nc > 2 || hdr.ne < 0 || hdr.nf < 0)
+    error("Corrupt solution file.");
+  if (hdr.size[H2DS_MONO_COEFS] != (uint64_t) hdr.nf * hdr.ss)
+    error("Corrupt solution file.");
+  for (i = H2DS_ELEM_ORDERS; i <= H2DS_ELEM_COEFS_0 + hdr.nc - 1; i++)
+    if (hdr.size[i] != (uint64_t) hdr.ne * sizeof(int))
+      error("Corrupt solution file.");
+
+  num_components = hdr.nc;
+  num_elems = hdr.ne;
   num_coefs = hdr.nf;
-  if (hdr.ss == sizeof(double))
+  num_dofs = hdr.nd;
+
+  bool mapped = false;
+#ifdef H2D_MMAP
+  // map an uncompressed file, private pages are copied on write
+  if (!(hdr.flags & H2DS_COMPRESSED) && hdr.ss == sizeof(scalar))
   {
-    double* temp = new double[num_coefs];
-    hermes_fread(temp, sizeof(double), num_coefs, f);
+    int fd = open(filename, O_RDONLY);
+    struct stat st;
+    if (fd >= 0 && fstat(fd, &st) == 0 && (uint64_t) st.st_size >= hdr.offset[H2DS_MESH] + hdr.size[H2DS_MESH])
+    {
+      void* data = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+      if (data != MAP_FAILED)
+      {
+        mapped_data = data;
+        mapped_size = st.st_size;
+        mono_coefs = (scalar*) ((char*) data + hdr.offset[H2DS_MONO_COEFS]);
+        elem_orders = (int*) ((char*) data + hdr.offset[H2DS_ELEM_ORDERS]);
+        for (i = 0; i < num_components; i++)
+          elem_coefs[i] = (int*) ((char*) data + hdr.offset[H2DS_ELEM_COEFS_0 + i]);
+        mapped = true;
+      }
+    }
+    if (fd >= 0) close(fd);
+  }
+#endif
 
-    #ifndef H2D_COMPLEX
-      mono_coefs = temp;
-    #else
+  if (!mapped)
+  {
+    // load monomial coefficients
+    if (hdr.ss == sizeof(scalar))
+    {
       mono_coefs = new scalar[num_coefs];
-      for (i = 0; i < num_coefs; i++)
-        mono_coefs[i] = temp[i];
+      read_section(f, hdr, H2DS_MONO_COEFS, mono_coefs);
+    }
+    else
+    {
+      double* temp = new double[num_coefs * (hdr.ss / sizeof(double))];
+      read_section(f, hdr, H2DS_MONO_COEFS, temp);
+      mono_coefs = convert_mono_coefs(temp, hdr.ss, num_coefs);
       delete [] temp;
-    #endif
+    }
+
+    // load element orders and element coef tables
+    elem_orders = new int[num_elems];
+    read_section(f, hdr, H2DS_ELEM_ORDERS, elem_orders);
+    for (i = 0; i < num_components; i++)
+    {
+      elem_coefs[i] = new int[num_elems];
+      read_section(f, hdr, H2DS_ELEM_COEFS_0 + i, elem_coefs[i]);
+    }
   }
-  else if (hdr.ss == 2*sizeof(double))
+
+  // load the mesh
+  mesh = new Mesh;
+  if (!(hdr.flags & H2DS_COMPRESSED))
   {
-    #ifndef H2D_COMPLEX
-      warn("Ignoring imaginary part of the complex solution since this is not H2D_COMPLEX code.");
-      scalar* temp = new double[num_coefs*2];
-      hermes_fread(temp, sizeof(scalar), num_coefs*2, f);
-      mono_coefs = new double[num_coefs];
-      for (i = 0; i < num_coefs; i++)
-        mono_coefs[i] = temp[2*i];
-      delete [] temp;
+    if (fseek(f, hdr.offset[H2DS_MESH], SEEK_SET) != 0) error("Corrupt solution file.");
+    mesh->load_raw(f);
+  }
+  else
+  {
+    char* buffer = new char[hdr.size[H2DS_MESH]];
+    read_section(f, hdr, H2DS_MESH, buffer);
+#ifdef H2D_MMAP
+    FILE* mf = fmemopen(buffer, hdr.size[H2DS_MESH], "r");
+#else
+    // no fmemopen() on Windows, the mesh goes through a temporary file as in save()
+    FILE* mf = tmpfile();
+    if (mf != NULL)
+    {
+      hermes_fwrite(buffer, 1, hdr.size[H2DS_MESH], mf);
+      rewind(mf);
+    }
+#endif
+    if (mf == NULL) error("Could not read the mesh from the solution file.");
+    mesh->load_raw(mf);
+    fclose(mf);
+    delete [] buffer;
+  }
+  own_mesh = true;
+
+  fclose(f);
+
+  init_dxdy_buffer();
+}
+
+
+void Solution::load_v1(FILE* f)
+{
+  int i;
+
+  // load header
+  struct {
+    char magic[4];
+    int  ver, ss, nc, ne, nf;
+  } hdr;
+  rewind(f);
+  hermes_fread(&hdr, sizeof(hdr), 1, f);
 
-    #else
-      mono_coefs = new scalar[num_coefs];;
-      hermes_fread(mono_coefs, sizeof(scalar), num_coefs, f);
-    #endif
+  // load monomial coefficients
+  num_coefs = hdr.nf;
+  if (hdr.ss == sizeof(scalar))
+  {
+    mono_coefs = new scalar[num_coefs];
+    hermes_fread(mono_coefs, sizeof(scalar), num_coefs, f);
+  }
+  else if (hdr.ss == sizeof(double) || hdr.ss == 2*sizeof(double))
+  {
+    double* temp = new double[num_coefs * (hdr.ss / sizeof(double))];
+    hermes_fread(temp, hdr.ss, num_coefs, f);
+    mono_coefs = convert_mono_coefs(temp, hdr.ss, num_coefs);
+    delete [] temp;
   }
   else
     error("Corrupt solution file.");
@@ -1315,10 +1569,20 @@ void Solution::load(const char* filename)
   mesh->load_raw(f);
   //printf("Loading mesh from file and setting own_mesh = true.\n");
   own_mesh = true;
+}
 
-  if (compressed) pclose(f); else fclose(f);
 
-  init_dxdy_buffer();
+void Solution::free_mapping()
+{
+  if (mapped_data == NULL) return;
+#ifdef H2D_MMAP
+  munmap(mapped_data, mapped_size);
+#endif
+  mapped_data = NULL;
+  mapped_size = 0;
+  mono_coefs = NULL;
+  elem_orders = NULL;
+  elem_coefs[0] = elem_coefs[1] = NULL;
 }
 
 
@@ -1343,16 +1607,6 @@ scalar Solution::get_ref_value(Element* e, double xi1, double xi2, int component
 }
 
 
-static inline bool is_in_ref_domain(Element* e, double xi1, double xi2)
-{
-  const double TOL = 1e-11;
-  if (e->is_triangle())
-    return (xi1 + xi2 <= TOL) && (xi1 + 1.0 >= -TOL) && (xi2 + 1.0 >= -TOL);
-  else
-    return (xi1 - 1.0 <= TOL) && (xi1 + 1.0 >= -TOL) && (xi2 - 1.0 <= TOL) && (xi2 + 1.0 >= -TOL);
-}
-
-
 scalar Solution::get_ref_value_transformed(Element* e, double xi1, double xi2, int a, int b)
 {
 
@@ -1392,15 +1646,22 @@ scalar Solution::get_ref_value_transformed(Element* e, double xi1, double xi2, i
   return 0;
 }
 
-scalar Solution::get_pt_value(double x, double y, int item)
+void Solution::get_item_indices(int item, int& a, int& b)
 {
-  double xi1, xi2;
-
-  int a = 0, b = 0, mask = item; // a = component, b = val, dx, dy, dxx, dyy, dxy
+  int mask = item;
+  a = b = 0;
   if (num_components == 1) mask = mask & H2D_FN_COMPONENT_0;
   if ((mask & (mask - 1)) != 0) error("'item' is invalid. ");
   if (mask >= 0x40) { a = 1; mask >>= 6; }
   while (!(mask & 1)) { mask >>= 1; b++; }
+}
+
+scalar Solution::get_pt_value(double x, double y, int item)
+{
+  double xi1, xi2;
+
+  int a, b; // a = component, b = val, dx, dy, dxx, dyy, dxy
+  get_item_indices(item, a, b);
 
   if (sln_type == HERMES_EXACT)
   {
@@ -1443,11 +1704,11 @@ scalar Solution::get_pt_value(double x, double y, int item)
       elem[i] = e_last->get_neighbor(i-1);
 
     for (unsigned int i = 0; i <= e_last->nvert; i++)
-      if (elem[i] != NULL)
+      if (elem[i] != NULL && elem[i]->active)
       {
         refmap->set_active_element(elem[i]);
         refmap->untransform(elem[i], x, y, xi1, xi2);
-        if (is_in_ref_domain(elem[i], xi1, xi2))
+        if (ElementLocator::is_in_ref_domain(elem[i], xi1, xi2))
         {
           e_last = elem[i];
           return get_ref_value_transformed(elem[i], xi1, xi2, a, b);
@@ -1455,17 +1716,12 @@ scalar Solution::get_pt_value(double x, double y, int item)
       }
   }
 
-  // go through all elements
-  Element *e;
-  for_all_active_elements(e, mesh)
+  // look the point up in the spatial index
+  Element* e = get_locator()->get_element(x, y, refmap, xi1, xi2);
+  if (e != NULL)
   {
-    refmap->set_active_element(e);
-    refmap->untransform(e, x, y, xi1, xi2);
-    if (is_in_ref_domain(e, xi1, xi2))
-    {
-      e_last = e;
-      return get_ref_value_transformed(e, xi1, xi2, a, b);
-    }
+    e_last = e;
+    return get_ref_value_transformed(e, xi1, xi2, a, b);
   }
 
   warn("Point (%g, %g) does not lie in any element.", x, y);
@@ -1473,6 +1729,74 @@ scalar Solution::get_pt_value(double x, double y, int item)
 }
 
 
+void Solution::get_pt_values(const double* x, const double* y, int n, scalar* values, int item)
+{
+  if (sln_type != HERMES_SLN || n < 2)
+  {
+    for (int i = 0; i < n; i++)
+      values[i] = get_pt_value(x[i], y[i], item);
+    return;
+  }
+
+  // Visit the points cell by cell of the locator grid, so that most lookups
+  // are resolved by the last visited element or its neighbors.
+  ElementLocator* loc = get_locator();
+  std::vector<std::pair<int, int> > order(n);
+  for (int i = 0; i < n; i++)
+    order[i] = std::make_pair(loc->get_cell(x[i], y[i]), i);
+  std::sort(order.begin(), order.end());
+
+  int a, b;
+  get_item_indices(item, a, b);
+
+  const int CHUNK = 64;
+  double bx[CHUNK], by[CHUNK], xi1[CHUNK], xi2[CHUNK];
+  int outside[CHUNK];
+  int k = 0;
+  while (k < n)
+  {
+    int i = order[k++].second;
+    values[i] = get_pt_value(x[i], y[i], item);
+
+    // The following points of the cell are tried in the element just found (the refmap
+    // is active on it), the points outside of it are looked up one by one.
+    Element* e = e_last;
+    if (e == NULL || refmap->get_active_element() != e) continue;
+    int first = k, m = 0;
+    while (k < n && m < CHUNK && order[k].first == order[first - 1].first)
+    {
+      int j = order[k++].second;
+      bx[m] = x[j];
+      by[m++] = y[j];
+    }
+    refmap->untransform(e, m, bx, by, xi1, xi2);
+    int num_outside = 0;
+    for (int l = 0; l < m; l++)
+    {
+      int j = order[first + l].second;
+      if (ElementLocator::is_in_ref_domain(e, xi1[l], xi2[l]))
+        values[j] = get_ref_value_transformed(e, xi1[l], xi2[l], a, b);
+      else
+        outside[num_outside++] = j;
+    }
+    for (int l = 0; l < num_outside; l++)
+      values[outside[l]] = get_pt_value(x[outside[l]], y[outside[l]], item);
+  }
+}
+
+
+ElementLocator* Solution::get_locator()
+{
+  if (locator == NULL || locator->get_mesh() != mesh || !locator->is_up_to_date())
+  {
+    delete locator;
+    locator = new ElementLocator(mesh);
+    e_last = NULL;
+  }
+  return locator;
+}
+
+
 // Exact solution.
 ExactSolution::ExactSolution(Mesh* mesh) : Solution(mesh)
 {
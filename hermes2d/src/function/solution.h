@@ -22,6 +22,7 @@
 #include "../../../hermes_common/matrix.h"
 
 class PrecalcShapeset;
+class ElementLocator;
 class Ord;
 
 /// \brief Represents a function defined on a mesh.
@@ -131,13 +132,17 @@ public:
   void enable_transform(bool enable = true);
 
   /// Saves the complete solution (i.e., including the internal copy of the mesh and
-  /// element orders) to a binary file. On Linux, if `compress` is true, the file is
-  /// compressed with gzip and a ".gz" suffix added to the file name.
-  void save(const char* filename, bool compress = true);
+  /// element orders) to a binary file. The sections of the file are aligned, so that an
+  /// uncompressed file can be mapped into memory by Solution::load(). If `compress` is true,
+  /// the sections are compressed block by block with zlib (requires Hermes built WITH_ZLIB,
+  /// otherwise the file is saved uncompressed).
+  void save(const char* filename, bool compress = false);
 
   /// Loads the solution from a file previously created by Solution::save(). This completely
-  /// restores the solution in the memory. The file name has to include the ".gz" suffix,
-  /// in which case the file is piped through gzip to decompress the data (Linux only).
+  /// restores the solution in the memory. Uncompressed files are mapped into memory (POSIX
+  /// systems) and the coefficient arrays are used directly from the mapping; pages are copied
+  /// only when the solution is modified, the file itself is never changed. Files of the
+  /// previous format version (also gzipped ones, if built WITH_ZLIB) can be loaded as well.
   void load(const char* filename);
 
   /// Returns solution value or derivatives at element e, in its reference domain point (xi1, xi2).
@@ -156,10 +161,18 @@ public:
   /// Returns solution value or derivatives at the physical domain point (x, y).
   /// 'item' controls the returned value: H2D_FN_VAL_0, H2D_FN_VAL_1, H2D_FN_DX_0, H2D_FN_DX_1, H2D_FN_DY_0,....
   /// NOTE: This function should be used for postprocessing only, it is not effective
-  /// enough for calculations. Since it searches for an element sequentinally, it is extremelly
-  /// slow. Prefer Solution::get_ref_value if possible.
+  /// enough for calculations. The element containing the point is looked up in a spatial
+  /// index of the mesh (see ElementLocator), which is built on the first call and rebuilt
+  /// when the mesh changes. Prefer Solution::get_ref_value if possible.
   virtual scalar get_pt_value(double x, double y, int item = H2D_FN_VAL_0);
 
+  /// Evaluates the solution at n points (x[i], y[i]), the results are stored in values.
+  /// The points are processed in an order given by the spatial index, so that consecutive
+  /// points mostly lie in the same or in neighboring elements. The points following a found
+  /// point in the same cell of the index are transformed to the reference domain of its
+  /// element together, see RefMap::untransform().
+  void get_pt_values(const double* x, const double* y, int n, scalar* values, int item = H2D_FN_VAL_0);
+
   /// Returns the number of degrees of freedom of the solution.
   /// Returns -1 for exact or constant solutions.
   int get_num_dofs() const { return num_dofs; };
@@ -225,6 +238,14 @@ protected:
   int num_coefs, num_elems;
   int num_dofs;
 
+  void* mapped_data;   ///< memory mapped solution file holding the arrays above, or NULL
+  size_t mapped_size;
+
+  /// Unmaps the solution file, if the coefficient arrays are mapped from one.
+  void free_mapping();
+  /// Loads the solution from an opened file of the old format (version 1).
+  void load_v1(FILE* f);
+
   ESpaceType space_type;
   void transform_values(int order, Node* node, int newmask, int oldmask, int np);
 
@@ -242,6 +263,15 @@ protected:
 
   Element* e_last; ///< last visited element when getting solution values at specific points
 
+  ElementLocator* locator; ///< spatial index of the mesh for get_pt_value()
+
+  /// Returns the spatial index of the mesh, (re)builds it if necessary.
+  ElementLocator* get_locator();
+
+  /// Splits 'item' of get_pt_value() into the component a and the value index b
+  /// (0 = value, 1 = dx, 2 = dy, ...) of get_ref_value_transformed().
+  void get_item_indices(int item, int& a, int& b);
+
 };
 
 
@@ -108,14 +108,31 @@ public:
   /// HERMES_API bool solve_newton(scalar* coeff_vec, DiscreteProblem* dp, Solver* solver, SparseMatrix* matrix,
   ///		                   Vector* rhs, double NEWTON_TOL, int NEWTON_MAX_ITER, bool verbose,
   ///                              unsigned int stop_condition = NEWTON_WATCH_RESIDUAL);
+  /// The residual vector and the Jacobian matrix at the same iterate are assembled in one
+  /// traversal. If jacobian_reuse_contraction > 0, the modified Newton's method is used: the
+  /// last Jacobian and its factorization are reused as long as every iteration reduces the
+  /// residual norm at least by this factor (e.g. 0.5), otherwise a new Jacobian is assembled.
   bool solve_newton(scalar* coeff_vec, DiscreteProblem* dp, Solver* solver, SparseMatrix* matrix,
 		    Vector* rhs, double NEWTON_TOL, int NEWTON_MAX_ITER, bool verbose = false,
                     bool residual_as_function = false,
-                    double damping_coeff = 1.0, double max_allowed_residual_norm = 1e6) const;
-
+                    double damping_coeff = 1.0, double max_allowed_residual_norm = 1e6,
+                    double jacobian_reuse_contraction = 0.0) const;
+
+  /// Picard's iteration for a weak form linearized around sln_prev_iter, which is updated
+  /// in place in every iteration and contains the result at the end. The matrix, the solver
+  /// (with the ordering of the first factorization) and sln_prev_iter are reused across the
+  /// iterations. The relative change (in percent) is measured in the H1 norm using the Gram
+  /// matrix assembled once, or with picard_tol_on_coeff_vec in the l2 norm of the coefficient
+  /// vectors (without the Dirichlet lift). Only the first iteration, when sln_prev_iter is not
+  /// a function of the space yet, integrates the difference numerically.
+  /// If anderson_window > 0, the iteration is accelerated by Anderson mixing: the next iterate
+  /// is the combination of the last anderson_window + 1 Picard updates minimizing the norm
+  /// of the combined change (the same norm as above), anderson_beta < 1 adds damping (also
+  /// to the plain iteration).
   bool solve_picard(WeakForm* wf, Space* space, Solution* sln_prev_iter, 
                     MatrixSolverType matrix_solver, double picard_tol, 
-                    int picard_max_iter, bool verbose) const;
+                    int picard_max_iter, bool verbose, int anderson_window = 0,
+                    double anderson_beta = 1.0, bool picard_tol_on_coeff_vec = false) const;
 };
 
 #endif
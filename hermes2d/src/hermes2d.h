@@ -37,6 +37,8 @@
 #include "../hermes_common/solver/nox.h"
 #include "../hermes_common/solver/petsc.h"
 #include "../hermes_common/solver/umfpack_solver.h"
+#include "../hermes_common/solver/krylov.h"
+#include "../hermes_common/solver/ldl.h"
 #include "../hermes_common/solver/superlu.h"
 
 // preconditioners
@@ -53,6 +55,7 @@
 #include "hermes_logging.h"
 
 #include "range.h"
+#include "arena.h"
 #include "quadrature/limit_order.h"
 
 #include "mesh/mesh.h"
@@ -72,6 +75,7 @@
 #include "shapeset/shapeset_l2_all.h"
 
 #include "mesh/refmap.h"
+#include "mesh/element_locator.h"
 #include "mesh/traverse.h"
 #include "mesh/trans.h"
 
@@ -18,6 +18,7 @@
 
 #include "../h2d_common.h"
 #include "../function/solution.h"
+#include "vtk_writer.h"
 
 const double HERMES_EPS_LOW      = 0.007;
 const double HERMES_EPS_NORMAL   = 0.0004;
@@ -75,6 +76,22 @@ public:
   // This function is used by save_solution_vtk().
   virtual void save_data_vtk(const char* file_name, const char* quantity_name, bool mode_3D);
 
+  /// Sets the format of the files written by save_data_vtk() and save_solution_vtk(). The default is HERMES_VTK_ASCII.
+  /// \param[in] single_precision If true, binary values are written as 32-bit floats instead of doubles.
+  /// \param[in] num_threads Number of threads converting and encoding the values, see VtkWriter.
+  void set_vtk_format(VtkFormat format, bool single_precision = false, int num_threads = 1);
+
+  /// Sets the number of threads used by process_solution(). The default is 1.
+  /** Every thread linearizes a block of elements into its own arrays, with its own copy of the
+   *  solution. The blocks are then merged, vertices with the same coordinates and value are
+   *  stored only once. The maximum used by the adaptive refinement is taken from all elements
+   *  before they are refined, so the result does not depend on the number of threads, but it
+   *  slightly differs from the result of one thread. Elements are processed serially if a
+   *  function is not a standard solution (e.g. a filter), or if the mesh contains both triangles
+   *  and quads. The views are not needed, this can be used for batch post-processing. */
+  void set_num_threads(int num_threads);
+  int get_num_threads() const { return num_threads; }
+
   void free();
 
 protected:
@@ -102,6 +119,13 @@ protected:
   bool curved, disp;
   double min_val, max_val;
 
+  VtkFormat vtk_format;        ///< Format of VTK files, see set_vtk_format().
+  bool vtk_single_precision;
+  int vtk_num_threads;
+
+  int num_threads;             ///< Number of threads of process_solution(), see set_num_threads().
+  bool max_fixed;              ///< True if the maximum is not updated during the refinement (in the threads).
+
   int get_vertex(int p1, int p2, double x, double y, double value);
   int get_top_vertex(int id, double value);
   int peek_vertex(int p1, int p2);
@@ -149,6 +173,24 @@ protected:
                     scalar* val, double* phx, double* phy, int* indices);
 
   void process_edge(int iv1, int iv2, int marker);
+
+  /// Allocates the arrays and the hash table for a mesh of num_elements elements.
+  void init_arrays(int num_elements);
+  /// Frees the hash table and the vertex info, they are only needed during the processing.
+  void free_hash();
+
+  /// Linearizes one state of the traversal of the solution and the displacement functions.
+  void process_state(Element** e);
+
+  /// Multithreaded processing.
+  /// Returns true if the solution and the displacements can be linearized by several threads.
+  bool can_process_in_parallel();
+  /// Linearizes the solution by Linearizer::num_threads threads and merges their results.
+  void process_parallel();
+  /// Updates Linearizer::max by the values used when the elements of the state are refined.
+  void find_state_max(Element** e);
+  /// Thread function, the argument is LinearizerThreadData.
+  static void* linearizer_thread(void* data);
   void regularize_triangle(int iv0, int iv1, int iv2, int mid0, int mid1, int mid2);
   void find_min_max();
   void print_hash_stats();
@@ -220,6 +262,9 @@ public: //accessors
 
   virtual void save_data(const char* filename);
   virtual void load_data(const char* filename);
+  // Saves the vectors in VTK format, with a zero third component. The points are
+  // always in the plane z = 0, mode_3D is ignored.
+  virtual void save_data_vtk(const char* file_name, const char* quantity_name, bool mode_3D = false);
   virtual void calc_vertices_aabb(double* min_x, double* max_x, double* min_y, double* max_y) const; ///< Returns axis aligned bounding box (AABB) of vertices. Assumes lock.
 
   void free();
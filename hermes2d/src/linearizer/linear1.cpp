@@ -133,6 +133,12 @@ Linearizer::Linearizer()
   tris = NULL;
   edges = NULL;
 
+  vtk_format = HERMES_VTK_ASCII;
+  vtk_single_precision = false;
+  vtk_num_threads = 1;
+  num_threads = 1;
+  max_fixed = false;
+
   pthread_mutexattr_t attr;
   pthread_mutexattr_init(&attr);
   pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
@@ -255,7 +261,7 @@ void Linearizer::process_triangle(int iv0, int iv1, int iv2, int level,
       // obtain solution values
       sln->set_quad_order(1, item);
       val = sln->get_values(ia, ib);
-      if (auto_max)
+      if (auto_max && !max_fixed)
         for (i = 0; i < lin_np_tri[1]; i++) {
           double v = getval(i);
           if (finite(v) && fabs(v) > max) max = fabs(v);
@@ -389,7 +395,7 @@ void Linearizer::process_quad(int iv0, int iv1, int iv2, int iv3, int level,
       // obtain solution values
       sln->set_quad_order(1, item);
       val = sln->get_values(ia, ib);
-      if (auto_max)
+      if (auto_max && !max_fixed)
         for (i = 0; i < lin_np_quad[1]; i++) {
           double v = getval(i);
           if (finite(v) && fabs(v) > max) max = fabs(v);
@@ -656,6 +662,312 @@ void Linearizer::find_min_max()
 
 //// process_solution //////////////////////////////////////////////////////////////////////////////
 
+void Linearizer::init_arrays(int num_elements)
+{
+  // estimate the required number of vertices and triangles
+  int ev = std::max(32 * num_elements, 10000);  // todo: check this
+  int et = std::max(64 * num_elements, 20000);
+  int ee = std::max(24 * num_elements, 7500);
+
+  // reuse or allocate vertex, triangle and edge arrays
+  lin_init_array(verts, double3, cv, ev);
+  lin_init_array(tris, int3, ct, et);
+  lin_init_array(edges, int3, ce, ee);
+  info = (int4*) malloc(sizeof(int4) * cv);
+
+  // initialize the hash table
+  int size = 0x2000;
+  while (size*2 < cv) size *= 2;
+  hash_table = (int*) malloc(sizeof(int) * size);
+  memset(hash_table, 0xff, sizeof(int) * size);
+  mask = size-1;
+}
+
+
+void Linearizer::free_hash()
+{
+  ::free(hash_table);
+  ::free(info);
+}
+
+
+void Linearizer::process_state(Element** e)
+{
+  sln->set_quad_order(0, item);
+  scalar* val = sln->get_values(ia, ib);
+  if (val == NULL) error("Item not defined in the solution.");
+
+  scalar *dx = NULL, *dy = NULL;
+  if (disp) {
+    xdisp->set_quad_order(0, H2D_FN_VAL);
+    ydisp->set_quad_order(0, H2D_FN_VAL);
+    dx = xdisp->get_fn_values();
+    dy = ydisp->get_fn_values();
+  }
+
+  int iv[4];
+  for (unsigned int i = 0; i < e[0]->nvert; i++)
+  {
+    double f = getval(i);
+    if (auto_max && !max_fixed && finite(f) && fabs(f) > max) 
+      max = fabs(f);
+
+    double x_disp = sln->get_refmap()->get_phys_x(0)[i];
+    double y_disp = sln->get_refmap()->get_phys_y(0)[i];
+
+    if (disp) {
+      x_disp += dmult*realpart(dx[i]);
+      y_disp += dmult*realpart(dy[i]);
+    }
+
+    iv[i] = get_vertex(-rand(), -rand(), x_disp, y_disp, f);
+  }
+
+  // we won't bother calculating physical coordinates from the refmap if this is not a curved element
+  curved = e[0]->is_curved();
+  cmax = e[0]->get_diameter();
+
+  // recur to sub-elements
+  if (e[0]->is_triangle())
+    process_triangle(iv[0], iv[1], iv[2], 0, NULL, NULL, NULL, NULL);
+  else
+    process_quad(iv[0], iv[1], iv[2], iv[3], 0, NULL, NULL, NULL, NULL);
+
+  for (unsigned int i = 0; i < e[0]->nvert; i++)
+    process_edge(iv[i], iv[e[0]->next_vert(i)], e[0]->en[i]->marker);
+}
+
+
+//// multithreaded processing ////////////////////////////////////////////////////////////////////
+
+/// Work of one thread of Linearizer::process_parallel().
+struct LinearizerThreadData
+{
+  Linearizer* worker;  ///< Has the copies of the functions and collects the vertices, triangles and edges.
+  int first, last;     ///< The states [first, last) of the traversal are processed by the thread.
+  bool find_max;       ///< Only the maximum is searched for, nothing is refined.
+};
+
+
+bool Linearizer::can_process_in_parallel()
+{
+  // Every thread gets a copy of the functions.
+  MeshFunction* fns[3] = { sln, xdisp, ydisp };
+  for (int i = 0; i < (disp ? 3 : 1); i++) {
+    Solution* s = dynamic_cast<Solution*>(fns[i]);
+    if (s == NULL || s->get_type() != HERMES_SLN)
+      return false;
+  }
+
+  // The linearization quadrature is shared and holds the mode of the current element.
+  int mode = -1;
+  for (int i = 0; i < (disp ? 3 : 1); i++) {
+    Element* e;
+    for_all_active_elements(e, fns[i]->get_mesh()) {
+      if (mode < 0) mode = e->get_mode();
+      else if (e->get_mode() != mode) return false;
+    }
+  }
+  return true;
+}
+
+
+void Linearizer::find_state_max(Element** e)
+{
+  // the values which process_triangle() and process_quad() use on the top level
+  int mode = e[0]->get_mode();
+  for (int order = 0; order <= 1; order++) {
+    sln->set_quad_order(order, item);
+    scalar* val = sln->get_values(ia, ib);
+    if (val == NULL) error("Item not defined in the solution.");
+    for (int i = 0; i < lin_np[mode][order]; i++) {
+      double v = getval(i);
+      if (finite(v) && fabs(v) > max) max = fabs(v);
+    }
+  }
+}
+
+
+void* Linearizer::linearizer_thread(void* data_ptr)
+{
+  LinearizerThreadData* data = (LinearizerThreadData*) data_ptr;
+  Linearizer* lin = data->worker;
+
+  Mesh* meshes[3] = { lin->sln->get_mesh(), NULL, NULL };
+  Transformable* trfs[3] = { lin->sln, lin->xdisp, lin->ydisp };
+  if (lin->disp) {
+    meshes[1] = lin->xdisp->get_mesh();
+    meshes[2] = lin->ydisp->get_mesh();
+  }
+
+  // Every thread traverses the meshes with its own functions, but processes only its block of states.
+  Traverse trav;
+  trav.begin(lin->disp ? 3 : 1, meshes, trfs);
+  Element** e;
+  int state = 0;
+  while (state < data->last && (e = trav.get_next_state(NULL, NULL)) != NULL) {
+    if (state++ < data->first)
+      continue;
+    if (data->find_max)
+      lin->find_state_max(e);
+    else
+      lin->process_state(e);
+  }
+  trav.finish();
+  return NULL;
+}
+
+
+/// Hash of the exact bits of a vertex, used to merge the vertices of the threads.
+static unsigned int vertex_hash(const double* v)
+{
+  uint64_t h = 0;
+  for (int k = 0; k < 3; k++) {
+    uint64_t bits;
+    memcpy(&bits, &v[k], sizeof(bits));
+    h = (h ^ bits) * 0x9e3779b97f4a7c15ULL;
+  }
+  return (unsigned int) (h >> 32);
+}
+
+
+void Linearizer::process_parallel()
+{
+  // Count the states, they are divided into contiguous blocks.
+  Mesh* meshes[3] = { sln->get_mesh(), NULL, NULL };
+  if (disp) {
+    meshes[1] = xdisp->get_mesh();
+    meshes[2] = ydisp->get_mesh();
+  }
+  int num_states = 0;
+  Traverse trav;
+  trav.begin(disp ? 3 : 1, meshes);
+  while (trav.get_next_state(NULL, NULL) != NULL)
+    num_states++;
+  trav.finish();
+
+  // The first thread uses the functions, the others get copies.
+  MeshFunction* fns[3] = { sln, xdisp, ydisp };
+  Quad2D* old_quads[3];
+  int nf = disp ? 3 : 1;
+  for (int i = 0; i < nf; i++)
+    old_quads[i] = fns[i]->get_quad_2d();
+
+  Linearizer* workers = new Linearizer[num_threads];
+  LinearizerThreadData* data = new LinearizerThreadData[num_threads];
+  for (int t = 0; t < num_threads; t++) {
+    Linearizer* w = &workers[t];
+    MeshFunction* copies[3] = { NULL, NULL, NULL };
+    for (int i = 0; i < nf; i++) {
+      if (t == 0)
+        copies[i] = fns[i];
+      else {
+        Solution* copy = new Solution;
+        copy->copy(static_cast<Solution*>(fns[i]));
+        copies[i] = copy;
+      }
+      copies[i]->set_quad_2d(&quad_lin);
+    }
+    w->sln = copies[0];
+    w->xdisp = copies[1];
+    w->ydisp = copies[2];
+    w->item = item;
+    w->ia = ia;
+    w->ib = ib;
+    w->eps = eps;
+    w->dmult = dmult;
+    w->disp = disp;
+    w->auto_max = auto_max;
+    w->max = max;
+
+    data[t].worker = w;
+    data[t].first = (int) ((long long) num_states * t / num_threads);
+    data[t].last = (int) ((long long) num_states * (t + 1) / num_threads);
+  }
+
+  // The maximum is found first, it then stays fixed in all threads.
+  pthread_t* threads = new pthread_t[num_threads];
+  for (int pass = auto_max ? 0 : 1; pass < 2; pass++) {
+    for (int t = 0; t < num_threads; t++) {
+      Linearizer* w = &workers[t];
+      data[t].find_max = (pass == 0);
+      if (pass == 1) {
+        w->max = max;
+        w->max_fixed = true;
+        w->nv = w->nt = w->ne = 0;
+        w->del_slot = -1;
+        w->init_arrays(meshes[0]->get_num_elements() / num_threads + 1);
+      }
+      if (pthread_create(&threads[t], NULL, linearizer_thread, &data[t]) != 0)
+        error("Could not create linearization thread %d.", t);
+    }
+    for (int t = 0; t < num_threads; t++)
+      pthread_join(threads[t], NULL);
+    if (pass == 0)
+      for (int t = 0; t < num_threads; t++)
+        max = std::max(max, workers[t].max);
+  }
+  delete [] threads;
+
+  // Merge the results of the threads. Vertices with the same coordinates and value, e.g. those
+  // shared by neighboring elements, are stored only once.
+  int tv = 0, tt = 0, te = 0, mv = 0;
+  for (int t = 0; t < num_threads; t++) {
+    workers[t].free_hash();
+    tv += workers[t].nv;
+    tt += workers[t].nt;
+    te += workers[t].ne;
+    mv = std::max(mv, workers[t].nv);
+  }
+  lin_init_array(verts, double3, cv, std::max(tv, 1));
+  lin_init_array(tris, int3, ct, std::max(tt, 1));
+  lin_init_array(edges, int3, ce, std::max(te, 1));
+
+  int size = 1;
+  while (size < 2 * tv) size *= 2;
+  int* table = new int[size];
+  memset(table, 0xff, sizeof(int) * size);
+  int* remap = new int[mv + 1];
+  for (int t = 0; t < num_threads; t++) {
+    Linearizer* w = &workers[t];
+    for (int i = 0; i < w->nv; i++) {
+      int index = vertex_hash(w->verts[i]) & (size - 1);
+      int j;
+      while ((j = table[index]) >= 0 && memcmp(verts[j], w->verts[i], sizeof(double3)) != 0)
+        index = (index + 1) & (size - 1);
+      if (j < 0) {
+        j = table[index] = nv++;
+        memcpy(verts[j], w->verts[i], sizeof(double3));
+      }
+      remap[i] = j;
+    }
+    for (int i = 0; i < w->nt; i++, nt++)
+      for (int k = 0; k < 3; k++)
+        tris[nt][k] = remap[w->tris[i][k]];
+    for (int i = 0; i < w->ne; i++, ne++) {
+      edges[ne][0] = remap[w->edges[i][0]];
+      edges[ne][1] = remap[w->edges[i][1]];
+      edges[ne][2] = w->edges[i][2];
+    }
+  }
+  delete [] table;
+  delete [] remap;
+
+  // clean up
+  for (int t = 1; t < num_threads; t++) {
+    delete workers[t].sln;
+    if (disp) {
+      delete workers[t].xdisp;
+      delete workers[t].ydisp;
+    }
+  }
+  for (int i = nf - 1; i >= 0; i--)
+    fns[i]->set_quad_2d(old_quads[i]);
+  delete [] workers;
+  delete [] data;
+}
+
+
 void Linearizer::process_solution(MeshFunction* sln, int item, double eps, double max_abs,
                                   MeshFunction* xdisp, MeshFunction* ydisp, double dmult)
 {
@@ -683,12 +995,26 @@ void Linearizer::process_solution(MeshFunction* sln, int item, double eps, doubl
   if (disp && (xdisp == NULL || ydisp == NULL))
     error("Both displacement components must be supplied.");
 
-  // estimate the required number of vertices and triangles
   Mesh* mesh = sln->get_mesh();
   if (mesh == NULL) {
     warn("Have you used Solution::set_coeff_vector() ?");
     error("Mesh is NULL in Linearizer:process_solution().");
   }
+
+  auto_max = (max_abs < 0.0);
+  max = auto_max ? 0.0 : max_abs;
+  max_fixed = false;
+
+  if (num_threads > 1) {
+    if (can_process_in_parallel()) {
+      process_parallel();
+      find_min_max();
+      unlock_data();
+      return;
+    }
+    verbose("Multithreaded linearization not possible, processing serially.");
+  }
+
   int nn = mesh->get_num_elements();
   /*
   if(disp) {
@@ -698,9 +1024,6 @@ void Linearizer::process_solution(MeshFunction* sln, int item, double eps, doubl
       nn = ydisp->get_mesh()->get_num_elements();
   }
   */
-  int ev = std::max(32 * nn, 10000);  // todo: check this
-  int et = std::max(64 * nn, 20000);
-  int ee = std::max(24 * nn, 7500);
 
   // check that displacement meshes are the same
   if (disp)
@@ -710,18 +1033,7 @@ void Linearizer::process_solution(MeshFunction* sln, int item, double eps, doubl
     unsigned seq3 = ydisp->get_mesh()->get_seq();
   }
 
-  // reuse or allocate vertex, triangle and edge arrays
-  lin_init_array(verts, double3, cv, ev);
-  lin_init_array(tris, int3, ct, et);
-  lin_init_array(edges, int3, ce, ee);
-  info = (int4*) malloc(sizeof(int4) * cv);
-
-  // initialize the hash table
-  int size = 0x2000;
-  while (size*2 < cv) size *= 2;
-  hash_table = (int*) malloc(sizeof(int) * size);
-  memset(hash_table, 0xff, sizeof(int) * size);
-  mask = size-1;
+  init_arrays(nn);
 
   // select the linearization quadrature
   Quad2D *old_quad, *old_quad_x = NULL, *old_quad_y = NULL;
@@ -765,9 +1077,6 @@ void Linearizer::process_solution(MeshFunction* sln, int item, double eps, doubl
   while (!finished);
   */
 
-  auto_max = (max_abs < 0.0);
-  max = auto_max ? 0.0 : max_abs;
-
   // obtain the solution in vertices, estimate the maximum solution value
   // Init multi-mesh traversal.
   Mesh** meshes;
@@ -796,51 +1105,11 @@ void Linearizer::process_solution(MeshFunction* sln, int item, double eps, doubl
 
   // Loop through all elements.
   Element **e;
-  // Loop through all elements.
-  while ((e = trav.get_next_state(NULL, NULL)) != NULL) {
-    sln->set_quad_order(0, item);
-    scalar* val = sln->get_values(ia, ib);
-    if (val == NULL) error("Item not defined in the solution.");
-
-    scalar *dx = NULL, *dy = NULL;
-    if (disp) {
-      xdisp->set_quad_order(0, H2D_FN_VAL);
-      ydisp->set_quad_order(0, H2D_FN_VAL);
-      dx = xdisp->get_fn_values();
-      dy = ydisp->get_fn_values();
-    }
-
-    int iv[4];
-    for (unsigned int i = 0; i < e[0]->nvert; i++)
-    {
-      double f = getval(i);
-      if (auto_max && finite(f) && fabs(f) > max) 
-        max = fabs(f);
-
-      double x_disp = sln->get_refmap()->get_phys_x(0)[i];
-      double y_disp = sln->get_refmap()->get_phys_y(0)[i];
-
-      if (disp) {
-        x_disp += dmult*realpart(dx[i]);
-        y_disp += dmult*realpart(dy[i]);
-      }
-
-      iv[i] = get_vertex(-rand(), -rand(), x_disp, y_disp, f);
-    }
-
-    // we won't bother calculating physical coordinates from the refmap if this is not a curved element
-    curved = e[0]->is_curved();
-    cmax = e[0]->get_diameter();
-
-    // recur to sub-elements
-    if (e[0]->is_triangle())
-      process_triangle(iv[0], iv[1], iv[2], 0, NULL, NULL, NULL, NULL);
-    else
-      process_quad(iv[0], iv[1], iv[2], iv[3], 0, NULL, NULL, NULL, NULL);
-
-    for (unsigned int i = 0; i < e[0]->nvert; i++)
-      process_edge(iv[i], iv[e[0]->next_vert(i)], e[0]->en[i]->marker);
-  }
+  while ((e = trav.get_next_state(NULL, NULL)) != NULL)
+    process_state(e);
+  trav.finish();
+  delete [] meshes;
+  delete [] trfs;
 
   /*
   delete [] id2id;
@@ -873,8 +1142,7 @@ void Linearizer::process_solution(MeshFunction* sln, int item, double eps, doubl
               ydisp->set_quad_2d(old_quad_y); }
 
   // clean up
-  ::free(hash_table);
-  ::free(info);
+  free_hash();
 }
 
 
@@ -926,6 +1194,7 @@ void Linearizer::save_solution_vtk(MeshFunction* meshfn, const char* file_name,
   // triangles for visualization purposes. Accuracy of this 
   // approximation is set through the parameter "eps" below.
   Linearizer lin;
+  lin.set_vtk_format(vtk_format, vtk_single_precision, vtk_num_threads);
 
   // Create a piecewise-linear approximation, and save it to a file in VTK format.
   lin.process_solution(meshfn, item, eps, max_abs, xdisp, ydisp, dmult);
@@ -934,49 +1203,30 @@ void Linearizer::save_solution_vtk(MeshFunction* meshfn, const char* file_name,
 
 void Linearizer::save_data_vtk(const char* filename, const char *name, bool mode_3D)
 {
-  FILE* f = fopen(filename, "wb");
-  if (f == NULL) error("Could not open %s for writing.", filename);
   lock_data();
 
-  // Output header for vertices.
-  fprintf(f, "# vtk DataFile Version 2.0\n");
-  fprintf(f, "\n");
-  fprintf(f, "ASCII\n\n");
-  fprintf(f, "DATASET UNSTRUCTURED_GRID\n");
-
-  // Output vertices.
-  fprintf(f, "POINTS %d %s\n", this->nv, "float");
-  for (int i=0; i < this->nv; i++) {
-    if (mode_3D == true) fprintf(f, "%g %g %g\n", this->verts[i][0], this->verts[i][1], this->verts[i][2]);
-    else fprintf(f, "%g %g %g\n", this->verts[i][0], this->verts[i][1], 0.0);
-  }
-
-  // Output elements.
-  fprintf(f, "\n");
-  fprintf(f, "CELLS %d %d\n", this->nt, 4 * this->nt);
-  for (int i=0; i < this->nt; i++) {
-    fprintf(f, "3 %d %d %d\n", this->tris[i][0], this->tris[i][1], this->tris[i][2]);
-  }
+  // This outputs scalar solution values. Vectorizer::save_data_vtk() does it for vectors.
+  VtkWriter writer(vtk_format, vtk_single_precision, vtk_num_threads);
+  writer.add_point_data(name, (double*) this->verts + 2, 3, 1, 1);
+  writer.write(filename, this->nv, (double*) this->verts, 3, mode_3D ? 3 : 2, this->nt, this->tris);
 
-  // Output cell types.
-  fprintf(f, "\n");
-  fprintf(f, "CELL_TYPES %d\n", this->nt);
-  for (int i=0; i < this->nt; i++) {
-    fprintf(f, "5\n");    // The "5" means triangle in VTK.
-  }
+  unlock_data();
+}
 
-  // This outputs scalar solution values. Look into hermes3d/src/output/vtk.cpp 
-  // for how it is done for vectors.
-  fprintf(f, "\n");
-  fprintf(f, "POINT_DATA %d\n", this->nv);
-  fprintf(f, "SCALARS %s %s %d\n", name, "float", 1);
-  fprintf(f, "LOOKUP_TABLE %s\n", "default");
-  for (int i=0; i < this->nv; i++) {
-    fprintf(f, "%g\n", this->verts[i][2]);
-  }
+void Linearizer::set_vtk_format(VtkFormat format, bool single_precision, int num_threads)
+{
+  if (num_threads < 1)
+    error("Invalid number of threads (%d) in Linearizer::set_vtk_format().", num_threads);
+  vtk_format = format;
+  vtk_single_precision = single_precision;
+  vtk_num_threads = num_threads;
+}
 
-  unlock_data();
-  fclose(f);
+void Linearizer::set_num_threads(int num_threads)
+{
+  if (num_threads < 1)
+    error("Invalid number of threads (%d) in Linearizer::set_num_threads().", num_threads);
+  this->num_threads = num_threads;
 }
 
 void Linearizer::load_data(const char* filename)
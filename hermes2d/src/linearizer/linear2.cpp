@@ -279,6 +279,7 @@ void Orderizer::save_orders_vtk(Space* space, const char* file_name)
   // with "solution values" that represent the polynomial 
   // degrees of mesh elements. 
   Orderizer ord;
+  ord.set_vtk_format(vtk_format, vtk_single_precision, vtk_num_threads);
 
   // Create a piecewise-linear approximation, and save it to a file in VTK format.
   ord.process_space(space);
@@ -287,46 +288,12 @@ void Orderizer::save_orders_vtk(Space* space, const char* file_name)
 
 void Orderizer::save_data_vtk(const char* file_name)
 {
-  FILE* f = fopen(file_name, "wb");
-  if (f == NULL) error("Could not open %s for writing.", file_name);
   lock_data();
 
-  // Output header for vertices.
-  fprintf(f, "# vtk DataFile Version 2.0\n");
-  fprintf(f, "\n");
-  fprintf(f, "ASCII\n\n");
-  fprintf(f, "DATASET UNSTRUCTURED_GRID\n");
-
-  // Output vertices.
-  fprintf(f, "POINTS %d %s\n", this->nv, "float");
-  for (int i=0; i < this->nv; i++) {
-    fprintf(f, "%g %g %g\n", this->verts[i][0], this->verts[i][1], 0.0);
-  }
-
-  // Output elements.
-  fprintf(f, "\n");
-  fprintf(f, "CELLS %d %d\n", this->nt, 4 * this->nt);
-  for (int i=0; i < this->nt; i++) {
-    fprintf(f, "3 %d %d %d\n", this->tris[i][0], this->tris[i][1], this->tris[i][2]);
-  }
-
-  // Output cell types.
-  fprintf(f, "\n");
-  fprintf(f, "CELL_TYPES %d\n", this->nt);
-  for (int i=0; i < this->nt; i++) {
-    fprintf(f, "5\n");    // The "5" means triangle in VTK.
-  }
-
-  // This outputs scalar solution values. Look into hermes3d/src/output/vtk.cpp 
-  // for how it is done for vectors.
-  fprintf(f, "\n");
-  fprintf(f, "POINT_DATA %d\n", this->nv);
-  fprintf(f, "SCALARS %s %s %d\n", "Mesh", "float", 1);
-  fprintf(f, "LOOKUP_TABLE %s\n", "default");
-  for (int i=0; i < this->nv; i++) {
-    fprintf(f, "%g\n", this->verts[i][2]);
-  }
+  // The orders are the values of the vertices, the mesh is flat.
+  VtkWriter writer(vtk_format, vtk_single_precision, vtk_num_threads);
+  writer.add_point_data("Mesh", (double*) this->verts + 2, 3, 1, 1);
+  writer.write(file_name, this->nv, (double*) this->verts, 3, 2, this->nt, this->tris);
 
   unlock_data();
-  fclose(f);
 }
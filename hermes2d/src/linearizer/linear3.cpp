@@ -580,6 +580,17 @@ void Vectorizer::load_data(const char* filename)
   fclose(f);
 }
 
+void Vectorizer::save_data_vtk(const char* file_name, const char* quantity_name, bool mode_3D)
+{
+  lock_data();
+
+  VtkWriter writer(vtk_format, vtk_single_precision, vtk_num_threads);
+  writer.add_point_data(quantity_name, (double*) this->verts + 2, 4, 2, 3);
+  writer.write(file_name, this->nv, (double*) this->verts, 4, 2, this->nt, this->tris);
+
+  unlock_data();
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////
 
 Vectorizer::~Vectorizer()
@@ -0,0 +1,344 @@
+// This file is part of Hermes2D.
+//
+// Hermes2D is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "vtk_writer.h"
+
+
+/// Number of items converted at once. A multiple of three, so that base64 encoded
+/// chunks can be concatenated.
+static const int H2D_VTK_CHUNK = 3 * 32768;
+
+static bool is_little_endian()
+{
+  int one = 1;
+  return *((char*) &one) == 1;
+}
+
+static void base64_encode(const std::string& in, std::string& out)
+{
+  static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  const unsigned char* p = (const unsigned char*) in.data();
+  size_t n = in.size();
+  out.resize((n + 2) / 3 * 4);
+  char* q = &out[0];
+  size_t i;
+  for (i = 0; i + 2 < n; i += 3, q += 4) {
+    unsigned int v = (p[i] << 16) | (p[i+1] << 8) | p[i+2];
+    q[0] = table[v >> 18];
+    q[1] = table[(v >> 12) & 63];
+    q[2] = table[(v >> 6) & 63];
+    q[3] = table[v & 63];
+  }
+  if (i < n) {
+    unsigned int v = (p[i] << 16) | ((i + 1 < n) ? (p[i+1] << 8) : 0);
+    q[0] = table[v >> 18];
+    q[1] = table[(v >> 12) & 63];
+    q[2] = (i + 1 < n) ? table[(v >> 6) & 63] : '=';
+    q[3] = '=';
+  }
+}
+
+/// One chunk of an array being encoded.
+struct VtkChunk
+{
+  const VtkWriter* writer;
+  const void* array;
+  int first, count;
+  bool base64;
+  std::string raw, out;
+};
+
+VtkWriter::VtkWriter(VtkFormat format, bool single_precision, int num_threads)
+  : format(format), single_precision(single_precision), num_threads(num_threads)
+{
+  if (num_threads < 1)
+    error("Invalid number of threads (%d) in VtkWriter.", num_threads);
+  // legacy binary files are always big-endian, VTU files declare the byte order
+  swap = (format == HERMES_VTK_BINARY && is_little_endian());
+}
+
+int VtkWriter::Array::get_size() const
+{
+  switch (type) {
+    case VTK_FLOAT64: return 8;
+    case VTK_FLOAT32: return 4;
+    case VTK_INT32: return 4;
+    default: return 1;
+  }
+}
+
+void VtkWriter::add_point_data(const char* name, const double* base, int stride, int num_src_comps, int num_comps)
+{
+  if (num_comps != 1 && num_comps != 3)
+    error("Point data written to VTK files have to have one or three components.");
+  Array a;
+  a.name = name;
+  a.source = SRC_DOUBLES;
+  a.base = base;
+  a.stride = stride;
+  a.num_src_comps = num_src_comps;
+  a.tris = NULL;
+  a.num_items = 0;
+  a.num_comps = num_comps;
+  a.type = single_precision ? VTK_FLOAT32 : VTK_FLOAT64;
+  point_data.push_back(a);
+}
+
+VtkWriter::Array VtkWriter::triangle_array(const char* name, int source, const int3* tris, int num_triangles,
+                                           int num_comps, int type)
+{
+  Array a;
+  a.name = name;
+  a.source = source;
+  a.base = NULL;
+  a.stride = a.num_src_comps = 0;
+  a.tris = tris;
+  a.num_items = num_triangles;
+  a.num_comps = num_comps;
+  a.type = type;
+  return a;
+}
+
+void VtkWriter::encode(const Array& a, int first, int count, std::string& out) const
+{
+  char buf[32];
+  for (int i = first; i < first + count; i++) {
+    for (int c = 0; c < a.num_comps; c++) {
+      double d = 0.0;
+      int k = 0;
+      switch (a.source) {
+        case SRC_DOUBLES: if (c < a.num_src_comps) d = a.base[(size_t) i * a.stride + c]; break;
+        case SRC_CONNECTIVITY: k = a.tris[i / 3][i % 3]; break;
+        case SRC_OFFSETS: k = 3 * (i + 1); break;
+        case SRC_TYPES: k = 5; break;  // The "5" means triangle in VTK.
+        case SRC_LEGACY_CELLS: k = (c == 0) ? 3 : a.tris[i][c - 1]; break;
+      }
+
+      if (format == HERMES_VTK_ASCII) {
+        int len = (a.source == SRC_DOUBLES) ? sprintf(buf, "%g", d) : sprintf(buf, "%d", k);
+        if (c > 0) out += ' ';
+        out.append(buf, len);
+        continue;
+      }
+
+      float f = (float) d;
+      unsigned char u = (unsigned char) k;
+      const char* p;
+      switch (a.type) {
+        case VTK_FLOAT64: p = (const char*) &d; break;
+        case VTK_FLOAT32: p = (const char*) &f; break;
+        case VTK_INT32: p = (const char*) &k; break;
+        default: p = (const char*) &u;
+      }
+      int size = a.get_size();
+      if (swap)
+        for (int j = size - 1; j >= 0; j--) out += p[j];
+      else
+        out.append(p, size);
+    }
+    if (format == HERMES_VTK_ASCII)
+      out += '\n';
+  }
+}
+
+void* VtkWriter::encoding_thread(void* data)
+{
+  VtkChunk* chunk = (VtkChunk*) data;
+  chunk->raw.clear();
+  chunk->writer->encode(*((const Array*) chunk->array), chunk->first, chunk->count, chunk->raw);
+  if (chunk->base64)
+    base64_encode(chunk->raw, chunk->out);
+  else
+    chunk->raw.swap(chunk->out);
+  return NULL;
+}
+
+void VtkWriter::write_array(FILE* f, const Array& a)
+{
+  // Rounds of num_threads chunks are encoded at once and written in order.
+  std::vector<VtkChunk> chunks(num_threads);
+  pthread_t* threads = new pthread_t[num_threads];
+  for (int first = 0; first < a.num_items; first += H2D_VTK_CHUNK * num_threads) {
+    int n = 0;
+    for (int t = 0; t < num_threads && first + t * H2D_VTK_CHUNK < a.num_items; t++, n++) {
+      chunks[t].writer = this;
+      chunks[t].array = &a;
+      chunks[t].first = first + t * H2D_VTK_CHUNK;
+      chunks[t].count = std::min(H2D_VTK_CHUNK, a.num_items - chunks[t].first);
+      chunks[t].base64 = (format == HERMES_VTU_BASE64);
+    }
+    for (int t = 1; t < n; t++)
+      if (pthread_create(&threads[t], NULL, encoding_thread, &chunks[t]) != 0)
+        error("Could not create VTK encoding thread %d.", t);
+    encoding_thread(&chunks[0]);
+    for (int t = 1; t < n; t++)
+      pthread_join(threads[t], NULL);
+
+    for (int t = 0; t < n; t++)
+      if (fwrite(chunks[t].out.data(), 1, chunks[t].out.size(), f) != chunks[t].out.size())
+        error("Error writing VTK data.");
+  }
+  delete [] threads;
+}
+
+void VtkWriter::write(const char* file_name, int num_points, const double* points, int stride, int num_src_comps,
+                      int num_triangles, const int3* triangles)
+{
+  _F_
+  FILE* f = fopen(file_name, "wb");
+  if (f == NULL) error("Could not open %s for writing.", file_name);
+
+  for (unsigned int i = 0; i < point_data.size(); i++)
+    point_data[i].num_items = num_points;
+  Array pts;
+  pts.source = SRC_DOUBLES;
+  pts.base = points;
+  pts.stride = stride;
+  pts.num_src_comps = num_src_comps;
+  pts.tris = NULL;
+  pts.num_items = num_points;
+  pts.num_comps = 3;
+  pts.type = single_precision ? VTK_FLOAT32 : VTK_FLOAT64;
+
+  if (format == HERMES_VTK_ASCII || format == HERMES_VTK_BINARY)
+    write_legacy(f, pts, num_triangles, triangles);
+  else
+    write_vtu(f, pts, num_triangles, triangles);
+
+  if (fclose(f) != 0)
+    error("Error writing %s.", file_name);
+}
+
+void VtkWriter::write_legacy(FILE* f, const Array& points, int num_triangles, const int3* triangles)
+{
+  bool binary = (format == HERMES_VTK_BINARY);
+  const char* type_name = (binary && !single_precision) ? "double" : "float";
+
+  // Output header for vertices.
+  fprintf(f, "# vtk DataFile Version 2.0\n");
+  fprintf(f, "\n");
+  fprintf(f, binary ? "BINARY\n\n" : "ASCII\n\n");
+  fprintf(f, "DATASET UNSTRUCTURED_GRID\n");
+
+  // Output vertices.
+  fprintf(f, "POINTS %d %s\n", points.num_items, type_name);
+  write_array(f, points);
+  if (binary) fprintf(f, "\n");
+
+  // Output elements.
+  fprintf(f, "\n");
+  fprintf(f, "CELLS %d %d\n", num_triangles, 4 * num_triangles);
+  write_array(f, triangle_array("", SRC_LEGACY_CELLS, triangles, num_triangles, 4, VTK_INT32));
+  if (binary) fprintf(f, "\n");
+
+  // Output cell types.
+  fprintf(f, "\n");
+  fprintf(f, "CELL_TYPES %d\n", num_triangles);
+  write_array(f, triangle_array("", SRC_TYPES, triangles, num_triangles, 1, VTK_INT32));
+  if (binary) fprintf(f, "\n");
+
+  // Output point data.
+  if (point_data.empty()) return;
+  fprintf(f, "\n");
+  fprintf(f, "POINT_DATA %d\n", points.num_items);
+  for (unsigned int i = 0; i < point_data.size(); i++) {
+    if (point_data[i].num_comps == 1) {
+      fprintf(f, "SCALARS %s %s %d\n", point_data[i].name.c_str(), type_name, 1);
+      fprintf(f, "LOOKUP_TABLE %s\n", "default");
+    }
+    else
+      fprintf(f, "VECTORS %s %s\n", point_data[i].name.c_str(), type_name);
+    write_array(f, point_data[i]);
+    if (binary) fprintf(f, "\n");
+  }
+}
+
+void VtkWriter::write_vtu_array(FILE* f, const Array& a, long long& offset)
+{
+  static const char* type_names[] = { "Float64", "Float32", "Int32", "UInt8" };
+  fprintf(f, "        <DataArray type=\"%s\"", type_names[a.type]);
+  if (!a.name.empty()) fprintf(f, " Name=\"%s\"", a.name.c_str());
+  fprintf(f, " NumberOfComponents=\"%d\"", a.num_comps);
+
+  if (format == HERMES_VTU_APPENDED) {
+    fprintf(f, " format=\"appended\" offset=\"%lld\"/>\n", offset);
+    offset += sizeof(unsigned long long) + a.get_num_bytes();
+    return;
+  }
+
+  // The size of the data and the data are encoded separately.
+  fprintf(f, " format=\"binary\">\n");
+  unsigned long long size = a.get_num_bytes();
+  std::string header((const char*) &size, sizeof(size)), encoded;
+  base64_encode(header, encoded);
+  fwrite(encoded.data(), 1, encoded.size(), f);
+  write_array(f, a);
+  fprintf(f, "\n        </DataArray>\n");
+}
+
+void VtkWriter::write_vtu(FILE* f, const Array& points, int num_triangles, const int3* triangles)
+{
+  std::vector<const Array*> arrays;
+  Array conn = triangle_array("connectivity", SRC_CONNECTIVITY, triangles, num_triangles, 1, VTK_INT32);
+  Array offs = triangle_array("offsets", SRC_OFFSETS, triangles, num_triangles, 1, VTK_INT32);
+  Array types = triangle_array("types", SRC_TYPES, triangles, num_triangles, 1, VTK_UINT8);
+  conn.num_items = 3 * num_triangles;
+
+  fprintf(f, "<?xml version=\"1.0\"?>\n");
+  fprintf(f, "<VTKFile type=\"UnstructuredGrid\" version=\"1.0\" byte_order=\"%s\" header_type=\"UInt64\">\n",
+          is_little_endian() ? "LittleEndian" : "BigEndian");
+  fprintf(f, "  <UnstructuredGrid>\n");
+  fprintf(f, "    <Piece NumberOfPoints=\"%d\" NumberOfCells=\"%d\">\n", points.num_items, num_triangles);
+
+  long long offset = 0;
+  fprintf(f, "      <PointData");
+  for (unsigned int i = 0; i < point_data.size(); i++)
+    if (point_data[i].num_comps == 1) { fprintf(f, " Scalars=\"%s\"", point_data[i].name.c_str()); break; }
+  for (unsigned int i = 0; i < point_data.size(); i++)
+    if (point_data[i].num_comps == 3) { fprintf(f, " Vectors=\"%s\"", point_data[i].name.c_str()); break; }
+  fprintf(f, ">\n");
+  for (unsigned int i = 0; i < point_data.size(); i++) {
+    write_vtu_array(f, point_data[i], offset);
+    arrays.push_back(&point_data[i]);
+  }
+  fprintf(f, "      </PointData>\n");
+
+  fprintf(f, "      <Points>\n");
+  write_vtu_array(f, points, offset);
+  arrays.push_back(&points);
+  fprintf(f, "      </Points>\n");
+
+  fprintf(f, "      <Cells>\n");
+  write_vtu_array(f, conn, offset);
+  write_vtu_array(f, offs, offset);
+  write_vtu_array(f, types, offset);
+  arrays.push_back(&conn);
+  arrays.push_back(&offs);
+  arrays.push_back(&types);
+  fprintf(f, "      </Cells>\n");
+  fprintf(f, "    </Piece>\n");
+  fprintf(f, "  </UnstructuredGrid>\n");
+
+  if (format == HERMES_VTU_APPENDED) {
+    fprintf(f, "  <AppendedData encoding=\"raw\">\n   _");
+    for (unsigned int i = 0; i < arrays.size(); i++) {
+      unsigned long long size = arrays[i]->get_num_bytes();
+      fwrite(&size, sizeof(size), 1, f);
+      write_array(f, *arrays[i]);
+    }
+    fprintf(f, "\n  </AppendedData>\n");
+  }
+  fprintf(f, "</VTKFile>\n");
+}
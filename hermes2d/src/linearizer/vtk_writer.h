@@ -0,0 +1,106 @@
+// This file is part of Hermes2D.
+//
+// Hermes2D is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef __H2D_VTK_WRITER_H
+#define __H2D_VTK_WRITER_H
+
+#include "../h2d_common.h"
+#include <string>
+
+/// Formats of the VTK files written by Linearizer, Orderizer and Vectorizer.
+enum VtkFormat
+{
+  HERMES_VTK_ASCII,     ///< Legacy VTK file, values as text.
+  HERMES_VTK_BINARY,    ///< Legacy VTK file, binary big-endian values.
+  HERMES_VTU_BASE64,    ///< XML unstructured grid (.vtu), binary values encoded inline in base64.
+  HERMES_VTU_APPENDED   ///< XML unstructured grid (.vtu), raw binary values appended at the end of the file.
+};
+
+/// Writes a triangular mesh with point data in one of the VTK formats.
+///
+/// Values are read directly from the arrays of the linearizers (e.g. x, y and the value
+/// of a vertex are the three doubles of a double3), no copies of the data are made.
+/// The values are converted (to big-endian, to 32-bit floats, to text) and encoded in
+/// chunks, the chunks can be processed by several threads at once.
+///
+class HERMES_API VtkWriter
+{
+public:
+
+  /// \param[in] single_precision If true, binary values are written as 32-bit floats instead of doubles.
+  /// \param[in] num_threads Number of threads converting and encoding the values.
+  VtkWriter(VtkFormat format = HERMES_VTK_ASCII, bool single_precision = false, int num_threads = 1);
+
+  /// Adds an array of point data, it has to have one or three components (scalars or vectors).
+  /// Component c of point i is base[i * stride + c] for c < num_src_comps, zero otherwise.
+  /// The data is not copied, it has to be valid until write() is called.
+  void add_point_data(const char* name, const double* base, int stride, int num_src_comps, int num_comps);
+
+  /// Writes the file. The coordinates of the points are stored like the point data,
+  /// with three components, the triangles are triples of indices of the points.
+  void write(const char* file_name, int num_points, const double* points, int stride, int num_src_comps,
+             int num_triangles, const int3* triangles);
+
+protected:
+
+  /// Types of values in the file.
+  enum { VTK_FLOAT64, VTK_FLOAT32, VTK_INT32, VTK_UINT8 };
+
+  /// Sources of the values. Integer arrays are generated from the triangles: the indices of
+  /// the points (one per item), offsets and types of the cells, and cells of legacy files.
+  enum { SRC_DOUBLES, SRC_CONNECTIVITY, SRC_OFFSETS, SRC_TYPES, SRC_LEGACY_CELLS };
+
+  /// An array of values written to the file.
+  struct Array
+  {
+    std::string name;
+    int source;
+    const double* base;   ///< Source of SRC_DOUBLES.
+    int stride, num_src_comps;
+    const int3* tris;     ///< Source of the other arrays.
+    int num_items, num_comps;
+    int type;
+
+    int get_size() const;  ///< Size of a value in bytes.
+    long long get_num_bytes() const { return (long long) num_items * num_comps * get_size(); }
+  };
+
+  /// Returns an array generated from the triangles.
+  Array triangle_array(const char* name, int source, const int3* tris, int num_triangles, int num_comps, int type);
+
+  /// Converts the items [first, first + count) of an array and appends them to out.
+  void encode(const Array& a, int first, int count, std::string& out) const;
+
+  /// Writes the values of an array, chunk by chunk.
+  void write_array(FILE* f, const Array& a);
+
+  void write_legacy(FILE* f, const Array& points, int num_triangles, const int3* triangles);
+  void write_vtu(FILE* f, const Array& points, int num_triangles, const int3* triangles);
+
+  /// Writes the DataArray element of a VTU file. The values of an appended array are written
+  /// later, its offset in the appended data is passed and increased by its size.
+  void write_vtu_array(FILE* f, const Array& a, long long& offset);
+
+  /// Thread function encoding one chunk, the argument is VtkChunk.
+  static void* encoding_thread(void* data);
+
+  VtkFormat format;
+  bool single_precision;
+  int num_threads;
+  bool swap;                  ///< Bytes of binary values are swapped (to big-endian in legacy files).
+  std::vector<Array> point_data;
+};
+
+#endif
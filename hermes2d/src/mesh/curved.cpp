@@ -89,21 +89,10 @@ void CurvMap::nurbs_edge(Element* e, Nurbs* nurbs, int edge, double t, double& x
   }
   else
   {
-    double3* cp = nurbs->pt;
-    x = y = 0.0;
-    double sum = 0.0;  // sum of basis fns and weights
-
-    for (int i = 0; i < nurbs->np; i++)
-    {
-      double basis = nurbs_basis_fn(i, nurbs->degree, t, nurbs->kv);
-      sum += cp[i][2] * basis;
-      x   += cp[i][2] * basis * cp[i][0];
-      y   += cp[i][2] * basis * cp[i][1];
-    }
-
-    sum = 1.0 / sum;
-    x *= sum;
-    y *= sum;
+    double2 pt;
+    nurbs_points(nurbs, 1, &t, &pt);
+    x = pt[0];
+    y = pt[1];
 
     if(!warning_issued) {
       printf("FIXME: IMPLEMENT CALCULATION OF n_x, n_y, t_x, t_y in nurbs_edge() !!!\n");
@@ -116,113 +105,196 @@ void CurvMap::nurbs_edge(Element* e, Nurbs* nurbs, int edge, double t, double& x
   }
 }
 
-//// non-polynomial reference map //////////////////////////////////////////////////////////////////////////////////
-const double2 CurvMap::ref_vert[2][4] = {
-    { { -1.0, -1.0 }, { 1.0, -1.0 }, { -1.0, 1.0 }, {  0.0, 0.0 } },
-    { { -1.0, -1.0 }, { 1.0, -1.0 }, {  1.0, 1.0 }, { -1.0, 1.0 } }
-  };
+void CurvMap::nurbs_points(Nurbs* nurbs, int n, const double* t, double2* pts)
+{
+  _F_
+  int p = nurbs->degree;
+  int last = nurbs->np - 1;
+  double* kv = nurbs->kv;
+  double3* cp = nurbs->pt;
+  std::vector<double> N(p + 1), left(p + 1), right(p + 1);
+
+  for (int k = 0; k < n; k++)
+  {
+    // knot span [kv[s], kv[s+1]) containing t, the last nonempty span for t = 1
+    double u = t[k];
+    int s;
+    if (u >= kv[last + 1])
+    {
+      s = last;
+      while (s > p && kv[s] >= kv[s + 1]) s--;
+    }
+    else if (u <= kv[p])
+      s = p;
+    else
+    {
+      int lo = p, hi = last + 1;
+      s = (lo + hi) / 2;
+      while (u < kv[s] || u >= kv[s + 1])
+      {
+        if (u < kv[s]) hi = s; else lo = s;
+        s = (lo + hi) / 2;
+      }
+    }
+
+    // nonzero basis functions N_{s-p,p}, ..., N_{s,p}
+    N[0] = 1.0;
+    for (int j = 1; j <= p; j++)
+    {
+      left[j] = u - kv[s + 1 - j];
+      right[j] = kv[s + j] - u;
+      double saved = 0.0;
+      for (int r = 0; r < j; r++)
+      {
+        double temp = N[r] / (right[r + 1] + left[j - r]);
+        N[r] = saved + right[r + 1] * temp;
+        saved = left[j - r] * temp;
+      }
+      N[j] = saved;
+    }
 
-// subtraction of straight edge and nurbs curve
-void CurvMap::nurbs_edge_0(Element* e, Nurbs* nurbs, int edge, double t, double& x, double& y, double& n_x, double& n_y, double& t_x, double& t_y)
+    double x = 0.0, y = 0.0, sum = 0.0;  // sum of basis fns and weights
+    for (int j = 0; j <= p; j++)
+    {
+      double* c = cp[s - p + j];
+      double wb = c[2] * N[j];
+      sum += wb;
+      x   += wb * c[0];
+      y   += wb * c[1];
+    }
+    pts[k][0] = x / sum;
+    pts[k][1] = y / sum;
+  }
+}
+
+void CurvMap::nurbs_edge_points(Element* e, Nurbs* nurbs, int edge, int n, const double* t, double2* pts)
 {
-  int va = edge;
-  int vb = e->next_vert(edge);
-  nurbs_edge(e, nurbs, edge, t, x, y, n_x, n_y, t_x, t_y);
+  _F_
+  if (n == 0) return;
 
-  x -= 0.5 * ((1-t) * (e->vn[va]->x) + (1+t) * (e->vn[vb]->x));
-  y -= 0.5 * ((1-t) * (e->vn[va]->y) + (1+t) * (e->vn[vb]->y));
+  // nurbs curves are parametrized from 0 to 1
+  std::vector<double> u(n);
+  for (int i = 0; i < n; i++)
+    u[i] = (t[i] + 1) / 2.0;
 
-  double k = 4.0 / ((1-t) * (1+t));
-  x *= k;
-  y *= k;
+  if (nurbs == NULL)
+  {
+    Node* va = e->vn[edge];
+    Node* vb = e->vn[e->next_vert(edge)];
+    for (int i = 0; i < n; i++)
+    {
+      pts[i][0] = va->x + u[i] * (vb->x - va->x);
+      pts[i][1] = va->y + u[i] * (vb->y - va->y);
+    }
+  }
+  else
+    nurbs_points(nurbs, n, &u[0], pts);
 }
 
+//// non-polynomial reference map //////////////////////////////////////////////////////////////////////////////////
+const double2 CurvMap::ref_vert[2][4] = {
+    { { -1.0, -1.0 }, { 1.0, -1.0 }, { -1.0, 1.0 }, {  0.0, 0.0 } },
+    { { -1.0, -1.0 }, { 1.0, -1.0 }, {  1.0, 1.0 }, { -1.0, 1.0 } }
+  };
+
 // calculation of nonpolynomial reference mapping on curved element
-void CurvMap::calc_ref_map_tri(Element* e, Nurbs** nurbs, double xi_1, double xi_2, double& x, double& y)
+void CurvMap::calc_ref_map_tri(Element* e, Nurbs** nurbs, int n, const double2* xi, double2* f)
 {
   _F_
-  double  fx,  fy;
-  x = y = 0.0;
+  std::vector<double> t(n), lab(n);
+  std::vector<int> idx(n);
+  double2* pts = new double2[n];
+
+  for (int i = 0; i < n; i++)
+    f[i][0] = f[i][1] = 0.0;
 
   for (unsigned int j = 0; j < e->nvert; j++)
   {
     int va = j;
     int vb = e->next_vert(j);
-    double l_a = 0;
-    double l_b = 0;
-    switch(va) {
-    case 0:
-      l_a = lambda_0(xi_1, xi_2);
-      break;
-    case 1:
-      l_a = lambda_1(xi_1, xi_2);
-      break;
-    case 2:
-      l_a = lambda_2(xi_1, xi_2);
-      break;
-    }
 
-    switch(vb) {
-    case 0:
-      l_b = lambda_0(xi_1, xi_2);
-      break;
-    case 1:
-      l_b = lambda_1(xi_1, xi_2);
-      break;
-    case 2:
-      l_b = lambda_2(xi_1, xi_2);
-      break;
-    }
+    // vertex part, the edge part is calculated for points not lying in the edge vertices
+    int m = 0;
+    for (int i = 0; i < n; i++)
+    {
+      double xi_1 = xi[i][0], xi_2 = xi[i][1];
+      double l[3] = { lambda_0(xi_1, xi_2), lambda_1(xi_1, xi_2), lambda_2(xi_1, xi_2) };
+      f[i][0] += e->vn[j]->x * l[va];
+      f[i][1] += e->vn[j]->y * l[va];
 
-    // vertex part
-    x += e->vn[j]->x * l_a;
-    y += e->vn[j]->y * l_a;
+      if (!(((ref_vert[0][va][0] == xi_1) && (ref_vert[0][va][1] == xi_2)) ||
+            ((ref_vert[0][vb][0] == xi_1) && (ref_vert[0][vb][1] == xi_2))))
+      {
+        t[m] = l[vb] - l[va];
+        lab[m] = l[va] * l[vb];
+        idx[m++] = i;
+      }
+    }
 
-    if (!(((ref_vert[0][va][0] == xi_1) && (ref_vert[0][va][1] == xi_2)) ||
-          ((ref_vert[0][vb][0] == xi_1) && (ref_vert[0][vb][1] == xi_2))))
+    // edge part: subtraction of straight edge and nurbs curve
+    nurbs_edge_points(e, nurbs[j], j, m, &t[0], pts);
+    for (int q = 0; q < m; q++)
     {
-      // edge part
-      double t = l_b - l_a;
-      double n_x, n_y, t_x, t_y;
-      nurbs_edge_0(e, nurbs[j], j, t, fx, fy, n_x, n_y, t_x, t_y);
-      x += fx * l_a  * l_b;
-      y += fy * l_a  * l_b;
+      double tq = t[q];
+      double fx = pts[q][0] - 0.5 * ((1-tq) * (e->vn[va]->x) + (1+tq) * (e->vn[vb]->x));
+      double fy = pts[q][1] - 0.5 * ((1-tq) * (e->vn[va]->y) + (1+tq) * (e->vn[vb]->y));
+      double k = 4.0 / ((1-tq) * (1+tq));
+      f[idx[q]][0] += fx * k * lab[q];
+      f[idx[q]][1] += fy * k * lab[q];
     }
   }
+
+  delete [] pts;
 }
 
 
-void CurvMap::calc_ref_map_quad(Element* e, Nurbs** nurbs, double xi_1, double xi_2,
-                              double& x, double& y)
+void CurvMap::calc_ref_map_quad(Element* e, Nurbs** nurbs, int n, const double2* xi, double2* f)
 {
   _F_
-  double ex[4], ey[4];
-
-  double n_x, n_y, t_x, t_y;
-  nurbs_edge(e, nurbs[0], 0,  xi_1, ex[0], ey[0], n_x, n_y, t_x, t_y);
-  nurbs_edge(e, nurbs[1], 1,  xi_2, ex[1], ey[1], n_x, n_y, t_x, t_y);
-  nurbs_edge(e, nurbs[2], 2, -xi_1, ex[2], ey[2], n_x, n_y, t_x, t_y);
-  nurbs_edge(e, nurbs[3], 3, -xi_2, ex[3], ey[3], n_x, n_y, t_x, t_y);
-
-  x = (1-xi_2)/2.0 * ex[0] + (1+xi_1)/2.0 * ex[1] +
-      (1+xi_2)/2.0 * ex[2] + (1-xi_1)/2.0 * ex[3] -
-      (1-xi_1)*(1-xi_2)/4.0 * e->vn[0]->x - (1+xi_1)*(1-xi_2)/4.0 * e->vn[1]->x -
-      (1+xi_1)*(1+xi_2)/4.0 * e->vn[2]->x - (1-xi_1)*(1+xi_2)/4.0 * e->vn[3]->x;
-
-  y = (1-xi_2)/2.0 * ey[0] + (1+xi_1)/2.0 * ey[1] +
-      (1+xi_2)/2.0 * ey[2] + (1-xi_1)/2.0 * ey[3] -
-      (1-xi_1)*(1-xi_2)/4.0 * e->vn[0]->y - (1+xi_1)*(1-xi_2)/4.0 * e->vn[1]->y -
-      (1+xi_1)*(1+xi_2)/4.0 * e->vn[2]->y - (1-xi_1)*(1+xi_2)/4.0 * e->vn[3]->y;
+  // points of the edges at the parameters xi_1, xi_2, -xi_1, -xi_2
+  std::vector<double> t(n);
+  double2* ep = new double2[4 * n];
+  for (int edge = 0; edge < 4; edge++)
+  {
+    for (int i = 0; i < n; i++)
+      t[i] = (edge < 2 ? 1.0 : -1.0) * xi[i][edge & 1];
+    nurbs_edge_points(e, nurbs[edge], edge, n, &t[0], ep + edge * n);
+  }
+
+  for (int i = 0; i < n; i++)
+  {
+    double xi_1 = xi[i][0], xi_2 = xi[i][1];
+    double2 *e0 = ep + i, *e1 = ep + n + i, *e2 = ep + 2*n + i, *e3 = ep + 3*n + i;
+
+    f[i][0] = (1-xi_2)/2.0 * (*e0)[0] + (1+xi_1)/2.0 * (*e1)[0] +
+              (1+xi_2)/2.0 * (*e2)[0] + (1-xi_1)/2.0 * (*e3)[0] -
+              (1-xi_1)*(1-xi_2)/4.0 * e->vn[0]->x - (1+xi_1)*(1-xi_2)/4.0 * e->vn[1]->x -
+              (1+xi_1)*(1+xi_2)/4.0 * e->vn[2]->x - (1-xi_1)*(1+xi_2)/4.0 * e->vn[3]->x;
+
+    f[i][1] = (1-xi_2)/2.0 * (*e0)[1] + (1+xi_1)/2.0 * (*e1)[1] +
+              (1+xi_2)/2.0 * (*e2)[1] + (1-xi_1)/2.0 * (*e3)[1] -
+              (1-xi_1)*(1-xi_2)/4.0 * e->vn[0]->y - (1+xi_1)*(1-xi_2)/4.0 * e->vn[1]->y -
+              (1+xi_1)*(1+xi_2)/4.0 * e->vn[2]->y - (1-xi_1)*(1+xi_2)/4.0 * e->vn[3]->y;
+  }
+
+  delete [] ep;
 }
 
 
-void CurvMap::calc_ref_map(Element* e, Nurbs** nurbs, double xi_1, double xi_2, double2& f)
+void CurvMap::calc_ref_map(Element* e, Nurbs** nurbs, int n, const double2* xi, double2* f)
 {
   _F_
   if (e->get_mode() == HERMES_MODE_QUAD)
-    calc_ref_map_quad(e, nurbs, xi_1, xi_2, f[0], f[1]);
+    calc_ref_map_quad(e, nurbs, n, xi, f);
   else
-    calc_ref_map_tri(e, nurbs, xi_1, xi_2, f[0], f[1]);
+    calc_ref_map_tri(e, nurbs, n, xi, f);
+}
+
+
+void CurvMap::calc_ref_map(Element* e, Nurbs** nurbs, double xi_1, double xi_2, double2& f)
+{
+  double2 xi = { xi_1, xi_2 };
+  calc_ref_map(e, nurbs, 1, &xi, &f);
 }
 
 
@@ -449,21 +521,25 @@ void CurvMap::calc_edge_projection(Element* e, int edge, Nurbs** nurbs, int orde
   b_1 = ctm.m[0] * ref_vert[mode][e->next_vert(edge)][0] + ctm.t[0];
   b_2 = ctm.m[1] * ref_vert[mode][e->next_vert(edge)][1] + ctm.t[1];
 
-  // values of nonpolynomial function in two vertices
-  double2 fa, fb;
-  calc_ref_map(e, nurbs, a_1, a_2, fa);
-  calc_ref_map(e, nurbs, b_1, b_2, fb);
-
+  // values of nonpolynomial function in all integration points and in the two vertices
+  double2 xi[17], f[17];
   double2* pt = quad1d.get_points(mo1);
+  for (j = 0; j < np; j++)
+  {
+    double2 v;
+    edge_coord(e, edge, pt[j][0], xi[j], v);
+  }
+  xi[np][0] = a_1;  xi[np][1] = a_2;
+  xi[np+1][0] = b_1;  xi[np+1][1] = b_2;
+  calc_ref_map(e, nurbs, np + 2, xi, f);
+  double* fa = f[np];
+  double* fb = f[np+1];
+
   for (j = 0; j < np; j++) // over all integration points
   {
-    double2 x, v;
     double t = pt[j][0];
-    edge_coord(e, edge, t, x, v);
-    calc_ref_map(e, nurbs, x[0], x[1], fn[j]);
-
     for (k = 0; k < 2; k++)
-      fn[j][k] = fn[j][k] - (fa[k] + (t+1)/2.0 * (fb[k] - fa[k]));
+      fn[j][k] = f[j][k] - (fa[k] + (t+1)/2.0 * (fb[k] - fa[k]));
   }
 
   double2* result = proj + e->nvert + edge * (order - 1);
@@ -588,13 +664,14 @@ void CurvMap::calc_bubble_projection(Element* e, Nurbs** nurbs, int order, doubl
 
   // fn values of both components of nonpolynomial function
   double3* pt = quad2d.get_points(mo2);
+  double2* a = new double2[np];
   for (j = 0; j < np; j++)  // over all integration points
   {
-    double2 a;
-    a[0] = ctm.m[0] * pt[j][0] + ctm.t[0];
-    a[1] = ctm.m[1] * pt[j][1] + ctm.t[1];
-    calc_ref_map(e, nurbs, a[0], a[1], fn[j]);
+    a[j][0] = ctm.m[0] * pt[j][0] + ctm.t[0];
+    a[j][1] = ctm.m[1] * pt[j][1] + ctm.t[1];
   }
+  calc_ref_map(e, nurbs, np, a, fn);
+  delete [] a;
 
   double2* result = proj + e->nvert + e->nvert * (order - 1);
   for (k = 0; k < 2; k++)
@@ -682,6 +759,17 @@ void CurvMap::update_refmap_coeffs(Element* e)
   // WARNING: do not change the format of the array 'coeffs'. If it changes,
   // RefMap::set_active_element() has to be changed too.
 
+  // the coefficients may have been calculated for another copy of the element
+  CurvMap* top = toplevel ? this : parent->cm;
+  if (top->cache == NULL) top->cache = new CurvMapCache;
+  std::pair<uint64_t, int> key(toplevel ? 0 : part, order);
+  std::map<std::pair<uint64_t, int>, double2*>::iterator it = top->cache->coeffs.find(key);
+  if (it != top->cache->coeffs.end())
+  {
+    memcpy(coeffs, it->second, nc * sizeof(double2));
+    return;
+  }
+
   Nurbs** nurbs;
   if (toplevel == false)
   {
@@ -699,6 +787,10 @@ void CurvMap::update_refmap_coeffs(Element* e)
 
   // calculation of new projection coefficients
   ref_map_projection(e, nurbs, order, coeffs);
+
+  double2* cached = new double2[nc];
+  memcpy(cached, coeffs, nc * sizeof(double2));
+  top->cache->coeffs[key] = cached;
 }
 
 void CurvMap::get_mid_edge_points(Element* e, double2* pt, int n)
@@ -716,13 +808,14 @@ void CurvMap::get_mid_edge_points(Element* e, double2* pt, int n)
   }
 
   ctm = *(tran.get_ctm());
-  double xi_1, xi_2;
+  double2* xi = new double2[n];
   for (int i = 0; i < n; i++)
   {
-    xi_1 = ctm.m[0] * pt[i][0] + ctm.t[0];
-    xi_2 = ctm.m[1] * pt[i][1] + ctm.t[1];
-    calc_ref_map(e, nurbs, xi_1, xi_2, pt[i]);
+    xi[i][0] = ctm.m[0] * pt[i][0] + ctm.t[0];
+    xi[i][1] = ctm.m[1] * pt[i][1] + ctm.t[1];
   }
+  calc_ref_map(e, nurbs, n, xi, pt);
+  delete [] xi;
 }
 
 void Nurbs::unref()
@@ -737,6 +830,20 @@ void Nurbs::unref()
 }
 
 
+CurvMapCache::~CurvMapCache()
+{
+  std::map<std::pair<uint64_t, int>, double2*>::iterator it;
+  for (it = coeffs.begin(); it != coeffs.end(); it++)
+    delete [] it->second;
+}
+
+void CurvMapCache::unref()
+{
+  if (!--ref)
+    delete this;
+}
+
+
 CurvMap::CurvMap(CurvMap* cm)
 {
   _F_
@@ -745,9 +852,13 @@ CurvMap::CurvMap(CurvMap* cm)
   memcpy(coeffs, cm->coeffs, sizeof(double2) * nc);
 
   if (toplevel)
+  {
     for (int i = 0; i < 4; i++)
       if (nurbs[i] != NULL)
         nurbs[i]->ref++;
+    if (cache != NULL)
+      cache->ref++;
+  }
 }
 
 CurvMap::~CurvMap()
@@ -758,7 +869,11 @@ CurvMap::~CurvMap()
     coeffs = NULL;
   }
   if (toplevel)
+  {
     for (int i = 0; i < 4; i++)
       if (nurbs[i] != NULL)
         nurbs[i]->unref();
+    if (cache != NULL)
+      cache->unref();
+  }
 }
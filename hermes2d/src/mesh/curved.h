@@ -55,6 +55,27 @@ struct HERMES_API Nurbs
 };
 
 
+/// \brief Cache of projected reference map coefficients.
+///
+/// The coefficients of the curved elements obtained by refining one base element
+/// depend only on the base element and on the position of the son in it. They are
+/// stored here, keyed by the sub-element ('part' of CurvMap, zero for the base element
+/// itself) and the order of the projection. The cache belongs to the CurvMap of the
+/// base element and is shared by its copies (e.g. in reference meshes), so sons which
+/// are created again by another refinement take their coefficients from the cache.
+/// Vertices of base elements must not be moved while the cache exists.
+///
+struct HERMES_API CurvMapCache
+{
+  CurvMapCache() { ref = 1; }
+  ~CurvMapCache();
+  void unref();
+
+  int ref;     ///< reference counter (the structure is deleted when this reaches zero)
+  std::map<std::pair<uint64_t, int>, double2*> coeffs;
+};
+
+
 /// CurvMap is a structure storing complete information on the curved edges of
 /// an element. There are two variants of this structure. The first is for
 /// top-level (master mesh) elements.
@@ -62,7 +83,7 @@ struct HERMES_API Nurbs
 class HERMES_API CurvMap
 {
 public:
-  CurvMap() { coeffs = NULL;};
+  CurvMap() { coeffs = NULL; cache = NULL; };
   CurvMap(CurvMap* cm);
   ~CurvMap();
 
@@ -91,6 +112,9 @@ public:
   int nc; // number of coefficients (todo: mozna spis polyn. rad zobrazeni)
   double2* coeffs; // array of the coefficients
 
+  // coefficients of the refined elements, only in toplevel structures
+  CurvMapCache* cache;
+
   // this is called for every curvilinear element when it is created
   // or when it is necessary to re-calculate coefficients for another
   // order: 'e' is a pointer to the element to which this CurvMap
@@ -117,6 +141,14 @@ public:
   static Trf ctm;
 
   static double nurbs_basis_fn(int i, int k, double t, double* knot);
+
+  /// Evaluates a NURBS curve at n parameters t[i] from [0, 1]. Only the degree+1 nonzero
+  /// basis functions of each point are calculated, by the triangular Cox-de Boor scheme.
+  static void nurbs_points(Nurbs* nurbs, int n, const double* t, double2* pts);
+
+  /// Evaluates the curve of an edge of e (straight if nurbs is NULL) at n parameters
+  /// t[i] from [-1, 1].
+  static void nurbs_edge_points(Element* e, Nurbs* nurbs, int edge, int n, const double* t, double2* pts);
   static void nurbs_edge(Element* e, Nurbs* nurbs, int edge, double t, double& x, 
                          double& y, double& n_x, double& n_y, double& t_x, double& t_y);
   
@@ -141,12 +173,11 @@ public:
 
   static const double2 ref_vert[2][4];
 
-  // subtraction of straight edge and nurbs curve
-  static void nurbs_edge_0(Element* e, Nurbs* nurbs, int edge, double t, double& x, double& y, double& n_x, double& n_y, double& t_x, double& t_y);
-  static void calc_ref_map_tri(Element* e, Nurbs** nurbs, double xi_1, double xi_2, double& x, double& y);
-  static void calc_ref_map_quad(Element* e, Nurbs** nurbs, double xi_1, double xi_2,
-                              double& x, double& y);
+  // nonpolynomial reference map at n points xi[i] of the reference domain
+  static void calc_ref_map_tri(Element* e, Nurbs** nurbs, int n, const double2* xi, double2* f);
+  static void calc_ref_map_quad(Element* e, Nurbs** nurbs, int n, const double2* xi, double2* f);
 
+  static void calc_ref_map(Element* e, Nurbs** nurbs, int n, const double2* xi, double2* f);
   static void calc_ref_map(Element* e, Nurbs** nurbs, double xi_1, double xi_2, double2& f);
 
   static void precalculate_cholesky_projection_matrix_edge();
@@ -0,0 +1,171 @@
+// This file is part of Hermes2D.
+//
+// Hermes2D is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include "../h2d_common.h"
+#include "element_locator.h"
+#include "mesh.h"
+#include "refmap.h"
+
+// Number of points sampled along each edge of a curved element.
+static const int H2D_LOCATOR_EDGE_SAMPLES = 16;
+
+ElementLocator::ElementLocator(Mesh* mesh) : mesh(mesh)
+{
+  _F_
+  mesh_seq = mesh->get_seq();
+  boxes = new double4[mesh->get_max_element_id() + 1];
+
+  // Bounding boxes of the elements and of the whole mesh.
+  RefMap refmap;
+  Element* e;
+  double xmin = 1e100, ymin = 1e100, xmax = -1e100, ymax = -1e100;
+  for_all_active_elements(e, mesh)
+  {
+    double* box = boxes[e->id];
+    calc_bounding_box(e, &refmap, box);
+    xmin = std::min(xmin, box[0]);  ymin = std::min(ymin, box[1]);
+    xmax = std::max(xmax, box[2]);  ymax = std::max(ymax, box[3]);
+  }
+
+  // Roughly square cells, about one element per cell.
+  int nactive = std::max(mesh->get_num_active_elements(), 1);
+  double width = std::max(xmax - xmin, 1e-12), height = std::max(ymax - ymin, 1e-12);
+  nx = std::max(1, std::min(nactive, (int) ceil(sqrt(nactive * width / height))));
+  ny = std::max(1, std::min(nactive, (int) ceil((double) nactive / nx)));
+  x0 = xmin;  cell_x = width / nx;
+  y0 = ymin;  cell_y = height / ny;
+
+  // Register every element in all cells its bounding box intersects:
+  // count first, then fill.
+  cell_start = new int[nx * ny + 1];
+  memset(cell_start, 0, (nx * ny + 1) * sizeof(int));
+  for (int pass = 0; pass < 2; pass++)
+  {
+    for_all_active_elements(e, mesh)
+    {
+      double* box = boxes[e->id];
+      int i0 = get_cell(box[0], box[1]) % nx, j0 = get_cell(box[0], box[1]) / nx;
+      int i1 = get_cell(box[2], box[3]) % nx, j1 = get_cell(box[2], box[3]) / nx;
+      for (int j = j0; j <= j1; j++)
+        for (int i = i0; i <= i1; i++)
+        {
+          if (pass == 0) cell_start[j * nx + i + 1]++;
+          else cell_elems[cell_start[j * nx + i]++] = e->id;
+        }
+    }
+    if (pass == 0)
+    {
+      for (int c = 0; c < nx * ny; c++)
+        cell_start[c + 1] += cell_start[c];
+      cell_elems = new int[cell_start[nx * ny]];
+    }
+  }
+  // The filling shifted each cell_start by the number of elements in the cell.
+  for (int c = nx * ny; c > 0; c--)
+    cell_start[c] = cell_start[c - 1];
+  cell_start[0] = 0;
+}
+
+ElementLocator::~ElementLocator()
+{
+  _F_
+  delete [] boxes;
+  delete [] cell_start;
+  delete [] cell_elems;
+}
+
+bool ElementLocator::is_up_to_date() const
+{
+  return mesh->get_seq() == mesh_seq;
+}
+
+void ElementLocator::calc_bounding_box(Element* e, RefMap* refmap, double4 box)
+{
+  box[0] = box[2] = e->vn[0]->x;
+  box[1] = box[3] = e->vn[0]->y;
+  for (unsigned int i = 1; i < e->nvert; i++)
+  {
+    box[0] = std::min(box[0], e->vn[i]->x);  box[2] = std::max(box[2], e->vn[i]->x);
+    box[1] = std::min(box[1], e->vn[i]->y);  box[3] = std::max(box[3], e->vn[i]->y);
+  }
+
+  // The edges of curved elements are sampled through the reference map, the box
+  // is then enlarged to cover the parts of the edges between the samples.
+  double margin = 0.0;
+  if (e->is_curved())
+  {
+    static const double tri_verts[3][2] = { { -1, -1 }, { 1, -1 }, { -1, 1 } };
+    static const double quad_verts[4][2] = { { -1, -1 }, { 1, -1 }, { 1, 1 }, { -1, 1 } };
+    const double (*verts)[2] = e->is_triangle() ? tri_verts : quad_verts;
+
+    refmap->set_active_element(e);
+    for (unsigned int i = 0; i < e->nvert; i++)
+    {
+      const double* a = verts[i];
+      const double* b = verts[e->next_vert(i)];
+      for (int k = 1; k < H2D_LOCATOR_EDGE_SAMPLES; k++)
+      {
+        double t = (double) k / H2D_LOCATOR_EDGE_SAMPLES, x, y;
+        double2x2 m;
+        refmap->inv_ref_map_at_point(a[0] + t * (b[0] - a[0]), a[1] + t * (b[1] - a[1]), x, y, m);
+        box[0] = std::min(box[0], x);  box[2] = std::max(box[2], x);
+        box[1] = std::min(box[1], y);  box[3] = std::max(box[3], y);
+      }
+    }
+    margin = 0.02;
+  }
+
+  // Points lying on the element boundary must be found as well.
+  double tol = std::max(margin, 1e-10) * std::max(box[2] - box[0], box[3] - box[1]);
+  box[0] -= tol;  box[1] -= tol;
+  box[2] += tol;  box[3] += tol;
+}
+
+int ElementLocator::get_cell(double x, double y) const
+{
+  int i = (int) floor((x - x0) / cell_x);
+  int j = (int) floor((y - y0) / cell_y);
+  i = std::max(0, std::min(nx - 1, i));
+  j = std::max(0, std::min(ny - 1, j));
+  return j * nx + i;
+}
+
+Element* ElementLocator::get_element(double x, double y, RefMap* refmap, double& xi1, double& xi2)
+{
+  _F_
+  int c = get_cell(x, y);
+  for (int k = cell_start[c]; k < cell_start[c + 1]; k++)
+  {
+    double* box = boxes[cell_elems[k]];
+    if (x < box[0] || y < box[1] || x > box[2] || y > box[3]) continue;
+
+    Element* e = mesh->get_element_fast(cell_elems[k]);
+    refmap->set_active_element(e);
+    refmap->untransform(e, x, y, xi1, xi2);
+    if (is_in_ref_domain(e, xi1, xi2))
+      return e;
+  }
+  return NULL;
+}
+
+bool ElementLocator::is_in_ref_domain(Element* e, double xi1, double xi2)
+{
+  const double TOL = 1e-11;
+  if (e->is_triangle())
+    return (xi1 + xi2 <= TOL) && (xi1 + 1.0 >= -TOL) && (xi2 + 1.0 >= -TOL);
+  else
+    return (xi1 - 1.0 <= TOL) && (xi1 + 1.0 >= -TOL) && (xi2 - 1.0 <= TOL) && (xi2 + 1.0 >= -TOL);
+}
@@ -0,0 +1,78 @@
+// This file is part of Hermes2D.
+//
+// Hermes2D is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 2 of the License, or
+// (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef __H2D_ELEMENT_LOCATOR_H
+#define __H2D_ELEMENT_LOCATOR_H
+
+#include "../h2d_common.h"
+
+class Mesh;
+class Element;
+class RefMap;
+
+
+/// \brief Finds the active element of a mesh containing a given point.
+///
+/// The bounding box of the mesh is covered by a uniform grid of about as many
+/// cells as there are active elements. Each cell lists the elements whose bounding
+/// boxes intersect it, so a point query only tests a few elements instead of
+/// all of them. The bounding boxes of curved elements are obtained by sampling
+/// their edges through the reference map.
+///
+/// The locator belongs to the state of the mesh it was built for, see is_up_to_date().
+///
+class HERMES_API ElementLocator
+{
+public:
+  ElementLocator(Mesh* mesh);
+  ~ElementLocator();
+
+  Mesh* get_mesh() const { return mesh; }
+
+  /// Returns false if the mesh was changed (refined, unrefined, reloaded) since the
+  /// locator was built.
+  bool is_up_to_date() const;
+
+  /// Returns the active element containing the point (x, y) and the reference
+  /// coordinates of the point in that element, or NULL if the point lies outside
+  /// the mesh. The reference map is set to the returned element.
+  Element* get_element(double x, double y, RefMap* refmap, double& xi1, double& xi2);
+
+  /// Returns the index of the grid cell containing (x, y). Points with close cell
+  /// indices are close to each other, which is used to sort batches of queries.
+  int get_cell(double x, double y) const;
+
+  /// Returns true if the reference coordinates lie in the reference domain of e.
+  static bool is_in_ref_domain(Element* e, double xi1, double xi2);
+
+protected:
+  void calc_bounding_box(Element* e, RefMap* refmap, double4 box);
+
+  Mesh* mesh;
+  unsigned mesh_seq;
+
+  /// The grid: origin, cell sizes, and numbers of cells.
+  double x0, y0, cell_x, cell_y;
+  int nx, ny;
+
+  /// Elements intersecting the cell c are cell_elems[cell_start[c]], ..., cell_elems[cell_start[c + 1] - 1].
+  int* cell_start;
+  int* cell_elems;
+
+  /// Bounding boxes (xmin, ymin, xmax, ymax), indexed by element id.
+  double4* boxes;
+};
+
+#endif
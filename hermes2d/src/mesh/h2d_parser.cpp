@@ -0,0 +1,416 @@
+// This file is part of Hermes2D
+//
+// Hermes2D is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D; if not, see <http://www.gnu.prg/licenses/>.
+
+#include <ctype.h>
+#include <limits.h>
+#include <sstream>
+#include <stdexcept>
+#include "h2d_parser.h"
+
+int H2DParser::Value::to_int() const
+{
+  if (type != NUMBER || num != floor(num) || fabs(num) > INT_MAX)
+    throw std::runtime_error("an integer expected");
+  return (int) num;
+}
+
+H2DParser::H2DParser(std::istream& is) : is(is), pos(0), len(0), line(1), depth(0), list_close(0), list_pos(0)
+{
+  next();
+}
+
+void H2DParser::unsupported(const char* what)
+{
+  std::ostringstream s;
+  s << "line " << line << ": unsupported " << what;
+  throw std::runtime_error(s.str());
+}
+
+int H2DParser::peek_char()
+{
+  if (pos >= len)
+  {
+    is.read(buf, sizeof(buf));
+    len = is.gcount();
+    pos = 0;
+    if (len <= 0) return -1;
+  }
+  return (unsigned char) buf[pos];
+}
+
+void H2DParser::next()
+{
+  // skip white space, comments and line continuations
+  int c;
+  for (;;)
+  {
+    c = peek_char();
+    if (c == ' ' || c == '\t' || c == '\r' || c == '\f') pos++;
+    else if (c == '#')
+      while ((c = peek_char()) >= 0 && c != '\n') pos++;
+    else if (c == '\\')
+    {
+      pos++;
+      if (peek_char() == '\r') pos++;
+      if (get_char() != '\n') unsupported("character '\\'");
+      line++;
+    }
+    else if (c == '\n')
+    {
+      pos++;
+      line++;
+      if (depth == 0) { tok = T_NEWLINE; return; }
+    }
+    else if (c == ';' && depth == 0)
+    {
+      // separates statements like a newline
+      pos++;
+      tok = T_NEWLINE;
+      return;
+    }
+    else break;
+  }
+
+  if (c < 0)
+  {
+    tok = T_END;
+  }
+  else if (isdigit(c) || c == '.')
+  {
+    // integers are accumulated directly, everything else is left to strtod
+    bool integer = true;
+    double val = 0.0;
+    tok_text.clear();
+    while ((c = peek_char()) >= 0 && isdigit(c)) { val = val * 10.0 + (c - '0'); tok_text += (char) c; pos++; }
+    if (c == '.')
+    {
+      integer = false;
+      tok_text += (char) get_char();
+      while ((c = peek_char()) >= 0 && isdigit(c)) tok_text += (char) get_char();
+    }
+    if (c == 'e' || c == 'E')
+    {
+      integer = false;
+      tok_text += (char) get_char();
+      if ((c = peek_char()) == '+' || c == '-') tok_text += (char) get_char();
+      while ((c = peek_char()) >= 0 && isdigit(c)) tok_text += (char) get_char();
+    }
+    if (tok_text == "." || (c >= 0 && (isalnum(c) || c == '_' || c == '.'))) unsupported("number");
+    tok = T_NUMBER;
+    tok_num = integer ? val : strtod(tok_text.c_str(), NULL);
+  }
+  else if (isalpha(c) || c == '_')
+  {
+    tok = T_NAME;
+    tok_text.clear();
+    while ((c = peek_char()) >= 0 && (isalnum(c) || c == '_')) tok_text += (char) get_char();
+  }
+  else if (c == '"' || c == '\'')
+  {
+    int quote = get_char();
+    tok = T_STRING;
+    tok_text.clear();
+    while ((c = get_char()) != quote)
+    {
+      if (c < 0 || c == '\n') unsupported("string");
+      if (c == '\\') c = get_char();
+      tok_text += (char) c;
+    }
+  }
+  else
+  {
+    tok = T_OP;
+    tok_op[0] = (char) get_char();
+    tok_op[1] = tok_op[2] = 0;
+    switch (tok_op[0])
+    {
+      case '(': case '[': case '{': depth++; break;
+      case ')': case ']': case '}': if (depth > 0) depth--; break;
+      case '^': tok_op[0] = tok_op[1] = '*'; break;
+      case '*': if (peek_char() == '*') tok_op[1] = (char) get_char(); break;
+      case '/': if (peek_char() == '/') unsupported("operator '//'"); break;
+      case '=': if (peek_char() == '=') unsupported("operator '=='"); break;
+      case ',': case '+': case '-': break;
+      default: unsupported("character");
+    }
+  }
+}
+
+void H2DParser::expect_op(char op)
+{
+  if (!is_op(op)) unsupported("syntax");
+  next();
+}
+
+void H2DParser::end_statement()
+{
+  if (tok != T_NEWLINE && tok != T_END) unsupported("statement");
+}
+
+
+//// statements ////////////////////////////////////////////////////////////////////////////////////
+
+bool H2DParser::next_assignment(std::string& name)
+{
+  while (tok == T_NEWLINE) next();
+  if (tok == T_END) return false;
+  if (tok != T_NAME) unsupported("statement");
+  name = tok_text;
+  next();
+  expect_op('=');
+
+  // a line ending with '=' continues on the next one
+  while (tok == T_NEWLINE) next();
+  return true;
+}
+
+void H2DParser::parse_variable(const std::string& name)
+{
+  Value v;
+  parse_expr(v);
+  end_statement();
+  variables[name] = v;
+}
+
+void H2DParser::begin_list()
+{
+  list_pos = 0;
+  if (is_op('{') || is_op('['))
+  {
+    list_close = is_op('{') ? '}' : ']';
+    next();
+  }
+  else
+  {
+    list_close = 0;
+    parse_expr(list_value);
+    end_statement();
+    if (list_value.type != Value::LIST) unsupported("value, a list expected");
+  }
+}
+
+bool H2DParser::next_item(Value& item)
+{
+  if (list_close == 0)
+  {
+    if (list_pos >= list_value.size) return false;
+    item = list_value.items[list_pos++];
+    return true;
+  }
+
+  if (is_op(list_close))
+  {
+    next();
+    end_statement();
+    return false;
+  }
+  parse_expr(item);
+  if (is_op(',')) next();
+  else if (!is_op(list_close)) unsupported("list");
+  return true;
+}
+
+
+//// expressions ///////////////////////////////////////////////////////////////////////////////////
+
+double H2DParser::number(const Value& v)
+{
+  if (v.type != Value::NUMBER) unsupported("operation on a string or a list");
+  return v.num;
+}
+
+void H2DParser::parse_expr(Value& v)
+{
+  parse_term(v);
+  while (is_op('+') || is_op('-'))
+  {
+    char op = tok_op[0];
+    Value r;
+    next();
+    parse_term(r);
+    v.num = (op == '+') ? number(v) + number(r) : number(v) - number(r);
+  }
+}
+
+void H2DParser::parse_term(Value& v)
+{
+  parse_unary(v);
+  while (is_op('*') || is_op('/'))
+  {
+    char op = tok_op[0];
+    Value r;
+    next();
+    parse_unary(r);
+    // true division, mesh files are run with 'from __future__ import division'
+    v.num = (op == '*') ? number(v) * number(r) : number(v) / number(r);
+  }
+}
+
+void H2DParser::parse_unary(Value& v)
+{
+  if (is_op('-') || is_op('+'))
+  {
+    char op = tok_op[0];
+    next();
+    parse_unary(v);
+    if (op == '-') v.num = -number(v);
+    else number(v);
+  }
+  else
+    parse_power(v);
+}
+
+void H2DParser::parse_power(Value& v)
+{
+  parse_atom(v);
+  if (tok == T_OP && tok_op[0] == '*' && tok_op[1] == '*')
+  {
+    Value r;
+    next();
+    parse_unary(r);
+    v.num = pow(number(v), number(r));
+  }
+}
+
+void H2DParser::parse_atom(Value& v)
+{
+  if (tok == T_NUMBER)
+  {
+    v.type = Value::NUMBER;
+    v.num = tok_num;
+    next();
+  }
+  else if (tok == T_STRING)
+  {
+    v.type = Value::STRING;
+    v.str = tok_text;
+    next();
+  }
+  else if (tok == T_NAME)
+  {
+    std::string name = tok_text;
+    next();
+    if (is_op('('))
+    {
+      parse_call(name, v);
+      return;
+    }
+    std::map<std::string, Value>::iterator it = variables.find(name);
+    v.type = Value::NUMBER;
+    if (it != variables.end()) v = it->second;
+    else if (name == "pi") v.num = M_PI;
+    else if (name == "e") v.num = M_E;
+    else unsupported("name");
+  }
+  else if (is_op('{') || is_op('['))
+  {
+    char close = is_op('{') ? '}' : ']';
+    next();
+    v.type = Value::LIST;
+    v.size = 0;
+    parse_list(v, close);
+  }
+  else if (is_op('('))
+  {
+    // parentheses or a tuple
+    next();
+    v.type = Value::LIST;
+    v.size = 0;
+    if (!is_op(')'))
+    {
+      parse_expr(v);
+      if (!is_op(',')) { expect_op(')'); return; }
+      next();
+      Value first = v;
+      v.type = Value::LIST;
+      v.size = 0;
+      if (v.items.empty()) v.items.push_back(first);
+      else v.items[0] = first;
+      v.size = 1;
+    }
+    parse_list(v, ')');
+  }
+  else
+    unsupported("expression");
+}
+
+void H2DParser::parse_list(Value& v, char close)
+{
+  while (!is_op(close))
+  {
+    if (v.size == v.items.size()) v.items.push_back(Value());
+    parse_expr(v.items[v.size++]);
+    if (is_op(',')) next();
+    else if (!is_op(close)) unsupported("list");
+  }
+  next();
+}
+
+void H2DParser::parse_call(const std::string& fn, Value& v)
+{
+  double a[2] = { 0.0, 0.0 };
+  int n = 0;
+  next();
+  while (!is_op(')'))
+  {
+    Value arg;
+    parse_expr(arg);
+    if (n == 2) unsupported("number of arguments");
+    a[n++] = number(arg);
+    if (is_op(',')) next();
+    else if (!is_op(')')) unsupported("function call");
+  }
+  next();
+
+  // the math module and a few builtins
+  double x = a[0], y = a[1];
+  v.type = Value::NUMBER;
+  if (n == 1)
+  {
+    if (fn == "sqrt") v.num = sqrt(x);
+    else if (fn == "sin") v.num = sin(x);
+    else if (fn == "cos") v.num = cos(x);
+    else if (fn == "tan") v.num = tan(x);
+    else if (fn == "asin") v.num = asin(x);
+    else if (fn == "acos") v.num = acos(x);
+    else if (fn == "atan") v.num = atan(x);
+    else if (fn == "sinh") v.num = sinh(x);
+    else if (fn == "cosh") v.num = cosh(x);
+    else if (fn == "tanh") v.num = tanh(x);
+    else if (fn == "exp") v.num = exp(x);
+    else if (fn == "log") v.num = log(x);
+    else if (fn == "log10") v.num = log10(x);
+    else if (fn == "fabs" || fn == "abs") v.num = fabs(x);
+    else if (fn == "floor") v.num = floor(x);
+    else if (fn == "ceil") v.num = ceil(x);
+    else if (fn == "radians") v.num = x * M_PI / 180.0;
+    else if (fn == "degrees") v.num = x * 180.0 / M_PI;
+    else if (fn == "float") v.num = x;
+    else if (fn == "int") v.num = (x < 0) ? ceil(x) : floor(x);
+    else unsupported("function");
+  }
+  else if (n == 2)
+  {
+    if (fn == "atan2") v.num = atan2(x, y);
+    else if (fn == "pow") v.num = pow(x, y);
+    else if (fn == "hypot") v.num = sqrt(x*x + y*y);
+    else if (fn == "fmod") v.num = fmod(x, y);
+    else if (fn == "min") v.num = std::min(x, y);
+    else if (fn == "max") v.num = std::max(x, y);
+    else unsupported("function");
+  }
+  else
+    unsupported("function");
+}
@@ -0,0 +1,114 @@
+// This file is part of Hermes2D
+//
+// Hermes2D is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// Hermes2D is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes2D; if not, see <http://www.gnu.prg/licenses/>.
+
+#ifndef _H2D_PARSER_H_
+#define _H2D_PARSER_H_
+
+#include "../h2d_common.h"
+#include <istream>
+#include <map>
+#include <string>
+#include <vector>
+
+
+/// \brief Tokenizer and evaluator of the Hermes2D mesh file format.
+///
+/// Mesh files are Python scripts. This class understands the part of Python
+/// they use: assignments of numbers, strings and nested lists (written with
+/// either {} or []), arithmetic expressions with the operators + - * / ** ^, and
+/// the functions and constants of the math module. The input is read in chunks,
+/// so lists can be processed item by item while they are being parsed.
+///
+/// Anything else (loops, tuples assigned to several variables, ...) makes the
+/// parser throw std::runtime_error, the caller can then use the Python reader.
+///
+class H2DParser
+{
+public:
+  /// A parsed value: a number, a string or a list of values.
+  struct Value
+  {
+    enum { NUMBER, STRING, LIST };
+    int type;
+    double num;
+    std::string str;
+    std::vector<Value> items;  ///< Only the first 'size' items are valid.
+    unsigned size;
+
+    Value() : type(NUMBER), num(0.0), size(0) {}
+
+    /// Returns the number as an integer, throws if the value is not an integer.
+    int to_int() const;
+  };
+
+  H2DParser(std::istream& is);
+
+  /// Reads the next assignment up to the '=' sign. Returns false at the end of the input.
+  bool next_assignment(std::string& name);
+
+  /// Reads the value of the current assignment and stores it as a variable.
+  void parse_variable(const std::string& name);
+
+  /// Reads the value of the current assignment, which has to be a list, item by item:
+  /// begin_list() is followed by calls to next_item() until it returns false.
+  void begin_list();
+  bool next_item(Value& item);
+
+  /// Returns the current line number, for error messages.
+  int get_line() const { return line; }
+
+protected:
+  enum { T_END, T_NEWLINE, T_NUMBER, T_NAME, T_STRING, T_OP };
+
+  /// Tokenizer.
+  void next();
+  int peek_char();
+  int get_char() { int c = peek_char(); if (c >= 0) pos++; return c; }
+  bool is_op(char op) const { return tok == T_OP && tok_op[0] == op && tok_op[1] == 0; }
+  void expect_op(char op);
+  void end_statement();
+  void unsupported(const char* what);
+
+  /// Recursive descent parser of expressions, evaluated on the fly.
+  void parse_expr(Value& v);
+  void parse_term(Value& v);
+  void parse_unary(Value& v);
+  void parse_power(Value& v);
+  void parse_atom(Value& v);
+  void parse_list(Value& v, char close);
+  void parse_call(const std::string& fn, Value& v);
+  double number(const Value& v);
+
+  std::istream& is;
+  char buf[64 * 1024];
+  int pos, len;
+  int line;
+  int depth;            ///< Bracket nesting depth, newlines inside brackets are ignored.
+
+  int tok;              ///< Current token: type, and its value.
+  double tok_num;
+  std::string tok_text;
+  char tok_op[3];
+
+  std::map<std::string, Value> variables;
+
+  /// State of the list being read by next_item(). If the value of the assignment is not
+  /// a literal list, it is evaluated as a whole and its items are handed out one by one.
+  char list_close;
+  Value list_value;
+  unsigned list_pos;
+};
+
+#endif
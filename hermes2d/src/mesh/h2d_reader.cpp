@@ -18,11 +18,12 @@
 #include <map>
 #include "hash.h"
 #include <iostream>
+#include <stdexcept>
 #include "h2d_reader.h"
 
 extern unsigned g_mesh_seq;
 
-H2DReader::H2DReader()
+H2DReader::H2DReader() : use_python(false)
 {
 }
 
@@ -146,6 +147,43 @@ Nurbs* H2DReader::load_nurbs(Mesh *mesh, Python &p, int id, Node** en, int &p1,
 }
 
 
+void H2DReader::assign_nurbs(Mesh *mesh, Node* en, Nurbs* nurbs, int p1)
+{
+  // assign the nurbs to the elements sharing the edge node
+  for (int k = 0; k < 2; k++)
+  {
+    Element* e = en->elem[k];
+    if (e == NULL) continue;
+
+    if (e->cm == NULL)
+    {
+      e->cm = new CurvMap;
+      memset(e->cm, 0, sizeof(CurvMap));
+      e->cm->toplevel = 1;
+      e->cm->order = 4;
+    }
+
+    int idx = -1;
+    for (unsigned j = 0; j < e->nvert; j++)
+      if (e->en[j] == en) { idx = j; break; }
+    assert(idx >= 0);
+
+    if (e->vn[idx]->id == p1)
+    {
+      e->cm->nurbs[idx] = nurbs;
+      nurbs->ref++;
+    }
+    else
+    {
+      Nurbs* nurbs_rev = mesh->reverse_nurbs(nurbs);
+      e->cm->nurbs[idx] = nurbs_rev;
+      nurbs_rev->ref++;
+    }
+  }
+  if (!nurbs->ref) delete nurbs;
+}
+
+
 bool H2DReader::load(const char *filename, Mesh *mesh)
 {
   std::ifstream s(filename);
@@ -165,7 +203,30 @@ PyMODINIT_FUNC initpython_reader(void); /*proto*/
 bool H2DReader::load_stream(std::istream &is, Mesh *mesh,
         const char *filename)
 {
-  int i, j, k, n;
+  if (!use_python)
+  {
+    std::streampos start = is.tellg();
+    try
+    {
+      return load_stream_native(is, mesh, filename);
+    }
+    catch (std::runtime_error& err)
+    {
+      // Start over with the Python interpreter, if the stream can be rewound.
+      if (start == std::streampos(-1))
+        error("File %s: %s.", filename, err.what());
+      verbose("File %s: %s, using the Python mesh reader.", filename, err.what());
+      is.clear();
+      is.seekg(start);
+    }
+  }
+  return load_stream_python(is, mesh, filename);
+}
+
+bool H2DReader::load_stream_python(std::istream &is, Mesh *mesh,
+        const char *filename)
+{
+  int i, j, n;
   Node* en;
   bool debug = false;
 
@@ -201,7 +262,6 @@ bool H2DReader::load_stream(std::istream &is, Mesh *mesh,
     node->type = HERMES_TYPE_VERTEX;
     node->bnd = 0;
     node->p1 = node->p2 = -1;
-    node->next_hash = NULL;
     p.push_int("i", i);
     p.exec("x, y = vertices[i]");
     node->x = p.pull_double("x");
@@ -362,39 +422,7 @@ bool H2DReader::load_stream(std::istream &is, Mesh *mesh,
       p.push_int("i", i);
       p.exec("curve = curves[i]");
       Nurbs* nurbs = load_nurbs(mesh, p, i, &en, p1, p2);
-
-      // assign the nurbs to the elements sharing the edge node
-      for (k = 0; k < 2; k++)
-      {
-        Element* e = en->elem[k];
-        if (e == NULL) continue;
-
-        if (e->cm == NULL)
-        {
-          e->cm = new CurvMap;
-          memset(e->cm, 0, sizeof(CurvMap));
-          e->cm->toplevel = 1;
-          e->cm->order = 4;
-        }
-
-        int idx = -1;
-        for (unsigned j = 0; j < e->nvert; j++)
-          if (e->en[j] == en) { idx = j; break; }
-        assert(idx >= 0);
-
-        if (e->vn[idx]->id == p1)
-        {
-          e->cm->nurbs[idx] = nurbs;
-          nurbs->ref++;
-        }
-        else
-        {
-          Nurbs* nurbs_rev = mesh->reverse_nurbs(nurbs);
-          e->cm->nurbs[idx] = nurbs_rev;
-          nurbs_rev->ref++;
-        }
-      }
-      if (!nurbs->ref) delete nurbs;
+      assign_nurbs(mesh, en, nurbs, p1);
     }
   }
 
@@ -431,6 +459,275 @@ bool H2DReader::load_stream(std::istream &is, Mesh *mesh,
   return true;
 }
 
+//// native parser ///////////////////////////////////////////////////////////////////////////////
+
+// The lists of the mesh file, in the order in which they are processed.
+enum { H2D_VERTICES, H2D_ELEMENTS, H2D_BOUNDARIES, H2D_CURVES, H2D_REFINEMENTS, H2D_NUM_SECTIONS };
+static const char* section_names[H2D_NUM_SECTIONS] = { "vertices", "elements", "boundaries", "curves", "refinements" };
+
+// Returns an element or boundary marker as a string, integer markers are converted.
+static std::string marker_string(const H2DParser::Value& marker)
+{
+  if (marker.type == H2DParser::Value::STRING)
+    return marker.str;
+  std::ostringstream string_stream;
+  string_stream << marker.to_int();
+  return string_stream.str();
+}
+
+// Checks that the item is a list of 'n' items.
+static void check_list(const H2DParser::Value& item, unsigned n)
+{
+  if (item.type != H2DParser::Value::LIST || item.size != n)
+    throw std::runtime_error("a list of wrong length");
+}
+
+bool H2DReader::load_stream_native(std::istream &is, Mesh *mesh, const char *filename)
+{
+  mesh->free();
+  mesh->init();
+  mesh->nactive = 0;
+
+  // The lists are processed while they are being parsed, that is why they have to come
+  // in the order of the Python reader. Otherwise the Python reader is used.
+  H2DParser parser(is);
+  H2DParser::Value item;
+  std::string name;
+  int last = -1;
+  while (parser.next_assignment(name))
+  {
+    int section = 0;
+    while (section < H2D_NUM_SECTIONS && name != section_names[section]) section++;
+    if (section == H2D_NUM_SECTIONS)
+    {
+      parser.parse_variable(name);
+      continue;
+    }
+    bool in_order = (section == H2D_REFINEMENTS) ? (last == H2D_BOUNDARIES || last == H2D_CURVES) : (last == section - 1);
+    if (!in_order)
+      throw std::runtime_error("'" + name + "' out of order");
+    last = section;
+
+    int n = 0;
+    parser.begin_list();
+    while (parser.next_item(item))
+      load_item(mesh, section, n++, item, filename);
+
+    if (section == H2D_VERTICES)
+    {
+      if (n < 2) error("File %s: invalid number of vertices.", filename);
+      mesh->ntopvert = n;
+    }
+    else if (section == H2D_ELEMENTS)
+    {
+      if (n < 1) error("File %s: no elements defined.", filename);
+      mesh->nbase = n;
+    }
+    else if (section == H2D_CURVES)
+    {
+      // update refmap coeffs of curvilinear elements
+      Element* e;
+      for_all_elements(e, mesh)
+        if (e->cm != NULL)
+          e->cm->update_refmap_coeffs(e);
+    }
+  }
+  if (last < H2D_BOUNDARIES)
+    error("File %s: 'vertices', 'elements' or 'boundaries' missing.", filename);
+
+  mesh->ninitial = mesh->elements.get_num_items();
+  mesh->seq = g_mesh_seq++;
+  return true;
+}
+
+void H2DReader::load_item(Mesh *mesh, int section, int i, const H2DParser::Value& item, const char *filename)
+{
+  const H2DParser::Value* it = (item.type == H2DParser::Value::LIST && item.size > 0) ? &item.items[0] : NULL;
+  switch (section)
+  {
+    case H2D_VERTICES:
+    {
+      check_list(item, 2);
+      Node* node = mesh->nodes.add();
+      assert(node->id == i);
+      node->ref = TOP_LEVEL_REF;
+      node->type = HERMES_TYPE_VERTEX;
+      node->bnd = 0;
+      node->p1 = node->p2 = -1;
+      if (it[0].type != H2DParser::Value::NUMBER || it[1].type != H2DParser::Value::NUMBER)
+        throw std::runtime_error("a vertex coordinate not a number");
+      node->x = it[0].num;
+      node->y = it[1].num;
+      break;
+    }
+
+    case H2D_ELEMENTS:
+    {
+      if (item.type != H2DParser::Value::LIST) throw std::runtime_error("an element not a list");
+      int nv = item.size;
+      if (!nv) {
+        mesh->elements.skip_slot();
+        return;
+      }
+      if (nv < 4 || nv > 5)
+        error("File %s: element #%d: wrong number of vertex indices.", filename, i);
+
+      int idx[4];
+      for (int j = 0; j < nv-1; j++)
+      {
+        idx[j] = it[j].to_int();
+        if (idx[j] < 0 || idx[j] >= mesh->ntopvert)
+          error("File %s: error creating element #%d: vertex #%d does not exist.", filename, i, idx[j]);
+      }
+
+      // This functions check if the user-supplied marker on this element has been
+      // already used, and if not, inserts it in the appropriate structure.
+      std::string el_marker = marker_string(it[nv-1]);
+      mesh->element_markers_conversion.insert_marker(mesh->element_markers_conversion.min_marker_unused, el_marker);
+      int marker = mesh->element_markers_conversion.get_internal_marker(el_marker);
+
+      Node *v0 = &mesh->nodes[idx[0]], *v1 = &mesh->nodes[idx[1]], *v2 = &mesh->nodes[idx[2]];
+      if (nv == 4) {
+        check_triangle(i, v0, v1, v2);
+        create_triangle(mesh, marker, v0, v1, v2, NULL);
+      }
+      else {
+        Node *v3 = &mesh->nodes[idx[3]];
+        check_quad(i, v0, v1, v2, v3);
+        create_quad(mesh, marker, v0, v1, v2, v3, NULL);
+      }
+      mesh->nactive++;
+      break;
+    }
+
+    case H2D_BOUNDARIES:
+    {
+      check_list(item, 3);
+      int v1 = it[0].to_int(), v2 = it[1].to_int();
+      Node* en = mesh->peek_edge_node(v1, v2);
+      if (en == NULL)
+        error("File %s: boundary data #%d: edge %d-%d does not exist", filename, i, v1, v2);
+
+      std::string bnd_marker = marker_string(it[2]);
+      mesh->boundary_markers_conversion.insert_marker(mesh->boundary_markers_conversion.min_marker_unused, bnd_marker);
+      int marker = mesh->boundary_markers_conversion.get_internal_marker(bnd_marker);
+      en->marker = marker;
+
+      // Negative boundary markers are reserved for the inner edges in DG.
+      if (marker > 0)
+      {
+        mesh->nodes[v1].bnd = 1;
+        mesh->nodes[v2].bnd = 1;
+        en->bnd = 1;
+      }
+      break;
+    }
+
+    case H2D_CURVES:
+    {
+      Node* en;
+      int p1, p2;
+      Nurbs* nurbs = load_nurbs(mesh, item, i, &en, p1, p2);
+      assign_nurbs(mesh, en, nurbs, p1);
+      break;
+    }
+
+    case H2D_REFINEMENTS:
+      check_list(item, 2);
+      mesh->refine_element_id(it[0].to_int(), it[1].to_int());
+      break;
+  }
+}
+
+Nurbs* H2DReader::load_nurbs(Mesh *mesh, const H2DParser::Value& curve, int id, Node** en, int &p1, int &p2)
+{
+  if (curve.type != H2DParser::Value::LIST || (curve.size != 3 && curve.size != 5))
+    error("Invalid curve #%d.", id);
+  const H2DParser::Value* it = &curve.items[0];
+  bool circle = (curve.size == 3);
+  const H2DParser::Value* points = circle ? NULL : &it[3];
+  const H2DParser::Value* knots = circle ? NULL : &it[4];
+
+  // check the types before anything is allocated
+  if (circle)
+  {
+    if (it[2].type != H2DParser::Value::NUMBER) throw std::runtime_error("an arc angle not a number");
+  }
+  else
+  {
+    if (points->type != H2DParser::Value::LIST || knots->type != H2DParser::Value::LIST)
+      throw std::runtime_error("a curve with wrong control points or knots");
+    for (unsigned i = 0; i < points->size; i++)
+    {
+      check_list(points->items[i], 3);
+      for (int j = 0; j < 3; j++)
+        if (points->items[i].items[j].type != H2DParser::Value::NUMBER) throw std::runtime_error("a control point not a number");
+    }
+    for (unsigned i = 0; i < knots->size; i++)
+      if (knots->items[i].type != H2DParser::Value::NUMBER) throw std::runtime_error("a knot not a number");
+  }
+
+  // read the end point indices
+  p1 = it[0].to_int();
+  p2 = it[1].to_int();
+  *en = mesh->peek_edge_node(p1, p2);
+  if (*en == NULL)
+    error("Curve #%d: edge %d-%d does not exist.", id, p1, p2);
+
+  int degree = circle ? 2 : it[2].to_int();
+
+  Nurbs* nurbs = new Nurbs;
+  nurbs->arc = circle;
+  nurbs->degree = degree;
+
+  // edge endpoints are also control points, with weight 1.0
+  int inner = circle ? 1 : points->size;
+  nurbs->np = inner + 2;
+  nurbs->pt = new double3[nurbs->np];
+  nurbs->pt[0][0] = mesh->nodes[p1].x;
+  nurbs->pt[0][1] = mesh->nodes[p1].y;
+  nurbs->pt[0][2] = 1.0;
+  nurbs->pt[inner+1][0] = mesh->nodes[p2].x;
+  nurbs->pt[inner+1][1] = mesh->nodes[p2].y;
+  nurbs->pt[inner+1][2] = 1.0;
+
+  if (!circle)
+  {
+    // read inner control points
+    for (int i = 0; i < inner; i++)
+      for (int j = 0; j < 3; j++)
+        nurbs->pt[i+1][j] = points->items[i].items[j].num;
+  }
+  else
+  {
+    // generate one control point from the arc angle
+    nurbs->angle = it[2].num;
+    double a = (180.0 - nurbs->angle) / 180.0 * M_PI;
+    double x = 1.0 / tan(a * 0.5);
+    nurbs->pt[1][0] = 0.5*((nurbs->pt[2][0] + nurbs->pt[0][0]) + (nurbs->pt[2][1] - nurbs->pt[0][1]) * x);
+    nurbs->pt[1][1] = 0.5*((nurbs->pt[2][1] + nurbs->pt[0][1]) - (nurbs->pt[2][0] - nurbs->pt[0][0]) * x);
+    nurbs->pt[1][2] = cos((M_PI - a) * 0.5);
+  }
+
+  // knot vector is completed by 0.0 on the left and by 1.0 on the right
+  inner = circle ? 0 : knots->size;
+  nurbs->nk = nurbs->degree + nurbs->np + 1;
+  int outer = nurbs->nk - inner;
+  if ((outer & 1) == 1)
+    error("Curve #%d: incorrect number of knot points.", id);
+
+  nurbs->kv = new double[nurbs->nk];
+  for (int i = 0; i < outer/2; i++)
+    nurbs->kv[i] = 0.0;
+  for (int i = 0; i < inner; i++)
+    nurbs->kv[outer/2 + i] = knots->items[i].num;
+  for (int i = outer/2 + inner; i < nurbs->nk; i++)
+    nurbs->kv[i] = 1.0;
+
+  nurbs->ref = 0;
+  return nurbs;
+}
+
 //// save ////////////////////////////////////////////////////////////////////////////////////
 
 void H2DReader::save_refinements(Mesh *mesh, FILE* f, Element* e, int id, bool& first)
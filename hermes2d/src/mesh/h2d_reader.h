@@ -17,11 +17,16 @@
 #define _H2D_READER_H_
 
 #include "mesh_loader.h"
+#include "h2d_parser.h"
 #include "../../../hermes_common/python/python_api.h"
 
 
 /// Mesh loader from Hermes2D format
 ///
+/// The files are read by a native parser (see H2DParser) which creates the nodes and
+/// elements while the lists are being parsed. Files using Python features the native
+/// parser does not understand are read by the embedded Python interpreter.
+///
 /// @ingroup meshloaders
 class HERMES_API H2DReader : public MeshLoader
 {
@@ -35,9 +40,24 @@ public:
   void load_str(const char* mesh_str, Mesh *mesh);
   bool load_stream(std::istream &is, Mesh *mesh, const char *filename);
 
+  /// If set, the files are always read by the Python interpreter instead of the native parser.
+  void set_use_python(bool use_python) { this->use_python = use_python; }
+
 protected:
+  bool use_python;
+
+  bool load_stream_native(std::istream &is, Mesh *mesh, const char *filename);
+  bool load_stream_python(std::istream &is, Mesh *mesh, const char *filename);
+
+  /// Processes one item of the list 'section' (vertices, elements, ...) read by the native parser.
+  void load_item(Mesh *mesh, int section, int i, const H2DParser::Value& item, const char *filename);
+
   Nurbs* load_nurbs_old(Mesh *mesh, FILE* f, Node** en, int &p1, int &p2);
   Nurbs* load_nurbs(Mesh *mesh, Python &p, int id, Node** en, int &p1, int &p2);
+  Nurbs* load_nurbs(Mesh *mesh, const H2DParser::Value& curve, int id, Node** en, int &p1, int &p2);
+
+  /// Assigns the nurbs of the edge node 'en' starting at vertex p1 to the elements sharing the edge.
+  void assign_nurbs(Mesh *mesh, Node* en, Nurbs* nurbs, int p1);
 
   void save_refinements(Mesh *mesh, FILE* f, Element* e, int id, bool& first);
   void save_nurbs(Mesh *mesh, FILE* f, int p1, int p2, Nurbs* nurbs);
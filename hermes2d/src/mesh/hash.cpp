@@ -21,6 +21,7 @@
 HashTable::HashTable()
 {
   v_table = NULL; e_table = NULL;
+  v_count = e_count = 0;
   nqueries = ncollisions = 0;
 }
 
@@ -28,31 +29,18 @@ HashTable::HashTable()
 void HashTable::init(int size)
 {
   v_table = e_table = NULL;
+  v_count = e_count = 0;
   nqueries = ncollisions = 0;
 
   mask = size-1;
   if (size & mask) error("Parameter 'size' must be a power of two.");
 
   // allocate and initialize the hash tables
-  v_table = new Node*[size];
-  e_table = new Node*[size];
+  v_table = new Slot[size];
+  e_table = new Slot[size];
 
-  memset(v_table, 0, size * sizeof(Node*));
-  memset(e_table, 0, size * sizeof(Node*));
-
-  nqueries = ncollisions = 0;
-}
-
-
-void HashTable::copy_list(Node** ptr, Node* node)
-{
-  while (node != NULL)
-  {
-    *ptr = &nodes[node->id];
-    ptr = &((*ptr)->next_hash);
-    node = node->next_hash;
-  }
-  *ptr = NULL;
+  memset(v_table, 0xff, size * sizeof(Slot));
+  memset(e_table, 0xff, size * sizeof(Slot));
 }
 
 
@@ -61,40 +49,59 @@ void HashTable::copy(const HashTable* ht)
   free();
   nodes.copy(ht->nodes);
   mask = ht->mask;
-
-  v_table = new Node*[mask+1];
-  e_table = new Node*[mask+1];
-  for (int i = 0; i <= mask; i++)
-  {
-    copy_list(v_table + i, ht->v_table[i]);
-    copy_list(e_table + i, ht->e_table[i]);
-  }
+  v_count = ht->v_count;
+  e_count = ht->e_count;
+
+  // the slots only refer to node ids, so the tables are copied as they are
+  v_table = new Slot[mask+1];
+  e_table = new Slot[mask+1];
+  memcpy(v_table, ht->v_table, (mask+1) * sizeof(Slot));
+  memcpy(e_table, ht->e_table, (mask+1) * sizeof(Slot));
 }
 
 
 void HashTable::rebuild()
 {
-  memset(v_table, 0, (mask+1) * sizeof(Node*));
-  memset(e_table, 0, (mask+1) * sizeof(Node*));
-
+  // top-level vertex nodes have no parents and are never searched for
   Node* node;
+  int nv = 0, ne = 0;
   for_all_nodes(node, this)
+    if (node->p1 >= 0 && node->p2 >= 0)
+      (node->type == HERMES_TYPE_VERTEX) ? nv++ : ne++;
+
+  // keep the tables at most half full
+  int size = mask+1;
+  while (2 * std::max(nv, ne) > size) size *= 2;
+  if (size != mask+1)
   {
-    int p1 = node->p1, p2 = node->p2;
-    if (p1 > p2) std::swap(p1, p2);
-    int idx = hash(p1, p2);
-
-    if (node->type == HERMES_TYPE_VERTEX)
-    {
-      node->next_hash = v_table[idx];
-      v_table[idx] = node;
-    }
-    else
-    {
-      node->next_hash = e_table[idx];
-      e_table[idx] = node;
-    }
+    delete [] v_table;
+    delete [] e_table;
+    mask = size-1;
+    v_table = new Slot[size];
+    e_table = new Slot[size];
   }
+
+  memset(v_table, 0xff, size * sizeof(Slot));
+  memset(e_table, 0xff, size * sizeof(Slot));
+  v_count = nv;
+  e_count = ne;
+
+  for_all_nodes(node, this)
+    if (node->p1 >= 0 && node->p2 >= 0)
+      insert_slot((node->type == HERMES_TYPE_VERTEX) ? v_table : e_table, node);
+}
+
+
+void HashTable::rehash(int size)
+{
+  if (size & (size-1)) error("Parameter 'size' must be a power of two.");
+  if (v_table != NULL) delete [] v_table;
+  if (e_table != NULL) delete [] e_table;
+
+  mask = size-1;
+  v_table = new Slot[size];
+  e_table = new Slot[size];
+  rebuild();
 }
 
 
@@ -111,6 +118,7 @@ void HashTable::free()
     delete [] e_table;
     e_table = NULL;
   }
+  v_count = e_count = 0;
   dump_hash_stat();
 }
 
@@ -123,16 +131,60 @@ void HashTable::dump_hash_stat()
 }
 
 
-inline Node* HashTable::search_list(Node* node, int p1, int p2)
+inline int HashTable::find_slot(const Slot* table, int p1, int p2)
 {
   nqueries++;
-  while (node != NULL)
+  int i = hash(p1, p2);
+  while (table[i].id >= 0)
   {
-    if (node->p1 == p1 && node->p2 == p2) return node;
-    node = node->next_hash;
+    if (table[i].p1 == p1 && table[i].p2 == p2) break;
+    i = (i + 1) & mask;
     ncollisions++;
   }
-  return NULL;
+  return i;
+}
+
+
+void HashTable::insert_slot(Slot* table, Node* node)
+{
+  int p1 = node->p1, p2 = node->p2;
+  if (p1 > p2) std::swap(p1, p2);
+  int i = hash(p1, p2);
+  while (table[i].id >= 0)
+    i = (i + 1) & mask;
+  table[i].p1 = p1;
+  table[i].p2 = p2;
+  table[i].id = node->id;
+}
+
+
+bool HashTable::remove_slot(Slot* table, int id)
+{
+  int p1 = nodes[id].p1, p2 = nodes[id].p2;
+  if (p1 > p2) std::swap(p1, p2);
+  int i = hash(p1, p2);
+  while (table[i].id != id)
+  {
+    if (table[i].id < 0) return false;
+    i = (i + 1) & mask;
+  }
+
+  // Empty the slot and move back the following nodes of the cluster
+  // which would not be found anymore because of the hole.
+  table[i].id = -1;
+  int j = i;
+  while (true)
+  {
+    j = (j + 1) & mask;
+    if (table[j].id < 0) break;
+    // the node at j stays if its home slot k lies cyclically in (i, j]
+    int k = hash(table[j].p1, table[j].p2);
+    if (i <= j ? (i < k && k <= j) : (i < k || k <= j)) continue;
+    table[i] = table[j];
+    table[j].id = -1;
+    i = j;
+  }
+  return true;
 }
 
 
@@ -140,9 +192,8 @@ Node* HashTable::get_vertex_node(int p1, int p2)
 {
   // search for the node in the vertex hashtable
   if (p1 > p2) std::swap(p1, p2);
-  int i = hash(p1, p2);
-  Node* node = search_list(v_table[i], p1, p2);
-  if (node != NULL) return node;
+  int i = find_slot(v_table, p1, p2);
+  if (v_table[i].id >= 0) return &nodes[v_table[i].id];
 
   // not found - create a new one
   Node* newnode = nodes.add();
@@ -158,8 +209,15 @@ Node* HashTable::get_vertex_node(int p1, int p2)
   newnode->y = (nodes[p1].y + nodes[p2].y) * 0.5;
 
   // insert into hashtable
-  newnode->next_hash = v_table[i];
-  v_table[i] = newnode;
+  if (2 * (v_count + 1) > mask+1)
+    rehash(2 * (mask+1)); // the new node is inserted by the rehash
+  else
+  {
+    v_table[i].p1 = p1;
+    v_table[i].p2 = p2;
+    v_table[i].id = newnode->id;
+    v_count++;
+  }
 
   return newnode;
 }
@@ -168,9 +226,8 @@ Node* HashTable::get_edge_node(int p1, int p2)
 {
   // search for the node in the edge hashtable
   if (p1 > p2) std::swap(p1, p2);
-  int i = hash(p1, p2);
-  Node* node = search_list(e_table[i], p1, p2);
-  if (node != NULL) return node;
+  int i = find_slot(e_table, p1, p2);
+  if (e_table[i].id >= 0) return &nodes[e_table[i].id];
 
   // not found - create a new one
   Node* newnode = nodes.add();
@@ -185,8 +242,15 @@ Node* HashTable::get_edge_node(int p1, int p2)
   newnode->elem[0] = newnode->elem[1] = NULL;
 
   // insert into hashtable
-  newnode->next_hash = e_table[i];
-  e_table[i] = newnode;
+  if (2 * (e_count + 1) > mask+1)
+    rehash(2 * (mask+1)); // the new node is inserted by the rehash
+  else
+  {
+    e_table[i].p1 = p1;
+    e_table[i].p2 = p2;
+    e_table[i].id = newnode->id;
+    e_count++;
+  }
 
   return newnode;
 }
@@ -195,33 +259,23 @@ Node* HashTable::get_edge_node(int p1, int p2)
 Node* HashTable::peek_vertex_node(int p1, int p2)
 {
   if (p1 > p2) std::swap(p1, p2);
-  return search_list(v_table[hash(p1, p2)], p1, p2);
+  int i = find_slot(v_table, p1, p2);
+  return (v_table[i].id >= 0) ? &nodes[v_table[i].id] : NULL;
 }
 
 
 Node* HashTable::peek_edge_node(int p1, int p2)
 {
   if (p1 > p2) std::swap(p1, p2);
-  return search_list(e_table[hash(p1, p2)], p1, p2);
+  int i = find_slot(e_table, p1, p2);
+  return (e_table[i].id >= 0) ? &nodes[e_table[i].id] : NULL;
 }
 
 
 void HashTable::remove_vertex_node(int id)
 {
   // remove the node from the hash table
-  int i = hash(nodes[id].p1, nodes[id].p2);
-  Node** ptr = v_table + i;
-  Node* node = *ptr;
-  while (node != NULL)
-  {
-    if (node->id == id)
-    {
-      *ptr = node->next_hash;
-      break;
-    }
-    ptr = &node->next_hash;
-    node = *ptr;
-  }
+  if (remove_slot(v_table, id)) v_count--;
 
   // remove node from the array
   nodes.remove(id);
@@ -231,19 +285,7 @@ void HashTable::remove_vertex_node(int id)
 void HashTable::remove_edge_node(int id)
 {
   // remove the node from the hash table
-  int i = hash(nodes[id].p1, nodes[id].p2);
-  Node** ptr = e_table + i;
-  Node* node = *ptr;
-  while (node != NULL)
-  {
-    if (node->id == id)
-    {
-      *ptr = node->next_hash;
-      break;
-    }
-    ptr = &node->next_hash;
-    node = *ptr;
-  }
+  if (remove_slot(e_table, id)) e_count--;
 
   // remove node from the array
   nodes.remove(id);
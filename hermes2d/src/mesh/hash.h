@@ -26,6 +26,10 @@ struct Node;
 ///
 /// HashTable is a base class for Mesh. It serves as a container for all nodes
 /// of a mesh. Moreover, it has node searching functions based on hash tables.
+/// The vertex and edge node tables use open addressing with linear probing: each
+/// slot holds the parent ids of a node and its id, so that a search only scans
+/// consecutive memory. The tables grow automatically (by a bulk rehash of all
+/// nodes) when they become half full.
 ///
 class HERMES_API HashTable
 {
@@ -63,10 +67,11 @@ public:
 protected:
   Array<Node> nodes; ///< Array storing all nodes
 
-  static const int H2D_DEFAULT_HASH_SIZE = 0x20000; // 128K entries
+  static const int H2D_DEFAULT_HASH_SIZE = 0x4000; // 16K entries
 
   /// Initializes the hash table.
-  /// \param size [in] Hash table size; must be a power of two.
+  /// \param size [in] Initial hash table size; must be a power of two. The tables
+  /// grow when needed, a larger size only saves rehashing.
   void init(int size = H2D_DEFAULT_HASH_SIZE);
 
   /// Copies another hash table contents
@@ -75,6 +80,9 @@ protected:
   /// Reconstructs the hashtable, after, e.g., the nodes have been loaded from a file.
   void rebuild();
 
+  /// Resizes the hash tables to 'size' slots (a power of two) and reinserts all nodes.
+  void rehash(int size);
+
   /// Frees all memory used by the instance.
   void free();
 
@@ -91,20 +99,31 @@ protected:
 // Internal members
 private:
 
-  Node** v_table; ///< Vertex node hash table
-  Node** e_table; ///< Edge node hash table
+  /// Slot of a hash table: parent ids (p1 < p2) and id of the node, id == -1 for an empty slot.
+  struct Slot { int p1, p2, id; };
+
+  Slot* v_table; ///< Vertex node hash table
+  Slot* e_table; ///< Edge node hash table
 
   int mask;
+  int v_count, e_count; ///< Numbers of nodes in the tables
   int nqueries, ncollisions;
 
-  int hash(int p1, int p2) { return (984120265*p1 + 125965121*p2) & mask; }
+  int hash(int p1, int p2) const
+  {
+    unsigned int h = (unsigned int) p1 * 0x9e3779b1u ^ (unsigned int) p2 * 0x85ebca77u;
+    return (h ^ (h >> 16)) & mask;
+  }
+
+  /// Returns the index of the slot holding the node with parent ids p1 < p2,
+  /// or of the empty slot where such a node would be inserted.
+  int find_slot(const Slot* table, int p1, int p2);
 
-  /// Searches a list of hash synonyms given the first list item.
-  /// Returns the node matching the parent ids p1 and p2.
-  Node* search_list(Node* node, int p1, int p2);
+  /// Inserts a node into a table, the table must not contain the node.
+  void insert_slot(Slot* table, Node* node);
 
-  /// Creates a copy of a hash synonym list.
-  void copy_list(Node** ptr, Node* node);
+  /// Removes the node with the given id from a table, returns false if it was not there.
+  bool remove_slot(Slot* table, int id);
 
   friend struct Node;
   friend class H2DReader;
@@ -1033,7 +1033,6 @@ void Mesh::create(int nv, double2* verts, int nt, int4* tris,
     node->type = HERMES_TYPE_VERTEX;
     node->bnd = 0;
     node->p1 = node->p2 = -1;
-    node->next_hash = NULL;
     node->x = verts[i][0];
     node->y = verts[i][1];
   }
@@ -55,7 +55,6 @@ struct HERMES_API Node
   };
 
   int p1, p2; ///< parent id numbers
-  Node* next_hash; ///< next node in hash synonym list
 
   bool is_constrained_vertex() const { assert(type == HERMES_TYPE_VERTEX); return ref <= 3 && !bnd; }
 
@@ -22,6 +22,37 @@
 H1ShapesetJacobi ref_map_shapeset;
 PrecalcShapeset ref_map_pss(&ref_map_shapeset);
 
+// The tables of ref_map_pss can not be shared by several threads (e.g. in multithreaded
+// assembling), threads other than the one which initialized the library get their own copy.
+static pthread_t ref_map_pss_thread = pthread_self();
+static pthread_key_t ref_map_pss_key;
+static pthread_once_t ref_map_pss_key_once = PTHREAD_ONCE_INIT;
+
+static void delete_thread_ref_map_pss(void* pss)
+{
+  delete (PrecalcShapeset*) pss;
+}
+
+static void create_ref_map_pss_key()
+{
+  pthread_key_create(&ref_map_pss_key, delete_thread_ref_map_pss);
+}
+
+/// Returns ref_map_pss of the calling thread.
+static PrecalcShapeset& get_ref_map_pss()
+{
+  if (pthread_equal(pthread_self(), ref_map_pss_thread))
+    return ref_map_pss;
+  pthread_once(&ref_map_pss_key_once, create_ref_map_pss_key);
+  PrecalcShapeset* pss = (PrecalcShapeset*) pthread_getspecific(ref_map_pss_key);
+  if (pss == NULL) {
+    pss = new PrecalcShapeset(&ref_map_shapeset);
+    pss->set_quad_2d(&g_quad_2d_std);
+    pthread_setspecific(ref_map_pss_key, pss);
+  }
+  return *pss;
+}
+
 
 RefMap::RefMap()
 {
@@ -38,7 +69,8 @@ void RefMap::set_quad_2d(Quad2D* quad_2d)
 {
   free();
   this->quad_2d = quad_2d;
-  ref_map_pss.set_quad_2d(quad_2d);
+  PrecalcShapeset& pss = get_ref_map_pss();
+  pss.set_quad_2d(quad_2d);
 }
 
 
@@ -46,7 +78,10 @@ void RefMap::set_active_element(Element* e)
 {
   if (e != element) free();
 
-  ref_map_pss.set_active_element(e);
+  PrecalcShapeset& pss = get_ref_map_pss();
+  // The reference maps of the thread may use different quadratures.
+  pss.set_quad_2d(quad_2d);
+  pss.set_active_element(e);
   quad_2d->set_mode(e->get_mode());
   num_tables = quad_2d->get_num_tables();
   assert(num_tables <= H2D_MAX_TABLES);
@@ -128,13 +163,14 @@ void RefMap::calc_inv_ref_map(int order)
 
   double2x2* m = new double2x2[np];
   memset(m, 0, np * sizeof(double2x2));
-  ref_map_pss.force_transform(sub_idx, ctm);
+  PrecalcShapeset& pss = get_ref_map_pss();
+  pss.force_transform(sub_idx, ctm);
   for (i = 0; i < nc; i++)
   {
     double *dx, *dy;
-    ref_map_pss.set_active_shape(indices[i]);
-    ref_map_pss.set_quad_order(order);
-    ref_map_pss.get_dx_dy_values(dx, dy);
+    pss.set_active_shape(indices[i]);
+    pss.set_quad_order(order);
+    pss.get_dx_dy_values(dx, dy);
     for (j = 0; j < np; j++)
     {
       m[j][0][0] += coeffs[i][0] * dx[j];
@@ -175,15 +211,16 @@ void RefMap::calc_second_ref_map(int order)
 
   double3x2* k = new double3x2[np];
   memset(k, 0, np * sizeof(double3x2));
-  ref_map_pss.force_transform(sub_idx, ctm);
+  PrecalcShapeset& pss = get_ref_map_pss();
+  pss.force_transform(sub_idx, ctm);
   for (i = 0; i < nc; i++)
   {
     double *dxy, *dxx, *dyy;
-    ref_map_pss.set_active_shape(indices[i]);
-    ref_map_pss.set_quad_order(order, H2D_FN_ALL);
-    dxx = ref_map_pss.get_dxx_values();
-    dyy = ref_map_pss.get_dyy_values();
-    dxy = ref_map_pss.get_dxy_values();
+    pss.set_active_shape(indices[i]);
+    pss.set_quad_order(order, H2D_FN_ALL);
+    dxx = pss.get_dxx_values();
+    dyy = pss.get_dyy_values();
+    dxy = pss.get_dxy_values();
     for (j = 0; j < np; j++)
     {
       k[j][0][0] += coeffs[i][0] * dxx[j];
@@ -266,12 +303,13 @@ void RefMap::calc_phys_x(int order)
   int i, j, np = quad_2d->get_num_points(order);
   double* x = cur_node->phys_x[order] = new double[np];
   memset(x, 0, np * sizeof(double));
-  ref_map_pss.force_transform(sub_idx, ctm);
+  PrecalcShapeset& pss = get_ref_map_pss();
+  pss.force_transform(sub_idx, ctm);
   for (i = 0; i < nc; i++)
   {
-    ref_map_pss.set_active_shape(indices[i]);
-    ref_map_pss.set_quad_order(order);
-    double* fn = ref_map_pss.get_fn_values();
+    pss.set_active_shape(indices[i]);
+    pss.set_quad_order(order);
+    double* fn = pss.get_fn_values();
     for (j = 0; j < np; j++)
       x[j] += coeffs[i][0] * fn[j];
   }
@@ -284,12 +322,13 @@ void RefMap::calc_phys_y(int order)
   int i, j, np = quad_2d->get_num_points(order);
   double* y = cur_node->phys_y[order] = new double[np];
   memset(y, 0, np * sizeof(double));
-  ref_map_pss.force_transform(sub_idx, ctm);
+  PrecalcShapeset& pss = get_ref_map_pss();
+  pss.force_transform(sub_idx, ctm);
   for (i = 0; i < nc; i++)
   {
-    ref_map_pss.set_active_shape(indices[i]);
-    ref_map_pss.set_quad_order(order);
-    double* fn = ref_map_pss.get_fn_values();
+    pss.set_active_shape(indices[i]);
+    pss.set_quad_order(order);
+    double* fn = pss.get_fn_values();
     for (j = 0; j < np; j++)
       y[j] += coeffs[i][1] * fn[j];
   }
@@ -320,16 +359,17 @@ void RefMap::calc_tangent(int edge, int eo)
   else
   {
     // construct jacobi matrices of the direct reference map at integration points along the edge
-    static double2x2 m[15];
+    double2x2 m[15];
     assert(np <= 15);
     memset(m, 0, np*sizeof(double2x2));
-    ref_map_pss.force_transform(sub_idx, ctm);
+    PrecalcShapeset& pss = get_ref_map_pss();
+    pss.force_transform(sub_idx, ctm);
     for (i = 0; i < nc; i++)
     {
       double *dx, *dy;
-      ref_map_pss.set_active_shape(indices[i]);
-      ref_map_pss.set_quad_order(eo);
-      ref_map_pss.get_dx_dy_values(dx, dy);
+      pss.set_active_shape(indices[i]);
+      pss.set_quad_order(eo);
+      pss.get_dx_dy_values(dx, dy);
       for (j = 0; j < np; j++)
       {
         m[j][0][0] += coeffs[i][0] * dx[j];
@@ -434,34 +474,133 @@ void RefMap::inv_ref_map_at_point(double xi1, double xi2, double& x, double& y,
 
 void RefMap::untransform(Element* e, double x, double y, double& xi1, double& xi2)
 {
-  const double TOL = 1e-12;
+  untransform(e, 1, &x, &y, &xi1, &xi2);
+}
+
 
+void RefMap::untransform(Element* e, int n, const double* x, const double* y, double* xi1, double* xi2)
+{
   if (is_const)
   {
-    double dx = e->vn[0]->x - x;
-    double dy = e->vn[0]->y - y;
-    xi1 = -1.0 - (const_inv_ref_map[0][0] * dx + const_inv_ref_map[1][0] * dy);
-    xi2 = -1.0 - (const_inv_ref_map[0][1] * dx + const_inv_ref_map[1][1] * dy);
+    // affine map (a triangle or a parallelogram), inverted in closed form
+    double x0 = e->vn[0]->x, y0 = e->vn[0]->y;
+    double m00 = const_inv_ref_map[0][0], m01 = const_inv_ref_map[0][1];
+    double m10 = const_inv_ref_map[1][0], m11 = const_inv_ref_map[1][1];
+    for (int i = 0; i < n; i++)
+    {
+      double dx = x0 - x[i];
+      double dy = y0 - y[i];
+      xi1[i] = -1.0 - (m00 * dx + m10 * dy);
+      xi2[i] = -1.0 - (m01 * dx + m11 * dy);
+    }
   }
-  else // Newton Method
+  else
   {
-    double xi1_old = 0.0, xi2_old = 0.0;
-    double vx, vy;
-    double2x2 m;
-    int it = 0; // number of Newton iterations
-    while (1)
+    for (int first = 0; first < n; first += H2D_UNTRANSFORM_CHUNK)
+      untransform_newton(e, std::min(n - first, (int) H2D_UNTRANSFORM_CHUNK),
+                         x + first, y + first, xi1 + first, xi2 + first);
+  }
+}
+
+
+void RefMap::untransform_newton(Element* e, int n, const double* x, const double* y, double* xi1, double* xi2)
+{
+  const double TOL = 1e-12;
+
+  // points still iterating, their last approximations, the map and its jacobi matrix there
+  int act[H2D_UNTRANSFORM_CHUNK];
+  double xi1_old[H2D_UNTRANSFORM_CHUNK], xi2_old[H2D_UNTRANSFORM_CHUNK];
+  double vx[H2D_UNTRANSFORM_CHUNK], vy[H2D_UNTRANSFORM_CHUNK];
+  double2x2 tmp[H2D_UNTRANSFORM_CHUNK];
+  int na = n;
+  for (int k = 0; k < n; k++)
+  {
+    act[k] = k;
+    xi1_old[k] = xi2_old[k] = 0.0;
+  }
+
+  // a straight quad is mapped by x = a[0] + a[1] * xi1 + a[2] * xi2 + a[3] * xi1 * xi2
+  bool bilinear = (e->cm == NULL && e->is_quad());
+  double2 a[4];
+  if (bilinear)
+  {
+    for (int c = 0; c < 2; c++)
+    {
+      double v0 = c ? e->vn[0]->y : e->vn[0]->x, v1 = c ? e->vn[1]->y : e->vn[1]->x;
+      double v2 = c ? e->vn[2]->y : e->vn[2]->x, v3 = c ? e->vn[3]->y : e->vn[3]->x;
+      a[0][c] = 0.25 * ( v0 + v1 + v2 + v3);
+      a[1][c] = 0.25 * (-v0 + v1 + v2 - v3);
+      a[2][c] = 0.25 * (-v0 - v1 + v2 + v3);
+      a[3][c] = 0.25 * ( v0 - v1 + v2 - v3);
+    }
+  }
+
+  bool failed = false;
+  for (int it = 0; na > 0; it++)
+  {
+    if (bilinear)
+    {
+      for (int k = 0; k < na; k++)
+      {
+        int p = act[k];
+        double s = xi1_old[p], t = xi2_old[p];
+        vx[p] = a[0][0] + a[1][0] * s + a[2][0] * t + a[3][0] * s * t;
+        vy[p] = a[0][1] + a[1][1] * s + a[2][1] * t + a[3][1] * s * t;
+        tmp[p][0][0] = a[1][0] + a[3][0] * t;
+        tmp[p][0][1] = a[2][0] + a[3][0] * s;
+        tmp[p][1][0] = a[1][1] + a[3][1] * t;
+        tmp[p][1][1] = a[2][1] + a[3][1] * s;
+      }
+    }
+    else
+    {
+      // same sums as in inv_ref_map_at_point(), shape function by shape function
+      for (int k = 0; k < na; k++)
+      {
+        int p = act[k];
+        vx[p] = vy[p] = 0.0;
+        memset(tmp[p], 0, sizeof(double2x2));
+      }
+      for (int i = 0; i < nc; i++)
+      {
+        int index = indices[i];
+        double cx = coeffs[i][0], cy = coeffs[i][1];
+        for (int k = 0; k < na; k++)
+        {
+          int p = act[k];
+          double val = ref_map_shapeset.get_fn_value(index, xi1_old[p], xi2_old[p], 0);
+          double dx = ref_map_shapeset.get_dx_value(index, xi1_old[p], xi2_old[p], 0);
+          double dy = ref_map_shapeset.get_dy_value(index, xi1_old[p], xi2_old[p], 0);
+          vx[p] += cx * val;
+          vy[p] += cy * val;
+          tmp[p][0][0] += cx * dx;
+          tmp[p][0][1] += cx * dy;
+          tmp[p][1][0] += cy * dx;
+          tmp[p][1][1] += cy * dy;
+        }
+      }
+    }
+
+    // Newton steps, converged and diverging points are dropped
+    int nn = 0;
+    for (int k = 0; k < na; k++)
     {
-      inv_ref_map_at_point(xi1_old, xi2_old, vx, vy, m);
-      xi1 = xi1_old - (m[0][0] * (vx - x) + m[1][0] * (vy - y));
-      xi2 = xi2_old - (m[0][1] * (vx - x) + m[1][1] * (vy - y));
-      if (fabs(xi1 - xi1_old) < TOL && fabs(xi2 - xi2_old) < TOL) return;
-      if (it > 1 && (xi1 > 1.5 || xi2 > 1.5 || xi1 < -1.5 || xi2 < -1.5)) return;
-      if (it > 100) { warn("Could not find reference coordinates - Newton method did not converge."); return; }
-      xi1_old = xi1;
-      xi2_old = xi2;
-      it++;
+      int p = act[k];
+      double jac = tmp[p][0][0] * tmp[p][1][1] - tmp[p][0][1] * tmp[p][1][0];
+      double m00 =  tmp[p][1][1] / jac, m01 = -tmp[p][1][0] / jac;
+      double m10 = -tmp[p][0][1] / jac, m11 =  tmp[p][0][0] / jac;
+      xi1[p] = xi1_old[p] - (m00 * (vx[p] - x[p]) + m10 * (vy[p] - y[p]));
+      xi2[p] = xi2_old[p] - (m01 * (vx[p] - x[p]) + m11 * (vy[p] - y[p]));
+      if (fabs(xi1[p] - xi1_old[p]) < TOL && fabs(xi2[p] - xi2_old[p]) < TOL) continue;
+      if (it > 1 && (xi1[p] > 1.5 || xi2[p] > 1.5 || xi1[p] < -1.5 || xi2[p] < -1.5)) continue;
+      if (it > 100) { failed = true; continue; }
+      xi1_old[p] = xi1[p];
+      xi2_old[p] = xi2[p];
+      act[nn++] = p;
     }
+    na = nn;
   }
+  if (failed) warn("Could not find reference coordinates - Newton method did not converge.");
 }
 
 void RefMap::init_node(Node* pp)
@@ -137,6 +137,13 @@ public:
   /// If the point (x, y) does not lie in e, then (xi1, xi2) will not lie in the reference domain.
   void untransform(Element* e, double x, double y, double& xi1, double& xi2);
 
+  /// Transforms n physical points (x[i], y[i]) from the element e to the reference domain,
+  /// the results are stored in xi1[i], xi2[i]. The reference map has to be active on e.
+  /// Elements with a constant jacobian are inverted in closed form. Straight quadrilaterals
+  /// and curved elements are inverted by Newton iterations performed for all points at once,
+  /// the bilinear map of a straight quadrilateral is evaluated without the shapeset.
+  void untransform(Element* e, int n, const double* x, const double* y, double* xi1, double* xi2);
+
   /// Calculates the inverse Jacobi matrix of reference map at a particular point (xi1, xi2).
   void inv_ref_map_at_point(double xi1, double xi2, double& x, double& y, double2x2& m);
 
@@ -223,6 +230,13 @@ protected:
   /// matrix alone. This is added to the total integration order in weak form itegrals.
   int calc_inv_ref_order();
 
+  /// Maximum number of points in the Newton iterations of untransform(), larger batches
+  /// are split into chunks of this size.
+  static const int H2D_UNTRANSFORM_CHUNK = 64;
+
+  /// Newton iterations of untransform() for at most H2D_UNTRANSFORM_CHUNK points.
+  void untransform_newton(Element* e, int n, const double* x, const double* y, double* xi1, double* xi2);
+
 
   void init_node(Node* pp);
   void free_node(Node* node);
@@ -1,16 +1,17 @@
 #include "hermes2d.h"
 
-NeighborSearch::NeighborSearch(Element* el, Mesh* mesh) :
+// Definition of the in-class constant, std::max() in reset_neighb_info() binds a reference to it.
+const unsigned int NeighborSearch::max_n_trans;
+
+NeighborSearch::NeighborSearch(Element* el, Mesh* mesh, NeighborTable* table) :
   supported_shapes(NULL),
   mesh(mesh),
+  table(table),
   central_el(el),
   neighb_el(NULL),
   quad(&g_quad_2d_std)
 {
-  memset(central_transformations, 0, max_neighbors*max_n_trans*sizeof(unsigned int));
-  memset(neighbor_transformations, 0, max_neighbors*max_n_trans*sizeof(unsigned int));
-  memset(central_n_trans, 0, max_neighbors*sizeof(unsigned int));
-  memset(neighbor_n_trans, 0, max_neighbors*sizeof(unsigned int));
+  alloc_transformations();
 
   assert_msg(central_el != NULL && central_el->active == 1,
              "You must pass an active element to the NeighborSearch constructor.");
@@ -26,16 +27,14 @@ NeighborSearch::NeighborSearch(Element* el, Mesh* mesh) :
 NeighborSearch::NeighborSearch(const NeighborSearch& ns) :
   supported_shapes(NULL),
   mesh(ns.mesh),
+  table(ns.table),
   central_el(ns.central_el),
   neighb_el(NULL),
   neighbor_edge(ns.neighbor_edge),
   active_segment(ns.active_segment)
 {
   _F_
-  memset(central_transformations, 0, max_neighbors*max_n_trans*sizeof(unsigned int));
-  memset(neighbor_transformations, 0, max_neighbors*max_n_trans*sizeof(unsigned int));
-  memset(central_n_trans, 0, max_neighbors*sizeof(unsigned int));
-  memset(neighbor_n_trans, 0, max_neighbors*sizeof(unsigned int));
+  alloc_transformations();
 
   neighbors.reserve(2);
   neighbor_edges.reserve(2);
@@ -76,6 +75,21 @@ NeighborSearch::~NeighborSearch()
   neighbor_edges.clear();
   neighbors.clear();
   clear_supported_shapes();
+  ::free(central_transformations);
+}
+
+void NeighborSearch::alloc_transformations()
+{
+  _F_
+  // One block for all four arrays. It is large, but calloc gets it as zeroed pages from the system
+  // and only the first few rows are ever touched.
+  size_t rows = max_neighbors * max_n_trans * sizeof(unsigned int);
+  char* data = (char*) calloc(2 * rows + 2 * max_neighbors * sizeof(unsigned int), 1);
+  if (data == NULL) error("Not enough memory in NeighborSearch.");
+  central_transformations = (unsigned int (*)[max_n_trans]) data;
+  neighbor_transformations = (unsigned int (*)[max_n_trans]) (data + rows);
+  central_n_trans = (unsigned int*) (data + 2 * rows);
+  neighbor_n_trans = central_n_trans + max_neighbors;
 }
 
 void NeighborSearch::reset_neighb_info()
@@ -90,13 +104,15 @@ void NeighborSearch::reset_neighb_info()
   // Clear vectors with neighbor elements and their edge info for the active edge.
   neighbor_edges.clear();
   neighbors.clear();
-  n_neighbors = 0;
 
-  // Reset transformations.
-  memset(central_transformations, 0, max_neighbors*max_n_trans*sizeof(unsigned int));
-  memset(neighbor_transformations, 0, max_neighbors*max_n_trans*sizeof(unsigned int));
-  memset(central_n_trans, 0, max_neighbors*sizeof(unsigned int));
-  memset(neighbor_n_trans, 0, max_neighbors*sizeof(unsigned int));
+  // Reset transformations. Only the rows of the neighbors can be nonzero (rows of deleted neighbors
+  // are cleared by delete_neighbor), handle_sub_idx_way_down() may also touch the first max_n_trans rows.
+  unsigned int rows = std::max(n_neighbors, max_n_trans);
+  memset(central_transformations, 0, rows*max_n_trans*sizeof(unsigned int));
+  memset(neighbor_transformations, 0, rows*max_n_trans*sizeof(unsigned int));
+  memset(central_n_trans, 0, rows*sizeof(unsigned int));
+  memset(neighbor_n_trans, 0, rows*sizeof(unsigned int));
+  n_neighbors = 0;
   neighborhood_type = H2D_DG_NOT_INITIALIZED;
 }
 
@@ -106,6 +122,14 @@ void NeighborSearch::set_active_edge(int edge)
   reset_neighb_info();
   active_edge = edge;
 
+  // Copy the neighborhood found when the table was built.
+  if (table != NULL)
+  {
+    if (!table->get_neighborhood(this, edge) && !ignore_errors)
+      error("The given edge isn't inner");
+    return;
+  }
+
   //debug_log("central element: %d", central_el->id);
   if (central_el->en[active_edge]->bnd == 0)
   {
@@ -714,10 +738,10 @@ int NeighborSearch::get_quad_eo(bool on_neighbor)
     return central_quad.eo;
 }
 
-DiscontinuousFunc<scalar>* NeighborSearch::init_ext_fn(MeshFunction* fu)
+DiscontinuousFunc<scalar>* NeighborSearch::init_ext_fn(MeshFunction* fu, Arena* arena)
 {
   _F_
-  Func<scalar>* fn_central = init_fn(fu, get_quad_eo(false));
+  Func<scalar>* fn_central = init_fn(fu, get_quad_eo(false), arena);
 
   uint64_t original_transform = fu->get_transform();
 
@@ -727,12 +751,15 @@ DiscontinuousFunc<scalar>* NeighborSearch::init_ext_fn(MeshFunction* fu)
   for(unsigned int i = 0; i < neighbor_n_trans[active_segment]; i++)
     fu->push_transform(neighbor_transformations[active_segment][i]);
 
-  Func<scalar>* fn_neighbor = init_fn(fu, get_quad_eo(true));
+  Func<scalar>* fn_neighbor = init_fn(fu, get_quad_eo(true), arena);
 
   // Restore the original function.
   fu->set_active_element(central_el);
   fu->set_transform(original_transform);
 
+  if (arena != NULL)
+    return new (arena->allocate(sizeof(DiscontinuousFunc<scalar>)))
+      DiscontinuousFunc<scalar>(fn_central, fn_neighbor, (neighbor_edge.orientation == 1));
   return new DiscontinuousFunc<scalar>(fn_central, fn_neighbor, (neighbor_edge.orientation == 1));
 
   //NOTE: This function is not very efficient, since it sets the active elements and possibly pushes transformations
@@ -786,3 +813,80 @@ void NeighborSearch::ExtendedShapeset::combine_assembly_lists()
   memcpy(dof, central_al->dof, sizeof(int)*central_al->cnt);
   memcpy(dof + central_al->cnt, neighbor_al->dof, sizeof(int)*neighbor_al->cnt);
 }
+
+
+
+/*** ______________________________________________ NEIGHBOR TABLE _______________________________________________ ***/
+
+
+NeighborTable::NeighborTable(Mesh* mesh) : mesh(mesh), seq(mesh->get_seq())
+{
+  _F_
+  first_edge.resize(mesh->get_max_element_id(), -1);
+  edges.reserve(4 * mesh->get_num_active_elements());
+  neighbors.reserve(4 * mesh->get_num_active_elements());
+
+  Element* e;
+  for_all_active_elements(e, mesh)
+  {
+    first_edge[e->id] = edges.size();
+    NeighborSearch ns(e, mesh);
+    ns.set_ignore_errors(true);
+    for (unsigned int i = 0; i < e->nvert; i++)
+    {
+      ns.set_active_edge(i);
+
+      Edge edge;
+      edge.type = ns.neighborhood_type;
+      edge.neighb_el_id = (ns.neighb_el != NULL) ? ns.neighb_el->id : -1;
+      edge.neighbor_edge = ns.neighbor_edge;
+      edge.first = neighbors.size();
+      edge.count = ns.n_neighbors;
+      edges.push_back(edge);
+
+      for (unsigned int j = 0; j < ns.n_neighbors; j++)
+      {
+        Neighbor n;
+        n.id = ns.neighbors[j]->id;
+        n.edge = ns.neighbor_edges[j];
+        n.central_n_trans = ns.central_n_trans[j];
+        n.neighbor_n_trans = ns.neighbor_n_trans[j];
+        for (unsigned int k = 0; k < NeighborSearch::max_n_trans; k++)
+        {
+          n.central_transformations[k] = ns.central_transformations[j][k];
+          n.neighbor_transformations[k] = ns.neighbor_transformations[j][k];
+        }
+        neighbors.push_back(n);
+      }
+    }
+  }
+  verbose("Neighbor table of mesh %d: %d edges, %d neighbors.", seq, (int) edges.size(), (int) neighbors.size());
+}
+
+bool NeighborTable::get_neighborhood(NeighborSearch* ns, int edge) const
+{
+  _F_
+  const Edge& ed = edges[get_edge_index(ns->central_el, edge)];
+  if (ed.type == NeighborSearch::H2D_DG_NOT_INITIALIZED)
+    return false;
+
+  // The elements are taken from the mesh of the NeighborSearch, which may be a copy of the table's mesh.
+  ns->neighborhood_type = (NeighborSearch::NeighborhoodType) ed.type;
+  ns->neighb_el = (ed.neighb_el_id >= 0) ? ns->mesh->get_element_fast(ed.neighb_el_id) : NULL;
+  ns->neighbor_edge = ed.neighbor_edge;
+  ns->n_neighbors = ed.count;
+  for (int j = 0; j < ed.count; j++)
+  {
+    const Neighbor& n = neighbors[ed.first + j];
+    ns->neighbors.push_back(ns->mesh->get_element_fast(n.id));
+    ns->neighbor_edges.push_back(n.edge);
+    ns->central_n_trans[j] = n.central_n_trans;
+    ns->neighbor_n_trans[j] = n.neighbor_n_trans;
+    for (unsigned int k = 0; k < NeighborSearch::max_n_trans; k++)
+    {
+      ns->central_transformations[j][k] = n.central_transformations[k];
+      ns->neighbor_transformations[j][k] = n.neighbor_transformations[k];
+    }
+  }
+  return true;
+}
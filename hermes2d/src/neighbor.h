@@ -8,6 +8,8 @@
 #include "function/forms.h"
 #include "mesh/refmap.h"
 
+class NeighborTable;
+
 /*** Class NeighborSearch. ***/
 
 /*!\class NeighborSearch neighbor.h "src/neighbor.h"
@@ -68,8 +70,9 @@ public:
   ///
   /// \param[in]  el    Central element of the neighborhood (current active element in the assembling procedure).
   /// \param[in]  mesh  Mesh on which we search for the neighbors.
+  /// \param[in]  table If given, the neighbors are taken from this table of the mesh instead of being searched for.
   ///
-  NeighborSearch(Element* el, Mesh* mesh);
+  NeighborSearch(Element* el, Mesh* mesh, NeighborTable* table = NULL);
   NeighborSearch(const NeighborSearch& ns);
 
 /*** Methods for changing active state for further calculations. ***/
@@ -128,9 +131,10 @@ public:
   /// Assumes that integration order has been set by \c set_quad_order.
   ///
   /// \param[in] fu MeshFunction whose values are requested.
+  /// \param[in] arena If given, the function and its values are allocated there (see init_fn).
   /// \return Pointer to a discontinuous function allowing to access the values from each side of the active edge.
   ///
-  DiscontinuousFunc<scalar>* init_ext_fn(MeshFunction* fu);
+  DiscontinuousFunc<scalar>* init_ext_fn(MeshFunction* fu, Arena* arena = NULL);
 
 /*** Methods for working with shape functions. ***/
 
@@ -226,6 +230,7 @@ public:
 private:
 
   Mesh* mesh;
+  NeighborTable* table;  ///< Precomputed neighbors of the edges of the mesh, or NULL.
 
 /*** Transformations. ***/
 
@@ -236,12 +241,18 @@ private:
   /// and it is used for the allocation of the arrays NeighborSearch::transformations and NeighborSearch::n_trans.
   static const unsigned int max_neighbors = 1 << max_n_trans;
 
-  unsigned int central_transformations[max_neighbors][max_n_trans]; ///< Vector of transformations of the central element to each neighbor
-                                                                    ///< (in a go-down neighborhood; stored row-wise for each neighbor).
-  unsigned int central_n_trans[max_neighbors];                      ///< Number of transforms stored in each row of \c central_transformations.
+  // The arrays below have max_neighbors rows and are allocated at once by alloc_transformations(). Only the rows
+  // of the current neighbors are used, all the rows after them are kept zero, so that only the used rows have to
+  // be cleared when a new edge is set as active (see reset_neighb_info).
+  unsigned int (*central_transformations)[max_n_trans];  ///< Vector of transformations of the central element to each neighbor
+                                                         ///< (in a go-down neighborhood; stored row-wise for each neighbor).
+  unsigned int* central_n_trans;                         ///< Number of transforms stored in each row of \c central_transformations.
   
-  unsigned int neighbor_transformations[max_neighbors][max_n_trans];///< Vector of transformations of the neighbor to the central element (go-up).
-  unsigned int neighbor_n_trans[max_neighbors];                     ///< Number of transforms stored in each row of \c neighbor_transformations.
+  unsigned int (*neighbor_transformations)[max_n_trans]; ///< Vector of transformations of the neighbor to the central element (go-up).
+  unsigned int* neighbor_n_trans;                        ///< Number of transforms stored in each row of \c neighbor_transformations.
+
+  /// Allocates the (zeroed) arrays of transformations.
+  void alloc_transformations();
   
   uint64_t original_central_el_transform;                           ///< Sub-element transformation of any function that comes from the
                                                                     ///< assembly, before transforms from \c transformations are pushed
@@ -423,6 +434,83 @@ public:
   friend class DiscreteProblem;
   friend class KellyTypeAdapt;
   friend class DiscontinuityDetector;
+  friend class NeighborTable;
+};
+
+
+/*** Class NeighborTable. ***/
+
+/*!\class NeighborTable neighbor.h "src/neighbor.h"
+ * \brief Neighborhoods of all edges of the active elements of a mesh.
+ *
+ * For every inner edge of every active element, the table holds what \c NeighborSearch::set_active_edge finds:
+ * the neighbor elements, the local numbers and orientations of the edge on their side and the transformations
+ * of the central element and of the neighbors. The table is built once for a state of the mesh. NeighborSearches
+ * created with the table then copy the neighborhood of their active edge from it, instead of walking up and down
+ * the refinement tree again for every assembled state.
+ *
+ * Elements are stored by their ids, the table is therefore valid for the mesh and for its copies as long as the
+ * sequence number of the mesh (\c Mesh::get_seq) does not change, i.e. until the mesh is refined.
+ */
+
+class HERMES_API NeighborTable
+{
+public:
+
+  /// Builds the table for the current state of the mesh.
+  NeighborTable(Mesh* mesh);
+
+  /// Returns true if the table was built for the current state of the mesh.
+  bool is_up_to_date(Mesh* mesh) const { return mesh == this->mesh && mesh->get_seq() == seq; }
+
+  /// Returns the number of neighbors across an edge of an active element, zero for a boundary edge.
+  int get_num_neighbors(Element* e, int edge) const { return edges[get_edge_index(e, edge)].count; }
+
+  /// Returns the i-th neighbor across an edge of an active element.
+  Element* get_neighbor(Element* e, int edge, int i) const
+  {
+    return mesh->get_element_fast(neighbors[edges[get_edge_index(e, edge)].first + i].id);
+  }
+
+protected:
+
+  /// A neighbor across an edge, see NeighborSearch::neighbors.
+  struct Neighbor
+  {
+    int id;                                        ///< Id of the neighbor element.
+    NeighborSearch::NeighborEdgeInfo edge;         ///< The edge seen from the neighbor.
+    unsigned char central_n_trans, neighbor_n_trans;
+    unsigned char central_transformations[NeighborSearch::max_n_trans];
+    unsigned char neighbor_transformations[NeighborSearch::max_n_trans];
+  };
+
+  /// The neighborhood of an edge of an element.
+  struct Edge
+  {
+    int type;                                      ///< NeighborSearch::NeighborhoodType, not initialized for a boundary edge.
+    int neighb_el_id;                              ///< Id of NeighborSearch::neighb_el after the search, or -1.
+    NeighborSearch::NeighborEdgeInfo neighbor_edge;///< NeighborSearch::neighbor_edge after the search.
+    int first, count;                              ///< Neighbors of the edge in NeighborTable::neighbors.
+  };
+
+  Mesh* mesh;
+  unsigned seq;
+  std::vector<int> first_edge;                     ///< Index of the first edge of an element in NeighborTable::edges, by element id.
+  std::vector<Edge> edges;
+  std::vector<Neighbor> neighbors;
+
+  int get_edge_index(Element* e, int edge) const
+  {
+    if (e->id >= (int) first_edge.size() || first_edge[e->id] < 0)
+      error("Element %d is not an active element of the mesh of the neighbor table.", e->id);
+    return first_edge[e->id] + edge;
+  }
+
+  /// Copies the neighborhood of an edge of the central element to ns, as if it was found by set_active_edge().
+  /// Returns false for a boundary edge.
+  bool get_neighborhood(NeighborSearch* ns, int edge) const;
+
+  friend class NeighborSearch;
 };
 
 #endif /* NEIGHBOR_H_ */
@@ -18,6 +18,8 @@ void OGProjection::project_internal(Hermes::vector<Space *> spaces, WeakForm* wf
   bool is_linear = true;
   DiscreteProblem* dp = new DiscreteProblem(wf, spaces, is_linear);
 
+  // Projection matrices are symmetric positive definite, unless custom forms are used.
+  matrix_solver = wf->select_matrix_solver(matrix_solver);
   SparseMatrix* matrix = create_matrix(matrix_solver);
   Vector* rhs = create_vector(matrix_solver);
   Solver* solver = create_linear_solver(matrix_solver, matrix, rhs);
@@ -64,7 +64,7 @@ protected:
   class ProjectionMatrixVolForm : public WeakForm::MatrixFormVol
   {
   public:
-    ProjectionMatrixVolForm(int i, int j, ProjNormType projNormType) : WeakForm::MatrixFormVol(i, j)
+    ProjectionMatrixVolForm(int i, int j, ProjNormType projNormType) : WeakForm::MatrixFormVol(i, j, HERMES_SYM)
     {
       this->adapt_eval = false;
       this->projNormType = projNormType;
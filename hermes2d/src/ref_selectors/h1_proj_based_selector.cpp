@@ -13,6 +13,12 @@ namespace RefinementSelectors {
   H1ProjBasedSelector::H1ProjBasedSelector(CandList cand_list, double conv_exp, int max_order, H1Shapeset* user_shapeset)
     : ProjBasedSelector(cand_list, conv_exp, max_order, user_shapeset == NULL ? &default_shapeset : user_shapeset, Range<int>(1,1), Range<int>(2, H2DRS_MAX_H1_ORDER)) {}
 
+  Selector* H1ProjBasedSelector::clone() const {
+    H1ProjBasedSelector* copy = new H1ProjBasedSelector(cand_list, conv_exp, max_order, static_cast<H1Shapeset*>(shapeset));
+    copy->copy_settings(this);
+    return copy;
+  }
+
   void H1ProjBasedSelector::set_current_order_range(Element* element) {
     current_max_order = this->max_order;
     int max_element_order = (20 - element->iro_cache)/2 - 1;
@@ -16,6 +16,12 @@ namespace RefinementSelectors {
     : ProjBasedSelector(cand_list, conv_exp, max_order, user_shapeset == NULL ? &default_shapeset : user_shapeset, Range<int>(), Range<int>(0, H2DRS_MAX_HCURL_ORDER))
     , precalc_rvals_curl(NULL) {}
 
+  Selector* HcurlProjBasedSelector::clone() const {
+    HcurlProjBasedSelector* copy = new HcurlProjBasedSelector(cand_list, conv_exp, max_order, static_cast<HcurlShapeset*>(shapeset));
+    copy->copy_settings(this);
+    return copy;
+  }
+
   HcurlProjBasedSelector::~HcurlProjBasedSelector() {
     delete[] precalc_rvals_curl;
   }
@@ -40,6 +40,8 @@ namespace RefinementSelectors {
     virtual ~HcurlProjBasedSelector();
 
   protected: //overloads
+    virtual Selector* clone() const; ///< Creates a new selector with the same settings.
+
     /// A function expansion of a function f used by this selector.
     enum LocalFuncExpansion {
       H2D_HCFE_VALUE0 = 0, ///< A function expansion: f_0.
@@ -13,6 +13,12 @@ namespace RefinementSelectors {
   L2ProjBasedSelector::L2ProjBasedSelector(CandList cand_list, double conv_exp, int max_order, L2Shapeset* user_shapeset)
     : ProjBasedSelector(cand_list, conv_exp, max_order, user_shapeset == NULL ? &default_shapeset : user_shapeset, Range<int>(1,1), Range<int>(0, H2DRS_MAX_L2_ORDER)) {}
 
+  Selector* L2ProjBasedSelector::clone() const {
+    L2ProjBasedSelector* copy = new L2ProjBasedSelector(cand_list, conv_exp, max_order, static_cast<L2Shapeset*>(shapeset));
+    copy->copy_settings(this);
+    return copy;
+  }
+
   void L2ProjBasedSelector::set_current_order_range(Element* element) {
     current_max_order = this->max_order;
     if (current_max_order == H2DRS_DEFAULT_ORDER)
@@ -622,6 +622,7 @@ namespace RefinementSelectors {
     case H2D_APPLY_CONV_EXP_DOF: opt_apply_exp_dof = enable; break;
     default: error("Unknown option %d.", (int)option);
     }
+    free_thread_copies();
   }
 
 }
@@ -49,6 +49,41 @@ namespace RefinementSelectors {
     error_weight_h = weight_h;
     error_weight_p = weight_p;
     error_weight_aniso = weight_aniso;
+    free_thread_copies();
+  }
+
+  void ProjBasedSelector::copy_settings(const ProjBasedSelector* other) {
+    opt_symmetric_mesh = other->opt_symmetric_mesh;
+    opt_apply_exp_dof = other->opt_apply_exp_dof;
+    error_weight_h = other->error_weight_h;
+    error_weight_p = other->error_weight_p;
+    error_weight_aniso = other->error_weight_aniso;
+    warn_uniform_orders = other->warn_uniform_orders;
+
+    //take over precalculated values of shape functions and projection matrices
+    for(int m = 0; m < H2D_NUM_MODES; m++) {
+      if (other->cached_shape_vals_valid[m]) {
+        for(int i = 0; i < H2D_TRF_NUM; i++) {
+          const std::vector<TrfShapeExp>& other_svals = other->cached_shape_vals[m][i];
+          const std::vector<TrfShapeExp>& other_ortho_svals = other->cached_shape_ortho_vals[m][i];
+          cached_shape_vals[m][i].resize(other_svals.size());
+          for(unsigned int k = 0; k < other_svals.size(); k++)
+            cached_shape_vals[m][i][k].copy(other_svals[k]);
+          cached_shape_ortho_vals[m][i].resize(other_ortho_svals.size());
+          for(unsigned int k = 0; k < other_ortho_svals.size(); k++)
+            cached_shape_ortho_vals[m][i][k].copy(other_ortho_svals[k]);
+        }
+        cached_shape_vals_valid[m] = true;
+      }
+
+      for(int i = 0; i < H2DRS_MAX_ORDER+1; i++)
+        for(int k = 0; k < H2DRS_MAX_ORDER+1; k++)
+          if (other->proj_matrix_cache[m][i][k] != NULL && proj_matrix_cache[m][i][k] == NULL) {
+            int num_shapes = calc_num_shapes(m, i, k, H2DST_VERTEX | H2DST_HORIZ_EDGE | H2DST_VERT_EDGE | H2DST_TRI_EDGE | H2DST_BUBBLE);
+            proj_matrix_cache[m][i][k] = new_matrix<double>(num_shapes, num_shapes);
+            copy_matrix(proj_matrix_cache[m][i][k], other->proj_matrix_cache[m][i][k], num_shapes, num_shapes);
+          }
+    }
   }
 
   void ProjBasedSelector::evaluate_cands_error(Element* e, Solution* rsln, double* avg_error, double* dev_error) {
@@ -108,6 +108,16 @@ namespace RefinementSelectors {
       /** \return True if the instance is empty, i.e., the method allocate() was not called yet. */
       inline bool empty() { return values == NULL; };
 
+      /// Copies values of another expansion.
+      void copy(const TrfShapeExp& other) {
+        delete[] values; values = NULL;
+        num_expansion = num_gip = 0;
+        if (other.values != NULL) {
+          allocate(other.num_expansion, other.num_gip);
+          memcpy(values[0], other.values[0], sizeof(double) * num_expansion * num_gip);
+        }
+      };
+
       /// Assignment operator. Prevent unauthorized copying of the pointer.
       /** This method prevents a user from copying allocated internal structures
        *  because C++ does not support garbage collection. */
@@ -173,6 +183,11 @@ namespace RefinementSelectors {
      *  \param[in] edge_bubble_order A range of orders for edge and bubble functions. Use an empty range (i.e. Range<int>()) to skip edge and bubble functions. */
     ProjBasedSelector(CandList cand_list, double conv_exp, int max_order, Shapeset* shapeset, const Range<int>& vertex_order, const Range<int>& edge_bubble_order);
 
+    /// Copies options and error weights of another selector and takes over its caches. Used by clone() of derived classes.
+    /** The precalculated values of shape functions and the projection matrices are copied,
+     *  so that a copy of a selector used by another thread does not need to calculate them again. */
+    void copy_settings(const ProjBasedSelector* other);
+
   protected: //internal logic
     /// True if the selector has already warned about possible inefficiency.
     /** If OptimumSelector::cand_list does not generate candidates with elements of
@@ -1,9 +1,36 @@
+#include <typeinfo>
 #include "../h2d_common.h"
 #include "../function/solution.h"
 #include "../mesh/element_to_refine.h"
 #include "selector.h"
 
 namespace RefinementSelectors {
+  Selector::~Selector() {
+    free_thread_copies();
+  }
+
+  Selector* Selector::get_thread_copy(int thread_index) {
+    assert_msg(thread_index > 0, "The first thread uses the selector itself.");
+    if (thread_index >= (int)thread_copies.size())
+      thread_copies.resize(thread_index + 1, NULL);
+    if (thread_copies[thread_index] == NULL) {
+      Selector* copy = clone();
+      //a derived class which does not implement clone() gets a copy of its parent
+      if (copy != NULL && typeid(*copy) != typeid(*this)) {
+        delete copy;
+        copy = NULL;
+      }
+      thread_copies[thread_index] = copy;
+    }
+    return thread_copies[thread_index];
+  }
+
+  void Selector::free_thread_copies() {
+    for(unsigned int i = 0; i < thread_copies.size(); i++)
+      delete thread_copies[i];
+    thread_copies.clear();
+  }
+
 
   bool HOnlySelector::select_refinement(Element* element, int quad_order, Solution* rsln, ElementToRefine& refinement) {
     refinement.split = H2D_REFINEMENT_H;
@@ -21,12 +48,20 @@ namespace RefinementSelectors {
         tgt_quad_orders[i] = orig_quad_order;
   }
 
+  Selector* HOnlySelector::clone() const {
+    return new HOnlySelector();
+  }
+
   POnlySelector::POnlySelector(int max_order, int order_h_inc, int order_v_inc)
   : Selector(max_order), order_h_inc(order_h_inc), order_v_inc(order_v_inc) {
     error_if(order_h_inc >= 0, "Horizontal increase has to be greater or equal to zero.");
     error_if(order_v_inc >= 0, "Vertical increase has to be greater or equal to zero.");
   }
 
+  Selector* POnlySelector::clone() const {
+    return new POnlySelector(max_order, order_h_inc, order_v_inc);
+  }
+
   bool POnlySelector::select_refinement(Element* element, int quad_order, Solution* rsln, ElementToRefine& refinement) {
     refinement.split = H2D_REFINEMENT_P;
 
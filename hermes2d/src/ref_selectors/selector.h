@@ -16,6 +16,7 @@
 #ifndef __H2D_REFINEMENT_SELECTOR_H
 #define __H2D_REFINEMENT_SELECTOR_H
 
+#include <vector>
 #ifndef _MSC_VER
 #include "../mesh/refinement_type.h"
 
@@ -71,7 +72,7 @@ namespace RefinementSelectors {
     /** \param[in] max_order A maximum order used by this selector. If it is ::H2DRS_DEFAULT_ORDER, a maximum supported order is used. */
     Selector(int max_order = H2DRS_DEFAULT_ORDER) : max_order(max_order) {};
     /// Destructor.
-    virtual ~Selector() {};
+    virtual ~Selector();
 
     /// Selects a refinement.
     /** This methods has to be implemented.
@@ -89,6 +90,24 @@ namespace RefinementSelectors {
      *  \param[out] tgt_quad_orders Generated encoded orders.
      *  \param[in] suggested_quad_orders Suggested encoded orders. If not NULL, the method should copy them to the output. If NULL, the method have to calculate orders. */
     virtual void generate_shared_mesh_orders(const Element* element, const int orig_quad_order, const int refinement, int tgt_quad_orders[H2D_MAX_ELEMENT_SONS], const int* suggested_quad_orders) = 0;
+
+    /// Returns a copy of the selector used by a thread of a multithreaded selection of refinements.
+    /** The first thread of Adapt::adapt() uses the selector itself, the other threads use copies created
+     *  by clone(). The copies are kept by the selector, so their caches are reused in the next adaptivity steps.
+     *  \param[in] thread_index An index of the thread. It has to be greater than zero.
+     *  \return A copy of the selector. NULL if the selector cannot be copied. */
+    Selector* get_thread_copy(int thread_index);
+
+  protected:
+    /// Creates a new selector with the same settings.
+    /** A selector which supports multithreaded selection has to implement this method.
+     *  \return A new instance. NULL if the selector cannot be copied, then refinements are selected serially. */
+    virtual Selector* clone() const { return NULL; };
+
+    /// Deletes copies created by get_thread_copy(). Has to be called if settings of the selector change.
+    void free_thread_copies();
+
+    std::vector<Selector*> thread_copies; ///< Copies used by threads. The index is an index of the thread.
   };
 
   /// A selector that selects H-refinements only. \ingroup g_selectors
@@ -105,6 +124,9 @@ namespace RefinementSelectors {
     /** If a parameter suggested_quad_orders is NULL, the method uses an encoded order in orig_quad_order.
      *  For details, see Selector::generate_shared_mesh_orders. */
     virtual void generate_shared_mesh_orders(const Element* element, const int orig_quad_order, const int refinement, int tgt_quad_orders[H2D_MAX_ELEMENT_SONS], const int* suggested_quad_orders);
+
+  protected:
+    virtual Selector* clone() const; ///< Creates a new selector with the same settings.
   };
 
   /// A selector that increases order (i.e., it selects P-refinements only). \ingroup g_selectors
@@ -126,6 +148,9 @@ namespace RefinementSelectors {
     /** If a parameter suggested_quad_orders is NULL, the method uses an encoded order in orig_quad_order.
      *  For details, see Selector::generate_shared_mesh_orders. */
     virtual void generate_shared_mesh_orders(const Element* element, const int orig_quad_order, const int refinement, int tgt_quad_orders[H2D_MAX_ELEMENT_SONS], const int* suggested_quad_orders);
+
+  protected:
+    virtual Selector* clone() const; ///< Creates a new selector with the same settings.
   };
 }
 
@@ -17,8 +17,10 @@
 #include "hermes2d.h"
 
 RungeKutta::RungeKutta(DiscreteProblem* dp, ButcherTable* bt, MatrixSolverType matrix_solver, bool start_from_zero_K_vector, bool residual_as_vector) 
-    : dp(dp), is_linear(dp->get_is_linear()), bt(bt), num_stages(bt->get_size()), stage_wf_right(bt->get_size() * dp->get_spaces().size()), 
-    stage_wf_left(dp->get_spaces().size()), start_from_zero_K_vector(start_from_zero_K_vector), residual_as_vector(residual_as_vector), iteration(0) 
+    : block_assembly(false), block_wf_right(dp->get_spaces().size()), block_dp_left(NULL), block_dp_right(NULL), block_structure_changed(true),
+    stage_structure_changed(true), mass_seq(0), jacobian_seq(0), stage_coeff(0.0), stage_mass_seq(-1), stage_jacobian_seq(-1),
+    dp(dp), is_linear(dp->get_is_linear()), bt(bt), num_stages(bt->get_size()), stage_wf_right(bt->get_size() * dp->get_spaces().size()), 
+    stage_wf_left(dp->get_spaces().size()), start_from_zero_K_vector(start_from_zero_K_vector), residual_as_vector(residual_as_vector), iteration(0)
 {
   // Check for not implemented features.
   if (matrix_solver != SOLVER_UMFPACK)
@@ -26,6 +28,7 @@ RungeKutta::RungeKutta(DiscreteProblem* dp, ButcherTable* bt, MatrixSolverType m
   
   // Create matrix solver.
   solver = create_linear_solver(matrix_solver, &matrix_right, &vector_right);
+  stage_solver = create_linear_solver(matrix_solver, &matrix_stage, &vector_stage);
 
   // Vector K_vector of length num_stages * ndof. will represent
   // the 'K_i' vectors in the usual R-K notation.
@@ -36,14 +39,21 @@ RungeKutta::RungeKutta(DiscreteProblem* dp, ButcherTable* bt, MatrixSolverType m
 
   // Vector for the left part of the residual.
   vector_left = new scalar[num_stages*  dp->get_num_dofs()];
+
+  // Newton's increment of K_vector if the stages are solved one by one.
+  stage_increment = new scalar[num_stages * dp->get_num_dofs()];
 }
 
 RungeKutta::~RungeKutta()
 {
   delete solver;
+  delete stage_solver;
+  delete block_dp_left;
+  delete block_dp_right;
   delete [] K_vector;
   delete [] u_ext_vec;
   delete [] vector_left;
+  delete [] stage_increment;
 }
 
 void RungeKutta::multiply_as_diagonal_block_matrix(UMFPackMatrix* matrix, int num_blocks,
@@ -55,6 +65,16 @@ void RungeKutta::multiply_as_diagonal_block_matrix(UMFPackMatrix* matrix, int nu
   }
 }
 
+void RungeKutta::set_block_assembly(bool block_assembly)
+{
+  this->block_assembly = block_assembly;
+
+  // The matrices may have been used by the other mode in the meantime.
+  block_sp_seq.clear();
+  block_structure_changed = true;
+  stage_structure_changed = true;
+}
+
 bool RungeKutta::rk_time_step(double current_time, double time_step, Solution* sln_time_prev, Solution* sln_time_new, 
                               Solution* error_fn, bool jacobian_changed, bool verbose, double newton_tol, int newton_max_iter,
                               double newton_damping_coeff, double newton_max_allowed_residual_norm)
@@ -84,9 +104,11 @@ bool RungeKutta::rk_time_step(double current_time, double time_step, Hermes::vec
   
   // Create spaces for stage solutions K_i. This is necessary
   // to define a num_stages x num_stages block weak formulation.
-  for (unsigned int i = 0; i < num_stages; i++)
-    for(unsigned int space_i = 0; space_i < dp->get_spaces().size(); space_i++)
-      stage_spaces_vector.push_back(dp->get_space(space_i)->dup(dp->get_space(space_i)->get_mesh()));
+  // The block assembly mode works with the original spaces only.
+  if (!block_assembly)
+    for (unsigned int i = 0; i < num_stages; i++)
+      for(unsigned int space_i = 0; space_i < dp->get_spaces().size(); space_i++)
+        stage_spaces_vector.push_back(dp->get_space(space_i)->dup(dp->get_space(space_i)->get_mesh()));
 
   int ndof = dp->get_num_dofs();
 
@@ -95,8 +117,12 @@ bool RungeKutta::rk_time_step(double current_time, double time_step, Hermes::vec
   scalar* slns_prev_time_projection = new scalar[ndof];
   OGProjection::project_global(dp->get_spaces(), slns_time_prev, slns_prev_time_projection, SOLVER_UMFPACK);
 
-  // Creates the stage weak formulation.
-  create_stage_wf(dp->get_spaces().size(), current_time, time_step);
+  // Creates the stage weak formulation. In the block assembly mode, the single-stage
+  // weak formulation does not depend on the time step and is created only once.
+  if (!block_assembly)
+    create_stage_wf(dp->get_spaces().size(), current_time, time_step);
+  else if (block_dp_right == NULL)
+    create_block_stage_wf(dp->get_spaces().size());
   
   // The tensor discrete problem is created in two parts. First, matrix_left is the Jacobian 
   // matrix of the term coming from the left-hand side of the RK formula k_i = f(...). This is 
@@ -105,8 +131,13 @@ bool RungeKutta::rk_time_step(double current_time, double time_step, Hermes::vec
   // matrix and residula vector coming from the function f(...). Of course the RK equation is assumed
   // in a form suitable for the Newton's method: k_i - f(...) = 0. At the end, matrix_left and vector_left
   // are added to matrix_right and vector_right, respectively.
-  DiscreteProblem stage_dp_left(&stage_wf_left, dp->get_spaces());
-  DiscreteProblem stage_dp_right(&stage_wf_right, stage_spaces_vector);
+  // In the block assembly mode, block_dp_left and block_dp_right are used instead.
+  DiscreteProblem* stage_dp_left = NULL;
+  DiscreteProblem* stage_dp_right = NULL;
+  if (!block_assembly) {
+    stage_dp_left = new DiscreteProblem(&stage_wf_left, dp->get_spaces());
+    stage_dp_right = new DiscreteProblem(&stage_wf_right, stage_spaces_vector);
+  }
 
   // Prepare residuals of stage solutions.
   Hermes::vector<Solution*> residuals_vector;
@@ -128,8 +159,25 @@ bool RungeKutta::rk_time_step(double current_time, double time_step, Hermes::vec
   // Assemble the block-diagonal mass matrix M of size ndof times ndof.
   // The corresponding part of the global residual vector is obtained 
   // just by multiplication with the stage vector K.
-  // FIXME: This should not be repeated if spaces have not changed.
-  stage_dp_left.assemble(&matrix_left, NULL);
+  if (!block_assembly)
+    stage_dp_left->assemble(&matrix_left, NULL);
+  else {
+    // M and the structure of the stage system are only rebuilt when the spaces change.
+    bool spaces_changed = (block_sp_seq.size() != dp->get_spaces().size());
+    for (unsigned int i = 0; i < dp->get_spaces().size() && !spaces_changed; i++)
+      if (block_sp_seq[i] != dp->get_space(i)->get_seq()) 
+        spaces_changed = true;
+    if (spaces_changed) {
+      block_sp_seq.clear();
+      for (unsigned int i = 0; i < dp->get_spaces().size(); i++)
+        block_sp_seq.push_back(dp->get_space(i)->get_seq());
+      block_dp_left->assemble(&matrix_left, NULL);
+      mass_seq++;
+      vector_right.alloc(num_stages * ndof);
+      block_structure_changed = true;
+      stage_structure_changed = true;
+    }
+  }
 
   // The Newton's loop.
   double residual_norm;
@@ -146,10 +194,22 @@ bool RungeKutta::rk_time_step(double current_time, double time_step, Hermes::vec
     // can be added later.
     bool force_diagonal_blocks = true;
     bool add_dir_lift = true;
-    stage_dp_right.assemble(u_ext_vec, NULL, &vector_right, force_diagonal_blocks, add_dir_lift);
+    if (!block_assembly) {
+      stage_dp_right->assemble(u_ext_vec, NULL, &vector_right, force_diagonal_blocks, add_dir_lift);
   
-    // Finalizing the residual vector.
-    vector_right.add_vector(vector_left);
+      // Finalizing the residual vector.
+      vector_right.add_vector(vector_left);
+    }
+    else {
+      // The stationary residual of each stage, evaluated at the stage time
+      // and at the stage solution.
+      for (unsigned int i = 0; i < num_stages; i++) {
+        set_block_stage_time(current_time + bt->get_C(i)*time_step);
+        block_dp_right->assemble(u_ext_vec + i*ndof, NULL, &vector_single, false, add_dir_lift);
+        for (int idx = 0; idx < ndof; idx++)
+          vector_right.set(i*ndof + idx, vector_left[i*ndof + idx] - vector_single.get(idx));
+      }
+    }
 
     // Multiply the residual vector with -1 since the matrix
     // equation reads J(Y^n) \deltaY^{n+1} = -F(Y^n).
@@ -161,7 +221,21 @@ bool RungeKutta::rk_time_step(double current_time, double time_step, Hermes::vec
       residual_norm = hermes2d.get_l2_norm(&vector_right);
     else {
       // Translate residual vector into residual functions.
-      Solution::vector_to_solutions(&vector_right, stage_dp_right.get_spaces(), residuals_vector, add_dir_lift);
+      if (!block_assembly)
+        Solution::vector_to_solutions(&vector_right, stage_dp_right->get_spaces(), residuals_vector, add_dir_lift);
+      else {
+        // Stage by stage, as the stages share the spaces.
+        for (unsigned int i = 0; i < num_stages; i++) {
+          Hermes::vector<Solution*> stage_residuals;
+          Hermes::vector<bool> stage_add_dir_lift;
+          for(unsigned int sln_i = 0; sln_i < dp->get_spaces().size(); sln_i++) {
+            stage_residuals.push_back(residuals_vector[i * dp->get_spaces().size() + sln_i]);
+            stage_add_dir_lift.push_back(false);
+          }
+          Solution::vector_to_solutions(vector_right.get_c_array() + i*ndof, dp->get_spaces(), 
+                                        stage_residuals, stage_add_dir_lift);
+        }
+      }
       residual_norm = hermes2d.calc_norms(residuals_vector);
     }
 
@@ -178,6 +252,8 @@ bool RungeKutta::rk_time_step(double current_time, double time_step, Hermes::vec
         info("Maximum allowed residual norm: %g", newton_max_allowed_residual_norm);
         info("Newton solve not successful, returning false.");
       }
+      delete stage_dp_left;
+      delete stage_dp_right;
       return false;
     }
 
@@ -188,11 +264,49 @@ bool RungeKutta::rk_time_step(double current_time, double time_step, Hermes::vec
     }
 
     bool rhs_only = (!jacobian_changed && it > 1);
-    if (!rhs_only) {
+
+    // With explicit and diagonally implicit tables the stage Jacobian is block lower 
+    // triangular and the stages are solved one after another.
+    bool forward_substitution = (block_assembly && bt->is_diagonally_implicit());
+    if (forward_substitution) {
+      solve_stages_forward(current_time, time_step, rhs_only, jacobian_changed);
+
+      // Add \deltaK^{n+1} to K^n.
+      for (unsigned int i = 0; i < num_stages*ndof; i++)
+        K_vector[i] += newton_damping_coeff * stage_increment[i];
+
+      // Increase iteration counter.
+      it++;
+      continue;
+    }
+
+    if (!rhs_only && block_assembly) {
+      // The Jacobian of the stationary residual is assembled once per stage and 
+      // its multiples are stamped into the blocks (i, j) with a_ij != 0.
+      for (unsigned int i = 0; i < num_stages; i++) {
+        set_block_stage_time(current_time + bt->get_C(i)*time_step);
+        block_dp_right->assemble(u_ext_vec + i*ndof, &matrix_single, NULL, false, add_dir_lift);
+        jacobian_seq++;
+        if (i == 0) {
+          if (block_structure_changed)
+            create_block_structure();
+          else
+            matrix_right.zero();
+        }
+        for (unsigned int j = 0; j < num_stages; j++)
+          if (bt->get_A(i, j) != 0.0)
+            matrix_right.add_as_block(i*ndof, j*ndof, &matrix_single, -time_step * bt->get_A(i, j));
+      }
+
+      // Adding the block mass matrix M to matrix_right. This completes the 
+      // resulting tensor Jacobian.
+      matrix_right.add_to_diagonal_blocks(num_stages, &matrix_left);
+    }
+    else if (!rhs_only) {
       // Assemble the block Jacobian matrix of the stationary residual F
       // Diagonal blocks are created even if empty, so that matrix_left
       // can be added later.
-      stage_dp_right.assemble(u_ext_vec, &matrix_right, NULL, force_diagonal_blocks, add_dir_lift);
+      stage_dp_right->assemble(u_ext_vec, &matrix_right, NULL, force_diagonal_blocks, add_dir_lift);
 
       // Adding the block mass matrix M to matrix_right. This completes the 
       // resulting tensor Jacobian.
@@ -215,6 +329,8 @@ bool RungeKutta::rk_time_step(double current_time, double time_step, Hermes::vec
   if (it >= newton_max_iter) {
     if (verbose) 
       info("Maximum allowed number of Newton iterations exceeded, returning false.");
+    delete stage_dp_left;
+    delete stage_dp_right;
     return false;
   }
 
@@ -247,8 +363,13 @@ bool RungeKutta::rk_time_step(double current_time, double time_step, Hermes::vec
   }
 
   // Delete stage spaces.
-  for (unsigned int i = 0; i < num_stages; i++) 
-    delete stage_spaces_vector[i];
+  if (!block_assembly)
+    for (unsigned int i = 0; i < num_stages; i++) 
+      delete stage_spaces_vector[i];
+
+  // Delete the stage discrete problems.
+  delete stage_dp_left;
+  delete stage_dp_right;
 
   // Delete all residuals.
   for (unsigned int i = 0; i < num_stages; i++) 
@@ -293,28 +414,7 @@ void RungeKutta::create_stage_wf(unsigned int size, double current_time, double
   stage_wf_right.delete_all();
 
   // First let's do the mass matrix (only one block ndof times ndof).
-  for(unsigned int component_i = 0; component_i < size; component_i++) {
-    if(dp->get_spaces()[component_i]->get_type() == HERMES_H1_SPACE || dp->get_spaces()[component_i]->get_type() == HERMES_L2_SPACE) {
-      MatrixFormVolL2* proj_form = new MatrixFormVolL2(component_i, component_i);
-      proj_form->area = HERMES_ANY;
-      proj_form->scaling_factor = 1.0;
-      proj_form->u_ext_offset = 0;
-      proj_form->adapt_eval = false;
-      proj_form->adapt_order_increase = -1;
-      proj_form->adapt_rel_error_tol = -1;
-      stage_wf_left.add_matrix_form(proj_form);
-    }
-    if(dp->get_spaces()[component_i]->get_type() == HERMES_HDIV_SPACE || dp->get_spaces()[component_i]->get_type() == HERMES_HCURL_SPACE) {
-      MatrixFormVolHCurl* proj_form = new MatrixFormVolHCurl(component_i, component_i);
-      proj_form->area = HERMES_ANY;
-      proj_form->scaling_factor = 1.0;
-      proj_form->u_ext_offset = 0;
-      proj_form->adapt_eval = false;
-      proj_form->adapt_order_increase = -1;
-      proj_form->adapt_rel_error_tol = -1;
-      stage_wf_left.add_matrix_form(proj_form);
-    }
-  }
+  create_stage_wf_left(size);
 
   // In the rest we will take the stationary jacobian and residual forms 
   // (right-hand side) and use them to create a block Jacobian matrix of
@@ -441,6 +541,231 @@ void RungeKutta::create_stage_wf(unsigned int size, double current_time, double
   }
 }
 
+void RungeKutta::create_stage_wf_left(unsigned int size) 
+{
+  for(unsigned int component_i = 0; component_i < size; component_i++) {
+    if(dp->get_spaces()[component_i]->get_type() == HERMES_H1_SPACE || dp->get_spaces()[component_i]->get_type() == HERMES_L2_SPACE) {
+      MatrixFormVolL2* proj_form = new MatrixFormVolL2(component_i, component_i);
+      proj_form->area = HERMES_ANY;
+      proj_form->scaling_factor = 1.0;
+      proj_form->u_ext_offset = 0;
+      proj_form->adapt_eval = false;
+      proj_form->adapt_order_increase = -1;
+      proj_form->adapt_rel_error_tol = -1;
+      stage_wf_left.add_matrix_form(proj_form);
+    }
+    if(dp->get_spaces()[component_i]->get_type() == HERMES_HDIV_SPACE || dp->get_spaces()[component_i]->get_type() == HERMES_HCURL_SPACE) {
+      MatrixFormVolHCurl* proj_form = new MatrixFormVolHCurl(component_i, component_i);
+      proj_form->area = HERMES_ANY;
+      proj_form->scaling_factor = 1.0;
+      proj_form->u_ext_offset = 0;
+      proj_form->adapt_eval = false;
+      proj_form->adapt_order_increase = -1;
+      proj_form->adapt_rel_error_tol = -1;
+      stage_wf_left.add_matrix_form(proj_form);
+    }
+  }
+}
+
+void RungeKutta::create_block_stage_wf(unsigned int size) 
+{
+  // Clear the WeakForms.
+  stage_wf_left.delete_all();
+  block_wf_right.delete_all();
+
+  // The mass matrix, the same as in create_stage_wf().
+  create_stage_wf_left(size);
+
+  // The single-stage weak formulation consists of the original forms. Scaling 
+  // by the Butcher's table is done when the blocks are stamped into the stage 
+  // Jacobian, the sign of the residual when it is combined with M.
+  WeakForm* wf = dp->get_weak_formulation();
+  Hermes::vector<WeakForm::MatrixFormVol *> mfvol_base = wf->get_mfvol();
+  Hermes::vector<WeakForm::MatrixFormSurf *> mfsurf_base = wf->get_mfsurf();
+  Hermes::vector<WeakForm::VectorFormVol *> vfvol_base = wf->get_vfvol();
+  Hermes::vector<WeakForm::VectorFormSurf *> vfsurf_base = wf->get_vfsurf();
+
+  for (unsigned int m = 0; m < mfvol_base.size(); m++) {
+    WeakForm::MatrixFormVol* mfv = mfvol_base[m]->clone();
+    mfv->scaling_factor = 1.0;
+    mfv->u_ext_offset = 0;
+    mfv->adapt_eval = false;
+    mfv->adapt_order_increase = -1;
+    mfv->adapt_rel_error_tol = -1;
+    block_wf_right.add_matrix_form(mfv);
+  }
+  for (unsigned int m = 0; m < mfsurf_base.size(); m++) {
+    WeakForm::MatrixFormSurf* mfs = mfsurf_base[m]->clone();
+    mfs->scaling_factor = 1.0;
+    mfs->u_ext_offset = 0;
+    mfs->adapt_eval = false;
+    mfs->adapt_order_increase = -1;
+    mfs->adapt_rel_error_tol = -1;
+    block_wf_right.add_matrix_form_surf(mfs);
+  }
+  for (unsigned int m = 0; m < vfvol_base.size(); m++) {
+    WeakForm::VectorFormVol* vfv = vfvol_base[m]->clone();
+    vfv->scaling_factor = 1.0;
+    vfv->u_ext_offset = 0;
+    vfv->adapt_eval = false;
+    vfv->adapt_order_increase = -1;
+    vfv->adapt_rel_error_tol = -1;
+    block_wf_right.add_vector_form(vfv);
+  }
+  for (unsigned int m = 0; m < vfsurf_base.size(); m++) {
+    WeakForm::VectorFormSurf* vfs = vfsurf_base[m]->clone();
+    vfs->scaling_factor = 1.0;
+    vfs->u_ext_offset = 0;
+    vfs->adapt_eval = false;
+    vfs->adapt_order_increase = -1;
+    vfs->adapt_rel_error_tol = -1;
+    block_wf_right.add_vector_form_surf(vfs);
+  }
+
+  delete block_dp_left;
+  delete block_dp_right;
+  block_dp_left = new DiscreteProblem(&stage_wf_left, dp->get_spaces());
+  block_dp_right = new DiscreteProblem(&block_wf_right, dp->get_spaces());
+  block_sp_seq.clear();
+}
+
+void RungeKutta::set_block_stage_time(double stage_time) 
+{
+  Hermes::vector<WeakForm::MatrixFormVol *> mfvol = block_wf_right.get_mfvol();
+  Hermes::vector<WeakForm::MatrixFormSurf *> mfsurf = block_wf_right.get_mfsurf();
+  Hermes::vector<WeakForm::VectorFormVol *> vfvol = block_wf_right.get_vfvol();
+  Hermes::vector<WeakForm::VectorFormSurf *> vfsurf = block_wf_right.get_vfsurf();
+  for (unsigned int m = 0; m < mfvol.size(); m++)
+    mfvol[m]->set_current_stage_time(stage_time);
+  for (unsigned int m = 0; m < mfsurf.size(); m++)
+    mfsurf[m]->set_current_stage_time(stage_time);
+  for (unsigned int m = 0; m < vfvol.size(); m++)
+    vfvol[m]->set_current_stage_time(stage_time);
+  for (unsigned int m = 0; m < vfsurf.size(); m++)
+    vfsurf[m]->set_current_stage_time(stage_time);
+}
+
+void RungeKutta::create_block_structure() 
+{
+  int ndof = matrix_left.get_size();
+  if (matrix_single.get_size() != (unsigned int) ndof)
+    error("Incompatible block sizes in RungeKutta::create_block_structure().");
+
+  SparsityPattern pattern;
+  pattern.prealloc(num_stages * ndof);
+  for (unsigned int i = 0; i < num_stages; i++) {
+    for (unsigned int j = 0; j < num_stages; j++) {
+      if (i == j) {
+        for (int col = 0; col < ndof; col++)
+          for (int k = matrix_left.get_Ap()[col]; k < matrix_left.get_Ap()[col + 1]; k++)
+            pattern.pre_add_ij(i*ndof + matrix_left.get_Ai()[k], j*ndof + col);
+      }
+      if (bt->get_A(i, j) != 0.0) {
+        for (int col = 0; col < ndof; col++)
+          for (int k = matrix_single.get_Ap()[col]; k < matrix_single.get_Ap()[col + 1]; k++)
+            pattern.pre_add_ij(i*ndof + matrix_single.get_Ai()[k], j*ndof + col);
+      }
+    }
+  }
+  pattern.finish();
+
+  matrix_right.free();
+  matrix_right.alloc_from_pattern(&pattern);
+  block_structure_changed = false;
+}
+
+void RungeKutta::create_stage_structure() 
+{
+  int ndof = matrix_left.get_size();
+  if (matrix_single.get_size() != (unsigned int) ndof)
+    error("Incompatible block sizes in RungeKutta::create_stage_structure().");
+
+  SparsityPattern pattern;
+  pattern.prealloc(ndof);
+  for (int col = 0; col < ndof; col++) {
+    for (int k = matrix_left.get_Ap()[col]; k < matrix_left.get_Ap()[col + 1]; k++)
+      pattern.pre_add_ij(matrix_left.get_Ai()[k], col);
+    for (int k = matrix_single.get_Ap()[col]; k < matrix_single.get_Ap()[col + 1]; k++)
+      pattern.pre_add_ij(matrix_single.get_Ai()[k], col);
+  }
+  pattern.finish();
+
+  matrix_stage.free();
+  matrix_stage.alloc_from_pattern(&pattern);
+  stage_structure_changed = false;
+  stage_mass_seq = stage_jacobian_seq = -1;
+  stage_solver->set_factorization_scheme(HERMES_FACTORIZE_FROM_SCRATCH);
+}
+
+void RungeKutta::prepare_stage_matrix(double coeff) 
+{
+  if (stage_structure_changed)
+    create_stage_structure();
+  else if (coeff == stage_coeff && stage_mass_seq == (int) mass_seq 
+           && (coeff == 0.0 || stage_jacobian_seq == (int) jacobian_seq)) {
+    // The matrix is the one factorized last time.
+    stage_solver->set_factorization_scheme(HERMES_REUSE_FACTORIZATION_COMPLETELY);
+    return;
+  }
+  else
+    stage_solver->set_factorization_scheme(HERMES_REUSE_MATRIX_REORDERING);
+
+  // matrix_stage = M - coeff * J.
+  matrix_stage.zero();
+  matrix_stage.add_as_block(0, 0, &matrix_left);
+  if (coeff != 0.0)
+    matrix_stage.add_as_block(0, 0, &matrix_single, -coeff);
+
+  stage_coeff = coeff;
+  stage_mass_seq = mass_seq;
+  stage_jacobian_seq = jacobian_seq;
+}
+
+void RungeKutta::solve_stages_forward(double current_time, double time_step, bool rhs_only, bool jacobian_changed) 
+{
+  int ndof = matrix_left.get_size();
+  bool add_dir_lift = true;
+  scalar* stage_sum = new scalar[ndof];
+  scalar* jacobian_times_sum = new scalar[ndof];
+  vector_stage.alloc(ndof);
+
+  for (unsigned int i = 0; i < num_stages; i++) {
+    // Jacobian of the stationary residual at the stage i. If it does not change
+    // during the time step, the one of the first stage serves all of them.
+    if (!rhs_only && (jacobian_changed || i == 0)) {
+      set_block_stage_time(current_time + bt->get_C(i)*time_step);
+      block_dp_right->assemble(u_ext_vec + i*ndof, &matrix_single, NULL, false, add_dir_lift);
+      jacobian_seq++;
+    }
+
+    // Right-hand side: the residual of the stage i minus the contribution of the 
+    // blocks (i, j), j < i, i.e., -F_i + tau * J_i * \sum_{j<i} a_ij \deltaK_j.
+    bool has_lower_blocks = false;
+    memset(stage_sum, 0, ndof * sizeof(scalar));
+    for (unsigned int j = 0; j < i; j++) {
+      if (bt->get_A(i, j) == 0.0) continue;
+      has_lower_blocks = true;
+      for (int idx = 0; idx < ndof; idx++)
+        stage_sum[idx] += bt->get_A(i, j) * stage_increment[j*ndof + idx];
+    }
+    if (has_lower_blocks)
+      matrix_single.multiply_with_vector(stage_sum, jacobian_times_sum);
+    for (int idx = 0; idx < ndof; idx++)
+      vector_stage.set(idx, vector_right.get(i*ndof + idx) 
+                            + (has_lower_blocks ? time_step * jacobian_times_sum[idx] : 0.0));
+
+    // Diagonal block M - tau * a_ii * J_i. For SDIRK methods with a constant Jacobian,
+    // the factorization is done once for all stages.
+    prepare_stage_matrix(time_step * bt->get_A(i, i));
+    if(!stage_solver->solve()) 
+      error ("Matrix solver failed.\n");
+    memcpy(stage_increment + i*ndof, stage_solver->get_solution(), ndof * sizeof(scalar));
+  }
+
+  delete [] stage_sum;
+  delete [] jacobian_times_sum;
+}
+
 void RungeKutta::prepare_u_ext_vec(double time_step, scalar* slns_prev_time_projection)
 {
   unsigned int ndof = dp->get_num_dofs();
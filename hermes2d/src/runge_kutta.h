@@ -28,8 +28,8 @@
 //     efficient, with explicit and diagonally implicit methods one should 
 //     first only solve for the upper left block, then eliminate all blocks 
 //     under it, then solve for block at position 22, eliminate all blocks 
-//     under it, etc. Currently this is not done and everything is left to 
-//     the matrix solver.   
+//     under it, etc. This is done in the block assembly mode only, otherwise
+//     everything is left to the matrix solver.   
 //
 // (2) In example 03-timedep-adapt-space-and-time with implicit Euler 
 //     method, Newton's method takes much longer than in 01-timedep-adapt-space-only
@@ -53,11 +53,11 @@
 //     assemble the matrix M (one block) and copy the sparsity structure
 //     into all remaining nonzero blocks (and diagonal blocks). Right 
 //     now, the sparsity structure is created expensively in each block 
-//     again.
+//     again. This is done in the block assembly mode, see set_block_assembly().
 //
 // (7) If space does not change, the sparsity does not change. Right now 
 //     we discard everything at the end of every time step, we should not 
-//     do it.  
+//     do it. The block assembly mode keeps the structure.
 //
 // (8) If the problem does not depend explicitly on time, then all the blocks 
 //     in the Jacobian matrix of the stationary residual are the same up 
@@ -89,6 +89,18 @@ public:
   void multiply_as_diagonal_block_matrix(UMFPackMatrix* matrix_left, int num_stages,
                                          scalar* stage_coeff_vec, scalar* vector_left);
 
+  /// Switches on/off the block assembly mode of rk_time_step(). In this mode the mass
+  /// matrix M and the single-stage Jacobian and residual (ndof times ndof) are assembled
+  /// by themselves, the Jacobian once per stage, and the num_stages*ndof system is then
+  /// stamped from these blocks. M and the sparse structure of the stage system are kept
+  /// between time steps as long as the spaces do not change.
+  /// With explicit and diagonally implicit tables, the stage system is not formed at all:
+  /// the stages are solved one after another with the diagonal blocks M - tau*a_ii*J_i.
+  /// If jacobian_changed == false is passed to rk_time_step(), the Jacobian is assumed
+  /// constant during the time step, it is only assembled for the first stage, and SDIRK
+  /// methods (equal a_ii) then factorize one matrix for all stages and Newton iterations.
+  void set_block_assembly(bool block_assembly = true);
+
   // Perform one explicit or implicit time step using the Runge-Kutta method
   // corresponding to a given Butcher's table. If err_vec != NULL then it will be 
   // filled with an error vector calculated using the second B-row of the Butcher's
@@ -128,6 +140,32 @@ protected:
   /// and right-hand side of the equation, respectively.
   void create_stage_wf(unsigned int size, double current_time, double time_step);
   
+  /// Creates the weak formulation for the mass matrix M (stage_wf_left).
+  void create_stage_wf_left(unsigned int size);
+
+  /// Creates stage_wf_left and the single-stage weak formulation block_wf_right
+  /// for the block assembly mode, together with their discrete problems.
+  void create_block_stage_wf(unsigned int size);
+
+  /// Sets the stage time to all forms of block_wf_right.
+  void set_block_stage_time(double stage_time);
+
+  /// Allocates matrix_right of size num_stages*ndof, with the structure of matrix_left
+  /// in the diagonal blocks and the one of matrix_single in the blocks (i, j) with a_ij != 0.
+  void create_block_structure();
+
+  /// Allocates matrix_stage (ndof times ndof) with the union of structures of matrix_left 
+  /// and matrix_single.
+  void create_stage_structure();
+
+  /// Sets matrix_stage to M - coeff*J, unless it holds that matrix already, and selects 
+  /// the factorization scheme of stage_solver accordingly.
+  void prepare_stage_matrix(double coeff);
+
+  /// Newton's step for explicit and diagonally implicit tables in the block assembly mode:
+  /// block forward substitution, the result is stored in stage_increment.
+  void solve_stages_forward(double current_time, double time_step, bool rhs_only, bool jacobian_changed);
+
   // Prepare u_ext_vec.
   void prepare_u_ext_vec(double time_step, scalar* slns_prev_time_projection);
 
@@ -146,6 +184,37 @@ protected:
   /// Matrix solver.
   Solver* solver;
 
+  /// Block assembly mode (see set_block_assembly()).
+  bool block_assembly;
+
+  /// Single-stage weak formulation (original forms, size ndof times ndof) and the
+  /// discrete problems assembling M and its blocks. They live as long as this class.
+  WeakForm block_wf_right;
+  DiscreteProblem* block_dp_left;
+  DiscreteProblem* block_dp_right;
+
+  /// Single-stage Jacobian and residual.
+  UMFPackMatrix matrix_single;
+  UMFPackVector vector_single;
+
+  /// Seq numbers of the spaces matrix_left and the structure of matrix_right belong to.
+  std::vector<int> block_sp_seq;
+  bool block_structure_changed;
+
+  /// Diagonal block of one stage and its solver (explicit and diagonally implicit tables).
+  UMFPackMatrix matrix_stage;
+  UMFPackVector vector_stage;
+  Solver* stage_solver;
+  bool stage_structure_changed;
+
+  /// Counters of assemblies of matrix_left and matrix_single, and the values
+  /// matrix_stage was created from, so that its factorization can be reused.
+  unsigned int mass_seq;
+  unsigned int jacobian_seq;
+  double stage_coeff;
+  int stage_mass_seq;
+  int stage_jacobian_seq;
+
   /// DiscreteProblem.
   DiscreteProblem* dp;
   bool is_linear;
@@ -175,6 +244,9 @@ protected:
   // Vector for the left part of the residual.
   scalar* vector_left;
 
+  // Newton's increment of K_vector, length num_stages * ndof (block forward substitution).
+  scalar* stage_increment;
+
   // Number of previous calls to rk_time_step().
   unsigned int iteration;
 };
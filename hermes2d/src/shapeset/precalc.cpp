@@ -28,6 +28,8 @@ PrecalcShapeset::PrecalcShapeset(Shapeset* shapeset)
   num_components = shapeset->get_num_components();
   assert(num_components == 1 || num_components == 2);
   update_max_index();
+  memset(master_tables, 0, sizeof(master_tables));
+  memset(num_master_orders, 0, sizeof(num_master_orders));
   set_quad_2d(&g_quad_2d_std);
 }
 
@@ -41,6 +43,8 @@ PrecalcShapeset::PrecalcShapeset(PrecalcShapeset* pss)
   shapeset = pss->shapeset;
   num_components = pss->num_components;
   update_max_index();
+  memset(master_tables, 0, sizeof(master_tables));
+  memset(num_master_orders, 0, sizeof(num_master_orders));
   set_quad_2d(&g_quad_2d_std);
 }
 
@@ -72,25 +76,87 @@ void PrecalcShapeset::handle_overflow_idx()
 
 void PrecalcShapeset::set_active_shape(int index)
 {
+  this->index = index;
+  order = std::max(H2D_GET_H_ORDER(shapeset->get_order(index)), H2D_GET_V_ORDER(shapeset->get_order(index)));
+
+  update_node_table();
+}
+
+
+void PrecalcShapeset::update_node_table()
+{
+  PrecalcShapeset* master = (master_pss != NULL) ? master_pss : this;
+
+  // Untransformed shape functions: direct indexing.
+  if (sub_idx == 0 && index >= 0) {
+    order_nodes = master->get_master_row(cur_quad, get_quad_2d(), mode, index);
+    num_order_nodes = master->num_master_orders[cur_quad][mode];
+    sub_tables = NULL;
+    return;
+  }
+  order_nodes = NULL;
+
   // Key creation.
   unsigned key = cur_quad | (mode << 3) | ((unsigned) (max_index[mode] - index) << 4);
 
-  if(master_pss == NULL) {
-    if(!tables.present(key))
-      tables.add(new std::map<uint64_t, LightArray<Node*>*>, key);
-    sub_tables = tables.get(key);
-  }
-  else {
-    if(!master_pss->tables.present(key))
-      master_pss->tables.add(new std::map<uint64_t, LightArray<Node*>*>, key);
-    sub_tables = master_pss->tables.get(key);
-  }
+  if(!master->tables.present(key))
+    master->tables.add(new std::map<uint64_t, LightArray<Node*>*>, key);
+  sub_tables = master->tables.get(key);
 
   // Update the Node table.
   update_nodes_ptr();
+}
 
-  this->index = index;
-  order = std::max(H2D_GET_H_ORDER(shapeset->get_order(index)), H2D_GET_V_ORDER(shapeset->get_order(index)));
+
+PrecalcShapeset::Node** PrecalcShapeset::get_master_row(int quad, Quad2D* quad_2d, int mode, int index)
+{
+  assert(!is_slave());
+  assert(index <= max_index[mode]);
+  Node*** rows = master_tables[quad][mode];
+  if (rows == NULL) {
+    rows = master_tables[quad][mode] = arena.alloc_array<Node**>(max_index[mode] + 1);
+    memset(rows, 0, (max_index[mode] + 1) * sizeof(Node**));
+    quad_2d->set_mode(mode);
+    num_master_orders[quad][mode] = quad_2d->get_num_tables();
+  }
+  if (rows[index] == NULL) {
+    rows[index] = arena.alloc_array<Node*>(num_master_orders[quad][mode]);
+    memset(rows[index], 0, num_master_orders[quad][mode] * sizeof(Node*));
+  }
+  return rows[index];
+}
+
+
+PrecalcShapeset::Node* PrecalcShapeset::new_aligned_node(int mask, int num_points)
+{
+  // get the number of tables
+  int nt = 0, m = mask;
+  if (num_components < 2) m &= H2D_FN_COMPONENT_0;
+  while (m) { nt += m & 1; m >>= 1; }
+
+  // the header and each table start at an aligned address
+  const int align = H2D_PRECALC_ALIGNMENT;
+  int hdr_size = (sizeof(Node) + align - 1) / align * align;
+  int table_len = (num_points * sizeof(double) + align - 1) / align * align / sizeof(double);
+  int size = hdr_size + nt * table_len * sizeof(double);
+
+  Node* node = (Node*) arena.allocate(size, align);
+  node->mask = mask;
+  node->size = size;
+  memset(node->values, 0, sizeof(node->values));
+  double* data = (double*) ((char*) node + hdr_size);
+  memset(data, 0, nt * table_len * sizeof(double));
+  for (int j = 0; j < num_components; j++) {
+    for (int i = 0; i < 6; i++)
+      if (mask & idx2mask[i][j]) {
+        node->values[j][i] = data;
+        data += table_len;
+      }
+  }
+
+  total_mem += size;
+  if (max_mem < total_mem) max_mem = total_mem;
+  return node;
 }
 
 
@@ -125,7 +191,8 @@ void PrecalcShapeset::precalculate(int order, int mask)
 
   int oldmask = (cur_node != NULL) ? cur_node->mask : 0;
   int newmask = mask | oldmask;
-  Node* node = new_node(newmask, np);
+  Node* node = (order_nodes != NULL) ? (master_pss != NULL ? master_pss : this)->new_aligned_node(newmask, np)
+                                     : new_node(newmask, np);
 
   // precalculate all required tables
   for (j = 0; j < num_components; j++)
@@ -142,11 +209,16 @@ void PrecalcShapeset::precalculate(int order, int mask)
       }
     }
   }
-  if(nodes->present(order)) {
-    assert(nodes->get(order) == cur_node);
-    ::free(nodes->get(order));
+  // Nodes in the flat tables stay in the arena until free().
+  if(order_nodes != NULL)
+    order_nodes[order] = node;
+  else {
+    if(nodes->present(order)) {
+      assert(nodes->get(order) == cur_node);
+      ::free(nodes->get(order));
+    }
+    nodes->add(node, order);
   }
-  nodes->add(node, order);
   cur_node = node;
 }
 
@@ -171,7 +243,12 @@ void PrecalcShapeset::free()
       if(overflow_nodes->present(i))
         ::free(overflow_nodes->get(i));
     delete overflow_nodes;
+    overflow_nodes = NULL;
   }
+
+  memset(master_tables, 0, sizeof(master_tables));
+  memset(num_master_orders, 0, sizeof(num_master_orders));
+  arena.free();
 }
 
 extern PrecalcShapeset ref_map_pss;
@@ -184,13 +261,13 @@ PrecalcShapeset::~PrecalcShapeset()
 void PrecalcShapeset::push_transform(int son)
 {
   Transformable::push_transform(son);
-  if(sub_tables != NULL)
-    update_nodes_ptr();
+  if(sub_tables != NULL || order_nodes != NULL)
+    update_node_table();
 }
 
 void PrecalcShapeset::pop_transform()
 {
   Transformable::pop_transform();
-  if(sub_tables != NULL)
-    update_nodes_ptr();
+  if(sub_tables != NULL || order_nodes != NULL)
+    update_node_table();
 }
\ No newline at end of file
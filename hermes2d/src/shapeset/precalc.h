@@ -18,12 +18,21 @@
 
 #include "../function/function.h"
 #include "../shapeset/shapeset.h"
+#include "../arena.h"
+
+/// Alignment of the value tables of the shape functions (in bytes). The length of each
+/// table is padded to a multiple of this, the padding is filled with zeros.
+#define H2D_PRECALC_ALIGNMENT   64
 
 
 /// \brief Caches precalculated shape function values.
 ///
 /// PrecalcShapeset is a cache of precalculated shape function values.
 ///
+/// The values of the shape functions on the master element, which is what the assembling
+/// asks for most of the time, are kept in flat tables indexed directly by the quadrature,
+/// the mode, the shape index and the integration order. Constrained shape functions and
+/// shape functions transformed to sub-elements are looked up by their transformation.
 ///
 class HERMES_API PrecalcShapeset : public RealFunction
 {
@@ -109,6 +118,14 @@ protected:
   /// and shape function index to a table from the middle layer.
   LightArray<std::map<uint64_t, LightArray<Node*>*>*> tables;
 
+  /// Flat tables for untransformed shape functions with non-negative indices:
+  /// master_tables[quad][mode][index][order]. Each row of the Node pointers has
+  /// num_master_orders[quad][mode] items. The rows and the Nodes are allocated lazily
+  /// in 'arena'; the value tables of the Nodes are aligned to H2D_PRECALC_ALIGNMENT.
+  Node*** master_tables[4][2];
+  unsigned int num_master_orders[4][2];
+  Arena arena;
+
   int mode;
   int index;
   int max_index[2];
@@ -121,6 +138,15 @@ protected:
 
   void update_max_index();
 
+  /// Selects the table of nodes for the current shape function, quadrature and transformation.
+  void update_node_table();
+
+  /// Returns the row of master_tables for the shape function 'index', allocates it if necessary.
+  Node** get_master_row(int quad, Quad2D* quad_2d, int mode, int index);
+
+  /// Allocates a Node in the arena, with aligned and zero-padded value tables.
+  Node* new_aligned_node(int mask, int num_points);
+
   /// Forces a transform without using push_transform() etc.
   /// Used by the Solution class. <b>For internal use only</b>.
   void force_transform(uint64_t sub_idx, Trf* ctm)
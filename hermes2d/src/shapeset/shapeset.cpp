@@ -120,6 +120,9 @@ double* Shapeset::calculate_constrained_edge_combination(int order, int part, in
 }
 
 
+/// Guards comb_table, the coefficients may be requested from several assembling threads.
+static pthread_mutex_t comb_table_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 /// Returns the coefficients for the linear combination forming a constrained edge function.
 /// This function performs the storage (caching) of these coefficients, so that they can be
 /// calculated only once.
@@ -128,6 +131,8 @@ double* Shapeset::get_constrained_edge_combination(int order, int part, int ori,
 {
   int index = 2*((max_order + 1 - ebias)*part + (order - ebias)) + ori;
 
+  pthread_mutex_lock(&comb_table_mutex);
+
   // allocate/reallocate the array if necessary
   if (comb_table == NULL)
   {
@@ -154,9 +159,11 @@ double* Shapeset::get_constrained_edge_combination(int order, int part, int ori,
     // no, calculate it
     comb_table[index] = calculate_constrained_edge_combination(order, part, ori);
   }
+  double* combination = comb_table[index];
+  pthread_mutex_unlock(&comb_table_mutex);
 
   nitems = order + 1 - ebias;
-  return comb_table[index];
+  return combination;
 }
 
 
@@ -88,7 +88,7 @@ WeakForm::MatrixFormSurf* WeakForm::MatrixFormSurf::clone()
 WeakForm::MatrixFormSurf::MatrixFormSurf(unsigned int i, unsigned int j, std::string area,
                                          Hermes::vector<MeshFunction *> ext, 
                                          Hermes::vector<scalar> param, double scaling_factor, int u_ext_offset) : 
-  Form(area, ext, param, scaling_factor, u_ext_offset), i(i), j(j)
+  Form(area, ext, param, scaling_factor, u_ext_offset), i(i), j(j), sym(HERMES_NONSYM)
 {
 }
 
@@ -163,7 +163,7 @@ WeakForm::MultiComponentMatrixFormVol* WeakForm::MultiComponentMatrixFormVol::cl
 WeakForm::MultiComponentMatrixFormSurf::MultiComponentMatrixFormSurf(Hermes::vector<std::pair<unsigned int, unsigned int> >coordinates, std::string area,
                                          Hermes::vector<MeshFunction *> ext, 
                                          Hermes::vector<scalar> param, double scaling_factor, int u_ext_offset) : 
-  Form(area, ext, param, scaling_factor, u_ext_offset), coordinates(coordinates)
+  Form(area, ext, param, scaling_factor, u_ext_offset), coordinates(coordinates), sym(HERMES_NONSYM)
 {
 }
 
@@ -673,6 +673,42 @@ bool** WeakForm::get_blocks(bool force_diagonal_blocks)
   return blocks;
 }
 
+bool WeakForm::is_sym() const
+{
+  _F_
+  for (unsigned i = 0; i < mfvol.size(); i++)
+    if (mfvol[i]->sym != HERMES_SYM)
+      return false;
+  for (unsigned i = 0; i < mfvol_mc.size(); i++)
+    if (mfvol_mc[i]->sym != HERMES_SYM)
+      return false;
+
+  // Surface forms are not mirrored by the assembling, an off-diagonal block would need
+  // its transpose added separately.
+  for (unsigned i = 0; i < mfsurf.size(); i++)
+    if (mfsurf[i]->sym != HERMES_SYM || mfsurf[i]->i != mfsurf[i]->j)
+      return false;
+  for (unsigned i = 0; i < mfsurf_mc.size(); i++) {
+    if (mfsurf_mc[i]->sym != HERMES_SYM)
+      return false;
+    for (unsigned int component_i = 0; component_i < mfsurf_mc[i]->coordinates.size(); component_i++)
+      if (mfsurf_mc[i]->coordinates[component_i].first != mfsurf_mc[i]->coordinates[component_i].second)
+        return false;
+  }
+
+  return true;
+}
+
+MatrixSolverType WeakForm::select_matrix_solver(MatrixSolverType matrix_solver) const
+{
+  _F_
+  if (matrix_solver == SOLVER_UMFPACK && is_sym()) {
+    verbose("The weak form is symmetric, using the LDL^T solver instead of UMFPack.");
+    return SOLVER_LDL;
+  }
+  return matrix_solver;
+}
+
 void WeakForm::set_current_time(double time)
 {
   current_time = time;
@@ -146,6 +146,9 @@ public:
     virtual MatrixFormSurf* clone();
 
     unsigned int i, j;
+    /// HERMES_SYM if the form is symmetric in u and v. Surface forms are always assembled
+    /// in full, the flag is only used by WeakForm::is_sym().
+    int sym;
 
     virtual scalar value(int n, double *wt, Func<scalar> *u_ext[], Func<double> *u, Func<double> *v,
                          Geom<double> *e, ExtData<scalar> *ext) const;
@@ -220,6 +223,8 @@ public:
     virtual MultiComponentMatrixFormSurf* clone();
 
     Hermes::vector<std::pair<unsigned int, unsigned int> > coordinates;
+    /// See MatrixFormSurf::sym.
+    int sym;
 
     virtual void value(int n, double *wt, Func<scalar> *u_ext[], Func<double> *u, Func<double> *v,
                          Geom<double> *e, ExtData<scalar> *ext, Hermes::vector<scalar>& result) const = 0;
@@ -368,7 +373,18 @@ public:
   bool is_in_area(std::string marker, std::string area) const
   { return area == marker; }
 
-  bool is_sym() const { return false; /* not impl. yet */ }
+  /// Returns true if the matrix of the weak form is symmetric: all volume matrix forms have
+  /// to be HERMES_SYM (their off-diagonal blocks are then assembled as transposes of each
+  /// other) and all surface matrix forms have to be HERMES_SYM diagonal blocks. Such
+  /// matrices can be stored and factorized as symmetric, see select_matrix_solver().
+  bool is_sym() const;
+
+  /// Returns SOLVER_LDL, the native sparse LDL^T solver with the symmetric storage, if the
+  /// matrix solver is SOLVER_UMFPACK and the weak form is symmetric (see is_sym()). Returns
+  /// the matrix solver unchanged otherwise. The LDL^T factorization does not pivot; at the
+  /// first pivot which is not positive (the matrix is not positive definite), the solver
+  /// falls back to UMFPack (see LDLSolver).
+  MatrixSolverType select_matrix_solver(MatrixSolverType matrix_solver) const;
 
   friend class DiscreteProblem;
   friend class Precond;
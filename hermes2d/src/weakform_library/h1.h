@@ -635,9 +635,9 @@ namespace WeakFormsH1 {
     {
     public:
       DefaultMatrixFormSurf(int i, int j, scalar coeff, GeomType gt = HERMES_PLANAR)
-  : WeakForm::MatrixFormSurf(i, j), coeff(coeff), gt(gt) { }
+  : WeakForm::MatrixFormSurf(i, j), coeff(coeff), gt(gt) { sym = HERMES_SYM; }
       DefaultMatrixFormSurf(int i, int j, std::string area, scalar coeff, GeomType gt = HERMES_PLANAR)
-  : WeakForm::MatrixFormSurf(i, j, area), coeff(coeff), gt(gt) { }
+  : WeakForm::MatrixFormSurf(i, j, area), coeff(coeff), gt(gt) { sym = HERMES_SYM; }
 
       virtual scalar value(int n, double *wt, Func<scalar> *u_ext[], Func<double> *u, Func<double> *v,
                            Geom<double> *e, ExtData<scalar> *ext) const {
@@ -676,10 +676,10 @@ namespace WeakFormsH1 {
     public:
       DefaultJacobianFormSurf(int i, int j, CubicSpline* spline_coeff, scalar const_coeff = 1.0,
                               GeomType gt = HERMES_PLANAR)
-  : WeakForm::MatrixFormSurf(i, j), spline_coeff(spline_coeff), const_coeff(const_coeff), gt(gt) { }
+  : WeakForm::MatrixFormSurf(i, j), spline_coeff(spline_coeff), const_coeff(const_coeff), gt(gt) { sym = HERMES_SYM; }
       DefaultJacobianFormSurf(int i, int j, std::string area, CubicSpline* spline_coeff,
                               scalar const_coeff = 1.0, GeomType gt = HERMES_PLANAR)
-  : WeakForm::MatrixFormSurf(i, j, area), spline_coeff(spline_coeff), const_coeff(const_coeff), gt(gt) { }
+  : WeakForm::MatrixFormSurf(i, j, area), spline_coeff(spline_coeff), const_coeff(const_coeff), gt(gt) { sym = HERMES_SYM; }
 
       template<typename Real, typename Scalar>
       Scalar matrix_form_surf(int n, double *wt, Func<Scalar> *u_ext[], Func<Real> *u,
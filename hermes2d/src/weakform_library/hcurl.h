@@ -105,9 +105,9 @@ namespace WeakFormsHcurl {
     {
     public:
       DefaultMatrixFormSurf(int i, int j, scalar coeff)
-        : WeakForm::MatrixFormSurf(i, j), coeff(coeff) { }
+        : WeakForm::MatrixFormSurf(i, j), coeff(coeff) { sym = HERMES_SYM; }
       DefaultMatrixFormSurf(int i, int j, std::string area, scalar coeff)
-        : WeakForm::MatrixFormSurf(i, j, area), coeff(coeff) { }
+        : WeakForm::MatrixFormSurf(i, j, area), coeff(coeff) { sym = HERMES_SYM; }
 
       template<typename Real, typename Scalar>
       Scalar matrix_form(int n, double *wt, Func<Scalar> *u_ext[], Func<Real> *u,
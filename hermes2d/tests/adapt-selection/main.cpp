@@ -0,0 +1,94 @@
+#include "hermes2d.h"
+
+using namespace RefinementSelectors;
+
+// This test checks the multithreaded selection of refinements. The function of the tutorial
+// example P04-06-exact-adapt is approximated by hp-adaptivity twice, first selecting the
+// refinements serially and then using NUM_THREADS threads. The refinements of all adaptivity
+// steps have to be the same. The reference solution is a projection of the function to the
+// reference space (an exact solution can not be copied for the threads). The times spent in
+// Adapt::adapt() are printed for comparison.
+
+const int P_INIT = 2;                             // Initial polynomial degree of all mesh elements.
+const int INIT_REF_NUM = 3;                       // Number of initial uniform mesh refinements.
+const int NUM_STEPS = 6;                          // Number of adaptivity steps.
+const double THRESHOLD = 0.3;                     // Parameter of the adaptive strategy.
+const int STRATEGY = 0;                           // Adaptive strategy, see adapt.h.
+const CandList CAND_LIST = H2D_HP_ANISO;          // Predefined list of element refinement candidates.
+const int NUM_THREADS = 4;                        // Number of threads of the multithreaded selection.
+MatrixSolverType matrix_solver = SOLVER_UMFPACK;  // Possibilities: SOLVER_AMESOS, SOLVER_AZTECOO, SOLVER_MUMPS,
+                                                  // SOLVER_PETSC, SOLVER_SUPERLU, SOLVER_UMFPACK.
+
+// Exact solution.
+#include "../../tutorial/P04-linear-adapt/06-exact-adapt/exact_solution.cpp"
+
+// Performs the adaptivity, stores the refinements of all steps and returns the time of adapt().
+double run_adaptivity(int num_threads, std::vector<ElementToRefine>& refinements)
+{
+  Mesh mesh;
+  H2DReader mloader;
+  mloader.load("../../tutorial/P04-linear-adapt/06-exact-adapt/square.mesh", &mesh);
+  for (int i = 0; i < INIT_REF_NUM; i++) mesh.refine_all_elements();
+
+  H1Space space(&mesh, P_INIT);
+  H1ProjBasedSelector selector(CAND_LIST, 1.0, H2DRS_DEFAULT_ORDER);
+
+  double time = 0;
+  TimePeriod cpu_time;
+  for (int step = 0; step < NUM_STEPS; step++) {
+    // Reference solution and its projection to the coarse space.
+    Space* ref_space = Space::construct_refined_space(&space);
+    ExactSolutionCustom exact(ref_space->get_mesh());
+    Solution ref_sln, sln;
+    OGProjection::project_global(ref_space, &exact, &ref_sln, matrix_solver);
+    OGProjection::project_global(&space, &ref_sln, &sln, matrix_solver);
+
+    // The errors are calculated serially, threads could change their rounding and the order of elements.
+    Adapt adaptivity(&space);
+    double err_est_rel = adaptivity.calc_err_est(&sln, &ref_sln) * 100;
+    info("threads: %d, step %d, ndof: %d, err_est_rel: %g%%", num_threads, step + 1,
+         Space::get_num_dofs(&space), err_est_rel);
+    adaptivity.set_num_threads(num_threads);
+
+    cpu_time.tick(HERMES_SKIP);
+    bool done = adaptivity.adapt(&selector, THRESHOLD, STRATEGY);
+    time += cpu_time.tick().last();
+
+    const std::vector<ElementToRefine>& last = adaptivity.get_last_refinements();
+    refinements.insert(refinements.end(), last.begin(), last.end());
+
+    delete ref_space->get_mesh();
+    delete ref_space;
+    if (done) break;
+  }
+  return time;
+}
+
+int main(int argc, char* argv[])
+{
+  std::vector<ElementToRefine> refinements_serial, refinements_parallel;
+  double time_serial = run_adaptivity(1, refinements_serial);
+  double time_parallel = run_adaptivity(NUM_THREADS, refinements_parallel);
+  printf("adapt(): %g s serially, %g s with %d threads, %d refinements\n",
+         time_serial, time_parallel, NUM_THREADS, (int) refinements_serial.size());
+
+  bool success = (refinements_serial.size() == refinements_parallel.size());
+  for (unsigned int i = 0; success && i < refinements_serial.size(); i++) {
+    const ElementToRefine& a = refinements_serial[i];
+    const ElementToRefine& b = refinements_parallel[i];
+    if (a.id != b.id || a.comp != b.comp || a.split != b.split)
+      success = false;
+    for (int j = 0; j < a.get_num_sons(); j++)
+      if (a.p[j] != b.p[j])
+        success = false;
+  }
+
+  if (success == true) {
+    printf("Success!\n");
+    return ERR_SUCCESS;
+  }
+  else {
+    printf("Failure!\n");
+    return ERR_FAILURE;
+  }
+}
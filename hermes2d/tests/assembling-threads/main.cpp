@@ -0,0 +1,166 @@
+#include "hermes2d.h"
+
+// This test assembles the problem from the tutorial example P01-03-poisson
+// (its mesh has both triangles and quads) with 1, 2, ..., MAX_THREADS threads,
+// and then a problem whose forms use a solution on a differently refined mesh.
+// It makes sure that the multithreaded assembling gives the same matrix and
+// right-hand side as the serial one, and prints the assembling times (pass the
+// maximum number of threads as the first argument to measure the scaling on
+// a larger machine).
+
+const int P_INIT = 6;                             // Uniform polynomial degree of mesh elements.
+const int INIT_REF_NUM = 3;                       // Number of initial uniform mesh refinements.
+const int MAX_THREADS = 4;                        // Default maximum number of threads.
+
+// Problem parameters.
+const double LAMBDA_AL = 236.0;            // Thermal cond. of Al for temperatures around 20 deg Celsius.
+const double LAMBDA_CU = 386.0;            // Thermal cond. of Cu for temperatures around 20 deg Celsius.
+const double VOLUME_HEAT_SRC = 5e2;        // Volume heat sources generated by electric current.
+const double FIXED_BDY_TEMP = 20.0;        // Fixed temperature on the boundary.
+
+// Weak forms.
+#include "../../tutorial/P01-linear/03-poisson/definitions.cpp"
+
+// Diffusion with the coefficient given by an external function.
+class CustomMatrixFormExt : public WeakForm::MatrixFormVol
+{
+public:
+  CustomMatrixFormExt(MeshFunction* coeff)
+    : WeakForm::MatrixFormVol(0, 0, HERMES_NONSYM, HERMES_ANY, Hermes::vector<MeshFunction*>(coeff)) { }
+
+  virtual scalar value(int n, double *wt, Func<scalar> *u_ext[], Func<double> *u,
+                       Func<double> *v, Geom<double> *e, ExtData<scalar> *ext) const {
+    scalar result = 0;
+    for (int i = 0; i < n; i++)
+      result += wt[i] * ext->fn[0]->val[i] * (u->dx[i] * v->dx[i] + u->dy[i] * v->dy[i]);
+    return result;
+  }
+
+  virtual Ord ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *u, Func<Ord> *v,
+                  Geom<Ord> *e, ExtData<Ord> *ext) const {
+    return ext->fn[0]->val[0] * (u->dx[0] * v->dx[0] + u->dy[0] * v->dy[0]);
+  }
+};
+
+// The right-hand side \int_{\Omega} f v, f is an external function.
+class CustomVectorFormExt : public WeakForm::VectorFormVol
+{
+public:
+  CustomVectorFormExt(MeshFunction* f)
+    : WeakForm::VectorFormVol(0, HERMES_ANY, Hermes::vector<MeshFunction*>(f)) { }
+
+  virtual scalar value(int n, double *wt, Func<scalar> *u_ext[], Func<double> *v,
+                       Geom<double> *e, ExtData<scalar> *ext) const {
+    scalar result = 0;
+    for (int i = 0; i < n; i++)
+      result += wt[i] * ext->fn[0]->val[i] * v->val[i];
+    return result;
+  }
+
+  virtual Ord ord(int n, double *wt, Func<Ord> *u_ext[], Func<Ord> *v,
+                  Geom<Ord> *e, ExtData<Ord> *ext) const {
+    return ext->fn[0]->val[0] * v->val[0];
+  }
+};
+
+class CustomWeakFormExt : public WeakForm
+{
+public:
+  CustomWeakFormExt(MeshFunction* coeff) : WeakForm(1)
+  {
+    add_matrix_form(new CustomMatrixFormExt(coeff));
+    add_vector_form(new CustomVectorFormExt(coeff));
+  };
+};
+
+// Assembles the problem serially and with 2, ..., max_threads threads, returns
+// false if the results differ.
+bool check_threads(DiscreteProblem* dp, int ndof, int max_threads)
+{
+  CSCMatrix matrix_ref;
+  UMFPackVector rhs_ref;
+  // TimePeriod measures the wall clock time, the CPU time would add up the times of all threads.
+  TimePeriod wall_clock;
+  dp->set_num_threads(1);
+  dp->assemble(&matrix_ref, &rhs_ref);
+  double time_ref = wall_clock.tick().last();
+  printf("threads = 1, assembling time = %g s\n", time_ref);
+
+  bool success = true;
+  for (int num_threads = 2; num_threads <= max_threads; num_threads++) {
+    dp->set_num_threads(num_threads);
+    CSCMatrix matrix;
+    UMFPackVector rhs;
+    wall_clock.tick(HERMES_SKIP);
+    dp->assemble(&matrix, &rhs);
+    double time = wall_clock.tick().last();
+    printf("threads = %d, assembling time = %g s, speedup = %g\n", num_threads, time, time_ref / time);
+
+    // The order of summation differs, so only compare up to round-off.
+    if (matrix.get_nnz() != matrix_ref.get_nnz()) success = false;
+    else
+      for (unsigned int i = 0; i < matrix.get_nnz(); i++)
+        if (std::abs(matrix.get_Ax()[i] - matrix_ref.get_Ax()[i]) > 1e-10 * (1 + std::abs(matrix_ref.get_Ax()[i])))
+          success = false;
+    for (int i = 0; i < ndof; i++)
+      if (std::abs(rhs.get(i) - rhs_ref.get(i)) > 1e-10 * (1 + std::abs(rhs_ref.get(i))))
+        success = false;
+  }
+  return success;
+}
+
+int main(int argc, char* argv[])
+{
+  int max_threads = (argc > 1) ? atoi(argv[1]) : MAX_THREADS;
+
+  // Load the mesh.
+  Mesh mesh;
+  H2DReader mloader;
+  mloader.load("../../tutorial/P01-linear/03-poisson/domain.mesh", &mesh);
+
+  // Perform initial mesh refinements.
+  for (int i = 0; i < INIT_REF_NUM; i++) mesh.refine_all_elements();
+
+  // Initialize the weak formulation.
+  CustomWeakFormPoisson wf("Aluminum", LAMBDA_AL, "Copper", LAMBDA_CU, VOLUME_HEAT_SRC);
+
+  // Initialize boundary conditions.
+  DefaultEssentialBCConst bc_essential(Hermes::vector<std::string>("Bottom", "Inner", "Outer", "Left"), FIXED_BDY_TEMP);
+  EssentialBCs bcs(&bc_essential);
+
+  // Create an H1 space with default shapeset.
+  H1Space space(&mesh, &bcs, P_INIT);
+  int ndof = space.get_num_dofs();
+  info("ndof = %d", ndof);
+
+  DiscreteProblem dp(&wf, &space, true);
+  bool success = check_threads(&dp, ndof, max_threads);
+
+  // A solution on a mesh refined towards a vertex, the forms of the second
+  // problem are then assembled over the union of both meshes.
+  Mesh mesh_coeff;
+  mesh_coeff.copy(&mesh);
+  mesh_coeff.refine_towards_vertex(3, 3);
+  H1Space space_coeff(&mesh_coeff, &bcs, 2);
+  int ndof_coeff = space_coeff.get_num_dofs();
+  scalar* coeff_vec = new scalar[ndof_coeff];
+  for (int i = 0; i < ndof_coeff; i++)
+    coeff_vec[i] = 1.0 + (i % 7) * 0.1;
+  Solution coeff;
+  Solution::vector_to_solution(coeff_vec, &space_coeff, &coeff);
+  delete [] coeff_vec;
+
+  CustomWeakFormExt wf_ext(&coeff);
+  DiscreteProblem dp_ext(&wf_ext, &space, true);
+  if (!check_threads(&dp_ext, ndof, max_threads))
+    success = false;
+
+  if (success == true) {
+    printf("Success!\n");
+    return ERR_SUCCESS;
+  }
+  else {
+    printf("Failure!\n");
+    return ERR_FAILURE;
+  }
+}
@@ -0,0 +1,157 @@
+#include "hermes2d.h"
+
+// This test checks the cache of the projected reference maps of curved elements and the
+// NURBS evaluator. The mesh is a ring of quads with circular arcs on both boundaries, one
+// arc is replaced by a cubic NURBS with two inner knots. The evaluator has to give the same
+// points as the sum of the recursively defined basis functions. Then reference meshes are
+// created NUM_STEPS times as in adaptivity (a copy of the mesh refined uniformly); from the
+// second step on, the sons take their coefficients from the cache. They have to be the same
+// as the coefficients of a mesh loaded and refined independently. The times of creating the
+// reference meshes are printed.
+
+const int N = 200;                                // Number of quads of the ring.
+const int INIT_REF_NUM = 2;                       // Number of initial uniform mesh refinements.
+const int NUM_STEPS = 4;                          // Number of created reference meshes.
+
+// Writes the mesh file.
+std::string write_mesh(int n)
+{
+  std::ostringstream s;
+  s.precision(17);
+  s << "vertices = [\n";
+  for (int k = 0; k < n; k++)
+  {
+    double phi = 2 * M_PI * k / n;
+    s << "  [ " << cos(phi) << ", " << sin(phi) << " ], [ " << 2 * cos(phi) << ", " << 2 * sin(phi) << " ],\n";
+  }
+  s << "]\nelements = [\n";
+  for (int k = 0; k < n; k++)
+  {
+    int l = (k + 1) % n;
+    s << "  [ " << 2*k << ", " << 2*k + 1 << ", " << 2*l + 1 << ", " << 2*l << ", 0 ],\n";
+  }
+  s << "]\nboundaries = [\n";
+  for (int k = 0; k < n; k++)
+  {
+    int l = (k + 1) % n;
+    s << "  [ " << 2*l << ", " << 2*k << ", 1 ], [ " << 2*k + 1 << ", " << 2*l + 1 << ", 2 ],\n";
+  }
+  s << "]\ncurves = [\n";
+  double angle = 360.0 / n, phi = 2 * M_PI / n;
+  for (int k = 0; k < n; k++)
+    s << "  [ " << 2*k << ", " << 2*((k + 1) % n) << ", " << angle << " ],\n";
+  s << "  [ 1, 3, 3, [ ";
+  for (int i = 1; i <= 4; i++)
+    s << "[ " << 2.02 * cos(phi * i / 5) << ", " << 2.02 * sin(phi * i / 5) << ", " << 1.0 + 0.1 * i << " ]" << (i < 4 ? ", " : "");
+  s << " ], [ 0.3, 0.6 ] ],\n";
+  for (int k = 1; k < n; k++)
+    s << "  [ " << 2*k + 1 << ", " << 2*((k + 1) % n) + 1 << ", " << angle << " ],\n";
+  s << "]\n";
+  return s.str();
+}
+
+// Returns a point of the NURBS curve as the sum of all basis functions.
+void nurbs_point_recursive(Nurbs* nurbs, double t, double2& pt)
+{
+  double x = 0.0, y = 0.0, sum = 0.0;
+  for (int i = 0; i < nurbs->np; i++)
+  {
+    double basis = CurvMap::nurbs_basis_fn(i, nurbs->degree, t, nurbs->kv);
+    sum += nurbs->pt[i][2] * basis;
+    x += nurbs->pt[i][2] * basis * nurbs->pt[i][0];
+    y += nurbs->pt[i][2] * basis * nurbs->pt[i][1];
+  }
+  pt[0] = x / sum;
+  pt[1] = y / sum;
+}
+
+// Compares the reference map coefficients of the curved elements of two meshes.
+bool compare_coeffs(Mesh* a, Mesh* b)
+{
+  if (a->get_max_element_id() != b->get_max_element_id()) return false;
+  for (int i = 0; i < a->get_max_element_id(); i++)
+  {
+    Element* ea = a->get_element_fast(i);
+    Element* eb = b->get_element_fast(i);
+    if (!ea->used || !ea->active) continue;
+    if (ea->cm == NULL || eb->cm == NULL)
+    {
+      if (ea->cm != eb->cm) return false;
+      continue;
+    }
+    if (ea->cm->nc != eb->cm->nc ||
+        memcmp(ea->cm->coeffs, eb->cm->coeffs, ea->cm->nc * sizeof(double2)) != 0)
+      return false;
+  }
+  return true;
+}
+
+int main(int argc, char* argv[])
+{
+  std::string mesh_str = write_mesh(N);
+  Mesh mesh;
+  H2DReader mloader;
+  mloader.load_str(mesh_str.c_str(), &mesh);
+
+  bool success = true;
+
+  // The evaluator against the recursive basis functions, on all curved edges.
+  int num_nurbs = 0;
+  Element* e;
+  for_all_base_elements(e, &mesh)
+    for (unsigned int i = 0; i < e->nvert; i++)
+    {
+      Nurbs* nurbs = e->cm->nurbs[i];
+      if (nurbs == NULL) continue;
+      if (nurbs->degree == 3) num_nurbs++;
+      double t[101];
+      double2 pts[101];
+      for (int k = 0; k <= 100; k++)
+        t[k] = k / 100.0;
+      CurvMap::nurbs_points(nurbs, 101, t, pts);
+      for (int k = 0; k <= 100; k++)
+      {
+        double2 pt;
+        nurbs_point_recursive(nurbs, t[k], pt);
+        if (fabs(pt[0] - pts[k][0]) > 1e-12 || fabs(pt[1] - pts[k][1]) > 1e-12)
+        {
+          printf("element %d, edge %d, t = %g: wrong point of the curve.\n", e->id, i, t[k]);
+          success = false;
+        }
+      }
+    }
+  if (num_nurbs != 1)
+    success = false;
+
+  TimePeriod cpu_time;
+  for (int i = 0; i < INIT_REF_NUM; i++) mesh.refine_all_elements();
+  printf("initial refinements: %g s\n", cpu_time.tick().last());
+
+  // Reference meshes, the first one calculates the coefficients of the sons.
+  for (int step = 0; step < NUM_STEPS; step++)
+  {
+    Mesh ref_mesh;
+    ref_mesh.copy(&mesh);
+    cpu_time.tick(HERMES_SKIP);
+    ref_mesh.refine_all_elements();
+    printf("reference mesh %d: %g s\n", step + 1, cpu_time.tick().last());
+
+    if (step == NUM_STEPS - 1)
+    {
+      Mesh mesh_fresh;
+      mloader.load_str(mesh_str.c_str(), &mesh_fresh);
+      for (int i = 0; i <= INIT_REF_NUM; i++) mesh_fresh.refine_all_elements();
+      if (!compare_coeffs(&ref_mesh, &mesh_fresh))
+        success = false;
+    }
+  }
+
+  if (success == true) {
+    printf("Success!\n");
+    return ERR_SUCCESS;
+  }
+  else {
+    printf("Failure!\n");
+    return ERR_FAILURE;
+  }
+}
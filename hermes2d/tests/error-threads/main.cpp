@@ -0,0 +1,82 @@
+#include "hermes2d.h"
+
+// This test checks the calculation of element errors in Adapt. The function of the tutorial
+// example P04-06-exact-adapt is projected to a coarse and to a reference space, and the errors
+// are calculated three times: with separate evaluation of the error and the norm, with the
+// fused evaluation, and by NUM_THREADS threads. The fused evaluation has to give the same
+// errors, the threads may differ in rounding only. The times are printed for comparison.
+
+const int P_INIT = 3;                             // Initial polynomial degree of all mesh elements.
+const int INIT_REF_NUM = 4;                       // Number of initial uniform mesh refinements.
+const int NUM_PASSES = 5;                         // Number of error calculations timed.
+const int NUM_THREADS = 4;                        // Number of threads of the multithreaded calculation.
+MatrixSolverType matrix_solver = SOLVER_UMFPACK;  // Possibilities: SOLVER_AMESOS, SOLVER_AZTECOO, SOLVER_MUMPS,
+                                                  // SOLVER_PETSC, SOLVER_SUPERLU, SOLVER_UMFPACK.
+
+// Exact solution.
+#include "../../tutorial/P04-linear-adapt/06-exact-adapt/exact_solution.cpp"
+
+// Calculates the errors, stores the errors of elements and returns the time of one calculation.
+double calc_errors(Space* space, Solution* sln, Solution* ref_sln, bool fused, int num_threads,
+                   double& err_est_rel, std::vector<double>& errors)
+{
+  Adapt adaptivity(space);
+  adaptivity.set_fused_error_evaluation(fused);
+  adaptivity.set_num_threads(num_threads);
+
+  TimePeriod cpu_time;
+  for (int pass = 0; pass < NUM_PASSES; pass++)
+    err_est_rel = adaptivity.calc_err_est(sln, ref_sln);
+  double time = cpu_time.tick().last() / NUM_PASSES;
+
+  Element* e;
+  errors.clear();
+  for_all_active_elements(e, space->get_mesh())
+    errors.push_back(adaptivity.get_element_error_squared(0, e->id));
+  return time;
+}
+
+int main(int argc, char* argv[])
+{
+  Mesh mesh;
+  H2DReader mloader;
+  mloader.load("../../tutorial/P04-linear-adapt/06-exact-adapt/square.mesh", &mesh);
+  for (int i = 0; i < INIT_REF_NUM; i++) mesh.refine_all_elements();
+
+  // Coarse and reference solutions.
+  H1Space space(&mesh, P_INIT);
+  Space* ref_space = Space::construct_refined_space(&space);
+  ExactSolutionCustom exact(ref_space->get_mesh());
+  Solution ref_sln, sln;
+  OGProjection::project_global(ref_space, &exact, &ref_sln, matrix_solver);
+  OGProjection::project_global(&space, &ref_sln, &sln, matrix_solver);
+  info("ndof: %d, ref_ndof: %d", Space::get_num_dofs(&space), Space::get_num_dofs(ref_space));
+
+  double err_separate, err_fused, err_parallel;
+  std::vector<double> errors_separate, errors_fused, errors_parallel;
+  double time_separate = calc_errors(&space, &sln, &ref_sln, false, 1, err_separate, errors_separate);
+  double time_fused = calc_errors(&space, &sln, &ref_sln, true, 1, err_fused, errors_fused);
+  double time_parallel = calc_errors(&space, &sln, &ref_sln, true, NUM_THREADS, err_parallel, errors_parallel);
+  printf("error: %g s separately, %g s fused, %g s with %d threads, err_est_rel: %g%%\n",
+         time_separate, time_fused, time_parallel, NUM_THREADS, err_fused * 100);
+
+  bool success = (err_fused == err_separate && std::abs(err_parallel - err_fused) < 1e-12 * err_fused);
+  for (unsigned int i = 0; i < errors_separate.size(); i++) {
+    if (errors_fused[i] != errors_separate[i])
+      success = false;
+    if (std::abs(errors_parallel[i] - errors_fused[i]) > 1e-12 * errors_fused[i])
+      success = false;
+  }
+
+  delete ref_space->get_mesh();
+  delete ref_space;
+
+  if (success == true) {
+    printf("Success!\n");
+    return ERR_SUCCESS;
+  }
+  else {
+    printf("Failure!\n");
+    return ERR_FAILURE;
+  }
+}
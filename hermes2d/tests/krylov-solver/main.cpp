@@ -0,0 +1,111 @@
+#include "hermes2d.h"
+
+// This test compares the native Krylov solver with UMFPack. The heat transfer problem of
+// the tutorial example P01-03-poisson (a symmetric positive definite matrix) is assembled
+// once and solved by UMFPack and by the Krylov solver with several methods, preconditioners
+// and numbers of threads. The solutions have to agree with the direct one, the times and
+// the numbers of iterations are printed for comparison. Pass the number of initial uniform
+// refinements as the first argument to measure larger problems.
+
+const int P_INIT = 3;                             // Uniform polynomial degree of mesh elements.
+const int INIT_REF_NUM = 4;                       // Number of initial uniform mesh refinements.
+const double TOLERANCE = 1e-10;                   // Relative residual of the Krylov solver.
+const double MAX_DIFFERENCE = 1e-6;               // Allowed relative difference from the direct solution.
+const int NUM_THREADS = 4;                        // Number of threads of the multithreaded solves.
+
+// Problem parameters.
+const double LAMBDA_AL = 236.0;            // Thermal cond. of Al for temperatures around 20 deg Celsius.
+const double LAMBDA_CU = 386.0;            // Thermal cond. of Cu for temperatures around 20 deg Celsius.
+const double VOLUME_HEAT_SRC = 5e2;        // Volume heat sources generated by electric current.
+const double FIXED_BDY_TEMP = 20.0;        // Fixed temperature on the boundary.
+
+// Weak forms.
+#include "../../tutorial/P01-linear/03-poisson/definitions.cpp"
+
+// Solves the system by the Krylov solver and returns the relative difference from the direct solution.
+bool solve_krylov(CSCMatrix* matrix, UMFPackVector* rhs, const scalar* direct, const char* method,
+                  const char* precond, int num_threads)
+{
+  KrylovSolver solver(matrix, rhs);
+  solver.set_solver(method);
+  solver.set_precond(precond);
+  solver.set_num_threads(num_threads);
+  solver.set_tolerance(TOLERANCE);
+  solver.solve();
+
+  int ndof = matrix->get_size();
+  double diff = 0.0, norm = 0.0;
+  for (int i = 0; i < ndof; i++) {
+    diff += sqr(solver.get_solution()[i] - direct[i]);
+    norm += sqr(direct[i]);
+  }
+  diff = sqrt(diff / norm);
+  printf("%-8s %-6s threads: %d, %g s, %d iterations, difference %g\n", method, precond, num_threads,
+         solver.get_time(), solver.get_num_iters(), diff);
+  return diff < MAX_DIFFERENCE;
+}
+
+int main(int argc, char* argv[])
+{
+  // Load the mesh.
+  Mesh mesh;
+  H2DReader mloader;
+  mloader.load("../../tutorial/P01-linear/03-poisson/domain.mesh", &mesh);
+  int ref_num = (argc > 1) ? atoi(argv[1]) : INIT_REF_NUM;
+  for (int i = 0; i < ref_num; i++) mesh.refine_all_elements();
+
+  // Initialize the weak formulation, boundary conditions and the space.
+  CustomWeakFormPoisson wf("Aluminum", LAMBDA_AL, "Copper", LAMBDA_CU, VOLUME_HEAT_SRC);
+  DefaultEssentialBCConst bc_essential(Hermes::vector<std::string>("Bottom", "Inner", "Outer", "Left"), FIXED_BDY_TEMP);
+  EssentialBCs bcs(&bc_essential);
+  H1Space space(&mesh, &bcs, P_INIT);
+  int ndof = space.get_num_dofs();
+  info("ndof = %d", ndof);
+
+  // Assemble the system.
+  DiscreteProblem dp(&wf, &space, true);
+  UMFPackMatrix matrix;
+  UMFPackVector rhs;
+  dp.assemble(&matrix, &rhs);
+
+  // Direct solution.
+  UMFPackLinearSolver direct(&matrix, &rhs);
+  if (!direct.solve()) error ("Matrix solver failed.\n");
+  printf("UMFPack: %g s\n", direct.get_time());
+
+  bool success = true;
+  const scalar* sln = direct.get_solution();
+  const char* cg_preconds[] = { "none", "jacobi", "ssor", "ilu0" };
+  for (int i = 0; i < 4; i++)
+    if (!solve_krylov(&matrix, &rhs, sln, "cg", cg_preconds[i], 1)) success = false;
+  if (!solve_krylov(&matrix, &rhs, sln, "gmres", "ilut", 1)) success = false;
+  if (!solve_krylov(&matrix, &rhs, sln, "bicgstab", "ilu0", 1)) success = false;
+
+  // Multithreaded solves.
+  if (!solve_krylov(&matrix, &rhs, sln, "cg", "jacobi", NUM_THREADS)) success = false;
+  if (!solve_krylov(&matrix, &rhs, sln, "cg", "ssor", NUM_THREADS)) success = false;
+  if (!solve_krylov(&matrix, &rhs, sln, "gmres", "ilu0", NUM_THREADS)) success = false;
+  if (!solve_krylov(&matrix, &rhs, sln, "bicgstab", "ilut", NUM_THREADS)) success = false;
+
+  // A solver created through the factory, reusing the preconditioner in the second solve.
+  Solver* solver = create_linear_solver(SOLVER_KRYLOV, &matrix, &rhs);
+  static_cast<KrylovSolver*>(solver)->set_solver("cg");
+  static_cast<KrylovSolver*>(solver)->set_precond("ilu0");
+  static_cast<KrylovSolver*>(solver)->set_tolerance(TOLERANCE);
+  for (int i = 0; i < 2; i++) {
+    if (!solver->solve()) success = false;
+    solver->set_factorization_scheme(HERMES_REUSE_FACTORIZATION_COMPLETELY);
+  }
+  for (int i = 0; i < ndof; i++)
+    if (fabs(solver->get_solution()[i] - sln[i]) > MAX_DIFFERENCE * FIXED_BDY_TEMP) success = false;
+  delete solver;
+
+  if (success == true) {
+    printf("Success!\n");
+    return ERR_SUCCESS;
+  }
+  else {
+    printf("Failure!\n");
+    return ERR_FAILURE;
+  }
+}
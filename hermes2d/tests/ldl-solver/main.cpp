@@ -0,0 +1,153 @@
+#include "hermes2d.h"
+
+// This test compares the symmetric storage and the native LDL^T solver with UMFPack on the
+// tutorial examples P01-06-bc-newton (volume and surface forms) and P01-08-system (linear
+// elasticity with a multicomponent form and a symmetric off-diagonal block). The weak forms
+// have to be recognized as symmetric, the solutions have to agree with UMFPack, also when
+// the ordering and the factorization are reused. The Jacobian of P02-02-newton-1 must not
+// be recognized as symmetric. The number of stored nonzeros and the times are printed.
+// Pass the number of initial uniform refinements as the first argument to measure larger
+// problems.
+
+const int INIT_REF_NUM = 2;                       // Number of initial uniform mesh refinements.
+const double MAX_DIFFERENCE = 1e-10;              // Allowed relative difference from UMFPack.
+
+// Problem parameters.
+const double LAMBDA_AL = 236.0;
+const double LAMBDA_CU = 386.0;
+const double ALPHA = 5.0;
+const double T_EXTERIOR = 50.0;
+const double E  = 200e9;
+const double nu = 0.3;
+const double rho = 8000.0;
+const double g1 = -9.81;
+const double HEAT_SRC = 1.0;
+
+// Weak forms.
+#include "../../tutorial/P01-linear/06-bc-newton/definitions.cpp"
+#include "../../tutorial/P01-linear/08-system/definitions.cpp"
+#include "../../tutorial/P02-nonlinear/02-newton-1/definitions.cpp"
+
+static double difference(const scalar* x, const scalar* x_ref, int ndof)
+{
+  double diff = 0.0, norm = 0.0;
+  for (int i = 0; i < ndof; i++) {
+    diff += sqr(x[i] - x_ref[i]);
+    norm += sqr(x_ref[i]);
+  }
+  return sqrt(diff / norm);
+}
+
+// Solves the problem by UMFPack and by the solver selected for the weak form.
+bool compare_solvers(WeakForm* wf, Hermes::vector<Space *> spaces, const char* name)
+{
+  MatrixSolverType matrix_solver = wf->select_matrix_solver(SOLVER_UMFPACK);
+  if (matrix_solver != SOLVER_LDL) {
+    printf("%s: the weak form is not recognized as symmetric.\n", name);
+    return false;
+  }
+
+  DiscreteProblem dp(wf, spaces, true);
+  int ndof = dp.get_num_dofs();
+
+  UMFPackMatrix matrix;
+  UMFPackVector rhs;
+  dp.assemble(&matrix, &rhs);
+  UMFPackLinearSolver direct(&matrix, &rhs);
+  if (!direct.solve()) error ("Matrix solver failed.\n");
+
+  SparseMatrix* sym_matrix = create_matrix(matrix_solver);
+  Vector* sym_rhs = create_vector(matrix_solver);
+  Solver* solver = create_linear_solver(matrix_solver, sym_matrix, sym_rhs);
+  dp.assemble(sym_matrix, sym_rhs);
+
+  bool success = true;
+  const char* schemes[] = { "from scratch", "reusing the ordering", "reusing the factorization" };
+  for (int i = 0; i < 3; i++) {
+    if (i == 1) {
+      solver->set_factorization_scheme(HERMES_REUSE_MATRIX_REORDERING);
+      dp.assemble(sym_matrix, sym_rhs);
+    }
+    if (i == 2)
+      solver->set_factorization_scheme(HERMES_REUSE_FACTORIZATION_COMPLETELY);
+    if (!solver->solve()) error ("Matrix solver failed.\n");
+    double diff = difference(solver->get_solution(), direct.get_solution(), ndof);
+    printf("%-10s ndof: %d, LDL^T %s: %g s, UMFPack: %g s, difference %g\n", name, ndof, schemes[i],
+           solver->get_time(), direct.get_time(), diff);
+    if (diff > MAX_DIFFERENCE) success = false;
+  }
+  printf("%-10s stored nonzeros: %d (UMFPack %d), nonzeros of L: %d\n", name,
+         static_cast<SymCSCMatrix*>(sym_matrix)->get_nnz(), matrix.get_nnz(),
+         static_cast<LDLSolver*>(solver)->get_factor_nnz());
+
+  // The symmetric product.
+  scalar* x = new scalar[ndof];
+  scalar* y = new scalar[ndof];
+  scalar* y_ref = new scalar[ndof];
+  for (int i = 0; i < ndof; i++) x[i] = sin(1.0 + 7.0 * i);
+  sym_matrix->multiply_with_vector(x, y);
+  matrix.multiply_with_vector(x, y_ref);
+  if (difference(y, y_ref, ndof) > MAX_DIFFERENCE) {
+    printf("%s: the products with the matrices differ.\n", name);
+    success = false;
+  }
+  delete [] x;
+  delete [] y;
+  delete [] y_ref;
+
+  delete solver;
+  delete sym_matrix;
+  delete sym_rhs;
+  return success;
+}
+
+int main(int argc, char* argv[])
+{
+  bool success = true;
+  int ref_num = (argc > 1) ? atoi(argv[1]) : INIT_REF_NUM;
+
+  // Volume and surface forms.
+  {
+    Mesh mesh;
+    H2DReader mloader;
+    mloader.load("../../tutorial/P01-linear/06-bc-newton/domain.mesh", &mesh);
+    for (int i = 0; i < ref_num; i++) mesh.refine_all_elements();
+    CustomWeakFormPoissonNeumann wf("Aluminum", LAMBDA_AL, "Copper", LAMBDA_CU, 0.0, "Outer", ALPHA, T_EXTERIOR);
+    CustomDirichletCondition bc_essential(Hermes::vector<std::string>("Bottom", "Inner", "Left"), 0.0, 0.0, 20.0);
+    EssentialBCs bcs(&bc_essential);
+    H1Space space(&mesh, &bcs, 4);
+    if (!compare_solvers(&wf, &space, "bc-newton")) success = false;
+  }
+
+  // A system with a multicomponent form and a symmetric off-diagonal block.
+  {
+    Mesh mesh;
+    H2DReader mloader;
+    mloader.load("../../tutorial/P01-linear/08-system/domain.mesh", &mesh);
+    for (int i = 0; i < ref_num; i++) mesh.refine_all_elements();
+    DefaultEssentialBCConst zero_disp("1", 0.0);
+    EssentialBCs bcs(&zero_disp);
+    H1Space u1_space(&mesh, &bcs, 6);
+    H1Space u2_space(&mesh, &bcs, 6);
+    CustomWeakFormLinearElasticity wf(E, nu, rho*g1, "3", 0.0, 8e4);
+    if (!compare_solvers(&wf, Hermes::vector<Space *>(&u1_space, &u2_space), "system")) success = false;
+  }
+
+  // A nonsymmetric Jacobian.
+  {
+    CustomWeakFormHeatTransferNewton wf(HEAT_SRC);
+    if (wf.is_sym() || wf.select_matrix_solver(SOLVER_UMFPACK) != SOLVER_UMFPACK) {
+      printf("newton: the Jacobian is recognized as symmetric.\n");
+      success = false;
+    }
+  }
+
+  if (success == true) {
+    printf("Success!\n");
+    return ERR_SUCCESS;
+  }
+  else {
+    printf("Failure!\n");
+    return ERR_FAILURE;
+  }
+}
@@ -0,0 +1,93 @@
+#include "hermes2d.h"
+
+// This test checks the multithreaded Linearizer. A projection of the function of the tutorial
+// example P04-06-exact-adapt is linearized serially and by several threads. With two and with
+// NUM_THREADS threads the vertices and the triangles have to be the same. The serial result
+// differs slightly, because the maximum used by the refinement is not known in advance there,
+// so only the range of the values and the number of triangles are compared with it. The times
+// are printed for comparison.
+
+const int P_INIT = 4;                             // Polynomial degree of all mesh elements.
+const int INIT_REF_NUM = 5;                       // Number of initial uniform mesh refinements.
+const int NUM_THREADS = 4;                        // Number of threads of the multithreaded linearization.
+MatrixSolverType matrix_solver = SOLVER_UMFPACK;  // Possibilities: SOLVER_AMESOS, SOLVER_AZTECOO, SOLVER_MUMPS,
+                                                  // SOLVER_PETSC, SOLVER_SUPERLU, SOLVER_UMFPACK.
+
+// Exact solution.
+#include "../../tutorial/P04-linear-adapt/06-exact-adapt/exact_solution.cpp"
+
+// Linearizes the solution and returns the time.
+double linearize(Linearizer* lin, Solution* sln, int num_threads)
+{
+  TimePeriod cpu_time;
+  lin->set_num_threads(num_threads);
+  lin->process_solution(sln, H2D_FN_VAL_0, HERMES_EPS_HIGH);
+  double time = cpu_time.tick().last();
+  printf("%d threads: %g s, %d vertices, %d triangles, %d edges\n", num_threads, time,
+         lin->get_num_vertices(), lin->get_num_triangles(), lin->get_num_edges());
+  return time;
+}
+
+// Returns true if the two linearizers have the same vertices, triangles and edges.
+bool compare(Linearizer* a, Linearizer* b)
+{
+  if (a->get_num_vertices() != b->get_num_vertices() || a->get_num_triangles() != b->get_num_triangles() ||
+      a->get_num_edges() != b->get_num_edges())
+    return false;
+  if (memcmp(a->get_vertices(), b->get_vertices(), sizeof(double3) * a->get_num_vertices()) != 0 ||
+      memcmp(a->get_triangles(), b->get_triangles(), sizeof(int3) * a->get_num_triangles()) != 0 ||
+      memcmp(a->get_edges(), b->get_edges(), sizeof(int3) * a->get_num_edges()) != 0)
+    return false;
+  return true;
+}
+
+int main(int argc, char* argv[])
+{
+  Mesh mesh;
+  H2DReader mloader;
+  mloader.load("../../tutorial/P04-linear-adapt/06-exact-adapt/square.mesh", &mesh);
+  for (int i = 0; i < INIT_REF_NUM; i++) mesh.refine_all_elements();
+
+  H1Space space(&mesh, P_INIT);
+  ExactSolutionCustom exact(&mesh);
+  Solution sln;
+  OGProjection::project_global(&space, &exact, &sln, matrix_solver);
+
+  Linearizer lin_serial, lin_two, lin_parallel;
+  linearize(&lin_serial, &sln, 1);
+  linearize(&lin_two, &sln, 2);
+  linearize(&lin_parallel, &sln, NUM_THREADS);
+
+  bool success = compare(&lin_two, &lin_parallel);
+
+  // The values are taken at a slightly different set of points.
+  double range = lin_serial.get_max_value() - lin_serial.get_min_value();
+  if (fabs(lin_parallel.get_min_value() - lin_serial.get_min_value()) > 1e-3 * range ||
+      fabs(lin_parallel.get_max_value() - lin_serial.get_max_value()) > 1e-3 * range)
+    success = false;
+  printf("values: [%g, %g] serially, [%g, %g] with %d threads\n", lin_serial.get_min_value(),
+         lin_serial.get_max_value(), lin_parallel.get_min_value(), lin_parallel.get_max_value(), NUM_THREADS);
+
+  // The serial maximum grows while the elements are processed, the first ones are refined more.
+  if (lin_parallel.get_num_triangles() > lin_serial.get_num_triangles())
+    success = false;
+
+  // Vertices shared by the elements are merged.
+  if (lin_parallel.get_num_vertices() >= lin_serial.get_num_vertices())
+    success = false;
+
+  // The solution is left usable, e.g. for another linearization.
+  Linearizer lin_again;
+  linearize(&lin_again, &sln, 1);
+  if (!compare(&lin_again, &lin_serial))
+    success = false;
+
+  if (success == true) {
+    printf("Success!\n");
+    return ERR_SUCCESS;
+  }
+  else {
+    printf("Failure!\n");
+    return ERR_FAILURE;
+  }
+}
@@ -0,0 +1,194 @@
+#include "hermes2d.h"
+
+// This test checks the matrix-free product DiscreteProblem::apply() against the product
+// with the assembled matrix, serially and with several threads, on three problems:
+// the tutorial example P01-06-bc-newton (volume and surface forms, curved elements),
+// the linear elasticity system P01-08-system (a multicomponent form and a symmetric
+// off-diagonal block) and the Jacobian of the nonlinear problem P02-02-newton-1.
+// Finally the first problem is solved by conjugate gradients using only apply().
+
+const int NUM_THREADS = 4;                        // Number of threads of the multithreaded products.
+const double MAX_DIFFERENCE = 1e-10;              // Allowed relative difference of the products.
+const double CG_TOLERANCE = 1e-12;                // Relative residual of the matrix-free CG.
+const int CG_MAX_ITER = 10000;
+
+// Problem parameters.
+const double LAMBDA_AL = 236.0;
+const double LAMBDA_CU = 386.0;
+const double ALPHA = 5.0;
+const double T_EXTERIOR = 50.0;
+const double E  = 200e9;
+const double nu = 0.3;
+const double rho = 8000.0;
+const double g1 = -9.81;
+const double HEAT_SRC = 1.0;
+
+// Weak forms.
+#include "../../tutorial/P01-linear/06-bc-newton/definitions.cpp"
+#include "../../tutorial/P01-linear/08-system/definitions.cpp"
+#include "../../tutorial/P02-nonlinear/02-newton-1/definitions.cpp"
+
+// Some vector without structure.
+static void fill_vector(scalar* x, int ndof)
+{
+  for (int i = 0; i < ndof; i++)
+    x[i] = sin(1.0 + 7.0 * i);
+}
+
+// Compares apply() with the product with the assembled matrix.
+bool check_product(DiscreteProblem* dp, UMFPackMatrix* matrix, scalar* coeff_vec, const char* name)
+{
+  int ndof = dp->get_num_dofs();
+  scalar* x = new scalar[ndof];
+  scalar* y = new scalar[ndof];
+  scalar* y_ref = new scalar[ndof];
+  fill_vector(x, ndof);
+  matrix->multiply_with_vector(x, y_ref);
+
+  bool success = true;
+  int threads[] = { 1, NUM_THREADS };
+  for (int t = 0; t < 2; t++) {
+    dp->set_num_threads(threads[t]);
+    TimePeriod time;
+    dp->apply(x, y, coeff_vec);
+    double product_time = time.tick().last();
+
+    double diff = 0.0, norm = 0.0;
+    for (int i = 0; i < ndof; i++) {
+      diff += sqr(y[i] - y_ref[i]);
+      norm += sqr(y_ref[i]);
+    }
+    diff = sqrt(diff / norm);
+    printf("%-10s ndof: %d, threads: %d, %g s, difference %g\n", name, ndof, threads[t], product_time, diff);
+    if (diff > MAX_DIFFERENCE) success = false;
+  }
+  dp->set_num_threads(1);
+
+  delete [] x;
+  delete [] y;
+  delete [] y_ref;
+  return success;
+}
+
+// Solves the symmetric positive definite system by CG without a matrix.
+bool solve_matrix_free(DiscreteProblem* dp, Vector* rhs, const scalar* direct)
+{
+  int ndof = dp->get_num_dofs();
+  scalar* x = new scalar[ndof];
+  scalar* r = new scalar[ndof];
+  scalar* p = new scalar[ndof];
+  scalar* q = new scalar[ndof];
+
+  double rr = 0.0;
+  for (int i = 0; i < ndof; i++) {
+    x[i] = 0.0;
+    r[i] = p[i] = rhs->get(i);
+    rr += sqr(r[i]);
+  }
+  double norm_b = sqrt(rr);
+  int it;
+  for (it = 0; it < CG_MAX_ITER && sqrt(rr) > CG_TOLERANCE * norm_b; it++) {
+    dp->apply(p, q);
+    double pq = 0.0;
+    for (int i = 0; i < ndof; i++) pq += p[i] * q[i];
+    double alpha = rr / pq, rr_new = 0.0;
+    for (int i = 0; i < ndof; i++) {
+      x[i] += alpha * p[i];
+      r[i] -= alpha * q[i];
+      rr_new += sqr(r[i]);
+    }
+    for (int i = 0; i < ndof; i++) p[i] = r[i] + rr_new / rr * p[i];
+    rr = rr_new;
+  }
+
+  double diff = 0.0, norm = 0.0;
+  for (int i = 0; i < ndof; i++) {
+    diff += sqr(x[i] - direct[i]);
+    norm += sqr(direct[i]);
+  }
+  diff = sqrt(diff / norm);
+  printf("matrix-free CG: %d iterations, difference from UMFPack %g\n", it, diff);
+
+  delete [] x;
+  delete [] r;
+  delete [] p;
+  delete [] q;
+  return diff < 1e-8;
+}
+
+int main(int argc, char* argv[])
+{
+  bool success = true;
+
+  // Volume and surface forms.
+  {
+    Mesh mesh;
+    H2DReader mloader;
+    mloader.load("../../tutorial/P01-linear/06-bc-newton/domain.mesh", &mesh);
+    mesh.refine_all_elements();
+    CustomWeakFormPoissonNeumann wf("Aluminum", LAMBDA_AL, "Copper", LAMBDA_CU, 0.0, "Outer", ALPHA, T_EXTERIOR);
+    CustomDirichletCondition bc_essential(Hermes::vector<std::string>("Bottom", "Inner", "Left"), 0.0, 0.0, 20.0);
+    EssentialBCs bcs(&bc_essential);
+    H1Space space(&mesh, &bcs, 5);
+
+    DiscreteProblem dp(&wf, &space, true);
+    UMFPackMatrix matrix;
+    UMFPackVector rhs;
+    dp.assemble(&matrix, &rhs);
+    if (!check_product(&dp, &matrix, NULL, "bc-newton")) success = false;
+
+    UMFPackLinearSolver solver(&matrix, &rhs);
+    if (!solver.solve()) error ("Matrix solver failed.\n");
+    if (!solve_matrix_free(&dp, &rhs, solver.get_solution())) success = false;
+  }
+
+  // A system with a multicomponent form and a symmetric off-diagonal block.
+  {
+    Mesh mesh;
+    H2DReader mloader;
+    mloader.load("../../tutorial/P01-linear/08-system/domain.mesh", &mesh);
+    mesh.refine_all_elements();
+    DefaultEssentialBCConst zero_disp("1", 0.0);
+    EssentialBCs bcs(&zero_disp);
+    H1Space u1_space(&mesh, &bcs, 6);
+    H1Space u2_space(&mesh, &bcs, 6);
+    CustomWeakFormLinearElasticity wf(E, nu, rho*g1, "3", 0.0, 8e4);
+
+    DiscreteProblem dp(&wf, Hermes::vector<Space *>(&u1_space, &u2_space), true);
+    UMFPackMatrix matrix;
+    dp.assemble(&matrix);
+    if (!check_product(&dp, &matrix, NULL, "system")) success = false;
+  }
+
+  // The Jacobian of a nonlinear problem.
+  {
+    Mesh mesh;
+    H2DReader mloader;
+    mloader.load("../../tutorial/P02-nonlinear/02-newton-1/square.mesh", &mesh);
+    for (int i = 0; i < 3; i++) mesh.refine_all_elements();
+    CustomWeakFormHeatTransferNewton wf(HEAT_SRC);
+    DefaultEssentialBCConst bc_essential("1", 0.0);
+    EssentialBCs bcs(&bc_essential);
+    H1Space space(&mesh, &bcs, 3);
+    int ndof = space.get_num_dofs();
+
+    scalar* coeff_vec = new scalar[ndof];
+    for (int i = 0; i < ndof; i++)
+      coeff_vec[i] = 1.0 + 0.5 * cos(3.0 * i);
+
+    DiscreteProblem dp(&wf, &space, false);
+    UMFPackMatrix matrix;
+    dp.assemble(coeff_vec, &matrix);
+    if (!check_product(&dp, &matrix, coeff_vec, "newton")) success = false;
+    delete [] coeff_vec;
+  }
+
+  if (success == true) {
+    printf("Success!\n");
+    return ERR_SUCCESS;
+  }
+  else {
+    printf("Failure!\n");
+    return ERR_FAILURE;
+  }
+}
@@ -0,0 +1,74 @@
+#include "hermes2d.h"
+
+// This benchmark measures the node hash tables of the mesh: the mesh from the tutorial
+// example P01-03-poisson is repeatedly refined uniformly to about 10^5 elements, copied,
+// and unrefined back. After each step it makes sure that every node can be found by its
+// parent ids, and that unrefining restores the original number of nodes. Pass the number
+// of uniform refinements as the first argument to measure larger meshes.
+
+const int INIT_REF_NUM = 2;                       // Number of initial uniform mesh refinements.
+const int REF_NUM = 6;                            // Number of refinements in every cycle.
+const int NUM_CYCLES = 3;                         // Number of refinement/unrefinement cycles.
+
+// Checks that all nodes having parents are found in the hash tables.
+bool check_nodes(Mesh* mesh)
+{
+  Node* node;
+  for_all_nodes(node, mesh)
+  {
+    if (node->p1 < 0) continue;
+    Node* found = (node->type == HERMES_TYPE_VERTEX) ? mesh->peek_vertex_node(node->p1, node->p2)
+                                                     : mesh->peek_edge_node(node->p2, node->p1);
+    if (found != node) return false;
+  }
+  return true;
+}
+
+int main(int argc, char* argv[])
+{
+  int ref_num = (argc > 1) ? atoi(argv[1]) : REF_NUM;
+
+  // Load the mesh.
+  Mesh mesh;
+  H2DReader mloader;
+  mloader.load("../../tutorial/P01-linear/03-poisson/domain.mesh", &mesh);
+
+  // Perform initial mesh refinements.
+  for (int i = 0; i < INIT_REF_NUM; i++) mesh.refine_all_elements();
+  int num_nodes = mesh.get_num_nodes();
+
+  bool success = true;
+  TimePeriod cpu_time;
+  double time_ref = 0, time_copy = 0, time_unref = 0;
+  for (int cycle = 0; cycle < NUM_CYCLES; cycle++)
+  {
+    cpu_time.tick(HERMES_SKIP);
+    for (int i = 0; i < ref_num; i++) mesh.refine_all_elements();
+    time_ref += cpu_time.tick().last();
+    if (!check_nodes(&mesh)) success = false;
+
+    Mesh mesh_copy;
+    cpu_time.tick(HERMES_SKIP);
+    mesh_copy.copy(&mesh);
+    time_copy += cpu_time.tick().last();
+    if (!check_nodes(&mesh_copy)) success = false;
+
+    int num_elems = mesh.get_num_active_elements();
+    cpu_time.tick(HERMES_SKIP);
+    for (int i = 0; i < ref_num; i++) mesh.unrefine_all_elements();
+    time_unref += cpu_time.tick().last();
+    if (!check_nodes(&mesh) || mesh.get_num_nodes() != num_nodes) success = false;
+
+    info("cycle %d: %d elements, %d nodes.", cycle, num_elems, mesh_copy.get_num_nodes());
+  }
+  printf("refine: %g s, copy: %g s, unrefine: %g s\n", time_ref, time_copy, time_unref);
+
+  if (success == true) {
+    printf("Success!\n");
+    return ERR_SUCCESS;
+  }
+  else {
+    printf("Failure!\n");
+    return ERR_FAILURE;
+  }
+}
@@ -0,0 +1,129 @@
+#include "hermes2d.h"
+
+// This benchmark measures the loading of meshes in the Hermes2D format. A mesh of
+// N x N quads on the unit square, with a curved edge and a few initial refinements,
+// is written to a string and loaded both by the native parser and by the Python
+// reader, and the two meshes are compared. A small mesh using Python features the
+// native parser does not handle checks that such files are still read. Pass N as
+// the first argument to measure larger meshes (N = 450 gives about 200k elements).
+
+const int N = 200;                                // Number of quads in each direction.
+
+// Writes the mesh file, using variables, expressions, comments and string markers.
+std::string write_mesh(int n)
+{
+  std::ostringstream s;
+  s.precision(17);
+  s << "# unit square, " << n << " x " << n << " quads\n";
+  s << "h = 1.0 / " << n << "\n\n";
+  s << "vertices =\n{\n";
+  for (int j = 0; j <= n; j++)
+    for (int i = 0; i <= n; i++)
+      s << "  { " << i << "*h, " << (double) j / n << " }" << ((i == n && j == n) ? "" : ",") << "\n";
+  s << "}\n\nelements =\n[\n";
+  for (int j = 0; j < n; j++)
+    for (int i = 0; i < n; i++) {
+      int v = j * (n + 1) + i;
+      s << "  [ " << v << ", " << v + 1 << ", " << v + n + 2 << ", " << v + n + 1 << ", "
+        << ((i < n / 2) ? "\"Left\"" : "\"Right\"") << " ],\n";
+    }
+  s << "]\n\nboundaries =\n{\n";
+  for (int i = 0; i < n; i++) {
+    s << "  { " << i << ", " << i + 1 << ", \"Bottom\" },\n";
+    s << "  { " << n * (n + 1) + i + 1 << ", " << n * (n + 1) + i << ", \"Top\" },\n";
+    s << "  { " << (i + 1) * (n + 1) << ", " << i * (n + 1) << ", 1 },\n";
+    s << "  { " << i * (n + 1) + n << ", " << (i + 1) * (n + 1) + n << ", 2 }" << (i < n - 1 ? "," : "") << "\n";
+  }
+  s << "}\n\ncurves =\n{\n  { 0, 1, 2 * sqrt(2)^2 }\n}\n\n";
+  s << "refinements =\n{\n  { 0, 0 },\n  { " << n - 1 << ", 1 }\n}\n";
+  return s.str();
+}
+
+// Compares two elements, and their sons if they are refined.
+bool compare_elements(Element* ea, Element* eb)
+{
+  if (ea->nvert != eb->nvert || ea->marker != eb->marker || ea->active != eb->active ||
+      ea->is_curved() != eb->is_curved())
+    return false;
+  for (unsigned int j = 0; j < ea->nvert; j++)
+    if (ea->vn[j]->id != eb->vn[j]->id || ea->vn[j]->x != eb->vn[j]->x || ea->vn[j]->y != eb->vn[j]->y)
+      return false;
+
+  // Edge nodes exist only for active elements, refined ones store their sons in the same place.
+  if (ea->active)
+  {
+    for (unsigned int j = 0; j < ea->nvert; j++)
+      if (ea->en[j]->marker != eb->en[j]->marker)
+        return false;
+  }
+  else
+  {
+    for (int j = 0; j < 4; j++)
+    {
+      if ((ea->sons[j] == NULL) != (eb->sons[j] == NULL))
+        return false;
+      if (ea->sons[j] != NULL && !compare_elements(ea->sons[j], eb->sons[j]))
+        return false;
+    }
+  }
+  return true;
+}
+
+// Compares the vertices and the elements of two meshes.
+bool compare_meshes(Mesh* a, Mesh* b)
+{
+  if (a->get_num_nodes() != b->get_num_nodes() || a->get_num_active_elements() != b->get_num_active_elements())
+    return false;
+  for (int i = 0; i < a->get_num_base_elements(); i++)
+    if (!compare_elements(a->get_element_fast(i), b->get_element_fast(i)))
+      return false;
+  return true;
+}
+
+int main(int argc, char* argv[])
+{
+  int n = (argc > 1) ? atoi(argv[1]) : N;
+  std::string mesh_str = write_mesh(n);
+  info("Mesh file: %d kB.", (int) (mesh_str.length() / 1024));
+
+  // Native parser.
+  Mesh mesh;
+  H2DReader mloader;
+  TimePeriod cpu_time;
+  mloader.load_str(mesh_str.c_str(), &mesh);
+  double time_native = cpu_time.tick().last();
+  printf("native parser: %g s, %d elements, %d nodes\n", time_native,
+         mesh.get_num_active_elements(), mesh.get_num_nodes());
+
+  bool success = true;
+  if (mesh.get_num_active_elements() != n * n + 4 || !mesh.get_element(0)->is_curved())
+    success = false;
+
+  // Python reader.
+  Mesh mesh_py;
+  H2DReader mloader_py;
+  mloader_py.set_use_python(true);
+  cpu_time.tick(HERMES_SKIP);
+  mloader_py.load_str(mesh_str.c_str(), &mesh_py);
+  double time_python = cpu_time.tick().last();
+  printf("Python reader: %g s, speedup %g\n", time_python, time_python / time_native);
+  if (!compare_meshes(&mesh, &mesh_py)) success = false;
+
+  // A tuple assignment is not understood by the native parser, the file is read by Python.
+  Mesh mesh_small;
+  mloader.load_str("a, b = 0.0, 1.0\n"
+                   "vertices = [ [a, a], [b, a], [b, b], [a, b] ]\n"
+                   "elements = [ [0, 1, 2, 3, 0] ]\n"
+                   "boundaries = [ [0, 1, 1], [1, 2, 1], [2, 3, 1], [3, 0, 1] ]\n", &mesh_small);
+  if (mesh_small.get_num_active_elements() != 1 || mesh_small.get_node(2)->x != 1.0)
+    success = false;
+
+  if (success == true) {
+    printf("Success!\n");
+    return ERR_SUCCESS;
+  }
+  else {
+    printf("Failure!\n");
+    return ERR_FAILURE;
+  }
+}
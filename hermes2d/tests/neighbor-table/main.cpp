@@ -0,0 +1,122 @@
+#include "hermes2d.h"
+
+// This test checks the neighbor tables of DG assembling. On the irregular mesh of the tutorial
+// example P08-01-linear-advection-dg, the neighbors of all edges taken from a NeighborTable must
+// be the same as those found by NeighborSearch, also for a copy of the mesh, and the table must
+// become outdated when the mesh is refined. The linear advection problem of the example
+// linear-advection-dg-adapt is then solved on this mesh (its assembling takes the neighbors from
+// the tables) and the solution is compared with values obtained before the tables were added.
+// Finally, the time of the DG assembling on a finer mesh is printed.
+
+const int P_INIT = 1;                             // Polynomial degree of mesh elements.
+const int INIT_REF = 1;                           // Number of initial uniform mesh refinements.
+const int P_TIME = 1;                             // Polynomial degree used for timing.
+const int INIT_REF_TIME = 4;                      // Number of initial uniform mesh refinements used for timing.
+MatrixSolverType matrix_solver = SOLVER_UMFPACK;  // Possibilities: SOLVER_AMESOS, SOLVER_AZTECOO, SOLVER_MUMPS,
+                                                  // SOLVER_PETSC, SOLVER_SUPERLU, SOLVER_UMFPACK.
+
+// Weak forms.
+#include "../../examples/advection-diffusion-reaction/linear-advection-dg-adapt/definitions.cpp"
+
+// Compares the neighbors of all edges of the mesh found by NeighborSearch and taken from the table
+// (the table returns the elements of the mesh it was built for, they are compared by their ids).
+bool compare_neighbors(Mesh* mesh, NeighborTable* table)
+{
+  Element* e;
+  for_all_active_elements(e, mesh) {
+    NeighborSearch ns(e, mesh), nt(e, mesh, table);
+    ns.set_ignore_errors(true);
+    nt.set_ignore_errors(true);
+    for (unsigned int edge = 0; edge < e->nvert; edge++) {
+      ns.set_active_edge(edge);
+      nt.set_active_edge(edge);
+      if (ns.get_num_neighbors() != nt.get_num_neighbors() ||
+          table->get_num_neighbors(e, edge) != ns.get_num_neighbors())
+        return false;
+      for (int i = 0; i < ns.get_num_neighbors(); i++)
+        if ((*ns.get_neighbors())[i] != (*nt.get_neighbors())[i] || table->get_neighbor(e, edge, i)->id != (*ns.get_neighbors())[i]->id ||
+            ns.get_neighb_edge_number(i) != nt.get_neighb_edge_number(i) ||
+            ns.get_neighb_edge_orientation(i) != nt.get_neighb_edge_orientation(i))
+          return false;
+    }
+  }
+  return true;
+}
+
+// Assembles and solves the example, returns the time of the assembling.
+double solve(Mesh* mesh, int p, Solution* sln)
+{
+  L2Space space(mesh, p);
+  CustomWeakForm wf("1");
+  DiscreteProblem dp(&wf, &space, true);
+
+  SparseMatrix* matrix = create_matrix(matrix_solver);
+  Vector* rhs = create_vector(matrix_solver);
+  Solver* solver = create_linear_solver(matrix_solver, matrix, rhs);
+
+  TimePeriod cpu_time;
+  dp.assemble(matrix, rhs);
+  double time = cpu_time.tick().last();
+  info("ndof: %d, assembling: %g s.", Space::get_num_dofs(&space), time);
+
+  if (solver->solve())
+    Solution::vector_to_solution(solver->get_solution(), &space, sln);
+  else
+    error("Matrix solver failed.");
+
+  delete solver;
+  delete matrix;
+  delete rhs;
+  return time;
+}
+
+int main(int argc, char* argv[])
+{
+  Mesh mesh;
+  H2DReader mloader;
+  mloader.load("../../tutorial/P08-fvm-and-dg/01-linear-advection-dg/square.mesh", &mesh);
+  for (int i = 0; i < INIT_REF; i++) mesh.refine_all_elements();
+
+  bool success = true;
+
+  // The table against the search, on the mesh and on its copy.
+  NeighborTable table(&mesh);
+  Mesh mesh_copy;
+  mesh_copy.copy(&mesh);
+  if (!compare_neighbors(&mesh, &table) || !compare_neighbors(&mesh_copy, &table) ||
+      !table.is_up_to_date(&mesh))
+    success = false;
+
+  // Solution of the example.
+  Solution sln;
+  solve(&mesh, P_INIT, &sln);
+  double coor_x_y[4] = {0.1, 0.3, 0.5, 0.7};
+  double value[4] = {0.999437, 1.061301, 0.000000, 0.000000};
+  for (int i = 0; i < 4; i++)
+    if (fabs(value[i] - sln.get_pt_value(coor_x_y[i], coor_x_y[i])) > 1E-6)
+      success = false;
+
+  // A refinement makes the table outdated.
+  mesh_copy.refine_all_elements();
+  if (table.is_up_to_date(&mesh_copy))
+    success = false;
+  NeighborTable table_copy(&mesh_copy);
+  if (!compare_neighbors(&mesh_copy, &table_copy))
+    success = false;
+
+  // Timing on a finer mesh.
+  Mesh mesh_fine;
+  mloader.load("../../tutorial/P08-fvm-and-dg/01-linear-advection-dg/square.mesh", &mesh_fine);
+  for (int i = 0; i < INIT_REF_TIME; i++) mesh_fine.refine_all_elements();
+  Solution sln_fine;
+  printf("DG assembling: %g s\n", solve(&mesh_fine, P_TIME, &sln_fine));
+
+  if (success == true) {
+    printf("Success!\n");
+    return ERR_SUCCESS;
+  }
+  else {
+    printf("Failure!\n");
+    return ERR_FAILURE;
+  }
+}
@@ -0,0 +1,110 @@
+#include "hermes2d.h"
+
+// This test checks the Newton's method of Hermes2D::solve_newton(), which assembles the
+// residual and the Jacobian at the same iterate in one traversal, and its modified variant
+// reusing the Jacobian. The nonlinear heat transfer problem of the tutorial example
+// P02-03-newton-2 is solved by the original loop (the residual and the Jacobian assembled
+// separately), by the fused one and by the modified Newton's method. The solutions have
+// to agree within the tolerance, the times are printed for comparison.
+
+const int P_INIT = 4;                             // Initial polynomial degree.
+const double NEWTON_TOL = 1e-8;                   // Stopping criterion for the Newton's method.
+const int NEWTON_MAX_ITER = 100;                  // Maximum allowed number of Newton iterations.
+const double JACOBIAN_REUSE_CONTRACTION = 0.5;    // Residual contraction required to reuse the Jacobian.
+const int INIT_GLOB_REF_NUM = 3;                  // Number of initial uniform mesh refinements.
+const int INIT_BDY_REF_NUM = 4;                   // Number of initial refinements towards boundary.
+MatrixSolverType matrix_solver = SOLVER_UMFPACK;  // Possibilities: SOLVER_AMESOS, SOLVER_AZTECOO, SOLVER_MUMPS,
+                                                  // SOLVER_PETSC, SOLVER_SUPERLU, SOLVER_UMFPACK.
+
+// Boundary markers.
+const std::string BDY_DIRICHLET = "1";
+
+// Weak forms.
+#include "../../tutorial/P02-nonlinear/03-newton-2/definitions.cpp"
+
+// The Newton's loop of solve_newton() before the residual and the Jacobian were fused.
+bool solve_newton_separately(scalar* coeff_vec, DiscreteProblem* dp, Solver* solver, SparseMatrix* matrix,
+                             Vector* rhs, double newton_tol, int newton_max_iter)
+{
+  Hermes2D hermes2d;
+  int ndof = dp->get_num_dofs();
+  for (int it = 1; it <= newton_max_iter; it++) {
+    dp->assemble(coeff_vec, NULL, rhs);
+    if (hermes2d.get_l2_norm(rhs) < newton_tol && it > 1) return true;
+    dp->assemble(coeff_vec, matrix, NULL);
+    rhs->change_sign();
+    if (!solver->solve()) error ("Matrix solver failed.\n");
+    for (int i = 0; i < ndof; i++) coeff_vec[i] += solver->get_solution()[i];
+  }
+  return false;
+}
+
+int main(int argc, char* argv[])
+{
+  // Load the mesh and perform initial refinements.
+  Mesh mesh;
+  H2DReader mloader;
+  mloader.load("../../tutorial/P02-nonlinear/03-newton-2/square.mesh", &mesh);
+  for (int i = 0; i < INIT_GLOB_REF_NUM; i++) mesh.refine_all_elements();
+  mesh.refine_towards_boundary(BDY_DIRICHLET, INIT_BDY_REF_NUM);
+
+  // Initialize boundary conditions, the space and the weak formulation.
+  CustomEssentialBCNonConst bc_essential(BDY_DIRICHLET);
+  EssentialBCs bcs(&bc_essential);
+  H1Space space(&mesh, &bcs, P_INIT);
+  int ndof = Space::get_num_dofs(&space);
+  info("ndof = %d", ndof);
+  CustomWeakFormHeatTransferNewton wf;
+
+  // Initial coefficient vector, the projection of the initial solution.
+  scalar* coeff_vec_init = new scalar[ndof];
+  CustomInitialSolutionHeatTransfer init_sln(&mesh);
+  OGProjection::project_global(&space, &init_sln, coeff_vec_init, matrix_solver);
+
+  Hermes2D hermes2d;
+  bool success = true;
+  scalar* coeff_vec[3];
+  double time[3];
+  for (int run = 0; run < 3; run++) {
+    DiscreteProblem dp(&wf, &space, false);
+    SparseMatrix* matrix = create_matrix(matrix_solver);
+    Vector* rhs = create_vector(matrix_solver);
+    Solver* solver = create_linear_solver(matrix_solver, matrix, rhs);
+    coeff_vec[run] = new scalar[ndof];
+    memcpy(coeff_vec[run], coeff_vec_init, ndof * sizeof(scalar));
+
+    TimePeriod cpu_time;
+    bool converged;
+    if (run == 0)
+      converged = solve_newton_separately(coeff_vec[run], &dp, solver, matrix, rhs, NEWTON_TOL, NEWTON_MAX_ITER);
+    else
+      converged = hermes2d.solve_newton(coeff_vec[run], &dp, solver, matrix, rhs, NEWTON_TOL, NEWTON_MAX_ITER,
+                                        true, false, 1.0, 1e6, (run == 2) ? JACOBIAN_REUSE_CONTRACTION : 0.0);
+    time[run] = cpu_time.tick().last();
+    if (!converged) success = false;
+
+    delete solver;
+    delete matrix;
+    delete rhs;
+  }
+  printf("separate assembling: %g s, fused: %g s, modified Newton: %g s\n", time[0], time[1], time[2]);
+
+  // Both Newton's methods converge to the same discrete solution.
+  for (int run = 1; run < 3; run++)
+    for (int i = 0; i < ndof; i++)
+      if (std::abs(coeff_vec[run][i] - coeff_vec[0][i]) > 1e-6)
+        success = false;
+
+  for (int run = 0; run < 3; run++)
+    delete [] coeff_vec[run];
+  delete [] coeff_vec_init;
+
+  if (success == true) {
+    printf("Success!\n");
+    return ERR_SUCCESS;
+  }
+  else {
+    printf("Failure!\n");
+    return ERR_FAILURE;
+  }
+}
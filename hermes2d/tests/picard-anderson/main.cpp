@@ -0,0 +1,88 @@
+#include "hermes2d.h"
+
+// This test checks the Anderson-accelerated Picard's iteration on the tutorial example
+// P02-01-picard (nonlinear heat conductivity 1 + u^4) with a four times stronger heat
+// source. With the zero Dirichlet condition, the plain Picard's iteration needs about
+// 150 iterations, the accelerated one has to converge within ANDERSON_MAX_ITER iterations
+// (with the tolerance in the H1 norm and on the coefficient vectors). With a nonzero
+// Dirichlet condition, the H1 norm of the iterates includes the Dirichlet lift. The
+// results have to agree with the damped Picard's iteration.
+
+const int P_INIT = 2;                             // Initial polynomial degree.
+const int INIT_GLOB_REF_NUM = 3;                  // Number of initial uniform mesh refinements.
+const int INIT_BDY_REF_NUM = 5;                   // Number of initial refinements towards boundary.
+const double PICARD_TOL = 1e-6;                   // Stopping criterion for the Picard's method.
+const int PICARD_MAX_ITER = 100;                  // Maximum allowed number of Picard iterations.
+const int ANDERSON_MAX_ITER = 40;                 // Iterations allowed to the accelerated method.
+const int ANDERSON_WINDOW = 5;                    // Number of the previous iterates used by Anderson mixing.
+const double INIT_COND_CONST = 3.0;               // Constant initial condition.
+const double DAMPING = 0.5;                       // Damping of the reference and of the accelerated iteration.
+const double MAX_DIFFERENCE = 1e-6;               // Allowed relative difference of the results.
+
+// Problem parameters.
+double HEAT_SRC = 4.0;
+
+// Weak forms.
+#include "../../tutorial/P02-nonlinear/01-picard/definitions.cpp"
+
+// Runs the Picard's iteration from the constant initial condition, returns whether it
+// converged and the values at a few points.
+bool picard(Space* space, int max_iter, int anderson_window, double beta, bool tol_on_coeff_vec,
+            double* values)
+{
+  Hermes2D hermes2d;
+  Solution sln_prev_iter(space->get_mesh(), INIT_COND_CONST);
+  CustomWeakFormHeatTransferPicard wf(&sln_prev_iter, HEAT_SRC);
+  TimePeriod time;
+  bool converged = hermes2d.solve_picard(&wf, space, &sln_prev_iter, SOLVER_UMFPACK, PICARD_TOL,
+                                         max_iter, false, anderson_window, beta, tol_on_coeff_vec);
+  printf("max. %d iterations, Anderson window %d, damping %g, tolerance on %s: %s, %g s\n", max_iter,
+         anderson_window, beta, tol_on_coeff_vec ? "coefficients" : "H1 norm",
+         converged ? "converged" : "not converged", time.tick().last());
+  for (int i = 0; i < 5; i++)
+    values[i] = sln_prev_iter.get_pt_value(-9.0 + 4.5 * i, -9.0 + 4.0 * i);
+  return converged;
+}
+
+bool compare(double* values, double* ref_values)
+{
+  bool success = true;
+  for (int i = 0; i < 5; i++)
+    if (std::abs(values[i] - ref_values[i]) > MAX_DIFFERENCE * std::abs(ref_values[i])) success = false;
+  if (!success) printf("The results of the damped and accelerated iterations differ.\n");
+  return success;
+}
+
+int main(int argc, char* argv[])
+{
+  bool success = true;
+  double bdy_values[] = { 0.0, 1.0 };
+  for (int b = 0; b < 2; b++) {
+    Mesh mesh;
+    H2DReader mloader;
+    mloader.load("../../tutorial/P02-nonlinear/01-picard/square.mesh", &mesh);
+    for(int i = 0; i < INIT_GLOB_REF_NUM; i++) mesh.refine_all_elements();
+    mesh.refine_towards_boundary("1", INIT_BDY_REF_NUM);
+    DefaultEssentialBCConst bc_essential("1", bdy_values[b]);
+    EssentialBCs bcs(&bc_essential);
+    H1Space space(&mesh, &bcs, P_INIT);
+    printf("Dirichlet value %g, ndof %d\n", bdy_values[b], space.get_num_dofs());
+
+    double ref_values[5], values[5];
+    if (!picard(&space, PICARD_MAX_ITER, 0, DAMPING, false, ref_values)) success = false;
+    if (b == 0 && picard(&space, ANDERSON_MAX_ITER, 0, 1.0, false, values)) success = false;
+    if (!picard(&space, ANDERSON_MAX_ITER, ANDERSON_WINDOW, 1.0, false, values)) success = false;
+    if (!compare(values, ref_values)) success = false;
+    if (!picard(&space, ANDERSON_MAX_ITER, ANDERSON_WINDOW, DAMPING, true, values)) success = false;
+    if (!compare(values, ref_values)) success = false;
+  }
+
+  if (success == true) {
+    printf("Success!\n");
+    return ERR_SUCCESS;
+  }
+  else {
+    printf("Failure!\n");
+    return ERR_FAILURE;
+  }
+}
@@ -0,0 +1,111 @@
+#include "hermes2d.h"
+
+// This test evaluates a solution at random points of the mesh from the tutorial
+// example P01-03-poisson (triangles, quads and two curved edges, refined with
+// hanging nodes). It makes sure that the spatial index used by Solution::get_pt_value()
+// finds the same elements as a sequential search through all elements, and that
+// the batch query Solution::get_pt_values() gives the same values as single queries.
+
+const int P_INIT = 3;                             // Uniform polynomial degree of mesh elements.
+const int INIT_REF_NUM = 3;                       // Number of initial uniform mesh refinements.
+const int NUM_POINTS = 10000;                     // Number of query points.
+
+// Returns the active element containing (x, y) by checking all elements.
+Element* find_element_sequentially(Mesh* mesh, RefMap* refmap, double x, double y)
+{
+  Element* e;
+  for_all_active_elements(e, mesh)
+  {
+    double xi1, xi2;
+    refmap->set_active_element(e);
+    refmap->untransform(e, x, y, xi1, xi2);
+    if (ElementLocator::is_in_ref_domain(e, xi1, xi2)) return e;
+  }
+  return NULL;
+}
+
+int main(int argc, char* argv[])
+{
+  // Load the mesh.
+  Mesh mesh;
+  H2DReader mloader;
+  mloader.load("../../tutorial/P01-linear/03-poisson/domain.mesh", &mesh);
+
+  // Perform initial mesh refinements, then refine some elements to get hanging nodes.
+  for (int i = 0; i < INIT_REF_NUM; i++) mesh.refine_all_elements();
+  srand(1);
+  for (int i = 0; i < 20; i++)
+  {
+    Element* e = mesh.get_element_fast(rand() % mesh.get_max_element_id());
+    if (e->used && e->active) mesh.refine_element_id(e->id);
+  }
+
+  // Create a solution with arbitrary coefficients.
+  H1Space space(&mesh, NULL, P_INIT);
+  int ndof = space.get_num_dofs();
+  scalar* coeff_vec = new scalar[ndof];
+  for (int i = 0; i < ndof; i++) coeff_vec[i] = sin(0.1 * i);
+  Solution sln, sln_single;
+  Solution::vector_to_solution(coeff_vec, &space, &sln);
+  Solution::vector_to_solution(coeff_vec, &space, &sln_single);
+
+  // Random points in the domain, half of them close to the curved edges.
+  std::vector<double> x, y;
+  while ((int) x.size() < NUM_POINTS)
+  {
+    double px, py;
+    if (x.size() % 2)
+    {
+      double r = 0.98 + 0.02 * rand() / RAND_MAX, phi = 0.5 * M_PI * rand() / RAND_MAX;
+      px = r * cos(phi);
+      py = r * sin(phi);
+    }
+    else
+    {
+      px = -1.0 + 2.0 * rand() / RAND_MAX;
+      py = -1.0 + 2.0 * rand() / RAND_MAX;
+      if ((px < 0 && py < 0) || (px > 0 && py > 0 && px*px + py*py > 1.0)) continue;
+    }
+    x.push_back(px);
+    y.push_back(py);
+  }
+
+  bool success = true;
+
+  // Compare the elements found by the locator with the sequential search.
+  ElementLocator locator(&mesh);
+  RefMap refmap, refmap_seq;
+  for (int i = 0; i < NUM_POINTS; i++)
+  {
+    double xi1, xi2;
+    Element* e = locator.get_element(x[i], y[i], &refmap, xi1, xi2);
+    Element* e_seq = find_element_sequentially(&mesh, &refmap_seq, x[i], y[i]);
+    // Points on element edges may be found in either of the neighbors.
+    if (e == NULL || e_seq == NULL || (e != e_seq && !ElementLocator::is_in_ref_domain(e, xi1, xi2)))
+    {
+      printf("point (%g, %g): wrong element.\n", x[i], y[i]);
+      success = false;
+    }
+  }
+
+  // Compare the batch query with single queries.
+  std::vector<scalar> values(NUM_POINTS);
+  TimePeriod cpu_time;
+  sln.get_pt_values(&x[0], &y[0], NUM_POINTS, &values[0]);
+  printf("get_pt_values: %g s\n", cpu_time.tick().last());
+  for (int i = 0; i < NUM_POINTS; i++)
+    if (std::abs(values[i] - sln_single.get_pt_value(x[i], y[i])) > 1e-12)
+      success = false;
+  printf("get_pt_value: %g s\n", cpu_time.tick().last());
+
+  delete [] coeff_vec;
+
+  if (success == true) {
+    printf("Success!\n");
+    return ERR_SUCCESS;
+  }
+  else {
+    printf("Failure!\n");
+    return ERR_FAILURE;
+  }
+}
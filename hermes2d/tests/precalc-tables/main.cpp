@@ -0,0 +1,145 @@
+#include "hermes2d.h"
+
+// This benchmark measures the precalculated shape function tables: for every element
+// of a p=8 space on the mesh from the tutorial example P01-03-poisson, all shape functions
+// of the element are activated and their values and derivatives are looked up, as the
+// assembling does it. The first pass fills the tables, the following ones only look the
+// values up. The values are checked against the shapeset, both on the master element and
+// on a sub-element, and the value tables are checked to be aligned. Finally the time of
+// the whole assembling of the Poisson problem is printed for comparison.
+
+const int P_INIT = 8;                             // Uniform polynomial degree of mesh elements.
+const int INIT_REF_NUM = 3;                       // Number of initial uniform mesh refinements.
+const int NUM_PASSES = 20;                        // Number of lookup passes over the mesh.
+
+// Problem parameters.
+const double LAMBDA_AL = 236.0;            // Thermal cond. of Al for temperatures around 20 deg Celsius.
+const double LAMBDA_CU = 386.0;            // Thermal cond. of Cu for temperatures around 20 deg Celsius.
+const double VOLUME_HEAT_SRC = 5e2;        // Volume heat sources generated by electric current.
+const double FIXED_BDY_TEMP = 20.0;        // Fixed temperature on the boundary.
+
+// Weak forms.
+#include "../../tutorial/P01-linear/03-poisson/definitions.cpp"
+
+// Integration order used for the lookups (the order of the stiffness matrix integrand).
+int get_order(Quad2D* quad)
+{
+  return std::min(2 * P_INIT, quad->get_max_order());
+}
+
+// Compares the values of the active shape function with the shapeset, in the
+// integration points transformed to the current sub-element. On the master element
+// the value tables have to be aligned.
+bool check_values(PrecalcShapeset* pss, Quad2D* quad, int index)
+{
+  Trf* ctm = pss->get_ctm();
+  int order = get_order(quad);
+  int np = quad->get_num_points(order);
+  double3* pt = quad->get_points(order);
+  Shapeset* shapeset = pss->get_shapeset();
+
+  double* val = pss->get_fn_values();
+  double *dx, *dy;
+  pss->get_dx_dy_values(dx, dy);
+  if (pss->get_transform() == 0 &&
+      ((size_t) val % H2D_PRECALC_ALIGNMENT != 0 || (size_t) dx % H2D_PRECALC_ALIGNMENT != 0))
+    return false;
+
+  for (int i = 0; i < np; i++) {
+    double x = ctm->m[0] * pt[i][0] + ctm->t[0], y = ctm->m[1] * pt[i][1] + ctm->t[1];
+    if (std::abs(val[i] - shapeset->get_fn_value(index, x, y, 0)) > 1e-12 ||
+        std::abs(dx[i] - shapeset->get_dx_value(index, x, y, 0)) > 1e-12 ||
+        std::abs(dy[i] - shapeset->get_dy_value(index, x, y, 0)) > 1e-12)
+      return false;
+  }
+  return true;
+}
+
+int main(int argc, char* argv[])
+{
+  // Load the mesh.
+  Mesh mesh;
+  H2DReader mloader;
+  mloader.load("../../tutorial/P01-linear/03-poisson/domain.mesh", &mesh);
+
+  // Perform initial mesh refinements.
+  for (int i = 0; i < INIT_REF_NUM; i++) mesh.refine_all_elements();
+
+  // Initialize boundary conditions.
+  DefaultEssentialBCConst bc_essential(Hermes::vector<std::string>("Bottom", "Inner", "Outer", "Left"), FIXED_BDY_TEMP);
+  EssentialBCs bcs(&bc_essential);
+
+  // Create an H1 space with default shapeset.
+  H1Space space(&mesh, &bcs, P_INIT);
+  int ndof = space.get_num_dofs();
+  info("ndof = %d", ndof);
+
+  // Lookups of the shape function values, element by element.
+  PrecalcShapeset pss(space.get_shapeset());
+  Quad2D* quad = pss.get_quad_2d();
+  AsmList al;
+  Element* e;
+  double sum = 0, time_first = 0, time_lookup = 0;
+  TimePeriod cpu_time;
+  for (int pass = 0; pass <= NUM_PASSES; pass++) {
+    cpu_time.tick(HERMES_SKIP);
+    for_all_active_elements(e, &mesh) {
+      pss.set_active_element(e);
+      space.get_element_assembly_list(e, &al);
+      int order = get_order(quad);
+      for (unsigned int i = 0; i < al.cnt; i++) {
+        pss.set_active_shape(al.idx[i]);
+        pss.set_quad_order(order);
+        double *dx, *dy;
+        pss.get_dx_dy_values(dx, dy);
+        sum += pss.get_fn_values()[0] + dx[0] + dy[0];
+      }
+    }
+    if (pass == 0) time_first = cpu_time.tick().last();
+    else time_lookup += cpu_time.tick().last();
+  }
+  int num_elems = mesh.get_num_active_elements();
+  printf("first pass: %g us per element, lookups: %g us per element (checksum %g)\n",
+         1e6 * time_first / num_elems, 1e6 * time_lookup / (NUM_PASSES * num_elems), sum);
+
+  // Check the values on the master element and on a sub-element of a triangle and a quad.
+  bool success = true;
+  for (int mode = 0; mode < 2; mode++) {
+    for_all_active_elements(e, &mesh)
+      if (e->get_mode() == mode) break;
+    pss.set_active_element(e);
+    space.get_element_assembly_list(e, &al);
+    for (unsigned int i = 0; i < al.cnt; i++) {
+      pss.set_active_shape(al.idx[i]);
+      pss.set_quad_order(get_order(quad));
+      if (!check_values(&pss, quad, al.idx[i])) success = false;
+
+      pss.push_transform(1);
+      pss.set_quad_order(get_order(quad));
+      if (!check_values(&pss, quad, al.idx[i])) success = false;
+      pss.pop_transform();
+
+      pss.set_quad_order(get_order(quad));
+      if (!check_values(&pss, quad, al.idx[i])) success = false;
+    }
+  }
+
+  // The whole assembling, for comparison.
+  CustomWeakFormPoisson wf("Aluminum", LAMBDA_AL, "Copper", LAMBDA_CU, VOLUME_HEAT_SRC);
+  DiscreteProblem dp(&wf, &space, true);
+  CSCMatrix matrix;
+  UMFPackVector rhs;
+  cpu_time.tick(HERMES_SKIP);
+  dp.assemble(&matrix, &rhs);
+  double time_asm = cpu_time.tick().last();
+  printf("assembling: %g us per element\n", 1e6 * time_asm / num_elems);
+
+  if (success == true) {
+    printf("Success!\n");
+    return ERR_SUCCESS;
+  }
+  else {
+    printf("Failure!\n");
+    return ERR_FAILURE;
+  }
+}
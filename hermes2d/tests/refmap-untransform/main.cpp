@@ -0,0 +1,108 @@
+#include "hermes2d.h"
+
+// This test checks the batched RefMap::untransform(). The mesh contains affine triangles
+// and parallelograms, general straight quads and curved elements. In every element, points
+// are mapped from random reference coordinates to the physical domain and back by the batched
+// untransform, which has to return the reference coordinates, and by the Newton method
+// evaluating the map point by point through RefMap::inv_ref_map_at_point(). The times of the
+// two are printed.
+
+const int INIT_REF_NUM = 2;                       // Number of initial uniform mesh refinements.
+const int NUM_POINTS = 200;                       // Number of points per element.
+
+// Newton method working one point at a time, starting at the center of the reference domain.
+void untransform_pointwise(RefMap* refmap, double x, double y, double& xi1, double& xi2)
+{
+  double xi1_old = 0.0, xi2_old = 0.0;
+  for (int it = 0; it <= 100; it++)
+  {
+    double vx, vy;
+    double2x2 m;
+    refmap->inv_ref_map_at_point(xi1_old, xi2_old, vx, vy, m);
+    xi1 = xi1_old - (m[0][0] * (vx - x) + m[1][0] * (vy - y));
+    xi2 = xi2_old - (m[0][1] * (vx - x) + m[1][1] * (vy - y));
+    if (fabs(xi1 - xi1_old) < 1e-12 && fabs(xi2 - xi2_old) < 1e-12) return;
+    xi1_old = xi1;
+    xi2_old = xi2;
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  // Two general quads, a parallelogram, a trapezoid, and a triangle with a curved edge.
+  Mesh mesh;
+  H2DReader mloader;
+  mloader.load_str("vertices = [ [0, 0], [1, 0], [2, 0], [0, 1], [1.3, 1.2], [2, 1], [0, 2], [1.3, 2.2], [2, 2], [3, 1] ]\n"
+                   "elements = [ [0, 1, 4, 3, 0], [1, 2, 5, 4, 0], [3, 4, 7, 6, 0], [4, 5, 8, 7, 0], [2, 9, 5, 0] ]\n"
+                   "boundaries = [ [0, 1, 1], [1, 2, 1], [2, 9, 1], [9, 5, 1], [5, 8, 1], [8, 7, 1], [7, 6, 1], [6, 3, 1], [3, 0, 1] ]\n"
+                   "curves = [ [2, 9, 60] ]\n", &mesh);
+  for (int i = 0; i < INIT_REF_NUM; i++) mesh.refine_all_elements();
+
+  bool success = true;
+  int num_const = 0, num_curved = 0, num_elems = 0;
+  double time_batch = 0.0, time_pointwise = 0.0;
+  TimePeriod cpu_time;
+  RefMap refmap;
+  srand(1);
+
+  Element* e;
+  for_all_active_elements(e, &mesh)
+  {
+    refmap.set_active_element(e);
+    num_elems++;
+    if (refmap.is_jacobian_const()) num_const++;
+    if (e->is_curved()) num_curved++;
+
+    // Random points of the reference domain and their images.
+    double ref1[NUM_POINTS], ref2[NUM_POINTS], x[NUM_POINTS], y[NUM_POINTS];
+    for (int i = 0; i < NUM_POINTS; i++)
+    {
+      do
+      {
+        ref1[i] = -1.0 + 2.0 * rand() / RAND_MAX;
+        ref2[i] = -1.0 + 2.0 * rand() / RAND_MAX;
+      }
+      while (e->is_triangle() && ref1[i] + ref2[i] > 0.0);
+      double2x2 m;
+      refmap.inv_ref_map_at_point(ref1[i], ref2[i], x[i], y[i], m);
+    }
+
+    double xi1[NUM_POINTS], xi2[NUM_POINTS];
+    cpu_time.tick(HERMES_SKIP);
+    refmap.untransform(e, NUM_POINTS, x, y, xi1, xi2);
+    time_batch += cpu_time.tick().last();
+
+    double pw1[NUM_POINTS], pw2[NUM_POINTS];
+    for (int i = 0; i < NUM_POINTS; i++)
+      untransform_pointwise(&refmap, x[i], y[i], pw1[i], pw2[i]);
+    time_pointwise += cpu_time.tick().last();
+
+    for (int i = 0; i < NUM_POINTS; i++)
+      if (fabs(xi1[i] - ref1[i]) > 1e-10 || fabs(xi2[i] - ref2[i]) > 1e-10 ||
+          fabs(xi1[i] - pw1[i]) > 1e-10 || fabs(xi2[i] - pw2[i]) > 1e-10)
+      {
+        printf("element %d, point (%g, %g): wrong reference coordinates.\n", e->id, x[i], y[i]);
+        success = false;
+      }
+
+    // The single point version has to give the same results.
+    double s1, s2;
+    refmap.untransform(e, x[0], y[0], s1, s2);
+    if (s1 != xi1[0] || s2 != xi2[0])
+      success = false;
+  }
+
+  printf("%d elements (%d constant jacobian, %d curved)\n", num_elems, num_const, num_curved);
+  printf("batched untransform: %g s, pointwise Newton method: %g s\n", time_batch, time_pointwise);
+  if (num_const == 0 || num_curved == 0 || num_const + num_curved == num_elems)
+    success = false;
+
+  if (success == true) {
+    printf("Success!\n");
+    return ERR_SUCCESS;
+  }
+  else {
+    printf("Failure!\n");
+    return ERR_FAILURE;
+  }
+}
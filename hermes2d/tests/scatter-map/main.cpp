@@ -0,0 +1,96 @@
+#include "hermes2d.h"
+
+// This test checks the precomputed scatter maps of DiscreteProblem. The problem from the
+// tutorial example P01-06-bc-newton (volume and surface matrix forms) is assembled with
+// a high polynomial degree, once adding the local matrices entry by entry and once at the
+// precomputed positions, also by several threads. The matrices have to be the same. The
+// times of a repeated assembling (the maps are created with the first one) are printed.
+
+const int P_INIT = 8;                             // Uniform polynomial degree of mesh elements.
+const int INIT_REF_NUM = 2;                       // Number of initial uniform mesh refinements.
+const int NUM_THREADS = 2;                        // Number of threads of the multithreaded assembling.
+
+// Problem parameters.
+const double LAMBDA_AL = 236.0;            // Thermal cond. of Al for temperatures around 20 deg Celsius.
+const double LAMBDA_CU = 386.0;            // Thermal cond. of Cu for temperatures around 20 deg Celsius.
+const double VOLUME_HEAT_SRC = 0.0;        // Volume heat sources generated by electric current.
+const double ALPHA = 5.0;                  // Heat transfer coefficient.
+const double T_EXTERIOR = 50.0;            // Exterior temperature.
+const double BDY_A_PARAM = 0.0;
+const double BDY_B_PARAM = 0.0;
+const double BDY_C_PARAM = 20.0;
+
+// Weak forms.
+#include "../../tutorial/P01-linear/06-bc-newton/definitions.cpp"
+
+// Assembles the matrix twice and returns the time of the second assembling.
+double assemble(DiscreteProblem* dp, CSCMatrix* matrix, UMFPackVector* rhs)
+{
+  dp->assemble(matrix, rhs);
+  TimePeriod cpu_time;
+  dp->assemble(matrix, rhs);
+  return cpu_time.tick().last();
+}
+
+bool same_matrices(CSCMatrix* a, CSCMatrix* b, double tol)
+{
+  if (a->get_nnz() != b->get_nnz()) return false;
+  for (unsigned int i = 0; i < a->get_nnz(); i++)
+    if (std::abs(a->get_Ax()[i] - b->get_Ax()[i]) > tol * (1 + std::abs(b->get_Ax()[i])))
+      return false;
+  return true;
+}
+
+int main(int argc, char* argv[])
+{
+  // Load the mesh.
+  Mesh mesh;
+  H2DReader mloader;
+  mloader.load("../../tutorial/P01-linear/06-bc-newton/domain.mesh", &mesh);
+  for (int i = 0; i < INIT_REF_NUM; i++) mesh.refine_all_elements();
+
+  // Initialize the weak formulation and boundary conditions.
+  CustomWeakFormPoissonNeumann wf("Aluminum", LAMBDA_AL, "Copper", LAMBDA_CU, VOLUME_HEAT_SRC,
+                                  "Outer", ALPHA, T_EXTERIOR);
+  CustomDirichletCondition bc_essential(Hermes::vector<std::string>("Bottom", "Inner", "Left"),
+                                        BDY_A_PARAM, BDY_B_PARAM, BDY_C_PARAM);
+  EssentialBCs bcs(&bc_essential);
+
+  // Create an H1 space with default shapeset.
+  H1Space space(&mesh, &bcs, P_INIT);
+  info("ndof = %d", space.get_num_dofs());
+
+  // Reference: entries added one by one.
+  DiscreteProblem dp(&wf, &space, true);
+  CSCMatrix matrix_ref;
+  UMFPackVector rhs_ref;
+  double time_ref = assemble(&dp, &matrix_ref, &rhs_ref);
+  printf("searching the positions: %g s\n", time_ref);
+
+  // Precomputed positions.
+  dp.set_precomputed_scatter(true);
+  CSCMatrix matrix;
+  UMFPackVector rhs;
+  double time = assemble(&dp, &matrix, &rhs);
+  printf("precomputed positions: %g s, speedup %g\n", time, time_ref / time);
+
+  // The sums are done in the same order, the matrices are identical.
+  bool success = same_matrices(&matrix, &matrix_ref, 0.0);
+
+  // Multithreaded assembling, the order of summation differs.
+  dp.set_num_threads(NUM_THREADS);
+  CSCMatrix matrix_par;
+  UMFPackVector rhs_par;
+  double time_par = assemble(&dp, &matrix_par, &rhs_par);
+  printf("precomputed positions, %d threads: %g s\n", NUM_THREADS, time_par);
+  if (!same_matrices(&matrix_par, &matrix_ref, 1e-10)) success = false;
+
+  if (success == true) {
+    printf("Success!\n");
+    return ERR_SUCCESS;
+  }
+  else {
+    printf("Failure!\n");
+    return ERR_FAILURE;
+  }
+}
@@ -0,0 +1,144 @@
+#include "hermes2d.h"
+
+// This test saves a solution on the square mesh from the tutorial example P01-07-general
+// (refined with hanging nodes, the mesh is saved with the solution and curved elements
+// are not supported there) and loads it back: from an uncompressed file, which is
+// mapped into memory, from a compressed file (uncompressed if Hermes was built without
+// zlib) and from a file of the old format version 1. The loaded solutions must give
+// the same values as the original one.
+
+const int P_INIT = 3;                             // Uniform polynomial degree of mesh elements.
+const int INIT_REF_NUM = 3;                       // Number of initial uniform mesh refinements.
+const int NUM_POINTS = 1000;                      // Number of points where the solutions are compared.
+
+// Gives access to the arrays of the solution, to write the old format and to find out
+// whether the solution is mapped from a file.
+class TestSolution : public Solution
+{
+public:
+  bool is_mapped() const { return mapped_data != NULL; }
+
+  // Saves the solution in the format version 1 (as Solution::save() did before).
+  void save_v1(const char* filename)
+  {
+    FILE* f = fopen(filename, "wb");
+    if (f == NULL) error("Could not open %s for writing.", filename);
+
+    hermes_fwrite("H2DS\001\000\000\000", 1, 8, f);
+    int ssize = sizeof(scalar);
+    hermes_fwrite(&ssize, sizeof(int), 1, f);
+    hermes_fwrite(&num_components, sizeof(int), 1, f);
+    hermes_fwrite(&num_elems, sizeof(int), 1, f);
+    hermes_fwrite(&num_coefs, sizeof(int), 1, f);
+    hermes_fwrite(mono_coefs, sizeof(scalar), num_coefs, f);
+
+    char* temp_orders = new char[num_elems];
+    for (int i = 0; i < num_elems; i++)
+      temp_orders[i] = elem_orders[i];
+    hermes_fwrite(temp_orders, sizeof(char), num_elems, f);
+    delete [] temp_orders;
+
+    for (int i = 0; i < num_components; i++)
+      hermes_fwrite(elem_coefs[i], sizeof(int), num_elems, f);
+    mesh->save_raw(f);
+    fclose(f);
+  }
+};
+
+// Compares the values and derivatives of two solutions at the given points.
+bool compare(const char* name, Solution* sln, Solution* loaded, std::vector<double>& x, std::vector<double>& y)
+{
+  const int items[3] = { H2D_FN_VAL_0, H2D_FN_DX_0, H2D_FN_DY_0 };
+  for (unsigned int i = 0; i < x.size(); i++)
+    for (int j = 0; j < 3; j++)
+      // Also fails if the point was not found (the value is NaN).
+      if (!(std::abs(sln->get_pt_value(x[i], y[i], items[j]) - loaded->get_pt_value(x[i], y[i], items[j])) <= 1e-12))
+      {
+        printf("%s: different values at (%g, %g).\n", name, x[i], y[i]);
+        return false;
+      }
+  printf("%s: ok\n", name);
+  return true;
+}
+
+int main(int argc, char* argv[])
+{
+  // Load the mesh.
+  Mesh mesh;
+  H2DReader mloader;
+  mloader.load("../../tutorial/P01-linear/07-general/domain.mesh", &mesh);
+
+  // Perform initial mesh refinements, then refine some elements to get hanging nodes.
+  for (int i = 0; i < INIT_REF_NUM; i++) mesh.refine_all_elements();
+  srand(1);
+  for (int i = 0; i < 10; i++)
+  {
+    Element* e = mesh.get_element_fast(rand() % mesh.get_max_element_id());
+    if (e->used && e->active) mesh.refine_element_id(e->id);
+  }
+
+  // Create a solution with arbitrary coefficients.
+  H1Space space(&mesh, NULL, P_INIT);
+  int ndof = space.get_num_dofs();
+  scalar* coeff_vec = new scalar[ndof];
+  for (int i = 0; i < ndof; i++) coeff_vec[i] = sin(0.1 * i);
+  TestSolution sln;
+  Solution::vector_to_solution(coeff_vec, &space, &sln);
+
+  // Random points in the domain.
+  std::vector<double> x, y;
+  for (int i = 0; i < NUM_POINTS; i++)
+  {
+    x.push_back(-1.0 + 2.0 * rand() / RAND_MAX);
+    y.push_back(-1.0 + 2.0 * rand() / RAND_MAX);
+  }
+
+  bool success = true;
+
+  // Uncompressed file, mapped into memory on POSIX systems.
+  TestSolution plain;
+  sln.save("solution-plain.h2ds");
+  plain.load("solution-plain.h2ds");
+#if !defined(WIN32) && !defined(_WINDOWS)
+  if (!plain.is_mapped())
+  {
+    printf("uncompressed file: not mapped.\n");
+    success = false;
+  }
+#endif
+  success = compare("uncompressed file", &sln, &plain, x, y) && success;
+
+  // Compressed file, read through the buffers.
+  TestSolution compressed;
+  sln.save("solution-compressed.h2ds", true);
+  compressed.load("solution-compressed.h2ds");
+  success = compare("compressed file", &sln, &compressed, x, y) && success;
+
+  // File of the format version 1.
+  TestSolution v1;
+  sln.save_v1("solution-v1.h2ds");
+  v1.load("solution-v1.h2ds");
+  if (v1.is_mapped())
+  {
+    printf("version 1 file: mapped.\n");
+    success = false;
+  }
+  success = compare("version 1 file", &sln, &v1, x, y) && success;
+
+  // A loaded solution can be saved again.
+  TestSolution resaved;
+  plain.save("solution-resaved.h2ds", true);
+  resaved.load("solution-resaved.h2ds");
+  success = compare("resaved file", &sln, &resaved, x, y) && success;
+
+  delete [] coeff_vec;
+
+  if (success == true) {
+    printf("Success!\n");
+    return ERR_SUCCESS;
+  }
+  else {
+    printf("Failure!\n");
+    return ERR_FAILURE;
+  }
+}
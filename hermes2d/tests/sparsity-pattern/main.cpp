@@ -0,0 +1,152 @@
+#include "hermes2d.h"
+
+// This test checks that the sparsity pattern kept by DiscreteProblem across assemblies
+// follows the changes of the spaces. The problem of the tutorial example P01-08-system
+// (linear elasticity, two spaces, off-diagonal blocks) is assembled, then the mesh is
+// refined, the orders are changed and the mesh is unrefined. After every change, the
+// matrix is assembled again into the same matrix and into a new one, and both have to be
+// identical to the matrix assembled by a new DiscreteProblem. A stale pattern would miss entries or have the wrong size.
+
+const int P_INIT = 2;                             // Initial polynomial degree of all elements.
+const double MAX_DIFFERENCE = 1e-12;              // Allowed relative difference of the entries.
+
+// Problem parameters.
+const double E  = 200e9;
+const double nu = 0.3;
+const double rho = 8000.0;
+const double g1 = -9.81;
+
+// Weak forms.
+#include "../../tutorial/P01-linear/08-system/definitions.cpp"
+
+// Compares the structure and the entries of two matrices and right-hand sides.
+bool compare(UMFPackMatrix* matrix, UMFPackVector* rhs, UMFPackMatrix* matrix_ref, UMFPackVector* rhs_ref,
+             const char* name)
+{
+  unsigned int size = matrix_ref->get_size();
+  if (matrix->get_size() != size || rhs->length() != size) {
+    printf("%s: size %d, expected %d.\n", name, matrix->get_size(), size);
+    return false;
+  }
+  if (matrix->get_nnz() != matrix_ref->get_nnz()) {
+    printf("%s: %d nonzeros, expected %d.\n", name, matrix->get_nnz(), matrix_ref->get_nnz());
+    return false;
+  }
+  for (unsigned int i = 0; i <= size; i++)
+    if (matrix->get_Ap()[i] != matrix_ref->get_Ap()[i]) {
+      printf("%s: the column %d differs.\n", name, i);
+      return false;
+    }
+
+  double norm = 0.0;
+  for (unsigned int i = 0; i < matrix_ref->get_nnz(); i++) {
+    if (matrix->get_Ai()[i] != matrix_ref->get_Ai()[i]) {
+      printf("%s: the row index of the nonzero %d differs.\n", name, i);
+      return false;
+    }
+    norm = std::max(norm, (double) std::abs(matrix_ref->get_Ax()[i]));
+  }
+  for (unsigned int i = 0; i < matrix_ref->get_nnz(); i++)
+    if (std::abs(matrix->get_Ax()[i] - matrix_ref->get_Ax()[i]) > MAX_DIFFERENCE * norm) {
+      printf("%s: the value of the nonzero %d differs.\n", name, i);
+      return false;
+    }
+
+  norm = 0.0;
+  for (unsigned int i = 0; i < size; i++)
+    norm = std::max(norm, (double) std::abs(rhs_ref->get(i)));
+  for (unsigned int i = 0; i < size; i++)
+    if (std::abs(rhs->get(i) - rhs_ref->get(i)) > MAX_DIFFERENCE * norm) {
+      printf("%s: the right-hand side differs at %d.\n", name, i);
+      return false;
+    }
+  return true;
+}
+
+// Assembles the matrix again by dp (into the old and into a new matrix) and by a new
+// DiscreteProblem, and compares the results.
+bool check(DiscreteProblem* dp, UMFPackMatrix* matrix, UMFPackVector* rhs, WeakForm* wf,
+           Hermes::vector<Space *> spaces, const char* name)
+{
+  Space::assign_dofs(spaces);
+  dp->assemble(matrix, rhs);
+
+  UMFPackMatrix new_matrix;
+  UMFPackVector new_rhs;
+  dp->assemble(&new_matrix, &new_rhs);
+
+  DiscreteProblem dp_ref(wf, spaces, true);
+  UMFPackMatrix matrix_ref;
+  UMFPackVector rhs_ref;
+  dp_ref.assemble(&matrix_ref, &rhs_ref);
+
+  printf("%-12s ndof: %d, nonzeros: %d\n", name, matrix_ref.get_size(), matrix_ref.get_nnz());
+  bool success = compare(matrix, rhs, &matrix_ref, &rhs_ref, name);
+  if (!compare(&new_matrix, &new_rhs, &matrix_ref, &rhs_ref, name)) success = false;
+  return success;
+}
+
+int main(int argc, char* argv[])
+{
+  bool success = true;
+
+  // Load the mesh.
+  Mesh mesh;
+  H2DReader mloader;
+  mloader.load("../../tutorial/P01-linear/08-system/domain.mesh", &mesh);
+  mesh.refine_all_elements();
+
+  // Create the spaces.
+  DefaultEssentialBCConst zero_disp("1", 0.0);
+  EssentialBCs bcs(&zero_disp);
+  H1Space u1_space(&mesh, &bcs, P_INIT);
+  H1Space u2_space(&mesh, &bcs, P_INIT);
+  Hermes::vector<Space *> spaces(&u1_space, &u2_space);
+
+  CustomWeakFormLinearElasticity wf(E, nu, rho*g1, "3", 0.0, 8e4);
+
+  DiscreteProblem dp(&wf, spaces, true);
+  UMFPackMatrix matrix;
+  UMFPackVector rhs;
+  dp.assemble(&matrix, &rhs);
+  if (!check(&dp, &matrix, &rhs, &wf, spaces, "initial")) success = false;
+
+  // Refine some elements (this creates hanging nodes).
+  int num_elements = mesh.get_max_element_id();
+  for (int id = 0; id < num_elements; id += 3) {
+    Element* e = mesh.get_element(id);
+    if (e->used && e->active) mesh.refine_element_id(id);
+  }
+  u1_space.set_uniform_order(P_INIT);
+  u2_space.set_uniform_order(P_INIT);
+  if (!check(&dp, &matrix, &rhs, &wf, spaces, "refined")) success = false;
+
+  // Change the orders of some elements, the mesh stays the same. The multicomponent form
+  // needs the same orders in both spaces.
+  Element* e;
+  for_all_active_elements(e, &mesh)
+    if (e->id % 2 == 0) {
+      int order = e->is_triangle() ? P_INIT + 1 : H2D_MAKE_QUAD_ORDER(P_INIT + 1, P_INIT + 1);
+      u1_space.set_element_order(e->id, order);
+      u2_space.set_element_order(e->id, order);
+    }
+  if (!check(&dp, &matrix, &rhs, &wf, spaces, "orders")) success = false;
+
+  // Unrefine some elements.
+  for (int id = 0; id < num_elements; id += 3) {
+    Element* e = mesh.get_element(id);
+    if (e->used && !e->active) mesh.unrefine_element_id(id);
+  }
+  u1_space.set_uniform_order(P_INIT);
+  u2_space.set_uniform_order(P_INIT);
+  if (!check(&dp, &matrix, &rhs, &wf, spaces, "unrefined")) success = false;
+
+  if (success == true) {
+    printf("Success!\n");
+    return ERR_SUCCESS;
+  }
+  else {
+    printf("Failure!\n");
+    return ERR_FAILURE;
+  }
+}
@@ -0,0 +1,210 @@
+#include "hermes2d.h"
+
+// This test checks the VTK output of Linearizer and Vectorizer. A projection of the function
+// of the tutorial example P04-06-exact-adapt is linearized and saved in all formats. The
+// ASCII file has to be the same as the one written by the original code, the values in
+// the binary files are read back and compared with the linearized data, the base64 encoded
+// file has to contain the same bytes as the appended one, and the threads must not change
+// anything. The times of the formats are printed for comparison.
+
+const int P_INIT = 4;                             // Polynomial degree of all mesh elements.
+const int INIT_REF_NUM = 5;                       // Number of initial uniform mesh refinements.
+const int NUM_THREADS = 4;                        // Number of threads encoding the values.
+MatrixSolverType matrix_solver = SOLVER_UMFPACK;  // Possibilities: SOLVER_AMESOS, SOLVER_AZTECOO, SOLVER_MUMPS,
+                                                  // SOLVER_PETSC, SOLVER_SUPERLU, SOLVER_UMFPACK.
+
+// Exact solution.
+#include "../../tutorial/P04-linear-adapt/06-exact-adapt/exact_solution.cpp"
+
+// Reads a whole file.
+std::string read_file(const char* file_name)
+{
+  std::ifstream is(file_name, std::ios::binary);
+  std::ostringstream s;
+  s << is.rdbuf();
+  return s.str();
+}
+
+// The ASCII output of the original Linearizer::save_data_vtk().
+std::string reference_ascii(Linearizer* lin, const char* name)
+{
+  std::ostringstream s;
+  char buf[100];
+  double3* verts = lin->get_vertices();
+  int3* tris = lin->get_triangles();
+  int nv = lin->get_num_vertices(), nt = lin->get_num_triangles();
+  s << "# vtk DataFile Version 2.0\n\nASCII\n\nDATASET UNSTRUCTURED_GRID\nPOINTS " << nv << " float\n";
+  for (int i = 0; i < nv; i++) { sprintf(buf, "%g %g %g\n", verts[i][0], verts[i][1], verts[i][2]); s << buf; }
+  s << "\nCELLS " << nt << " " << 4 * nt << "\n";
+  for (int i = 0; i < nt; i++) s << "3 " << tris[i][0] << " " << tris[i][1] << " " << tris[i][2] << "\n";
+  s << "\nCELL_TYPES " << nt << "\n";
+  for (int i = 0; i < nt; i++) s << "5\n";
+  s << "\nPOINT_DATA " << nv << "\nSCALARS " << name << " float 1\nLOOKUP_TABLE default\n";
+  for (int i = 0; i < nv; i++) { sprintf(buf, "%g\n", verts[i][2]); s << buf; }
+  return s.str();
+}
+
+// Reads a big-endian double of a legacy binary file.
+double read_big_endian(const char* p)
+{
+  double d;
+  char* q = (char*) &d;
+  int one = 1;
+  for (int j = 0; j < 8; j++)
+    q[j] = (*((char*) &one) == 1) ? p[7 - j] : p[j];
+  return d;
+}
+
+// Checks the points and the values of a legacy binary file.
+bool check_legacy_binary(Linearizer* lin, const std::string& file)
+{
+  double3* verts = lin->get_vertices();
+  int nv = lin->get_num_vertices();
+  size_t pos = file.find("POINTS ");
+  pos = file.find('\n', pos) + 1;
+  for (int i = 0; i < nv; i++)
+    for (int c = 0; c < 3; c++)
+      if (read_big_endian(&file[pos + 8 * (3 * i + c)]) != verts[i][c])
+        return false;
+  pos = file.find("LOOKUP_TABLE default\n") + 21;
+  for (int i = 0; i < nv; i++)
+    if (read_big_endian(&file[pos + 8 * i]) != verts[i][2])
+      return false;
+  return true;
+}
+
+// Returns the arrays of an appended VTU file, in the order they are stored.
+std::vector<std::string> read_appended(const std::string& file)
+{
+  std::vector<std::string> arrays;
+  size_t pos = file.find("_", file.find("<AppendedData")) + 1;
+  size_t end = file.rfind("</AppendedData>");
+  while (pos + 8 < end) {
+    unsigned long long size;
+    memcpy(&size, &file[pos], 8);
+    arrays.push_back(file.substr(pos + 8, size));
+    pos += 8 + size;
+  }
+  return arrays;
+}
+
+// Decodes the inline base64 arrays of a VTU file.
+std::vector<std::string> read_base64(const std::string& file)
+{
+  std::string table = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::vector<std::string> arrays;
+  size_t pos = 0;
+  while ((pos = file.find("format=\"binary\">\n", pos)) != std::string::npos) {
+    pos += 17;
+    size_t end = file.find('\n', pos);
+    std::string data;
+    for (size_t i = pos + 12; i + 3 < end; i += 4) {
+      unsigned int v = 0;
+      for (int j = 0; j < 4; j++)
+        v = (v << 6) | ((file[i + j] == '=') ? 0 : table.find(file[i + j]));
+      data += (char) (v >> 16);
+      if (file[i + 2] != '=') data += (char) (v >> 8);
+      if (file[i + 3] != '=') data += (char) v;
+    }
+    arrays.push_back(data);
+  }
+  return arrays;
+}
+
+// Checks the arrays of a VTU file: values, points, connectivity, offsets and types.
+bool check_vtu(Linearizer* lin, const std::vector<std::string>& arrays, bool single_precision)
+{
+  double3* verts = lin->get_vertices();
+  int3* tris = lin->get_triangles();
+  int nv = lin->get_num_vertices(), nt = lin->get_num_triangles();
+  if (arrays.size() != 5) return false;
+  for (int i = 0; i < nv; i++) {
+    for (int c = 0; c < 3; c++) {
+      double value = single_precision ? ((const float*) arrays[1].data())[3 * i + c]
+                                      : ((const double*) arrays[1].data())[3 * i + c];
+      double expected = single_precision ? (float) verts[i][c] : verts[i][c];
+      if (value != expected) return false;
+    }
+    double value = single_precision ? ((const float*) arrays[0].data())[i] : ((const double*) arrays[0].data())[i];
+    if (value != (single_precision ? (float) verts[i][2] : verts[i][2])) return false;
+  }
+  const int* conn = (const int*) arrays[2].data();
+  const int* offsets = (const int*) arrays[3].data();
+  for (int i = 0; i < nt; i++)
+    if (conn[3 * i] != tris[i][0] || conn[3 * i + 1] != tris[i][1] || conn[3 * i + 2] != tris[i][2] ||
+        offsets[i] != 3 * (i + 1) || arrays[4][i] != 5)
+      return false;
+  return true;
+}
+
+int main(int argc, char* argv[])
+{
+  Mesh mesh;
+  H2DReader mloader;
+  mloader.load("../../tutorial/P04-linear-adapt/06-exact-adapt/square.mesh", &mesh);
+  for (int i = 0; i < INIT_REF_NUM; i++) mesh.refine_all_elements();
+
+  H1Space space(&mesh, P_INIT);
+  ExactSolutionCustom exact(&mesh);
+  Solution sln;
+  OGProjection::project_global(&space, &exact, &sln, matrix_solver);
+
+  Linearizer lin;
+  lin.process_solution(&sln, H2D_FN_VAL_0, HERMES_EPS_HIGH);
+  info("Linearized: %d vertices, %d triangles.", lin.get_num_vertices(), lin.get_num_triangles());
+
+  // Write all formats.
+  const char* names[] = { "ascii", "binary", "base64", "appended" };
+  TimePeriod cpu_time;
+  for (int format = HERMES_VTK_ASCII; format <= HERMES_VTU_APPENDED; format++) {
+    for (int threads = 1; threads <= NUM_THREADS; threads += NUM_THREADS - 1) {
+      char file_name[100];
+      sprintf(file_name, "%s-%d.vtk", names[format], threads);
+      lin.set_vtk_format((VtkFormat) format, false, threads);
+      cpu_time.tick(HERMES_SKIP);
+      lin.save_data_vtk(file_name, "u", true);
+      printf("%s, %d threads: %g s\n", names[format], threads, cpu_time.tick().last());
+    }
+  }
+  lin.set_vtk_format(HERMES_VTU_APPENDED, true);
+  lin.save_data_vtk("appended-float.vtk", "u", true);
+
+  bool success = true;
+  for (int format = HERMES_VTK_ASCII; format <= HERMES_VTU_APPENDED; format++) {
+    std::string name = names[format];
+    if (read_file((name + "-1.vtk").c_str()) != read_file((name + "-4.vtk").c_str()))
+      success = false;
+  }
+  if (read_file("ascii-1.vtk") != reference_ascii(&lin, "u"))
+    success = false;
+  if (!check_legacy_binary(&lin, read_file("binary-1.vtk")))
+    success = false;
+  std::vector<std::string> appended = read_appended(read_file("appended-1.vtk"));
+  if (!check_vtu(&lin, appended, false) || read_base64(read_file("base64-1.vtk")) != appended)
+    success = false;
+  if (!check_vtu(&lin, read_appended(read_file("appended-float.vtk")), true))
+    success = false;
+
+  // Vectors: the gradient of the solution.
+  Vectorizer vec;
+  vec.process_solution(&sln, H2D_FN_DX_0, &sln, H2D_FN_DY_0, HERMES_EPS_NORMAL);
+  vec.set_vtk_format(HERMES_VTU_APPENDED);
+  vec.save_data_vtk("vectors.vtk", "grad_u");
+  appended = read_appended(read_file("vectors.vtk"));
+  double4* verts = vec.get_vertices();
+  for (int i = 0; i < vec.get_num_vertices(); i++) {
+    const double* v = (const double*) appended[0].data() + 3 * i;
+    const double* p = (const double*) appended[1].data() + 3 * i;
+    if (v[0] != verts[i][2] || v[1] != verts[i][3] || v[2] != 0.0 || p[0] != verts[i][0] || p[1] != verts[i][1] || p[2] != 0.0)
+      success = false;
+  }
+
+  if (success == true) {
+    printf("Success!\n");
+    return ERR_SUCCESS;
+  }
+  else {
+    printf("Failure!\n");
+    return ERR_FAILURE;
+  }
+}
@@ -114,6 +114,12 @@ int main(int argc, char* argv[])
   // Initialize Runge-Kutta time stepping.
   RungeKutta runge_kutta(&dp, &bt, matrix_solver);
 
+  // The optional second parameter selects the block assembly of the stage system.
+  if (argc > 2 && std::string(argv[2]) == "block") {
+    info("Using the block assembly of the stage system.");
+    runge_kutta.set_block_assembly();
+  }
+
   // Time stepping loop:
   double current_time = 0.0; int ts = 1;
   do 
@@ -128,7 +128,7 @@ int main(int argc, char* argv[])
 
       // Save complete Solution.
       sprintf(filename, "tsln_%d.dat", ts);
-      bool compress = false;   // Gzip compression not used as it only works on Linux.
+      bool compress = false;   // Compression requires Hermes built WITH_ZLIB.
       tsln.save(filename, compress);
       info("Complete Solution saved to file %s.", filename);
     }
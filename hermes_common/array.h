@@ -232,12 +232,13 @@ public:
 
   /// Counts the items in the array and registers unused items.
   /// This is a special-purpose function, used after loading the array
-  /// from file.
+  /// from file. The items below 'start' are counted even if unused,
+  /// like the slots created by skip_slot().
   void post_load_scan(int start = 0)
   {
     nitems = 0;
-    for (int i = start; i < size; i++)
-      if (get(i).used) nitems++;
+    for (int i = 0; i < size; i++)
+      if (i < start || get(i).used) nitems++;
       else unused.push_back(i);
   }
 
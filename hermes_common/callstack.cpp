@@ -32,7 +32,9 @@ CallStackObj::CallStackObj(int ln, const char *func, const char *file) {
 	this->func = func;
 	this->file = file;
 
-	// add this object to the call stack
+	// add this object to the call stack; the stack is kept only for the thread that created
+	// it, worker threads (e.g. of multithreaded assembling) would race on it
+	if (!pthread_equal(pthread_self(), callstack.thread)) return;
 	if (callstack.size < callstack.max_size) {
 		callstack.stack[callstack.size] = this;
 		callstack.size++;
@@ -41,6 +43,7 @@ CallStackObj::CallStackObj(int ln, const char *func, const char *file) {
 
 CallStackObj::~CallStackObj() {
 	// remove the object only if it is on the top of the call stack
+	if (!pthread_equal(pthread_self(), callstack.thread)) return;
 	if (callstack.size > 0 && callstack.stack[callstack.size - 1] == this) {
 		callstack.size--;
 		callstack.stack[callstack.size] = NULL;
@@ -89,6 +92,7 @@ CallStack::CallStack(int max_size) {
 	this->max_size = max_size;
 	this->size = 0;
 	this->stack = new CallStackObj *[max_size];
+	this->thread = pthread_self();
 
 	// initialize signals
 	callstack_initialize();
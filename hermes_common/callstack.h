@@ -21,6 +21,7 @@
 #define __HERMES_COMMON_CALLSTACK_H_
 
 #include <stdio.h>
+#include <pthread.h>
 #include "compat.h"
 
 // __PRETTY_FUNCTION__ missing on MSVC
@@ -58,6 +59,7 @@ protected:
 	CallStackObj **stack;
 	int size;
 	int max_size;
+	pthread_t thread;			// the only thread that records its calls
 
 	friend class CallStackObj;
 };
@@ -83,18 +83,22 @@ enum MatrixSolverType
    SOLVER_MUMPS,
    SOLVER_SUPERLU,
    SOLVER_AMESOS,
-   SOLVER_AZTECOO
+   SOLVER_AZTECOO,
+   SOLVER_KRYLOV,
+   SOLVER_LDL
 };
 
 // Should be in the same order as MatrixSolverTypes above, so that the
 // names may be accessed by the same enumeration variable.
-const std::string MatrixSolverNames[7] = {
+const std::string MatrixSolverNames[8] = {
   "UMFPACK",
   "PETSc",
   "MUMPS",
   "SuperLU",
   "Trilinos/Amesos",
-  "Trilinos/AztecOO"
+  "Trilinos/AztecOO",
+  "Krylov",
+  "LDL"
 };
 
 #define UMFPACK_NOT_COMPILED  HERMES " was not built with UMFPACK support."
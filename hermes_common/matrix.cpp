@@ -25,6 +25,8 @@
 //  Solvers
 #include "solver/solver.h"
 #include "solver/umfpack_solver.h"
+#include "solver/krylov.h"
+#include "solver/ldl.h"
 #include "solver/superlu.h"
 #include "solver/amesos.h"
 #include "solver/petsc.h"
@@ -200,6 +202,18 @@ int SparseMatrix::sort_and_store_indices(Page *page, int *buffer, int *max)
   return q - buffer;
 }
 
+void SparseMatrix::alloc_from_pattern(SparsityPattern *pattern)
+{
+  _F_
+  prealloc(pattern->get_size());
+  int *Ap = pattern->get_Ap();
+  int *Ai = pattern->get_Ai();
+  for (unsigned int j = 0; j < pattern->get_size(); j++)
+    for (int i = Ap[j]; i < Ap[j + 1]; i++)
+      pre_add_ij(Ai[i], j);
+  alloc();
+}
+
 int SparseMatrix::get_num_indices()
 {
   _F_
@@ -211,6 +225,125 @@ int SparseMatrix::get_num_indices()
   return total;
 }
 
+// SparsityPattern /////////////////////////////////////////////////////////////////////////////////
+
+SparsityPattern::SparsityPattern()
+{
+  _F_
+  size = 0;
+  nnz = 0;
+  Ap = Ai = NULL;
+  row_ptr = col_idx = NULL;
+  hash = 0;
+  columns = NULL;
+}
+
+SparsityPattern::~SparsityPattern()
+{
+  _F_
+  free();
+}
+
+void SparsityPattern::free()
+{
+  _F_
+  delete [] Ap; Ap = NULL;
+  delete [] Ai; Ai = NULL;
+  delete [] row_ptr; row_ptr = NULL;
+  delete [] col_idx; col_idx = NULL;
+  delete [] columns; columns = NULL;
+  size = nnz = 0;
+  hash = 0;
+}
+
+void SparsityPattern::prealloc(unsigned int n)
+{
+  _F_
+  free();
+  size = n;
+  columns = new std::vector<int>[n];
+  MEM_CHECK(columns);
+}
+
+void SparsityPattern::pre_add_ij(unsigned int row, unsigned int col)
+{
+  _F_
+  columns[col].push_back(row);
+}
+
+void SparsityPattern::finish()
+{
+  _F_
+  assert(columns != NULL);
+
+  // Sort the indices and remove duplicities.
+  Ap = new int[size + 1];
+  MEM_CHECK(Ap);
+  Ap[0] = 0;
+  for (unsigned int j = 0; j < size; j++) {
+    std::sort(columns[j].begin(), columns[j].end());
+    columns[j].erase(std::unique(columns[j].begin(), columns[j].end()), columns[j].end());
+    Ap[j + 1] = Ap[j] + columns[j].size();
+  }
+  nnz = Ap[size];
+
+  Ai = new int[nnz];
+  MEM_CHECK(Ai);
+  for (unsigned int j = 0; j < size; j++)
+    if (!columns[j].empty())
+      memcpy(Ai + Ap[j], &columns[j].front(), sizeof(int) * columns[j].size());
+  delete [] columns;
+  columns = NULL;
+
+  // FNV-1a hash of the structure.
+  hash = 2166136261ul;
+  hash = (hash ^ size) * 16777619ul;
+  for (unsigned int j = 0; j <= size; j++)
+    hash = (hash ^ (unsigned long) Ap[j]) * 16777619ul;
+  for (unsigned int i = 0; i < nnz; i++)
+    hash = (hash ^ (unsigned long) Ai[i]) * 16777619ul;
+}
+
+int *SparsityPattern::get_row_ptr()
+{
+  _F_
+  if (row_ptr == NULL) {
+    // Transpose the structure.
+    row_ptr = new int[size + 1];
+    MEM_CHECK(row_ptr);
+    col_idx = new int[nnz];
+    MEM_CHECK(col_idx);
+    memset(row_ptr, 0, sizeof(int) * (size + 1));
+    for (unsigned int i = 0; i < nnz; i++)
+      row_ptr[Ai[i] + 1]++;
+    for (unsigned int i = 0; i < size; i++)
+      row_ptr[i + 1] += row_ptr[i];
+    int *pos = new int[size];
+    memcpy(pos, row_ptr, sizeof(int) * size);
+    for (unsigned int j = 0; j < size; j++)
+      for (int i = Ap[j]; i < Ap[j + 1]; i++)
+        col_idx[pos[Ai[i]]++] = j;
+    delete [] pos;
+  }
+  return row_ptr;
+}
+
+int *SparsityPattern::get_col_idx()
+{
+  _F_
+  get_row_ptr();
+  return col_idx;
+}
+
+bool SparsityPattern::operator==(const SparsityPattern &other) const
+{
+  _F_
+  if (hash != other.hash || size != other.size || nnz != other.nnz)
+    return false;
+  return memcmp(Ap, other.Ap, sizeof(int) * (size + 1)) == 0
+         && memcmp(Ai, other.Ai, sizeof(int) * nnz) == 0;
+}
+
 SparseMatrix* create_matrix(MatrixSolverType matrix_solver)
 {
   _F_
@@ -237,6 +370,16 @@ SparseMatrix* create_matrix(MatrixSolverType matrix_solver)
         return new UMFPackMatrix;
         break;
       }
+    case SOLVER_KRYLOV: 
+      {
+        return new CSCMatrix;
+        break;
+      }
+    case SOLVER_LDL: 
+      {
+        return new SymCSCMatrix;
+        break;
+      }
     case SOLVER_SUPERLU: 
     {
       return new SuperLUMatrix;
@@ -289,6 +432,20 @@ Solver* create_linear_solver(MatrixSolverType matrix_solver, Matrix* matrix, Vec
         else return new UMFPackLinearSolver(static_cast<UMFPackMatrix*>(matrix), static_cast<UMFPackVector*>(rhs_dummy));  
         break;
       }
+    case SOLVER_KRYLOV: 
+      {
+        info("Using the native Krylov solver.");
+        if (rhs != NULL) return new KrylovSolver(static_cast<CSCMatrix*>(matrix), static_cast<UMFPackVector*>(rhs)); 
+        else return new KrylovSolver(static_cast<CSCMatrix*>(matrix), static_cast<UMFPackVector*>(rhs_dummy));  
+        break;
+      }
+    case SOLVER_LDL: 
+      {
+        info("Using the native LDL^T solver.");
+        if (rhs != NULL) return new LDLSolver(static_cast<SymCSCMatrix*>(matrix), static_cast<UMFPackVector*>(rhs)); 
+        else return new LDLSolver(static_cast<SymCSCMatrix*>(matrix), static_cast<UMFPackVector*>(rhs_dummy));  
+        break;
+      }
     case SOLVER_SUPERLU: 
     {
       info("Using SuperLU.");       
@@ -324,6 +481,8 @@ Vector* create_vector(MatrixSolverType matrix_solver)
         break;
       }
     case SOLVER_UMFPACK: 
+    case SOLVER_KRYLOV: 
+    case SOLVER_LDL: 
       {
         return new UMFPackVector;
         break;
@@ -293,6 +293,52 @@ protected:
   unsigned int size;  // matrix size
 };
 
+/// Nonzero structure of a sparse matrix, stored in compressed column (CSC) form.
+///
+/// The structure is built once (DiscreteProblem does so for each configuration
+/// of spaces) and can then be used to allocate any number of matrices by
+/// SparseMatrix::alloc_from_pattern(), which (for most of the backends) is
+/// merely a copy of the index arrays.
+class HERMES_API SparsityPattern {
+public:
+  SparsityPattern();
+  ~SparsityPattern();
+
+  /// Building, the same protocol as SparseMatrix::prealloc(), pre_add_ij() and alloc().
+  void prealloc(unsigned int n);
+  void pre_add_ij(unsigned int row, unsigned int col);
+  void finish();
+
+  void free();
+
+  unsigned int get_size() const { return size; }
+  unsigned int get_nnz() const { return nnz; }
+
+  /// CSC arrays: the (sorted) row indices of the column j are Ai[Ap[j]], ..., Ai[Ap[j + 1] - 1].
+  int *get_Ap() const { return Ap; }
+  int *get_Ai() const { return Ai; }
+
+  /// CSR arrays (the structure by rows), calculated on the first request.
+  int *get_row_ptr();
+  int *get_col_idx();
+
+  /// Hash of the structure, patterns with different hashes are different.
+  unsigned long get_hash() const { return hash; }
+  bool operator==(const SparsityPattern &other) const;
+
+protected:
+  unsigned int size;
+  unsigned int nnz;
+  int *Ap;
+  int *Ai;
+  int *row_ptr;
+  int *col_idx;
+  unsigned long hash;
+
+  /// Row indices of every column while the pattern is being built.
+  std::vector<int> *columns;
+};
+
 class HERMES_API SparseMatrix : public Matrix {
 public:
   SparseMatrix();
@@ -312,8 +358,31 @@ public:
 
   virtual void finish() { }
 
+  /// Allocates the matrix with the given nonzero structure, this replaces
+  /// the sequence prealloc(), pre_add_ij(), ..., alloc().
+  virtual void alloc_from_pattern(SparsityPattern *pattern);
+
   virtual unsigned int get_size() { return size; }
 
+  /// Returns true if the values of the matrix are stored in the order of the nonzeros
+  /// of the pattern it was allocated from (see alloc_from_pattern()), i.e. the value of
+  /// the k-th nonzero of the pattern (in the CSC order) can be added by add_at_positions().
+  virtual bool has_pattern_positions() const { return false; }
+
+  /// Adds a block of values to the positions precomputed from the sparsity pattern:
+  /// mat[i][j] is added to the value of the nonzero number pos[i * n + j], entries
+  /// with a negative position (e.g. Dirichlet dofs) are skipped. Unlike add(), no
+  /// searching is done. Only for matrices with has_pattern_positions().
+  virtual void add_at_positions(unsigned int m, unsigned int n, scalar **mat, const int *pos)
+  {
+    error("add_at_positions() undefined.");
+  }
+
+  /// Returns true if add() and add_at_positions() only touch the storage of the added
+  /// entries, so that several threads can add to different entries at once (see
+  /// DiscreteProblem::set_num_threads()).
+  virtual bool supports_concurrent_add() const { return false; }
+
   virtual void add_sparse_matrix(SparseMatrix* mat) 
   { 
     error("add_sparse_matrix() undefined.");
@@ -437,6 +506,9 @@ public:
   /// @param[in] y   - values
   virtual void add(unsigned int n, unsigned int *idx, scalar *y) = 0;
 
+  /// Returns true if add() only touches the added entries, see SparseMatrix::supports_concurrent_add().
+  virtual bool supports_concurrent_add() const { return false; }
+
   /// Get vector length.
   unsigned int length() {return this->size;}
 
@@ -114,6 +114,30 @@ void EpetraMatrix::alloc()
 #endif
 }
 
+void EpetraMatrix::alloc_from_pattern(SparsityPattern *pattern)
+{
+  _F_
+#ifdef HAVE_EPETRA
+  this->size = pattern->get_size();
+  std_map = new Epetra_Map(size, 0, seq_comm); MEM_CHECK(std_map);
+
+  // Insert the whole rows at once into a graph with exactly preallocated rows.
+  int *row_ptr = pattern->get_row_ptr();
+  int *col_idx = pattern->get_col_idx();
+  int *num_indices = new int[size];
+  MEM_CHECK(num_indices);
+  for (unsigned int i = 0; i < size; i++)
+    num_indices[i] = row_ptr[i + 1] - row_ptr[i];
+  grph = new Epetra_CrsGraph(Copy, *std_map, num_indices, true); MEM_CHECK(grph);
+  for (unsigned int i = 0; i < size; i++)
+    if (num_indices[i] > 0)
+      grph->InsertGlobalIndices(i, num_indices[i], col_idx + row_ptr[i]);
+  delete [] num_indices;
+
+  alloc();
+#endif
+}
+
 void EpetraMatrix::free()
 {
   _F_
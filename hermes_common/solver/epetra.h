@@ -49,6 +49,7 @@ public:
   virtual void finish();
 
   virtual void alloc();
+  virtual void alloc_from_pattern(SparsityPattern *pattern);
   virtual void free();
   virtual scalar get(unsigned int m, unsigned int n);
   virtual int get_num_row_entries(unsigned int row);
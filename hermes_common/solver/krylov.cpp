@@ -0,0 +1,792 @@
+// This file is part of Hermes
+//
+// Copyright (c) 2009 hp-FEM group at the University of Nevada, Reno (UNR).
+// Email: hpfem-group@unr.edu, home page: http://hpfem.org/.
+//
+// Hermes is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published
+// by the Free Software Foundation; either version 2 of the License,
+// or (at your option) any later version.
+//
+// Hermes is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+#include "krylov.h"
+#include "../callstack.h"
+#include <algorithm>
+#include <queue>
+#include <functional>
+
+/// Barrier of the threads of one solve.
+class KrylovSolver::Barrier
+{
+public:
+  Barrier(int count) : count(count), waiting(0), generation(0)
+  {
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&cond, NULL);
+  }
+
+  ~Barrier()
+  {
+    pthread_cond_destroy(&cond);
+    pthread_mutex_destroy(&mutex);
+  }
+
+  void wait()
+  {
+    if (count == 1) return;
+    pthread_mutex_lock(&mutex);
+    int gen = generation;
+    if (++waiting == count) {
+      waiting = 0;
+      generation++;
+      pthread_cond_broadcast(&cond);
+    }
+    else
+      while (gen == generation)
+        pthread_cond_wait(&cond, &mutex);
+    pthread_mutex_unlock(&mutex);
+  }
+
+protected:
+  int count, waiting, generation;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+};
+
+/// Argument of KrylovSolver::krylov_thread().
+struct KrylovThreadData
+{
+  KrylovSolver* solver;
+  int index;
+};
+
+/// Orders candidate entries of ILUT by decreasing magnitude.
+static bool larger_entry(const std::pair<double, int>& a, const std::pair<double, int>& b)
+{
+  return a.first > b.first;
+}
+
+KrylovSolver::KrylovSolver(CSCMatrix *m, UMFPackVector *rhs)
+  : IterSolver(), m(m), rhs(rhs)
+{
+  _F_
+  method = HERMES_KRYLOV_GMRES;
+  precond = HERMES_KRYLOV_PRECOND_NONE;
+  restart = 30;
+  omega = 1.0;
+  ilut_drop_tol = 1e-4;
+  ilut_fill = 10;
+  num_threads = 1;
+  factorization_scheme = HERMES_FACTORIZE_FROM_SCRATCH;
+  num_iters = 0;
+  residual = 0.0;
+  converged = false;
+  n = 0;
+  precond_compute = false;
+  precond_ready = false;
+  precond_computed = HERMES_KRYLOV_PRECOND_NONE;
+  barrier = NULL;
+}
+
+KrylovSolver::~KrylovSolver()
+{
+  _F_
+}
+
+void KrylovSolver::set_solver(const char *name)
+{
+  _F_
+  if (strcasecmp(name, "cg") == 0) method = HERMES_KRYLOV_CG;
+  else if (strcasecmp(name, "gmres") == 0) method = HERMES_KRYLOV_GMRES;
+  else if (strcasecmp(name, "bicgstab") == 0) method = HERMES_KRYLOV_BICGSTAB;
+  else {
+    warning("Unknown Krylov method '%s', using GMRES.", name);
+    method = HERMES_KRYLOV_GMRES;
+  }
+}
+
+void KrylovSolver::set_restart(int restart)
+{
+  _F_
+  if (restart < 1 || restart >= MAX_REDUCTION)
+    error("The restart of GMRES has to be between 1 and %d.", MAX_REDUCTION - 1);
+  this->restart = restart;
+}
+
+void KrylovSolver::set_precond(const char *name)
+{
+  _F_
+  if (strcasecmp(name, "none") == 0) set_precond(HERMES_KRYLOV_PRECOND_NONE);
+  else if (strcasecmp(name, "jacobi") == 0) set_precond(HERMES_KRYLOV_PRECOND_JACOBI);
+  else if (strcasecmp(name, "ssor") == 0) set_precond(HERMES_KRYLOV_PRECOND_SSOR);
+  else if (strcasecmp(name, "ilu0") == 0) set_precond(HERMES_KRYLOV_PRECOND_ILU0);
+  else if (strcasecmp(name, "ilut") == 0) set_precond(HERMES_KRYLOV_PRECOND_ILUT);
+  else {
+    warning("Unknown preconditioner '%s', using none.", name);
+    set_precond(HERMES_KRYLOV_PRECOND_NONE);
+  }
+}
+
+void KrylovSolver::set_precond(KrylovPrecond precond)
+{
+  _F_
+  this->precond = precond;
+  precond_yes = (precond != HERMES_KRYLOV_PRECOND_NONE);
+}
+
+#ifdef HAVE_TEUCHOS
+void KrylovSolver::set_precond(Teuchos::RCP<Precond> &pc)
+#else
+void KrylovSolver::set_precond(Precond *pc)
+#endif
+{
+  _F_
+  warning("KrylovSolver uses only its built-in preconditioners, the preconditioner is ignored.");
+}
+
+void KrylovSolver::set_ssor_omega(double omega)
+{
+  _F_
+  if (omega <= 0.0 || omega >= 2.0) error("The relaxation parameter of SSOR has to be in (0, 2).");
+  this->omega = omega;
+}
+
+void KrylovSolver::set_ilut_params(double drop_tol, int fill)
+{
+  _F_
+  if (drop_tol < 0.0 || fill < 0) error("Invalid parameters of ILUT.");
+  ilut_drop_tol = drop_tol;
+  ilut_fill = fill;
+}
+
+void KrylovSolver::set_num_threads(int num_threads)
+{
+  _F_
+  if (num_threads < 1) error("The number of threads has to be positive.");
+  this->num_threads = num_threads;
+}
+
+bool KrylovSolver::solve()
+{
+  _F_
+  assert(m != NULL);
+  assert(rhs != NULL);
+  assert(m->get_size() == rhs->length());
+
+  TimePeriod tmr;
+
+  setup_matrix();
+
+  // The preconditioner of the previous solve (and its distribution of the rows) is kept
+  // only if the factorization is to be reused completely.
+  precond_compute = !(factorization_scheme == HERMES_REUSE_FACTORIZATION_COMPLETELY && precond_ready
+                      && precond_computed == precond && (int) precond_rows.size() == num_threads + 1
+                      && precond_rows[num_threads] == n);
+  if (precond_compute) {
+    factors.clear();
+    factors.resize(num_threads);
+    precond_rows = row_start;
+  }
+  else
+    row_start = precond_rows;
+
+  b.resize(n);
+  if (n > 0) rhs->extract(&b[0]);
+  x.assign(n, 0.0);
+  r.assign(n, 0.0);
+  z.assign(n, 0.0);
+  q.assign(n, 0.0);
+  if (method != HERMES_KRYLOV_GMRES) p.assign(n, 0.0);
+  if (method == HERMES_KRYLOV_GMRES) basis.assign((restart + 1) * n, 0.0);
+  if (method == HERMES_KRYLOV_BICGSTAB) {
+    s.assign(n, 0.0);
+    t.assign(n, 0.0);
+    y.assign(n, 0.0);
+    r0.assign(n, 0.0);
+  }
+
+  for (int i = 0; i < 2; i++)
+    partial[i].assign(num_threads * MAX_REDUCTION, 0.0);
+  parity.assign(num_threads, 0);
+  zero_pivots.assign(num_threads, 0);
+  num_iters = 0;
+  residual = 0.0;
+  converged = false;
+
+  barrier = new Barrier(num_threads);
+  if (n == 0)
+    converged = true;
+  else if (num_threads == 1)
+    run(0);
+  else {
+    // The calling thread works as the thread 0.
+    KrylovThreadData* data = new KrylovThreadData[num_threads];
+    pthread_t* threads = new pthread_t[num_threads];
+    for (int th = 1; th < num_threads; th++) {
+      data[th].solver = this;
+      data[th].index = th;
+      if (pthread_create(&threads[th], NULL, krylov_thread, &data[th]) != 0)
+        error("Could not create Krylov solver thread %d.", th);
+    }
+    run(0);
+    for (int th = 1; th < num_threads; th++)
+      pthread_join(threads[th], NULL);
+    delete [] threads;
+    delete [] data;
+  }
+  delete barrier;
+  barrier = NULL;
+
+  if (precond_compute) {
+    precond_ready = true;
+    precond_computed = precond;
+    int num_zero = 0;
+    for (int th = 0; th < num_threads; th++) num_zero += zero_pivots[th];
+    if (num_zero > 0)
+      warning("%d zero pivots of the preconditioner were replaced.", num_zero);
+  }
+  if (!converged)
+    warning("Krylov solver did not converge in %d iterations, relative residual %g.", num_iters, residual);
+
+  delete [] sln;
+  sln = new scalar[n];
+  MEM_CHECK(sln);
+  for (int i = 0; i < n; i++) sln[i] = x[i];
+
+  tmr.tick();
+  time = tmr.accumulated();
+
+  return true;
+}
+
+void KrylovSolver::setup_matrix()
+{
+  _F_
+  n = m->get_size();
+  int *Ap = m->get_Ap(), *Ai = m->get_Ai();
+  scalar *Ax = m->get_Ax();
+  int nnz = (n > 0) ? Ap[n] : 0;
+
+  // Transpose of the column structure.
+  Rp.assign(n + 1, 0);
+  for (int k = 0; k < nnz; k++) Rp[Ai[k] + 1]++;
+  for (int i = 0; i < n; i++) Rp[i + 1] += Rp[i];
+  Ri.resize(nnz);
+  Rx.resize(nnz);
+  std::vector<int> next(Rp.begin(), Rp.end() - 1);
+  for (int j = 0; j < n; j++)
+    for (int k = Ap[j]; k < Ap[j + 1]; k++) {
+      int pos = next[Ai[k]]++;
+      Ri[pos] = j;
+      Rx[pos] = Ax[k];
+    }
+
+  // Blocks of rows with about the same number of nonzeros.
+  row_start.resize(num_threads + 1);
+  row_start[0] = 0;
+  for (int th = 1; th < num_threads; th++) {
+    int bound = (int) ((long long) nnz * th / num_threads);
+    row_start[th] = std::max(row_start[th - 1], (int) (std::lower_bound(Rp.begin(), Rp.end(), bound) - Rp.begin()));
+    row_start[th] = std::min(row_start[th], n);
+  }
+  row_start[num_threads] = n;
+}
+
+void* KrylovSolver::krylov_thread(void* data)
+{
+  KrylovThreadData* d = (KrylovThreadData*) data;
+  d->solver->run(d->index);
+  return NULL;
+}
+
+void KrylovSolver::run(int th)
+{
+  if (precond_compute) compute_precond(th);
+
+  switch (method) {
+    case HERMES_KRYLOV_CG: cg(th); break;
+    case HERMES_KRYLOV_GMRES: gmres(th); break;
+    case HERMES_KRYLOV_BICGSTAB: bicgstab(th); break;
+  }
+}
+
+//// vector operations /////////////////////////////////////////////////////////////////////////
+
+void KrylovSolver::multiply(int th, const scalar *in, scalar *out)
+{
+  for (int i = row_start[th]; i < row_start[th + 1]; i++) {
+    scalar sum = 0.0;
+    for (int k = Rp[i]; k < Rp[i + 1]; k++)
+      sum += Rx[k] * in[Ri[k]];
+    out[i] = sum;
+  }
+}
+
+void KrylovSolver::reduce(int th, const scalar *values, int count, scalar *result)
+{
+  std::vector<scalar>& sums = partial[parity[th]];
+  parity[th] ^= 1;
+  for (int i = 0; i < count; i++)
+    sums[th * MAX_REDUCTION + i] = values[i];
+  barrier->wait();
+
+  // All threads add the partial sums in the same order and get the same results.
+  for (int i = 0; i < count; i++) {
+    scalar sum = 0.0;
+    for (int k = 0; k < num_threads; k++)
+      sum += sums[k * MAX_REDUCTION + i];
+    result[i] = sum;
+  }
+}
+
+scalar KrylovSolver::local_dot(int th, const scalar *u, const scalar *v)
+{
+  scalar sum = 0.0;
+  for (int i = row_start[th]; i < row_start[th + 1]; i++)
+    sum += CONJ(u[i]) * v[i];
+  return sum;
+}
+
+scalar KrylovSolver::dot(int th, const scalar *u, const scalar *v)
+{
+  scalar local = local_dot(th, u, v), result;
+  reduce(th, &local, 1, &result);
+  return result;
+}
+
+double KrylovSolver::norm(int th, const scalar *u)
+{
+  return sqrt(magn(dot(th, u, u)));
+}
+
+//// Krylov methods ////////////////////////////////////////////////////////////////////////////
+
+// Before every product with the matrix, the threads wait for each other so that the whole
+// vector is up to date. A vector multiplied is not changed before the next dot product,
+// i.e. before all threads finish the product. Everything else works on the rows of the thread.
+
+void KrylovSolver::cg(int th)
+{
+  int first = row_start[th], last = row_start[th + 1];
+  double b_norm = norm(th, &b[0]);
+  if (b_norm == 0.0) {
+    if (th == 0) converged = true;
+    return;
+  }
+
+  for (int i = first; i < last; i++) r[i] = b[i];
+  apply_precond(th, &r[0], &z[0]);
+  for (int i = first; i < last; i++) p[i] = z[i];
+  scalar rz = dot(th, &r[0], &z[0]);
+
+  int iters = 0;
+  double res = 1.0;
+  while (iters < max_iters && res > tolerance) {
+    barrier->wait();
+    multiply(th, &p[0], &q[0]);
+    scalar pq = dot(th, &p[0], &q[0]);
+    if (pq == 0.0) break;
+    scalar alpha = rz / pq;
+    for (int i = first; i < last; i++) {
+      x[i] += alpha * p[i];
+      r[i] -= alpha * q[i];
+    }
+    apply_precond(th, &r[0], &z[0]);
+
+    scalar local[2] = { local_dot(th, &r[0], &r[0]), local_dot(th, &r[0], &z[0]) }, sums[2];
+    reduce(th, local, 2, sums);
+    iters++;
+    res = sqrt(magn(sums[0])) / b_norm;
+
+    scalar beta = sums[1] / rz;
+    rz = sums[1];
+    for (int i = first; i < last; i++) p[i] = z[i] + beta * p[i];
+  }
+
+  if (th == 0) {
+    num_iters = iters;
+    residual = res;
+    converged = (res <= tolerance);
+  }
+}
+
+void KrylovSolver::gmres(int th)
+{
+  int first = row_start[th], last = row_start[th + 1];
+  double b_norm = norm(th, &b[0]);
+  if (b_norm == 0.0) {
+    if (th == 0) converged = true;
+    return;
+  }
+
+  // Hessenberg matrix (column-wise), Givens rotations and the right-hand side of the least squares
+  // problem, computed by every thread.
+  int ld = restart + 1;
+  std::vector<scalar> h(ld * restart), g(ld), sn(restart), yy(restart), local(ld), sums(ld);
+  std::vector<double> cs(restart);
+
+  int iters = 0;
+  double res = 1.0;
+  while (true) {
+    // Residual of the current solution.
+    barrier->wait();
+    multiply(th, &x[0], &r[0]);
+    for (int i = first; i < last; i++) r[i] = b[i] - r[i];
+    double beta = norm(th, &r[0]);
+    res = beta / b_norm;
+    if (res <= tolerance || iters >= max_iters) break;
+
+    scalar* v0 = &basis[0];
+    for (int i = first; i < last; i++) v0[i] = r[i] / beta;
+    std::fill(g.begin(), g.end(), scalar(0.0));
+    g[0] = beta;
+
+    int j = 0;
+    while (j < restart && iters < max_iters) {
+      scalar* w = &basis[(j + 1) * n];
+      apply_precond(th, &basis[j * n], &z[0]);
+      barrier->wait();
+      multiply(th, &z[0], w);
+
+      // Classical Gram-Schmidt applied twice, one reduction per pass.
+      scalar* hj = &h[j * ld];
+      std::fill(hj, hj + ld, scalar(0.0));
+      for (int pass = 0; pass < 2; pass++) {
+        for (int k = 0; k <= j; k++)
+          local[k] = local_dot(th, &basis[k * n], w);
+        reduce(th, &local[0], j + 1, &sums[0]);
+        for (int k = 0; k <= j; k++) {
+          const scalar* vk = &basis[k * n];
+          for (int i = first; i < last; i++) w[i] -= sums[k] * vk[i];
+          hj[k] += sums[k];
+        }
+      }
+      double w_norm = norm(th, w);
+      hj[j + 1] = w_norm;
+      if (w_norm != 0.0)
+        for (int i = first; i < last; i++) w[i] /= w_norm;
+
+      // Previous rotations and a new one eliminating hj[j + 1].
+      for (int k = 0; k < j; k++) {
+        scalar tmp = cs[k] * hj[k] + sn[k] * hj[k + 1];
+        hj[k + 1] = -CONJ(sn[k]) * hj[k] + cs[k] * hj[k + 1];
+        hj[k] = tmp;
+      }
+      double a = magn(hj[j]), rr = sqrt(a * a + w_norm * w_norm);
+      if (a == 0.0) {
+        cs[j] = 0.0;
+        sn[j] = 1.0;
+      }
+      else {
+        cs[j] = a / rr;
+        sn[j] = (hj[j] / a) * w_norm / rr;
+      }
+      hj[j] = cs[j] * hj[j] + sn[j] * hj[j + 1];
+      hj[j + 1] = 0.0;
+      g[j + 1] = -CONJ(sn[j]) * g[j];
+      g[j] = cs[j] * g[j];
+
+      j++;
+      iters++;
+      if (magn(g[j]) / b_norm <= tolerance || w_norm == 0.0) break;
+    }
+
+    // Solution of the least squares problem, x += M^-1 V y.
+    for (int k = j - 1; k >= 0; k--) {
+      scalar sum = g[k];
+      for (int l = k + 1; l < j; l++) sum -= h[l * ld + k] * yy[l];
+      yy[k] = (h[k * ld + k] != 0.0) ? sum / h[k * ld + k] : scalar(0.0);
+    }
+    for (int i = first; i < last; i++) {
+      scalar sum = 0.0;
+      for (int k = 0; k < j; k++) sum += yy[k] * basis[k * n + i];
+      r[i] = sum;
+    }
+    apply_precond(th, &r[0], &z[0]);
+    for (int i = first; i < last; i++) x[i] += z[i];
+  }
+
+  if (th == 0) {
+    num_iters = iters;
+    residual = res;
+    converged = (res <= tolerance);
+  }
+}
+
+void KrylovSolver::bicgstab(int th)
+{
+  int first = row_start[th], last = row_start[th + 1];
+  double b_norm = norm(th, &b[0]);
+  if (b_norm == 0.0) {
+    if (th == 0) converged = true;
+    return;
+  }
+
+  for (int i = first; i < last; i++) r[i] = r0[i] = b[i];
+  scalar rho = 1.0, alpha = 1.0, om = 1.0;
+  scalar rho_new = b_norm * b_norm;
+
+  // The vector v of the method is q.
+  int iters = 0;
+  double res = 1.0;
+  while (iters < max_iters && res > tolerance) {
+    if (rho_new == 0.0) break;
+    scalar beta = (rho_new / rho) * (alpha / om);
+    rho = rho_new;
+    for (int i = first; i < last; i++) p[i] = r[i] + beta * (p[i] - om * q[i]);
+
+    apply_precond(th, &p[0], &y[0]);
+    barrier->wait();
+    multiply(th, &y[0], &q[0]);
+    scalar r0q = dot(th, &r0[0], &q[0]);
+    if (r0q == 0.0) break;
+    alpha = rho / r0q;
+    for (int i = first; i < last; i++) {
+      s[i] = r[i] - alpha * q[i];
+      x[i] += alpha * y[i];
+    }
+    iters++;
+    double s_norm = norm(th, &s[0]);
+    if (s_norm / b_norm <= tolerance) {
+      res = s_norm / b_norm;
+      break;
+    }
+
+    apply_precond(th, &s[0], &z[0]);
+    barrier->wait();
+    multiply(th, &z[0], &t[0]);
+    scalar local[2] = { local_dot(th, &t[0], &s[0]), local_dot(th, &t[0], &t[0]) }, sums[2];
+    reduce(th, local, 2, sums);
+    if (sums[1] == 0.0) break;
+    om = sums[0] / sums[1];
+    for (int i = first; i < last; i++) {
+      x[i] += om * z[i];
+      r[i] = s[i] - om * t[i];
+    }
+
+    local[0] = local_dot(th, &r[0], &r[0]);
+    local[1] = local_dot(th, &r0[0], &r[0]);
+    reduce(th, local, 2, sums);
+    res = sqrt(magn(sums[0])) / b_norm;
+    rho_new = sums[1];
+    if (om == 0.0) break;
+  }
+
+  if (th == 0) {
+    num_iters = iters;
+    residual = res;
+    converged = (res <= tolerance);
+  }
+}
+
+//// preconditioners ///////////////////////////////////////////////////////////////////////////
+
+void KrylovSolver::compute_precond(int th)
+{
+  int first = row_start[th], last = row_start[th + 1];
+  Factors& f = factors[th];
+
+  switch (precond) {
+    case HERMES_KRYLOV_PRECOND_NONE:
+      break;
+
+    case HERMES_KRYLOV_PRECOND_JACOBI:
+    case HERMES_KRYLOV_PRECOND_SSOR:
+      f.diag.assign(last - first, 0.0);
+      for (int i = first; i < last; i++) {
+        for (int k = Rp[i]; k < Rp[i + 1]; k++)
+          if (Ri[k] == i) f.diag[i - first] += Rx[k];
+        if (f.diag[i - first] == 0.0) {
+          zero_pivots[th]++;
+          f.diag[i - first] = 1.0;
+        }
+        if (precond == HERMES_KRYLOV_PRECOND_JACOBI)
+          f.diag[i - first] = 1.0 / f.diag[i - first];
+      }
+      break;
+
+    case HERMES_KRYLOV_PRECOND_ILU0:
+      factorize_ilu(th, false);
+      break;
+
+    case HERMES_KRYLOV_PRECOND_ILUT:
+      factorize_ilu(th, true);
+      break;
+  }
+}
+
+void KrylovSolver::factorize_ilu(int th, bool threshold)
+{
+  int first = row_start[th], last = row_start[th + 1];
+  int nb = last - first;
+  Factors& f = factors[th];
+  f.Lp.assign(1, 0);
+  f.Up.assign(1, 0);
+  f.Li.clear(); f.Lx.clear();
+  f.Ui.clear(); f.Ux.clear();
+  f.diag.assign(nb, 0.0);
+
+  // The current row is expanded in w, nonzero marks its pattern, cols lists the pattern and
+  // lower holds the columns left of the diagonal still to be eliminated, in increasing order.
+  std::vector<scalar> w(nb, 0.0);
+  std::vector<char> nonzero(nb, 0);
+  std::vector<int> cols;
+  std::priority_queue<int, std::vector<int>, std::greater<int> > lower;
+  std::vector<std::pair<double, int> > cand_l, cand_u;
+
+  for (int i = 0; i < nb; i++) {
+    int gi = first + i, num_l = 0, num_u = 0;
+    double row_norm = 0.0;
+    for (int k = Rp[gi]; k < Rp[gi + 1]; k++) {
+      int c = Ri[k] - first;
+      if (c < 0 || c >= nb) continue;
+      if (!nonzero[c]) {
+        nonzero[c] = 1;
+        cols.push_back(c);
+        if (c < i) { lower.push(c); num_l++; }
+        else if (c > i) num_u++;
+      }
+      w[c] += Rx[k];
+      row_norm += sqr(Rx[k]);
+    }
+    row_norm = sqrt(row_norm);
+    double tol = threshold ? ilut_drop_tol * row_norm : 0.0;
+    if (!nonzero[i]) {
+      nonzero[i] = 1;
+      cols.push_back(i);
+    }
+
+    // Elimination by the previous rows of U. ILU(0) skips the fill, ILUT drops small entries.
+    while (!lower.empty()) {
+      int k = lower.top();
+      lower.pop();
+      scalar wk = w[k] * f.diag[k];
+      if (threshold && magn(wk) < tol) {
+        w[k] = 0.0;
+        continue;
+      }
+      w[k] = wk;
+      for (int pos = f.Up[k]; pos < f.Up[k + 1]; pos++) {
+        int c = f.Ui[pos];
+        if (nonzero[c])
+          w[c] -= wk * f.Ux[pos];
+        else if (threshold) {
+          nonzero[c] = 1;
+          cols.push_back(c);
+          w[c] = -wk * f.Ux[pos];
+          if (c < i) lower.push(c);
+        }
+      }
+    }
+
+    // Rows of L and U.
+    cand_l.clear();
+    cand_u.clear();
+    for (unsigned int k = 0; k < cols.size(); k++) {
+      int c = cols[k];
+      if (c == i) continue;
+      double size = magn(w[c]);
+      if (threshold && (size < tol || size == 0.0)) continue;
+      if (c < i) cand_l.push_back(std::make_pair(size, c));
+      else cand_u.push_back(std::make_pair(size, c));
+    }
+    if (threshold) {
+      unsigned int max_l = num_l + ilut_fill, max_u = num_u + ilut_fill;
+      if (cand_l.size() > max_l) {
+        std::nth_element(cand_l.begin(), cand_l.begin() + max_l, cand_l.end(), larger_entry);
+        cand_l.resize(max_l);
+      }
+      if (cand_u.size() > max_u) {
+        std::nth_element(cand_u.begin(), cand_u.begin() + max_u, cand_u.end(), larger_entry);
+        cand_u.resize(max_u);
+      }
+    }
+    for (unsigned int k = 0; k < cand_l.size(); k++) {
+      f.Li.push_back(cand_l[k].second);
+      f.Lx.push_back(w[cand_l[k].second]);
+    }
+    for (unsigned int k = 0; k < cand_u.size(); k++) {
+      f.Ui.push_back(cand_u[k].second);
+      f.Ux.push_back(w[cand_u[k].second]);
+    }
+    f.Lp.push_back(f.Li.size());
+    f.Up.push_back(f.Ui.size());
+
+    scalar pivot = w[i];
+    if (pivot == 0.0) {
+      zero_pivots[th]++;
+      pivot = (row_norm > 0.0) ? (1e-4 + ilut_drop_tol) * row_norm : 1.0;
+    }
+    f.diag[i] = 1.0 / pivot;
+
+    for (unsigned int k = 0; k < cols.size(); k++) {
+      w[cols[k]] = 0.0;
+      nonzero[cols[k]] = 0;
+    }
+    cols.clear();
+  }
+}
+
+void KrylovSolver::apply_precond(int th, const scalar *in, scalar *out)
+{
+  int first = row_start[th], last = row_start[th + 1];
+  const Factors& f = factors[th];
+
+  switch (precond) {
+    case HERMES_KRYLOV_PRECOND_NONE:
+      for (int i = first; i < last; i++) out[i] = in[i];
+      break;
+
+    case HERMES_KRYLOV_PRECOND_JACOBI:
+      for (int i = first; i < last; i++) out[i] = f.diag[i - first] * in[i];
+      break;
+
+    case HERMES_KRYLOV_PRECOND_SSOR:
+    {
+      // (D + omega L) y = omega (2 - omega) in, (D + omega U) out = D y.
+      double c = omega * (2.0 - omega);
+      for (int i = first; i < last; i++) {
+        scalar sum = c * in[i];
+        for (int k = Rp[i]; k < Rp[i + 1]; k++) {
+          int j = Ri[k];
+          if (j >= first && j < i) sum -= omega * Rx[k] * out[j];
+        }
+        out[i] = sum / f.diag[i - first];
+      }
+      for (int i = last - 1; i >= first; i--) {
+        scalar sum = f.diag[i - first] * out[i];
+        for (int k = Rp[i]; k < Rp[i + 1]; k++) {
+          int j = Ri[k];
+          if (j > i && j < last) sum -= omega * Rx[k] * out[j];
+        }
+        out[i] = sum / f.diag[i - first];
+      }
+      break;
+    }
+
+    case HERMES_KRYLOV_PRECOND_ILU0:
+    case HERMES_KRYLOV_PRECOND_ILUT:
+    {
+      scalar* o = out + first;
+      for (int i = 0; i < last - first; i++) {
+        scalar sum = in[first + i];
+        for (int k = f.Lp[i]; k < f.Lp[i + 1]; k++) sum -= f.Lx[k] * o[f.Li[k]];
+        o[i] = sum;
+      }
+      for (int i = last - first - 1; i >= 0; i--) {
+        scalar sum = o[i];
+        for (int k = f.Up[i]; k < f.Up[i + 1]; k++) sum -= f.Ux[k] * o[f.Ui[k]];
+        o[i] = sum * f.diag[i];
+      }
+      break;
+    }
+  }
+}
@@ -0,0 +1,180 @@
+// This file is part of Hermes
+//
+// Copyright (c) 2009 hp-FEM group at the University of Nevada, Reno (UNR).
+// Email: hpfem-group@unr.edu, home page: http://hpfem.org/.
+//
+// Hermes is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published
+// by the Free Software Foundation; either version 2 of the License,
+// or (at your option) any later version.
+//
+// Hermes is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+#ifndef __HERMES_COMMON_KRYLOV_SOLVER_H_
+#define __HERMES_COMMON_KRYLOV_SOLVER_H_
+
+#include "solver.h"
+#include "umfpack_solver.h"
+
+/// Krylov methods of KrylovSolver.
+enum KrylovMethod
+{
+  HERMES_KRYLOV_CG,         ///< Conjugate gradients, for symmetric (hermitian) positive definite matrices.
+  HERMES_KRYLOV_GMRES,      ///< Restarted GMRES(m), right preconditioned.
+  HERMES_KRYLOV_BICGSTAB    ///< BiCGStab, right preconditioned.
+};
+
+/// Preconditioners built into KrylovSolver.
+enum KrylovPrecond
+{
+  HERMES_KRYLOV_PRECOND_NONE,
+  HERMES_KRYLOV_PRECOND_JACOBI,   ///< Inverse of the diagonal.
+  HERMES_KRYLOV_PRECOND_SSOR,     ///< Symmetric successive over-relaxation.
+  HERMES_KRYLOV_PRECOND_ILU0,     ///< Incomplete LU factorization with the sparsity pattern of the matrix.
+  HERMES_KRYLOV_PRECOND_ILUT      ///< Incomplete LU factorization with a threshold and a limited fill.
+};
+
+/// Native preconditioned Krylov solver, needs no external library.
+///
+/// Solves systems with matrices in the CSC format (create the matrix and the vector with
+/// SOLVER_KRYLOV, or use CSCMatrix/UMFPackMatrix and UMFPackVector directly) by CG, GMRES(m)
+/// or BiCGStab, starting from a zero initial guess, until the residual relative to the
+/// right-hand side drops below the tolerance.
+///
+/// The rows of the matrix are split among the threads in blocks of about the same number of
+/// nonzeros. Every thread multiplies its block of rows and updates its part of the vectors,
+/// the threads meet only in the dot products and before the products with the matrix.
+/// The preconditioners are computed and applied on the diagonal blocks of the threads,
+/// i.e. with several threads SSOR and ILU become block Jacobi methods with SSOR or ILU
+/// in the blocks (the number of iterations grows slightly with the number of threads).
+///
+/// With HERMES_REUSE_FACTORIZATION_COMPLETELY, the preconditioner computed in the previous
+/// solve is used again.
+///
+/// @ingroup solvers
+class HERMES_API KrylovSolver : public IterSolver {
+public:
+  KrylovSolver(CSCMatrix *m, UMFPackVector *rhs);
+  virtual ~KrylovSolver();
+
+  virtual bool solve();
+
+  virtual int get_num_iters() { return num_iters; }
+  /// Returns the final residual relative to the right-hand side.
+  virtual double get_residual() { return residual; }
+
+  /// Set the Krylov method
+  /// @param[in] solver - name of the method [ cg | gmres | bicgstab ]
+  void set_solver(const char *solver);
+  void set_solver(KrylovMethod method) { this->method = method; }
+  /// Set the number of iterations of GMRES between restarts (30 by default).
+  void set_restart(int restart);
+
+  /// Set a built-in preconditioner
+  /// @param[in] name - name of the preconditioner [ none | jacobi | ssor | ilu0 | ilut ]
+  virtual void set_precond(const char *name);
+  void set_precond(KrylovPrecond precond);
+
+  /// External preconditioners are not supported, only the built-in ones.
+#ifdef HAVE_TEUCHOS
+  virtual void set_precond(Teuchos::RCP<Precond> &pc);
+#else
+  virtual void set_precond(Precond *pc);
+#endif
+
+  /// Set the relaxation parameter of SSOR, 0 < omega < 2 (1.0 by default).
+  void set_ssor_omega(double omega);
+  /// Set the parameters of ILUT. Entries of the factors smaller than drop_tol times the
+  /// norm of the row of the matrix are dropped, at most fill entries more than the matrix
+  /// has are kept in each row of L and of U (1e-4 and 10 by default).
+  void set_ilut_params(double drop_tol, int fill);
+
+  /// Set the number of threads (1 by default).
+  void set_num_threads(int num_threads);
+
+  virtual void set_factorization_scheme(FactorizationScheme reuse_scheme) { factorization_scheme = reuse_scheme; }
+  virtual FactorizationScheme get_factorization_scheme() const { return factorization_scheme; }
+
+protected:
+  CSCMatrix *m;
+  UMFPackVector *rhs;
+
+  KrylovMethod method;
+  KrylovPrecond precond;
+  int restart;
+  double omega;
+  double ilut_drop_tol;
+  int ilut_fill;
+  int num_threads;
+  FactorizationScheme factorization_scheme;
+
+  int num_iters;
+  double residual;
+  bool converged;
+
+  /// The matrix in the CSR format.
+  int n;
+  std::vector<int> Rp, Ri;
+  std::vector<scalar> Rx;
+  /// Rows of the thread t are [row_start[t], row_start[t + 1]).
+  std::vector<int> row_start;
+
+  /// Preconditioner of the diagonal block of one thread, with local row and column indices.
+  /// The diagonal holds the inverses of the pivots (ILU, Jacobi) or the diagonal (SSOR).
+  struct Factors
+  {
+    std::vector<int> Lp, Li, Up, Ui;
+    std::vector<scalar> Lx, Ux, diag;
+  };
+  std::vector<Factors> factors;
+  std::vector<int> zero_pivots;
+  std::vector<int> precond_rows;  ///< row_start of the computed preconditioner.
+  bool precond_compute;           ///< The preconditioner is computed in this solve.
+  bool precond_ready;
+  KrylovPrecond precond_computed;
+
+  /// Vectors of the methods.
+  std::vector<scalar> b, x, r, p, q, s, t, y, z, r0, basis;
+
+  /// Partial sums of the dot products, one set per thread. Two sets are used in turns,
+  /// so that a thread can not overwrite partial sums other threads have not read yet.
+  std::vector<scalar> partial[2];
+  std::vector<int> parity;
+  static const int MAX_REDUCTION = 64;
+
+  class Barrier;
+  Barrier *barrier;
+
+  /// Builds the CSR copy of the matrix and splits the rows among the threads.
+  void setup_matrix();
+
+  /// Thread function, the argument is KrylovThreadData.
+  static void* krylov_thread(void* data);
+  void run(int th);
+
+  void cg(int th);
+  void gmres(int th);
+  void bicgstab(int th);
+
+  void compute_precond(int th);
+  void factorize_ilu(int th, bool threshold);
+  void apply_precond(int th, const scalar *in, scalar *out);
+
+  /// out = A in for the rows of the thread, all of in has to be up to date.
+  void multiply(int th, const scalar *in, scalar *out);
+  /// Sums count values over the threads, the result is the same in all threads.
+  void reduce(int th, const scalar *values, int count, scalar *result);
+  /// Dot product (conjugating u) of the parts of u and v of the thread.
+  scalar local_dot(int th, const scalar *u, const scalar *v);
+  scalar dot(int th, const scalar *u, const scalar *v);
+  double norm(int th, const scalar *u);
+};
+
+#endif
@@ -0,0 +1,639 @@
+// This file is part of Hermes
+//
+// Copyright (c) 2009 hp-FEM group at the University of Nevada, Reno (UNR).
+// Email: hpfem-group@unr.edu, home page: http://hpfem.org/.
+//
+// Hermes is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published
+// by the Free Software Foundation; either version 2 of the License,
+// or (at your option) any later version.
+//
+// Hermes is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+#include "ldl.h"
+#include "../callstack.h"
+#include <algorithm>
+#include <iterator>
+#include <set>
+
+// Real matrices: the factorization is abandoned at the first pivot which is not positive,
+// i.e. as soon as the matrix turns out not to be positive definite.
+// Complex symmetric matrices have no such test, the factorization is abandoned if the
+// entries of a row of the factors grow more than LDL_MAX_GROWTH times over the entries
+// of the matrix, or if the pivot is smaller than LDL_TINY_PIVOT times the entries it was
+// computed from.
+#ifdef HERMES_COMMON_COMPLEX
+static const double LDL_MAX_GROWTH = 1e6;
+static const double LDL_TINY_PIVOT = 1e-14;
+#endif
+
+// SymCSCMatrix ////////////////////////////////////////////////////////////////////////////////////
+
+SymCSCMatrix::SymCSCMatrix()
+{
+  _F_
+  size = 0; nnz = 0;
+  Ap = NULL;
+  Ai = NULL;
+  Ax = NULL;
+}
+
+SymCSCMatrix::~SymCSCMatrix()
+{
+  _F_
+  free();
+}
+
+void SymCSCMatrix::pre_add_ij(unsigned int row, unsigned int col)
+{
+  _F_
+  if (row <= col) SparseMatrix::pre_add_ij(row, col);
+}
+
+void SymCSCMatrix::alloc()
+{
+  _F_
+  assert(pages != NULL);
+
+  Ap = new int [size + 1];
+  MEM_CHECK(Ap);
+  int aisize = get_num_indices();
+  Ai = new int [aisize];
+  MEM_CHECK(Ai);
+
+  // sort the indices and remove duplicities, insert into Ai
+  unsigned int i;
+  int pos = 0;
+  for (i = 0; i < size; i++) {
+    Ap[i] = pos;
+    pos += sort_and_store_indices(pages[i], Ai + pos, Ai + aisize);
+  }
+  Ap[i] = pos;
+
+  delete [] pages;
+  pages = NULL;
+
+  nnz = Ap[size];
+
+  Ax = new scalar [nnz];
+  MEM_CHECK(Ax);
+  memset(Ax, 0, sizeof(scalar) * nnz);
+}
+
+void SymCSCMatrix::alloc_from_pattern(SparsityPattern *pattern)
+{
+  _F_
+  size = pattern->get_size();
+  int *pAp = pattern->get_Ap();
+  int *pAi = pattern->get_Ai();
+
+  // The row indices are sorted, the upper triangle of a column is its beginning.
+  Ap = new int [size + 1];
+  MEM_CHECK(Ap);
+  Ap[0] = 0;
+  for (unsigned int j = 0; j < size; j++)
+    Ap[j + 1] = Ap[j] + (std::upper_bound(pAi + pAp[j], pAi + pAp[j + 1], (int) j) - (pAi + pAp[j]));
+  nnz = Ap[size];
+
+  Ai = new int [nnz];
+  MEM_CHECK(Ai);
+  for (unsigned int j = 0; j < size; j++)
+    memcpy(Ai + Ap[j], pAi + pAp[j], sizeof(int) * (Ap[j + 1] - Ap[j]));
+
+  Ax = new scalar [nnz];
+  MEM_CHECK(Ax);
+  memset(Ax, 0, sizeof(scalar) * nnz);
+}
+
+void SymCSCMatrix::free()
+{
+  _F_
+  nnz = 0;
+  if (Ap != NULL) {delete [] Ap; Ap = NULL;}
+  if (Ai != NULL) {delete [] Ai; Ai = NULL;}
+  if (Ax != NULL) {delete [] Ax; Ax = NULL;}
+}
+
+scalar SymCSCMatrix::get(unsigned int m, unsigned int n)
+{
+  _F_
+  if (m > n) std::swap(m, n);
+  int *pos = std::lower_bound(Ai + Ap[n], Ai + Ap[n + 1], (int) m);
+  if (pos == Ai + Ap[n + 1] || *pos != (int) m)
+    return 0.0;
+  return Ax[pos - Ai];
+}
+
+void SymCSCMatrix::zero()
+{
+  _F_
+  memset(Ax, 0, sizeof(scalar) * nnz);
+}
+
+void SymCSCMatrix::add(unsigned int m, unsigned int n, scalar v)
+{
+  _F_
+  // The lower triangle is the transpose of the upper one.
+  if (m > n || v == 0.0) return;
+
+  int *pos = std::lower_bound(Ai + Ap[n], Ai + Ap[n + 1], (int) m);
+  if (pos == Ai + Ap[n + 1] || *pos != (int) m) {
+    info("SymCSCMatrix::add(): i = %d, j = %d.", m, n);
+    error("Sparse matrix entry not found");
+  }
+  Ax[pos - Ai] += v;
+}
+
+void SymCSCMatrix::add_to_diagonal(scalar v)
+{
+  _F_
+  for (unsigned int i = 0; i < size; i++)
+    add(i, i, v);
+}
+
+void SymCSCMatrix::add(unsigned int m, unsigned int n, scalar **mat, int *rows, int *cols)
+{
+  _F_
+  for (unsigned int i = 0; i < m; i++)       // rows
+    for (unsigned int j = 0; j < n; j++)     // cols
+      if (rows[i] >= 0 && cols[j] >= 0 && rows[i] <= cols[j]) // not Dir. dofs, upper triangle.
+        add(rows[i], cols[j], mat[i][j]);
+}
+
+bool SymCSCMatrix::dump(FILE *file, const char *var_name, EMatrixDumpFormat fmt)
+{
+  _F_
+  switch (fmt)
+  {
+    case DF_MATLAB_SPARSE:
+      fprintf(file, "%% Size: %dx%d\n%% Nonzeros in the upper triangle: %d\ntemp = zeros(%d, 3);\ntemp = [\n",
+              size, size, nnz, nnz);
+      for (unsigned int j = 0; j < size; j++)
+        for (int i = Ap[j]; i < Ap[j + 1]; i++)
+          fprintf(file, "%d %d " SCALAR_FMT "\n", Ai[i] + 1, j + 1, SCALAR(Ax[i]));
+      fprintf(file, "];\n%s = spconvert(temp);\n%s = %s + triu(%s, 1).';\n", var_name, var_name, var_name, var_name);
+
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+unsigned int SymCSCMatrix::get_matrix_size() const
+{
+  return size;
+}
+
+double SymCSCMatrix::get_fill_in() const
+{
+  _F_
+  return nnz / (double) (size * size);
+}
+
+void SymCSCMatrix::multiply_with_vector(scalar* vector_in, scalar* vector_out)
+{
+  _F_
+  for (unsigned int j = 0; j < size; j++) vector_out[j] = 0;
+  for (unsigned int j = 0; j < size; j++)
+    for (int p = Ap[j]; p < Ap[j + 1]; p++) {
+      int i = Ai[p];
+      vector_out[i] += Ax[p] * vector_in[j];
+      if (i != (int) j) vector_out[j] += Ax[p] * vector_in[i];
+    }
+}
+
+void SymCSCMatrix::multiply_with_scalar(scalar value)
+{
+  _F_
+  for (unsigned int i = 0; i < nnz; i++) Ax[i] *= value;
+}
+
+// LDLSolver ///////////////////////////////////////////////////////////////////////////////////////
+
+LDLSolver::LDLSolver(SymCSCMatrix *m, UMFPackVector *rhs)
+  : LinearSolver(), m(m), rhs(rhs)
+{
+  _F_
+  n = 0;
+  symbolic_ready = false;
+  numeric_ready = false;
+  unstable = false;
+  fallback_matrix = NULL;
+  fallback_solver = NULL;
+}
+
+LDLSolver::~LDLSolver()
+{
+  _F_
+  delete fallback_solver;
+  delete fallback_matrix;
+}
+
+bool LDLSolver::solve()
+{
+  _F_
+  assert(m != NULL);
+  assert(rhs != NULL);
+  assert(m->get_size() == rhs->length());
+
+  TimePeriod tmr;
+
+  if (!setup_factorization()) {
+    warning("LDL^T factorization could not be completed.");
+    return false;
+  }
+
+  if (unstable && !fallback_solver->solve())
+    return false;
+
+  if (sln)
+    delete [] sln;
+  sln = new scalar[n];
+  MEM_CHECK(sln);
+  if (unstable)
+    memcpy(sln, fallback_solver->get_solution(), n * sizeof(scalar));
+  else {
+    rhs->extract(sln);
+    std::vector<scalar> work(n + 1);
+    solve_factorized(sln, &work[0]);
+  }
+
+  tmr.tick();
+  time = tmr.accumulated();
+
+  return true;
+}
+
+bool LDLSolver::solve_multiple_rhs(int nrhs, const scalar* rhs_block, scalar* sln_block)
+{
+  _F_
+  assert(m != NULL);
+
+  TimePeriod tmr;
+
+  if (!setup_factorization()) {
+    warning("LDL^T factorization could not be completed.");
+    return false;
+  }
+
+  if (unstable) {
+    if (!fallback_solver->solve_multiple_rhs(nrhs, rhs_block, sln_block))
+      return false;
+  }
+  else {
+    std::vector<scalar> work(n + 1);
+    for (int k = 0; k < nrhs; k++) {
+      memcpy(sln_block + k * n, rhs_block + k * n, n * sizeof(scalar));
+      solve_factorized(sln_block + k * n, &work[0]);
+    }
+  }
+
+  tmr.tick();
+  time = tmr.accumulated();
+
+  return true;
+}
+
+bool LDLSolver::setup_factorization()
+{
+  _F_
+  // Perform all phases for the first time or if the matrix has changed its structure.
+  int eff_fact_scheme = factorization_scheme;
+  if (!symbolic_ready || (int) m->get_size() != n || m->get_nnz() != Cmap.size())
+    eff_fact_scheme = HERMES_FACTORIZE_FROM_SCRATCH;
+  else if (eff_fact_scheme == HERMES_REUSE_FACTORIZATION_COMPLETELY && !numeric_ready && !unstable)
+    eff_fact_scheme = HERMES_REUSE_MATRIX_REORDERING;
+
+  switch (eff_fact_scheme)
+  {
+    case HERMES_FACTORIZE_FROM_SCRATCH:
+      n = m->get_size();
+      numeric_ready = false;
+      minimum_degree_ordering();
+      symbolic_factorization();
+      symbolic_ready = true;
+      // fall through
+
+    case HERMES_REUSE_MATRIX_REORDERING:
+    case HERMES_REUSE_MATRIX_REORDERING_AND_SCALING:
+      numeric_ready = numeric_factorization();
+      unstable = !numeric_ready;
+  }
+
+  // UMFPack solves the system if the factorization is not stable (also when its
+  // factorization is reused).
+  if (unstable)
+    return setup_fallback(eff_fact_scheme);
+  return numeric_ready;
+}
+
+bool LDLSolver::setup_fallback(int fact_scheme)
+{
+  _F_
+#ifdef WITH_UMFPACK
+  if (fallback_solver == NULL) {
+    warning("The LDL^T factorization is not stable, the matrix is not positive definite. Using UMFPack.");
+    fallback_matrix = new UMFPackMatrix;
+    fallback_solver = new UMFPackLinearSolver(fallback_matrix, rhs);
+    fact_scheme = HERMES_FACTORIZE_FROM_SCRATCH;
+  }
+
+  if (fact_scheme != HERMES_REUSE_FACTORIZATION_COMPLETELY) {
+    // The full matrix: the upper triangle of a column, then the transposed entries below
+    // the diagonal (these come in the increasing order of the rows, column by column).
+    int *Ap = m->get_Ap();
+    int *Ai = m->get_Ai();
+    scalar *Ax = m->get_Ax();
+    std::vector<int> Fp(n + 1, 0);
+    for (int j = 0; j < n; j++)
+      for (int p = Ap[j]; p < Ap[j + 1]; p++) {
+        Fp[j + 1]++;
+        if (Ai[p] != j) Fp[Ai[p] + 1]++;
+      }
+    for (int j = 0; j < n; j++)
+      Fp[j + 1] += Fp[j];
+    std::vector<int> Fi(Fp[n]);
+    std::vector<scalar> Fx(Fp[n]);
+    std::vector<int> next(n);
+    for (int j = 0; j < n; j++)
+      next[j] = Fp[j] + (Ap[j + 1] - Ap[j]);
+    for (int j = 0; j < n; j++)
+      for (int p = Ap[j]; p < Ap[j + 1]; p++) {
+        int i = Ai[p];
+        Fi[Fp[j] + p - Ap[j]] = i;
+        Fx[Fp[j] + p - Ap[j]] = Ax[p];
+        if (i != j) {
+          Fi[next[i]] = j;
+          Fx[next[i]++] = Ax[p];
+        }
+      }
+
+    fallback_matrix->free();
+    fallback_matrix->create(n, Fp[n], &Fp[0], &Fi[0], &Fx[0]);
+  }
+
+  // (public only through Solver)
+  static_cast<Solver*>(fallback_solver)->set_factorization_scheme((FactorizationScheme) fact_scheme);
+  return true;
+#else
+  warning("The LDL^T factorization is not stable, the matrix is not positive definite.");
+  return false;
+#endif
+}
+
+void LDLSolver::minimum_degree_ordering()
+{
+  _F_
+  int *Ap = m->get_Ap();
+  int *Ai = m->get_Ai();
+
+  // Graph of the matrix. The row indices of a column are sorted and the columns are
+  // visited in the increasing order, so the neighbours of every vertex come out sorted.
+  std::vector<std::vector<int> > graph(n);
+  for (int j = 0; j < n; j++)
+    for (int p = Ap[j]; p < Ap[j + 1]; p++)
+      if (Ai[p] != j) {
+        graph[Ai[p]].push_back(j);
+        graph[j].push_back(Ai[p]);
+      }
+
+  // Indistinguishable vertices (adjacent to each other and to the same other vertices, e.g.
+  // the bubble functions of one element or the components of a vector field in one node) are
+  // merged into supervertices, they would be eliminated one after another anyway. Candidates
+  // are found by the size and the sum of the closed neighbourhood.
+  std::vector<std::pair<std::pair<int, long long>, int> > keys(n);
+  for (int v = 0; v < n; v++) {
+    long long sum = v;
+    for (unsigned int a = 0; a < graph[v].size(); a++) sum += graph[v][a];
+    keys[v] = std::make_pair(std::make_pair((int) graph[v].size(), sum), v);
+  }
+  std::sort(keys.begin(), keys.end());
+
+  std::vector<int> super(n, -1), weight;
+  std::vector<std::vector<int> > members;
+  for (int a = 0; a < n; a++) {
+    int v = keys[a].second;
+    if (super[v] >= 0) continue;
+    super[v] = weight.size();
+    members.push_back(std::vector<int>(1, v));
+    for (int b = a + 1; b < n && keys[b].first == keys[a].first; b++) {
+      int u = keys[b].second;
+      if (super[u] >= 0 || !std::binary_search(graph[v].begin(), graph[v].end(), u)) continue;
+      // Closed neighbourhoods of u and v are equal iff the open ones are equal up to u and v.
+      bool same = true;
+      for (unsigned int p = 0, q = 0; same && (p < graph[v].size() || q < graph[u].size()); ) {
+        if (p < graph[v].size() && graph[v][p] == u) p++;
+        else if (q < graph[u].size() && graph[u][q] == v) q++;
+        else if (p < graph[v].size() && q < graph[u].size() && graph[v][p] == graph[u][q]) { p++; q++; }
+        else same = false;
+      }
+      if (same) {
+        super[u] = super[v];
+        members.back().push_back(u);
+      }
+    }
+    weight.push_back(members.back().size());
+  }
+
+  // Graph of the supervertices, the degree of a supervertex is the number of the vertices
+  // adjacent to it.
+  int ns = weight.size();
+  std::vector<std::vector<int> > adj(ns);
+  std::vector<int> degree(ns, 0);
+  for (int s = 0; s < ns; s++) {
+    std::vector<int>& nb = graph[members[s][0]];
+    for (unsigned int a = 0; a < nb.size(); a++)
+      if (super[nb[a]] != s) adj[s].push_back(super[nb[a]]);
+    std::sort(adj[s].begin(), adj[s].end());
+    adj[s].erase(std::unique(adj[s].begin(), adj[s].end()), adj[s].end());
+    for (unsigned int a = 0; a < adj[s].size(); a++)
+      degree[s] += weight[adj[s][a]];
+  }
+  std::vector<std::vector<int> >().swap(graph);
+
+  // Supervertices ordered by their degree in the elimination graph.
+  std::set<std::pair<int, int> > queue;
+  for (int s = 0; s < ns; s++)
+    queue.insert(std::make_pair(degree[s], s));
+
+  perm.resize(n);
+  pinv.resize(n);
+  std::vector<int> merged;
+  int k = 0;
+  while (!queue.empty()) {
+    int s = queue.begin()->second;
+    std::vector<int>& nb = adj[s];
+
+    // The remaining vertices form a clique, their order does not matter.
+    if (degree[s] + weight[s] == n - k) {
+      for (std::set<std::pair<int, int> >::iterator it = queue.begin(); it != queue.end(); it++)
+        for (unsigned int a = 0; a < members[it->second].size(); a++)
+          perm[k++] = members[it->second][a];
+      break;
+    }
+
+    // Eliminating s makes its neighbours a clique.
+    queue.erase(queue.begin());
+    for (unsigned int a = 0; a < members[s].size(); a++)
+      perm[k++] = members[s][a];
+    for (unsigned int a = 0; a < nb.size(); a++) {
+      int u = nb[a];
+      queue.erase(std::make_pair(degree[u], u));
+      merged.clear();
+      std::set_union(adj[u].begin(), adj[u].end(), nb.begin(), nb.end(), std::back_inserter(merged));
+      merged.erase(std::remove(merged.begin(), merged.end(), u), merged.end());
+      merged.erase(std::remove(merged.begin(), merged.end(), s), merged.end());
+      adj[u].swap(merged);
+      degree[u] = 0;
+      for (unsigned int b = 0; b < adj[u].size(); b++)
+        degree[u] += weight[adj[u][b]];
+      queue.insert(std::make_pair(degree[u], u));
+    }
+    std::vector<int>().swap(nb);
+  }
+
+  for (int i = 0; i < n; i++)
+    pinv[perm[i]] = i;
+}
+
+void LDLSolver::symbolic_factorization()
+{
+  _F_
+  int *Ap = m->get_Ap();
+  int *Ai = m->get_Ai();
+  int nnz = m->get_nnz();
+
+  // Upper triangle of the reordered matrix.
+  Cp.assign(n + 1, 0);
+  for (int j = 0; j < n; j++)
+    for (int p = Ap[j]; p < Ap[j + 1]; p++)
+      Cp[std::max(pinv[Ai[p]], pinv[j]) + 1]++;
+  for (int j = 0; j < n; j++)
+    Cp[j + 1] += Cp[j];
+  Ci.resize(nnz);
+  Cx.resize(nnz);
+  Cmap.resize(nnz);
+  std::vector<int> next(Cp.begin(), Cp.end() - 1);
+  for (int j = 0; j < n; j++)
+    for (int p = Ap[j]; p < Ap[j + 1]; p++) {
+      int r = pinv[Ai[p]], c = pinv[j];
+      if (r > c) std::swap(r, c);
+      Ci[next[c]] = r;
+      Cmap[p] = next[c]++;
+    }
+
+  // Elimination tree and the number of nonzeros in every column of L: the nonzeros of
+  // the row k of L are found by following the tree up from the nonzeros of the column k
+  // of the upper triangle, until a vertex already visited in the row k is reached.
+  parent.assign(n, -1);
+  std::vector<int> flag(n), lnz(n, 0);
+  for (int k = 0; k < n; k++) {
+    flag[k] = k;
+    for (int p = Cp[k]; p < Cp[k + 1]; p++)
+      for (int i = Ci[p]; i < k && flag[i] != k; i = parent[i]) {
+        if (parent[i] == -1) parent[i] = k;
+        lnz[i]++;
+        flag[i] = k;
+      }
+  }
+
+  Lp.resize(n + 1);
+  Lp[0] = 0;
+  for (int k = 0; k < n; k++)
+    Lp[k + 1] = Lp[k] + lnz[k];
+  Li.resize(Lp[n]);
+  Lx.resize(Lp[n]);
+  D.resize(n);
+}
+
+bool LDLSolver::numeric_factorization()
+{
+  _F_
+  scalar *Ax = m->get_Ax();
+  for (unsigned int p = 0; p < Cmap.size(); p++)
+    Cx[Cmap[p]] = Ax[p];
+
+  // Row k of L is obtained by a triangular solve with the rows already computed. The
+  // nonzeros of the row (the pattern) are visited in a topological order of the
+  // elimination tree, the entries of the row are appended to the columns of L.
+  // The growth of the row k is the sum of |L_ki^2 D_i|, which for a positive definite
+  // matrix is smaller than the diagonal entry A_kk (it is only checked for complex
+  // matrices, a real symmetric matrix is positive definite iff all pivots are positive).
+  std::vector<scalar> y(n, 0.0);
+  std::vector<int> pattern(n), flag(n), lnz(n);
+  for (int k = 0; k < n; k++) {
+    int top = n;
+    double amax = 0.0, growth = 0.0;
+    flag[k] = k;
+    lnz[k] = 0;
+    for (int p = Cp[k]; p < Cp[k + 1]; p++) {
+      int i = Ci[p], len = 0;
+      y[i] += Cx[p];
+      amax = std::max(amax, (double) std::abs(Cx[p]));
+      for (; flag[i] != k; i = parent[i]) {
+        pattern[len++] = i;
+        flag[i] = k;
+      }
+      while (len > 0) pattern[--top] = pattern[--len];
+    }
+
+    D[k] = y[k];
+    y[k] = 0.0;
+    for (; top < n; top++) {
+      int i = pattern[top];
+      scalar yi = y[i];
+      y[i] = 0.0;
+      int p2 = Lp[i] + lnz[i];
+      for (int p = Lp[i]; p < p2; p++)
+        y[Li[p]] -= Lx[p] * yi;
+      scalar l_ki = yi / D[i];
+      D[k] -= l_ki * yi;
+      growth += std::abs(l_ki * yi);
+      Li[p2] = k;
+      Lx[p2] = l_ki;
+      lnz[i]++;
+    }
+
+#ifdef HERMES_COMMON_COMPLEX
+    if (growth > LDL_MAX_GROWTH * amax || std::abs(D[k]) <= LDL_TINY_PIVOT * (growth + amax)) {
+      verbose("Unstable LDL^T factorization at unknown %d (pivot %g, growth %g).",
+              perm[k], (double) std::abs(D[k]), growth / amax);
+      return false;
+    }
+#else
+    if (D[k] <= 0.0) {
+      verbose("The matrix is not positive definite (pivot %g at unknown %d).", D[k], perm[k]);
+      return false;
+    }
+#endif
+  }
+
+  return true;
+}
+
+void LDLSolver::solve_factorized(scalar *x, scalar *work) const
+{
+  _F_
+  for (int k = 0; k < n; k++)
+    work[k] = x[perm[k]];
+
+  for (int j = 0; j < n; j++)
+    for (int p = Lp[j]; p < Lp[j + 1]; p++)
+      work[Li[p]] -= Lx[p] * work[j];
+  for (int j = 0; j < n; j++)
+    work[j] /= D[j];
+  for (int j = n - 1; j >= 0; j--)
+    for (int p = Lp[j]; p < Lp[j + 1]; p++)
+      work[j] -= Lx[p] * work[Li[p]];
+
+  for (int k = 0; k < n; k++)
+    x[perm[k]] = work[k];
+}
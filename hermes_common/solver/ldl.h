@@ -0,0 +1,134 @@
+// This file is part of Hermes
+//
+// Copyright (c) 2009 hp-FEM group at the University of Nevada, Reno (UNR).
+// Email: hpfem-group@unr.edu, home page: http://hpfem.org/.
+//
+// Hermes is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published
+// by the Free Software Foundation; either version 2 of the License,
+// or (at your option) any later version.
+//
+// Hermes is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Hermes; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+#ifndef __HERMES_COMMON_LDL_SOLVER_H_
+#define __HERMES_COMMON_LDL_SOLVER_H_
+
+#include "solver.h"
+#include "umfpack_solver.h"
+
+/// Symmetric matrix in the CSC format, only the upper triangle (row <= column) is stored.
+///
+/// Entries below the diagonal are dropped already in pre_add_ij() and in add(), i.e. the
+/// matrix is assembled as usual and the lower triangle is assumed to be the transpose of
+/// the upper one. The matrix is symmetric, not hermitian: in the complex case the lower
+/// triangle is not conjugated.
+class HERMES_API SymCSCMatrix : public SparseMatrix {
+public:
+  SymCSCMatrix();
+  virtual ~SymCSCMatrix();
+
+  virtual void pre_add_ij(unsigned int row, unsigned int col);
+  virtual void alloc();
+  virtual void alloc_from_pattern(SparsityPattern *pattern);
+  virtual void free();
+  virtual scalar get(unsigned int m, unsigned int n);
+  virtual void zero();
+  virtual void add(unsigned int m, unsigned int n, scalar v);
+  virtual void add_to_diagonal(scalar v);
+  virtual void add(unsigned int m, unsigned int n, scalar **mat, int *rows, int *cols);
+  virtual bool supports_concurrent_add() const { return true; }
+  /// Dumps the upper triangle and the commands restoring the full matrix.
+  virtual bool dump(FILE *file, const char *var_name, EMatrixDumpFormat fmt = DF_MATLAB_SPARSE);
+  virtual unsigned int get_matrix_size() const;
+  unsigned int get_nnz() { return nnz; }
+  /// Fill-in of the stored upper triangle.
+  virtual double get_fill_in() const;
+
+  virtual void multiply_with_vector(scalar* vector_in, scalar* vector_out);
+  virtual void multiply_with_scalar(scalar value);
+
+  int *get_Ap() { return Ap; }
+  int *get_Ai() { return Ai; }
+  scalar *get_Ax() { return Ax; }
+
+protected:
+  scalar *Ax;            // Entries of the upper triangle (column-wise).
+  int *Ai;               // Row indices of values in Ax, sorted in every column.
+  int *Ap;               // Index to Ax/Ai, where each column starts.
+  unsigned int nnz;      // Number of stored entries (= Ap[size]).
+};
+
+/// Sparse LDL^T factorization of symmetric matrices, needs no external library.
+///
+/// Solves systems with SymCSCMatrix (create the matrix and the vector with SOLVER_LDL).
+/// The unknowns are reordered by the minimum degree algorithm to reduce the fill-in,
+/// then the elimination tree and the nonzero structure of L are computed (symbolic
+/// factorization) and the matrix is factorized row by row (up-looking LDL^T). There is
+/// no pivoting, so the factorization is stable for symmetric positive definite matrices
+/// only. A real matrix is factorized only as long as the pivots are positive: at the first
+/// pivot which is not, the matrix is not positive definite, the factorization is abandoned
+/// and the system is solved by UMFPack (with pivoting) instead. For complex symmetric
+/// matrices, the growth of the factors is checked in every row instead, and the same
+/// happens if it is too large or if a pivot is (relatively) tiny. Without UMFPack,
+/// solve() returns false in these cases.
+///
+/// With HERMES_REUSE_MATRIX_REORDERING(_AND_SCALING), the ordering and the symbolic
+/// factorization of the previous solve are used (the matrix has to have the same sparsity
+/// pattern), with HERMES_REUSE_FACTORIZATION_COMPLETELY also the factors.
+///
+/// @ingroup solvers
+class HERMES_API LDLSolver : public LinearSolver {
+public:
+  LDLSolver(SymCSCMatrix *m, UMFPackVector *rhs);
+  virtual ~LDLSolver();
+
+  virtual bool solve();
+  virtual bool solve_multiple_rhs(int nrhs, const scalar* rhs_block, scalar* sln_block);
+
+  /// Returns the number of nonzeros of L (without the unit diagonal).
+  int get_factor_nnz() const { return Lp.empty() ? 0 : Lp.back(); }
+
+  /// Returns true if the last system was solved by UMFPack, the factorization not being stable.
+  bool is_unstable() const { return unstable; }
+
+protected:
+  SymCSCMatrix *m;
+  UMFPackVector *rhs;
+
+  int n;
+  bool symbolic_ready, numeric_ready;
+  /// The last numeric factorization was abandoned, the fallback solves the system.
+  bool unstable;
+
+  /// The full matrix and UMFPack used if the factorization is not stable.
+  UMFPackMatrix *fallback_matrix;
+  UMFPackLinearSolver *fallback_solver;
+
+  /// Ordering: perm[k] is the unknown eliminated as the k-th one, pinv its inverse.
+  std::vector<int> perm, pinv;
+  /// Upper triangle of the reordered matrix, Cmap[p] is the position of the p-th
+  /// entry of the matrix in Cx.
+  std::vector<int> Cp, Ci, Cmap;
+  std::vector<scalar> Cx;
+  /// Elimination tree and the factors: L by columns, the unit diagonal is not stored.
+  std::vector<int> parent, Lp, Li;
+  std::vector<scalar> Lx, D;
+
+  bool setup_factorization();
+  void minimum_degree_ordering();
+  void symbolic_factorization();
+  bool numeric_factorization();
+  /// Fills the fallback matrix (unless the factorization is reused) and sets up its solver.
+  bool setup_fallback(int fact_scheme);
+  /// Solves the system in place, x is in the original ordering, work has n entries.
+  void solve_factorized(scalar *x, scalar *work) const;
+};
+
+#endif
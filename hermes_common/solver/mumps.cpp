@@ -77,6 +77,7 @@ MumpsMatrix::MumpsMatrix()
   Ax = NULL;
   Ap = NULL;
   Ai = NULL;
+  pattern_positions = false;
 }
 
 MumpsMatrix::~MumpsMatrix()
@@ -122,10 +123,41 @@ void MumpsMatrix::alloc()
   }  
 }
 
+void MumpsMatrix::alloc_from_pattern(SparsityPattern *pattern)
+{
+  _F_
+  size = pattern->get_size();
+  nnz = pattern->get_nnz();
+
+  Ap = new unsigned int [size + 1];
+  MEM_CHECK(Ap);
+  int *pattern_Ap = pattern->get_Ap();
+  for (unsigned int i = 0; i <= size; i++)
+    Ap[i] = pattern_Ap[i];
+  Ai = new int [nnz];
+  MEM_CHECK(Ai);
+  memcpy(Ai, pattern->get_Ai(), sizeof(int) * nnz);
+
+  Ax = new mumps_scalar[nnz];
+  memset(Ax, 0, sizeof(mumps_scalar) * nnz);
+
+  // The indices of all entries are known, add_at_positions() does not set them.
+  irn = new int[nnz];
+  jcn = new int[nnz];
+  for (unsigned int j = 0; j < size; j++)
+    for (unsigned int i = Ap[j]; i < Ap[j + 1]; i++)
+    {
+      irn[i] = Ai[i] + 1;  // MUMPS is indexing from 1
+      jcn[i] = j + 1;
+    }
+  pattern_positions = true;
+}
+
 void MumpsMatrix::free()
 {
   _F_
   nnz = 0;
+  pattern_positions = false;
   delete[] Ap; Ap = NULL;
   delete[] Ai; Ai = NULL;
   delete[] Ax; Ax = NULL;
@@ -187,6 +219,22 @@ void MumpsMatrix::add(unsigned int m, unsigned int n, scalar **mat, int *rows, i
         add(rows[i], cols[j], mat[i][j]);
 }
 
+void MumpsMatrix::add_at_positions(unsigned int m, unsigned int n, scalar **mat, const int *pos)
+{
+  _F_
+  for (unsigned int i = 0; i < m; i++, pos += n)
+    for (unsigned int j = 0; j < n; j++)
+      if (pos[j] >= 0)
+      {
+#ifndef HERMES_COMMON_COMPLEX
+        Ax[pos[j]] += mat[i][j];
+#else
+        Ax[pos[j]].r += mat[i][j].real();
+        Ax[pos[j]].i += mat[i][j].imag();
+#endif
+      }
+}
+
 /// Add a number to each diagonal entry.
 void MumpsMatrix::add_to_diagonal(scalar v) 
 {
@@ -338,6 +386,7 @@ void MumpsMatrix::multiply_with_scalar(scalar value){
   // Creates matrix using size, nnz, and the three arrays.
 void MumpsMatrix::create(unsigned int size, unsigned int nnz, int* ap, int* ai, scalar* ax){
   this->nnz = nnz;
+  pattern_positions = false;
   this->size = size;
   this->Ap = new unsigned int[size+1]; assert(this->Ap != NULL);
   this->Ai = new int[nnz];    assert(this->Ai != NULL);
@@ -660,6 +709,62 @@ bool MumpsSolver::solve()
 #endif
 }
 
+bool MumpsSolver::solve_multiple_rhs(int nrhs, const scalar* rhs_block, scalar* sln_block)
+{
+  _F_
+#ifdef WITH_MUMPS
+  assert(m != NULL);
+
+  bool ret = false;
+
+  TimePeriod tmr;
+
+  // Prepare the MUMPS data structure with input for the solver driver 
+  // (according to the chosen factorization reuse strategy), as well as
+  // the system matrix.
+  if ( !setup_factorization() )
+  {
+    warning("LU factorization could not be completed.");
+    return false;
+  }
+  
+  // Specify the right-hand sides (will be replaced by the solutions), a centralized
+  // dense matrix with nrhs columns solved with one factorization.
+  param.rhs = new mumps_scalar[m->size * nrhs];
+  // (scalar and mumps_scalar have the same layout, see MumpsVector::extract())
+  memcpy(param.rhs, rhs_block, m->size * nrhs * sizeof(mumps_scalar));
+  param.nrhs = nrhs;
+  param.lrhs = m->size;
+  
+  // Do the jobs specified in setup_factorization().
+  MUMPS(&param);
+  
+  ret = check_status();
+
+  if (ret) 
+  {
+#ifndef HERMES_COMMON_COMPLEX
+    for (unsigned int i = 0; i < m->size * nrhs; i++)
+      sln_block[i] = param.rhs[i];
+#else
+    for (unsigned int i = 0; i < m->size * nrhs; i++)
+      sln_block[i] = cplx(param.rhs[i].r, param.rhs[i].i);
+#endif
+  }
+
+  tmr.tick();
+  time = tmr.accumulated();
+
+  delete [] param.rhs;
+  param.rhs = NULL;
+  param.nrhs = 1;
+
+  return ret;
+#else
+  return false;
+#endif
+}
+
 bool MumpsSolver::setup_factorization()
 {
   _F_
@@ -61,12 +61,16 @@ public:
   virtual ~MumpsMatrix();
 
   virtual void alloc();
+  virtual void alloc_from_pattern(SparsityPattern *pattern);
   virtual void free();
   virtual scalar get(unsigned int m, unsigned int n);
   virtual void zero();
   virtual void add(unsigned int m, unsigned int n, scalar v);
   virtual void add_to_diagonal(scalar v);
   virtual void add(unsigned int m, unsigned int n, scalar **mat, int *rows, int *cols);
+  virtual bool has_pattern_positions() const { return pattern_positions; }
+  virtual void add_at_positions(unsigned int m, unsigned int n, scalar **mat, const int *pos);
+  virtual bool supports_concurrent_add() const { return true; }
   virtual bool dump(FILE *file, const char *var_name, EMatrixDumpFormat fmt = DF_MATLAB_SPARSE);
   virtual unsigned int get_matrix_size() const;
   virtual unsigned int get_nnz() const;
@@ -92,6 +96,7 @@ protected:
   mumps_scalar *Ax; // Matrix entries (column-wise).
   int *Ai;          // Row indices of values in Ax.
   unsigned int *Ap;          // Index to Ax/Ai, where each column starts.
+  bool pattern_positions;    // Allocated by alloc_from_pattern().
 
   friend class MumpsSolver;
 };
@@ -115,6 +120,7 @@ public:
   virtual void set(unsigned int idx, scalar y);
   virtual void add(unsigned int idx, scalar y);
   virtual void add(unsigned int n, unsigned int *idx, scalar *y);
+  virtual bool supports_concurrent_add() const { return true; }
   virtual void add_vector(Vector* vec) {
     assert(this->length() == vec->length());
     for (unsigned int i = 0; i < this->length(); i++) this->add(i, vec->get(i));
@@ -141,6 +147,7 @@ public:
   virtual ~MumpsSolver();
 
   virtual bool solve();
+  virtual bool solve_multiple_rhs(int nrhs, const scalar* rhs_block, scalar* sln_block);
 
 protected:
   MumpsMatrix *m;
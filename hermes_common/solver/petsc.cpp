@@ -137,6 +137,26 @@ void PetscMatrix::alloc() {
 #endif
 }
 
+void PetscMatrix::alloc_from_pattern(SparsityPattern *pattern) {
+  _F_
+#ifdef WITH_PETSC
+  size = pattern->get_size();
+  nnz = pattern->get_nnz();
+
+  // Exact number of nonzeros in every row.
+  int *nnz_array = new int[size];
+  MEM_CHECK(nnz_array);
+  int *row_ptr = pattern->get_row_ptr();
+  for (unsigned int i = 0; i < size; i++)
+    nnz_array[i] = row_ptr[i + 1] - row_ptr[i];
+
+  MatCreateSeqAIJ(PETSC_COMM_SELF, size, size, 0, nnz_array, &matrix);
+  delete [] nnz_array;
+
+  inited = true;
+#endif
+}
+
 void PetscMatrix::free() {
   _F_
 #ifdef WITH_PETSC
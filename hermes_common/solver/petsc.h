@@ -38,6 +38,7 @@ public:
   virtual ~PetscMatrix();
 
   virtual void alloc();
+  virtual void alloc_from_pattern(SparsityPattern *pattern);
   virtual void free();
   virtual void finish();
   virtual scalar get(unsigned int m, unsigned int n);
@@ -100,6 +100,7 @@ public:
   virtual void set_factorization_scheme() {
     set_factorization_scheme(HERMES_REUSE_FACTORIZATION_COMPLETELY); 
   }
+  virtual FactorizationScheme get_factorization_scheme() const { return HERMES_FACTORIZE_FROM_SCRATCH; }
 
 protected:
   scalar *sln;
@@ -115,6 +116,21 @@ class LinearSolver : public Solver
   public:
     LinearSolver(unsigned int factorization_scheme = HERMES_FACTORIZE_FROM_SCRATCH) 
       : Solver(), factorization_scheme(factorization_scheme) {};
+
+    virtual FactorizationScheme get_factorization_scheme() const {
+      return (FactorizationScheme) factorization_scheme;
+    }
+
+    /// Solves the system for nrhs right-hand sides with one factorization of the matrix
+    /// (factorized according to the factorization scheme, like in solve()). The right-hand
+    /// sides are stored column by column in rhs_block, i.e. the k-th one starts at
+    /// rhs_block + k * n, where n is the size of the matrix. The solutions are stored
+    /// in sln_block in the same way, get_solution() is not changed.
+    /// Supported by UMFPack, SuperLU, MUMPS and LDLSolver.
+    virtual bool solve_multiple_rhs(int nrhs, const scalar* rhs_block, scalar* sln_block) {
+      warning("This solver does not support multiple right-hand sides.");
+      return false;
+    }
     
   protected:
     virtual void set_factorization_scheme(FactorizationScheme reuse_scheme) { 
@@ -58,6 +58,7 @@ SuperLUMatrix::SuperLUMatrix()
   Ax = NULL;
   Ap = NULL;
   Ai = NULL;
+  pattern_positions = false;
 }
 
 SuperLUMatrix::~SuperLUMatrix()
@@ -95,10 +96,31 @@ void SuperLUMatrix::alloc()
   memset(Ax, 0, sizeof(slu_scalar) * nnz);
 }
 
+void SuperLUMatrix::alloc_from_pattern(SparsityPattern *pattern)
+{
+  _F_
+  size = pattern->get_size();
+  nnz = pattern->get_nnz();
+
+  Ap = new unsigned int [size + 1];
+  MEM_CHECK(Ap);
+  int *pattern_Ap = pattern->get_Ap();
+  for (unsigned int i = 0; i <= size; i++)
+    Ap[i] = pattern_Ap[i];
+  Ai = new int [nnz];
+  MEM_CHECK(Ai);
+  memcpy(Ai, pattern->get_Ai(), sizeof(int) * nnz);
+
+  Ax = new slu_scalar [nnz];
+  memset(Ax, 0, sizeof(slu_scalar) * nnz);
+  pattern_positions = true;
+}
+
 void SuperLUMatrix::free()
 {
   _F_
   nnz = 0;
+  pattern_positions = false;
   delete [] Ap; Ap = NULL;
   delete [] Ai; Ai = NULL;
   delete [] Ax; Ax = NULL;
@@ -165,6 +187,22 @@ void SuperLUMatrix::add(unsigned int m, unsigned int n, scalar **mat, int *rows,
         add(rows[i], cols[j], mat[i][j]);
 }
 
+void SuperLUMatrix::add_at_positions(unsigned int m, unsigned int n, scalar **mat, const int *pos)
+{
+  _F_
+  for (unsigned int i = 0; i < m; i++, pos += n)
+    for (unsigned int j = 0; j < n; j++)
+      if (pos[j] >= 0)
+      {
+#ifndef HERMES_COMMON_COMPLEX
+        Ax[pos[j]] += mat[i][j];
+#else
+        Ax[pos[j]].r += mat[i][j].real();
+        Ax[pos[j]].i += mat[i][j].imag();
+#endif
+      }
+}
+
 /// Save matrix and right-hand side to a file.
 ///
 bool SuperLUMatrix::dump(FILE *file, const char *var_name, EMatrixDumpFormat fmt)
@@ -302,6 +340,7 @@ void SuperLUMatrix::multiply_with_scalar(scalar value){
 void SuperLUMatrix::create(unsigned int size, unsigned int nnz, int* ap, int* ai, scalar* ax){
   _F_
   this->nnz = nnz;
+  pattern_positions = false;
   this->size = size;
   this->Ap = new unsigned int[size+1]; assert(this->Ap != NULL);
   this->Ai = new int[nnz];    assert(this->Ai != NULL);
@@ -742,6 +781,183 @@ bool SuperLUSolver::solve()
 #endif
 }
 
+bool SuperLUSolver::solve_multiple_rhs(int nrhs, const scalar* rhs_block, scalar* sln_block)
+{
+  _F_
+#ifdef WITH_SUPERLU
+  assert(m != NULL);
+
+  TimePeriod tmr;
+  
+  // Initialize the statistics variable.
+  slu_stat_t stat;
+  SLU_INIT_STAT(&stat);
+  
+  // Prepare data structures serving as input for the solver driver 
+  // (according to the chosen factorization reuse strategy).
+  void *work = NULL;        // Explicit pointer to the factorization workspace 
+                            // (unused, see below).
+  int lwork = 0;            // Space for the factorization will be allocated 
+                            // internally by system malloc.
+  std::vector<double> ferr(nrhs, 1.0);  // Estimated relative forward errors 
+                                        // (unused unless iterative refinement is performed).
+  std::vector<double> berr(nrhs, 1.0);  // Estimated relative backward errors 
+                                        // (unused unless iterative refinement is performed).
+  slu_memusage_t memusage;  // Record the memory usage statistics.
+  double rpivot_growth;     // The reciprocal pivot growth factor.
+  double rcond;             // The estimate of the reciprocal condition number.                          
+#ifdef SLU_MT
+  options.work = work;
+  options.lwork = lwork;
+#endif
+
+  if ( !setup_factorization() )
+  {
+    warning("LU factorization could not be completed.");
+    return false;
+  }
+  
+  // If the previous factorization of A is to be fully reused as an input for the solver driver,
+  // keep the (possibly rescaled) matrix from the last factorization, otherwise recreate it 
+  // from the master SuperLUMatrix pointed to by this->m (this also applies to the case when 
+  // A does not yet exist).
+  if (!has_A || factorization_scheme != HERMES_REUSE_FACTORIZATION_COMPLETELY)
+  {
+    if (A_changed) 
+      free_matrix();
+    
+    if (!has_A)
+    {
+      // A will be created from the local copy of the value and index arrays, because these
+      // may be modified by the solver driver.
+      if (local_Ai) delete [] local_Ai;
+      local_Ai = new int [m->nnz];
+      memcpy(local_Ai, m->Ai, m->nnz * sizeof(int));
+      
+      if (local_Ap) delete [] local_Ap;
+      local_Ap = new int [m->size+1];
+      memcpy(local_Ap, m->Ap, (m->size+1) * sizeof(int));
+      
+      if (local_Ax) delete [] local_Ax;
+      local_Ax = new slu_scalar [m->nnz];
+      memcpy(local_Ax, m->Ax, m->nnz * sizeof(slu_scalar));
+      
+      // Create new general (non-symmetric), column-major, non-supernodal, size X size matrix.
+      SLU_CREATE_CSC_MATRIX(&A, m->size, m->size, m->nnz, local_Ax, local_Ai, local_Ap, SLU_NC, SLU_DTYPE, SLU_GE);
+      
+      has_A = true;
+    }
+  }
+
+  // Recreate the input rhs for the solver driver from a local copy of the new value array.
+  // The right-hand sides are the nrhs columns of B, all solved with one factorization.
+  free_rhs();
+ 
+  if (local_rhs) delete [] local_rhs;
+  local_rhs = new slu_scalar [m->size * nrhs];
+  // (scalar and slu_scalar have the same layout, see SuperLUVector::extract())
+  memcpy(local_rhs, rhs_block, m->size * nrhs * sizeof(slu_scalar));
+  
+  SLU_CREATE_DENSE_MATRIX(&B, m->size, nrhs, local_rhs, m->size, SLU_DN, SLU_DTYPE, SLU_GE);
+  
+  has_B = true;
+  
+  // Initialize the solution variable.
+  SuperMatrix X;
+  slu_scalar *x;
+  if ( !(x = SLU_SCALAR_MALLOC(m->size * nrhs)) ) 
+    error("Malloc fails for x[].");
+  SLU_CREATE_DENSE_MATRIX(&X, m->size, nrhs, x, m->size, SLU_DN, SLU_DTYPE, SLU_GE);
+    
+  // Solve the system.
+  int info;
+
+#ifdef SLU_MT  
+  if (options.refact == NO)
+  {
+    // Get column permutation vector perm_c[], according to the first argument:
+    //  0: natural ordering 
+    //  1: minimum degree ordering on structure of A'*A
+    //  2: minimum degree ordering on structure of A'+A
+    //  3: approximate minimum degree for unsymmetric matrices   
+    get_perm_c(1, &A, perm_c);
+  }
+   
+/*
+  // Compute reciprocal pivot growth, estimate reciprocal condition number of A, solve,
+  // perform iterative refinement of the solution and estimate forward and backward error.
+  // Memory usage will be acquired at the end. If A is singular, info will be set to A->ncol+1.
+  //
+  slu_mt_solver_driver( &options, &A, perm_c, perm_r, &AC, &equed, R, C,
+                        &L, &U, &B, &X, &rpivot_growth, &rcond, &ferr.front(), &berr.front(), 
+                        &stat, &memusage, &info );
+*/
+                        
+  // ... OR ...
+  
+  // Estimate reciprocal condition number of A and solve the system. If A is singular, info
+  // will be set to A->ncol+1.
+  //
+  slu_mt_solver_driver( &options, &A, perm_c, perm_r, &AC, &equed, R, C,
+                        &L, &U, &B, &X, NULL, &rcond, NULL, NULL, 
+                        &stat, NULL, &info );
+
+  // ... OR ...
+
+/*  
+  // Do not check the regularity of A and just solve the system.
+  //
+  slu_mt_solver_driver( &options, &A, perm_c, perm_r, &AC, &equed, R, C,
+                        &L, &U, &B, &X, NULL, NULL, NULL, NULL, 
+                        &stat, NULL, &info );                        
+*/
+#else
+  SLU_SOLVER_DRIVER(&options, &A, perm_c, perm_r, etree, equed, R, C, &L, &U,
+                    work, lwork, &B, &X, &rpivot_growth, &rcond, &ferr.front(), &berr.front(),
+                    &memusage, &stat, &info);
+#endif
+                    
+  // A and B may have been multiplied by the scaling vectors R and C on the output of the 
+  // solver. If the next call to the solver should reuse factorization only partially,
+  // it will need the original unscaled matrix - this will indicate such situation 
+  // (rhs is always recreated anew).
+#ifdef SLU_MT  
+  A_changed = (equed != NOEQUIL);
+#else
+  A_changed = (*equed != 'N');
+#endif  
+
+  bool factorized = check_status(info);
+  
+  if (factorized) 
+  {
+    slu_scalar *sol = (slu_scalar*) ((DNformat*) X.Store)->nzval; 
+    
+    for (unsigned int i = 0; i < m->size * nrhs; i++)
+#ifndef HERMES_COMMON_COMPLEX      
+      sln_block[i] = sol[i];
+#else
+      sln_block[i] = cplx(sol[i].r, sol[i].i);
+#endif
+  }
+  
+  // If required, print statistics.
+  if ( options.PrintStat ) SLU_PRINT_STAT(&stat);
+  
+  // Free temporary local variables.
+  StatFree(&stat);
+  SUPERLU_FREE (x);
+  Destroy_SuperMatrix_Store(&X);
+  
+  tmr.tick();
+  time = tmr.accumulated();
+  
+  return factorized;
+#else
+  return false;
+#endif
+}
+
 bool SuperLUSolver::setup_factorization()
 {
   _F_
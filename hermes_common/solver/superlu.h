@@ -140,12 +140,16 @@ public:
   virtual ~SuperLUMatrix();
 
   virtual void alloc();
+  virtual void alloc_from_pattern(SparsityPattern *pattern);
   virtual void free();
   virtual scalar get(unsigned int m, unsigned int n);
   virtual void zero();
   virtual void add(unsigned int m, unsigned int n, scalar v);
   virtual void add_to_diagonal(scalar v);
   virtual void add(unsigned int m, unsigned int n, scalar **mat, int *rows, int *cols);
+  virtual bool has_pattern_positions() const { return pattern_positions; }
+  virtual void add_at_positions(unsigned int m, unsigned int n, scalar **mat, const int *pos);
+  virtual bool supports_concurrent_add() const { return true; }
   virtual bool dump(FILE *file, const char *var_name, EMatrixDumpFormat fmt = DF_MATLAB_SPARSE);
   virtual unsigned int get_matrix_size() const;
   virtual unsigned int get_nnz() const;
@@ -169,6 +173,7 @@ protected:
   int *Ai;        // Row indices of values in Ax.
   unsigned int *Ap;        // Index to Ax/Ai, where each column starts.
   unsigned int nnz;        // Number of non-zero entries (= Ap[size]).
+  bool pattern_positions;  // Allocated by alloc_from_pattern().
   
   friend class SuperLUSolver;
 };
@@ -192,6 +197,7 @@ public:
   virtual void set(unsigned int idx, scalar y);
   virtual void add(unsigned int idx, scalar y);
   virtual void add(unsigned int n, unsigned int *idx, scalar *y);
+  virtual bool supports_concurrent_add() const { return true; }
   virtual void add_vector(Vector* vec) {
     assert(this->length() == vec->length());
     for (unsigned int i = 0; i < this->length(); i++) this->add(i, vec->get(i));
@@ -218,6 +224,7 @@ public:
   virtual ~SuperLUSolver();
 
   virtual bool solve();
+  virtual bool solve_multiple_rhs(int nrhs, const scalar* rhs_block, scalar* sln_block);
   
 protected:
   SuperLUMatrix *m;       
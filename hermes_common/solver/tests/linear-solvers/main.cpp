@@ -8,12 +8,14 @@
 
 #include "solver/solver.h"
 #include "solver/umfpack_solver.h"
+#include "solver/ldl.h"
 #include "solver/superlu.h"
 #include "solver/petsc.h"
 #include "solver/epetra.h"
 #include "solver/amesos.h"
 #include "solver/aztecoo.h"
 #include "solver/mumps.h"
+#include "solver/krylov.h"
 
 #include <iostream>
 
@@ -303,6 +305,37 @@ void solve(Solver &solver, int n) {
   }
 }
 
+// Solves for the right-hand side and two of its multiples at once. The first solution
+// is printed, the other two have to be its multiples.
+void solve_multiple_rhs(LinearSolver &solver, Vector *rhs, int n) {
+  const int nrhs = 3;
+  const double factors[nrhs] = { 1.0, 2.0, -0.5 };
+  scalar *rhs_block = new scalar[nrhs * n];
+  scalar *sln_block = new scalar[nrhs * n];
+  for (int k = 0; k < nrhs; k++)
+    for (int i = 0; i < n; i++)
+      rhs_block[k * n + i] = factors[k] * rhs->get(i);
+
+  if (solver.solve_multiple_rhs(nrhs, rhs_block, sln_block)) {
+    bool consistent = true;
+    for (int k = 1; k < nrhs; k++)
+      for (int i = 0; i < n; i++)
+        if (std::abs(sln_block[k * n + i] - factors[k] * sln_block[i]) > 1e-10 * (1.0 + std::abs(sln_block[i])))
+          consistent = false;
+    if (consistent)
+      for (int i = 0; i < n; i++)
+        printf(SCALAR_FMT"\n", SCALAR(sln_block[i]));
+    else
+      printf("Inconsistent solutions for multiple right-hand sides.\n");
+  }
+  else {
+    printf("Unable to solve.\n");
+  }
+
+  delete [] rhs_block;
+  delete [] sln_block;
+}
+
 int main(int argc, char *argv[]) {
   int ret = ERR_SUCCESS;
 
@@ -369,6 +402,26 @@ int main(int argc, char *argv[]) {
 
     UMFPackLinearSolver solver(&mat, &rhs);
     solve(solver, n);
+#endif
+  }
+  else if (strcasecmp(argv[1], "umfpack-multi") == 0) {
+#ifdef WITH_UMFPACK
+    UMFPackMatrix mat;
+    UMFPackVector rhs;
+    build_matrix(n, ar_mat, ar_rhs, &mat, &rhs);
+
+    UMFPackLinearSolver solver(&mat, &rhs);
+    solve_multiple_rhs(solver, &rhs, n);
+#endif
+  }
+  else if (strcasecmp(argv[1], "superlu-multi") == 0) {
+#ifdef WITH_SUPERLU
+    SuperLUMatrix mat;
+    SuperLUVector rhs;
+    build_matrix(n, ar_mat, ar_rhs, &mat, &rhs);
+
+    SuperLUSolver solver(&mat, &rhs);
+    solve_multiple_rhs(solver, &rhs, n);
 #endif
   }
   else if (strcasecmp(argv[1], "aztecoo") == 0) {
@@ -435,6 +488,69 @@ int main(int argc, char *argv[]) {
     solve(solver, n);
 #endif
   }  
+  else if (strcasecmp(argv[1], "mumps-multi") == 0) {
+#ifdef WITH_MUMPS
+    MumpsMatrix mat;
+    MumpsVector rhs;
+    build_matrix(n, ar_mat, ar_rhs, &mat, &rhs);
+
+    MumpsSolver solver(&mat, &rhs);
+    solve_multiple_rhs(solver, &rhs, n);
+#endif
+  }
+  else if (strcasecmp(argv[1], "krylov") == 0) {
+    CSCMatrix mat;
+    UMFPackVector rhs;
+    build_matrix(n, ar_mat, ar_rhs, &mat, &rhs);
+
+    KrylovSolver solver(&mat, &rhs);
+    solver.set_tolerance(1e-12);
+    solve(solver, n);
+  }
+  else if (strcasecmp(argv[1], "krylov-block") == 0) {
+    CSCMatrix mat;
+    UMFPackVector rhs;
+    build_matrix_block(n, ar_mat, ar_rhs, &mat, &rhs);
+
+    KrylovSolver solver(&mat, &rhs);
+    solver.set_tolerance(1e-12);
+    solve(solver, n);
+  }
+  else if (strcasecmp(argv[1], "krylov-bicgstab") == 0) {
+    CSCMatrix mat;
+    UMFPackVector rhs;
+    build_matrix(n, ar_mat, ar_rhs, &mat, &rhs);
+
+    KrylovSolver solver(&mat, &rhs);
+    solver.set_solver("bicgstab");
+    solver.set_precond("ilu0");
+    solver.set_tolerance(1e-12);
+    solve(solver, n);
+  }
+  else if (strcasecmp(argv[1], "ldl") == 0) {
+    SymCSCMatrix mat;
+    UMFPackVector rhs;
+    build_matrix(n, ar_mat, ar_rhs, &mat, &rhs);
+
+    LDLSolver solver(&mat, &rhs);
+    solve(solver, n);
+  }
+  else if (strcasecmp(argv[1], "ldl-block") == 0) {
+    SymCSCMatrix mat;
+    UMFPackVector rhs;
+    build_matrix_block(n, ar_mat, ar_rhs, &mat, &rhs);
+
+    LDLSolver solver(&mat, &rhs);
+    solve(solver, n);
+  }
+  else if (strcasecmp(argv[1], "ldl-multi") == 0) {
+    SymCSCMatrix mat;
+    UMFPackVector rhs;
+    build_matrix(n, ar_mat, ar_rhs, &mat, &rhs);
+
+    LDLSolver solver(&mat, &rhs);
+    solve_multiple_rhs(solver, &rhs, n);
+  }
   else
     ret = ERR_FAILURE;
 
@@ -27,6 +27,7 @@
   }
 #endif
 
+#include <algorithm>
 #include "../trace.h"
 #include "../error.h"
 #include "../utils.h"
@@ -65,11 +66,13 @@ CSCMatrix::CSCMatrix() {
   Ap = NULL;
   Ai = NULL;
   Ax = NULL;
+  pattern_positions = false;
 }
 
 CSCMatrix::CSCMatrix(unsigned int size) {
   _F_
   this->size = size;
+  pattern_positions = false;
   this->alloc();
 }
 
@@ -84,7 +87,7 @@ void CSCMatrix::multiply_with_vector(scalar* vector_in, scalar* vector_out)
   for (int j=0; j<n; j++) vector_out[j] = 0;
   for (int j=0; j<n; j++) {
     for (int i = Ap[j]; i < Ap[j + 1]; i++) {
-      vector_out[j] += vector_in[Ai[i]]*Ax[i];
+      vector_out[Ai[i]] += Ax[i]*vector_in[j];
     }
   }
 }
@@ -124,9 +127,28 @@ void CSCMatrix::alloc() {
   memset(Ax, 0, sizeof(scalar) * nnz);
 }
 
+void CSCMatrix::alloc_from_pattern(SparsityPattern *pattern) {
+  _F_
+  size = pattern->get_size();
+  nnz = pattern->get_nnz();
+
+  Ap = new int [size + 1];
+  MEM_CHECK(Ap);
+  memcpy(Ap, pattern->get_Ap(), sizeof(int) * (size + 1));
+  Ai = new int [nnz];
+  MEM_CHECK(Ai);
+  memcpy(Ai, pattern->get_Ai(), sizeof(int) * nnz);
+
+  Ax = new scalar [nnz];
+  MEM_CHECK(Ax);
+  memset(Ax, 0, sizeof(scalar) * nnz);
+  pattern_positions = true;
+}
+
 void CSCMatrix::free() {
   _F_
   nnz = 0;
+  pattern_positions = false;
   if (Ap != NULL) {delete [] Ap; Ap = NULL;}
   if (Ai != NULL) {delete [] Ai; Ai = NULL;}
   if (Ax != NULL) {delete [] Ax; Ax = NULL;}
@@ -178,29 +200,26 @@ void CSCMatrix::add_to_diagonal_blocks(int num_stages, CSCMatrix* mat_block)
   }
 }
 
-void CSCMatrix::add_as_block(unsigned int offset_i, unsigned int offset_j, CSCMatrix* mat)
+void CSCMatrix::add_as_block(unsigned int offset_i, unsigned int offset_j, CSCMatrix* mat, scalar coeff)
 {
-  UMFPackIterator mat_it(mat);
-  UMFPackIterator this_it(this);
-
-  // Sanity check.
-  bool this_not_empty = this_it.init();
-  if (!this_not_empty) error("Empty matrix detected in CSCMatrix::add_as_block().");
-
-  // Iterate through the small matrix column by column and add all nonzeros 
-  // to the large one.
-  bool mat_not_finished = mat_it.init();
-  if (!mat_not_finished) error("Empty matrix detected in CSCMatrix::add_as_block().");
-  
-  int mat_i, mat_j;
-  scalar mat_val;
-  while(mat_not_finished) {
-    mat_it.get_current_position(mat_i, mat_j, mat_val);
-    bool found = this_it.move_to_position(mat_i + offset_i, mat_j + offset_j);
-    if (!found) error ("Nonzero matrix entry at %d, %d not found in CSCMatrix::add_as_block().", 
-                       mat_i + offset_i, mat_j + offset_j);
-    this_it.add_to_current_position(mat_val);
-    mat_not_finished = mat_it.move_ptr();
+  _F_
+  if (offset_i + mat->get_size() > this->size || offset_j + mat->get_size() > this->size)
+    error("Block does not fit into the matrix in CSCMatrix::add_as_block().");
+
+  // Row indices are sorted in both matrices, so every column of the block
+  // is matched with the corresponding column of this matrix in one pass.
+  for (unsigned int col = 0; col < mat->size; col++) {
+    if (mat->Ap[col] == mat->Ap[col + 1]) continue;
+    int *col_end = Ai + Ap[col + offset_j + 1];
+    int *pos = std::lower_bound(Ai + Ap[col + offset_j], col_end, (int) (mat->Ai[mat->Ap[col]] + offset_i));
+    for (int k = mat->Ap[col]; k < mat->Ap[col + 1]; k++) {
+      int row = mat->Ai[k] + offset_i;
+      while (pos < col_end && *pos < row) pos++;
+      if (pos == col_end || *pos != row)
+        error("Nonzero matrix entry at %d, %d not found in CSCMatrix::add_as_block().", 
+              row, col + offset_j);
+      Ax[pos - Ai] += coeff * mat->Ax[k];
+    }
   }
 }
 
@@ -255,6 +274,14 @@ void CSCMatrix::add(unsigned int m, unsigned int n, scalar **mat, int *rows, int
         add(rows[i], cols[j], mat[i][j]);
 }
 
+void CSCMatrix::add_at_positions(unsigned int m, unsigned int n, scalar **mat, const int *pos) {
+  _F_
+  for (unsigned int i = 0; i < m; i++, pos += n)
+    for (unsigned int j = 0; j < n; j++)
+      if (pos[j] >= 0)
+        Ax[pos[j]] += mat[i][j];
+}
+
 /// dumping matrix and right-hand side
 ///
 bool CSCMatrix::dump(FILE *file, const char *var_name, EMatrixDumpFormat fmt) {
@@ -377,6 +404,7 @@ void CSCMatrix::create(unsigned int size, unsigned int nnz, int* ap, int* ai, sc
 {
   _F_
   this->nnz = nnz;
+  pattern_positions = false;
   this->size = size;
   this->Ap = new int[size+1]; assert(this->Ap != NULL);
   this->Ai = new int[nnz];    assert(this->Ai != NULL);
@@ -506,6 +534,10 @@ bool UMFPackVector::dump(FILE *file, const char *var_name, EMatrixDumpFormat fmt
   #define umfpack_symbolic(m, n, Ap, Ai, Ax, S, C, I)   umfpack_di_symbolic(m, n, Ap, Ai, Ax, S, C, I)
   #define umfpack_numeric(Ap, Ai, Ax, S, N, C, I)       umfpack_di_numeric(Ap, Ai, Ax, S, N, C, I)
   #define umfpack_solve(sys, Ap, Ai, Ax, X, B, N, C, I) umfpack_di_solve(sys, Ap, Ai, Ax, X, B, N, C, I)
+  #define umfpack_wsolve(sys, Ap, Ai, Ax, X, B, N, C, I, Wi, W) \
+                                                        umfpack_di_wsolve(sys, Ap, Ai, Ax, X, B, N, C, I, Wi, W)
+  // Size of the workspace W of umfpack_wsolve() in multiples of the size of the matrix.
+  #define UMFPACK_WSOLVE_W_SIZE                         5
   #define umfpack_free_symbolic                         umfpack_di_free_symbolic
   #define umfpack_free_numeric                          umfpack_di_free_numeric
   #define umfpack_defaults                              umfpack_di_defaults
@@ -514,6 +546,9 @@ bool UMFPackVector::dump(FILE *file, const char *var_name, EMatrixDumpFormat fmt
   #define umfpack_symbolic(m, n, Ap, Ai, Ax, S, C, I)   umfpack_zi_symbolic(m, n, Ap, Ai, (double *) (Ax), NULL, S, C, I)
   #define umfpack_numeric(Ap, Ai, Ax, S, N, C, I)       umfpack_zi_numeric(Ap, Ai, (double *) (Ax), NULL, S, N, C, I)
   #define umfpack_solve(sys, Ap, Ai, Ax, X, B, N, C, I) umfpack_zi_solve(sys, Ap, Ai, (double *) (Ax), NULL, (double *) (X), NULL, (double *) (B), NULL, N, C, I)
+  #define umfpack_wsolve(sys, Ap, Ai, Ax, X, B, N, C, I, Wi, W) \
+    umfpack_zi_wsolve(sys, Ap, Ai, (double *) (Ax), NULL, (double *) (X), NULL, (const double *) (B), NULL, N, C, I, Wi, W)
+  #define UMFPACK_WSOLVE_W_SIZE                         10
   #define umfpack_free_symbolic                         umfpack_di_free_symbolic
   #define umfpack_free_numeric                          umfpack_zi_free_numeric
   #define umfpack_defaults                              umfpack_zi_defaults
@@ -597,6 +632,50 @@ bool UMFPackLinearSolver::solve() {
 #endif
 }
 
+bool UMFPackLinearSolver::solve_multiple_rhs(int nrhs, const scalar* rhs_block, scalar* sln_block)
+{
+  _F_
+#ifdef WITH_UMFPACK
+  assert(m != NULL);
+
+  TimePeriod tmr;
+
+  if ( !setup_factorization() )
+  {
+    warning("LU factorization could not be completed.");
+    return false;
+  }
+
+  // UMFPack has no multiple right-hand side mode, the triangular solves are done one by one
+  // with the same numeric factorization and with one workspace for all of them.
+  int n = m->size;
+  int *Wi = new int[n];
+  double *W = new double[UMFPACK_WSOLVE_W_SIZE * n];
+  MEM_CHECK(Wi);
+  MEM_CHECK(W);
+
+  bool ret = true;
+  for (int k = 0; k < nrhs && ret; k++) {
+    int status = umfpack_wsolve(UMFPACK_A, m->Ap, m->Ai, m->Ax, sln_block + k * n, rhs_block + k * n,
+                                numeric, NULL, NULL, Wi, W);
+    if (status != UMFPACK_OK) {
+      check_status("umfpack_di_wsolve", status);
+      ret = false;
+    }
+  }
+
+  delete [] Wi;
+  delete [] W;
+
+  tmr.tick();
+  time = tmr.accumulated();
+
+  return ret;
+#else
+  return false;
+#endif
+}
+
 bool UMFPackLinearSolver::setup_factorization()
 {
   _F_
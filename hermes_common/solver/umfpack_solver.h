@@ -33,6 +33,7 @@ public:
   virtual ~CSCMatrix();
 
   virtual void alloc();
+  virtual void alloc_from_pattern(SparsityPattern *pattern);
   virtual void free();
   virtual scalar get(unsigned int m, unsigned int n);
   virtual void zero();
@@ -43,8 +44,13 @@ public:
   // TODO: implement this for other matrix types.
   virtual void add_to_diagonal_blocks(int num_stages, CSCMatrix* mat);
   // TODO: implement this for other matrix types.
-  virtual void add_as_block(unsigned int i, unsigned int j, CSCMatrix* mat);
+  /// Adds coeff * mat to the block of this matrix whose upper left corner is at
+  /// the position (i, j). All nonzeros of mat must exist in this matrix.
+  virtual void add_as_block(unsigned int i, unsigned int j, CSCMatrix* mat, scalar coeff = 1.0);
   virtual void add(unsigned int m, unsigned int n, scalar **mat, int *rows, int *cols);
+  virtual bool has_pattern_positions() const { return pattern_positions; }
+  virtual void add_at_positions(unsigned int m, unsigned int n, scalar **mat, const int *pos);
+  virtual bool supports_concurrent_add() const { return true; }
   virtual bool dump(FILE *file, const char *var_name, EMatrixDumpFormat fmt = DF_MATLAB_SPARSE);
   virtual unsigned int get_matrix_size() const;
   unsigned int get_nnz() {return this->nnz;}
@@ -75,6 +81,7 @@ protected:
   int *Ai;               // Row indices of values in Ax.
   int *Ap;               // Index to Ax/Ai, where each column starts.
   unsigned int nnz;      // Number of non-zero entries (= Ap[size]).
+  bool pattern_positions; // Allocated by alloc_from_pattern().
 
 };
 
@@ -98,6 +105,7 @@ public:
   virtual void set(unsigned int idx, scalar y);
   virtual void add(unsigned int idx, scalar y);
   virtual void add(unsigned int n, unsigned int *idx, scalar *y);
+  virtual bool supports_concurrent_add() const { return true; }
   virtual void add_vector(Vector* vec) {
     assert(this->length() == vec->length());
     for (unsigned int i = 0; i < this->length(); i++) this->v[i] += vec->get(i);
@@ -127,6 +135,7 @@ public:
   virtual ~UMFPackLinearSolver();
 
   virtual bool solve();
+  virtual bool solve_multiple_rhs(int nrhs, const scalar* rhs_block, scalar* sln_block);
     
 protected:
   UMFPackMatrix *m;